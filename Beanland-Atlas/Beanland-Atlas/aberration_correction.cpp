@@ -21,28 +21,33 @@ namespace ba
 		//super-necessary here as the mean of the laplacians is expected to be near zero...
 		float mean = cv::mean(lap, mask)[0];
 
-		//Calculate the variance of the Laplacian filtrate at the marked locations
-		float sum_sqr_diff = 0.0f;
-		int num_mask_px = 0;
-		float *p;
-		byte *b;
-        #pragma omp parallel for reduction(sum:sum_sqr_diff), reduction(sum:num_mask_px)
-		for (int i = 0; i < img.rows; i++)
+		//Calculate the variance of the Laplacian filtrate at the marked locations. Rows are reduced in chunks
+		std::pair<float, int> sums = parallel_reduce<std::pair<float, int>>(0, img.rows, std::make_pair(0.0f, 0), 
+			[&](int start, int stop)
 		{
-			p = lap.ptr<float>(i);
-			b = mask.ptr<byte>(i);
-			for (int j = 0; j < img.cols; j++)
+			float sum_sqr_diff = 0.0f;
+			int num_mask_px = 0;
+			for (int i = start; i < stop; i++)
 			{
-				//Check if the pixel is marked for calculation on the mask
-				if (b[j])
+				float *p = lap.ptr<float>(i);
+				byte *b = mask.ptr<byte>(i);
+				for (int j = 0; j < img.cols; j++)
 				{
-					sum_sqr_diff += (p[j] - mean)*(p[j] - mean);
-					num_mask_px++;
+					//Check if the pixel is marked for calculation on the mask
+					if (b[j])
+					{
+						sum_sqr_diff += (p[j] - mean)*(p[j] - mean);
+						num_mask_px++;
+					}
 				}
 			}
-		}
+			return std::make_pair(sum_sqr_diff, num_mask_px);
+		}, [](const std::pair<float, int> &a, const std::pair<float, int> &b)
+		{
+			return std::make_pair(a.first + b.first, a.second + b.second);
+		});
 
-		return sum_sqr_diff / (num_mask_px - 1);
+		return sums.first / (sums.second - 1);
 	}
 
 	/*Use cluster analysis to label the high intensity pixels and produce a mask where their positions are marked. These positions
@@ -114,16 +119,14 @@ namespace ba
 			if (img.cols > 1)
 			{
 				img1D= cv::Mat(img.rows*img.cols, 1, CV_32FC1);
-				float *p;
-                #pragma omp parallel for
-				for( int y = 0; y < img.rows; y++ )
+				parallel_for(0, img.rows, [&](int y)
 				{
-					p = img.ptr<float>(y);
+					float *p = img.ptr<float>(y);
 					for( int x = 0; x < img.cols; x++ )
 					{ 
 						img1D.at<float>(y + x*img.rows) = p[x];
 					}
-				}
+				});
 			}
 			else
 			{
@@ -157,16 +160,14 @@ namespace ba
 			}
 
 			//Construct the mask
-			byte *b;
-            #pragma omp parallel for
-			for( int y = 0; y < img.rows; y++ )
+			parallel_for(0, img.rows, [&](int y)
 			{
-				b = dst.ptr<byte>(y);
+				byte *b = dst.ptr<byte>(y);
 				for( int x = 0; x < img.cols; x++ )
 				{ 
 					b[x] = contains(centers_to_use, centers.at<float>( labels.at<int>(y + x*img.rows, 0), 0 )) ? val : 0;
 				}
-			}
+			});
 		}
 		else
 		{
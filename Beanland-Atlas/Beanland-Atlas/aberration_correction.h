@@ -3,6 +3,7 @@
 #include <includes.h>
 
 #include <commensuration_ellipses.h>
+#include <task_scheduler.h>
 #include <utility.hpp>
 
 namespace ba
@@ -11,6 +11,8 @@ namespace ba
 	void align_and_avg(std::vector<cv::Mat> &mats, std::vector<std::vector<int>> &refined_pos, cv::Mat &acc, 
 		cv::Mat &num_overlap)
 	{
+		BA_TIME_FUNCTION();
+
 		//Get the minimum and maximum relative positions of rows and columns
 		int row_min = refined_pos[0][std::distance(refined_pos[0].begin(), std::min_element(refined_pos[0].begin(), refined_pos[0].end()))];
 		int row_max = refined_pos[0][std::distance(refined_pos[0].begin(), std::max_element(refined_pos[0].begin(), refined_pos[0].end()))];
@@ -38,13 +40,11 @@ namespace ba
 		}
 	
 		//Divide non-zero accumulator matrix pixel values by number of overlapping contributing images
-		float *p;
-		ushort *q;
-		#pragma omp parallel for
-		for (int i = 0; i < num_overlap.rows; i++) {
+		parallel_for(0, num_overlap.rows, [&](int i)
+		{
 	
-			p = acc.ptr<float>(i);
-			q = num_overlap.ptr<ushort>(i);
+			float *p = acc.ptr<float>(i);
+			ushort *q = num_overlap.ptr<ushort>(i);
 			for (int j = 0; j < num_overlap.cols; j++) {
 	
 				//Divide pixels contributed to by the number of contributing pixels
@@ -52,7 +52,7 @@ namespace ba
 					p[j] /= q[j];
 				}
 			}
-		}
+		});
 	}
 
 	/*Refine the relative positions of the images using all the known relative positions
@@ -63,6 +63,8 @@ namespace ba
 	*/
 	std::vector<std::vector<int>> refine_rel_pos(std::vector<std::array<float, 5>> &positions)
 	{
+		BA_TIME_FUNCTION();
+
 		/* Assume that images are all compared against the first image for now. Refine this later */
 
 		//Assign memory to store the refined positions
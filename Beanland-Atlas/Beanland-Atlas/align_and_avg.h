@@ -2,6 +2,8 @@
 
 #include <includes.h>
 
+#include <task_scheduler.h>
+
 namespace ba
 {
 	/*Align the diffraction patterns using their known relative positions and average over the aligned px
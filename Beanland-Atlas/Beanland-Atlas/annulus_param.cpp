@@ -12,20 +12,24 @@ namespace ba
 	**init_thickness: int, Thickness to use when getting initial radius of annulus. The radii tested are separated by this value
 	**max_contrib: int, Maximum number of images to use. If the autocorrelation of the autocorrelation of the cross correlation
 	**still hasn't decreased after this many images, the parameters will be calculated from the images processed so far
-	**mats_rows_af: int, Number of rows of ArrayFire array containing the images. This is transpositional to the OpenCV mat
-	**mats_cols_af: int, Number of cols of ArrayFire array containing the images. This is transpositional to the OpenCV mat
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
 	**gauss_fft_af: Fourier transform of Gaussian to blur annuluses with
 	**af_context: cl_context, ArrayFire context
 	**af_device_id: cl_device_id, ArrayFire device
 	**af_queue: cl_command_queue, ArrayFire command queue
-	**NUM_THREADS: const int, Number of threads supported for OpenMP
 	**Returns:
 	**std::vector<int>, Refined radius and thickness of annulus, in that order
 	*/
 	std::vector<int> get_annulus_param(cv::Mat &mat, int min_rad, int max_rad, int init_thickness, int max_contrib,
-		int mats_rows_af, int mats_cols_af, af::array &gauss_fft_af, cl_kernel create_annulus_kernel, cl_command_queue af_queue, 
-		int NUM_THREADS)
+		const image_layout &layout, af::array &gauss_fft_af, cl_kernel create_annulus_kernel, cl_command_queue af_queue)
 	{
+		BA_TIME_FUNCTION();
+
+		//ArrayFire arrays are column-major, so their rows are the images' columns
+		af::dim4 dims_af = af_dims(layout);
+		int mats_rows_af = (int)dims_af[0];
+		int mats_cols_af = (int)dims_af[1];
+
 		//Assign memory to store spectra of cross correlation maxima
 		int spectrum_size = (max_rad-min_rad)/init_thickness + ((max_rad-min_rad)%init_thickness ? 1 : 0);
 		std::vector<float> spectrum(spectrum_size);
@@ -37,10 +41,9 @@ namespace ba
 
 		/* Perform analysis on first image separately to grow ArrayFire abstract syntax tree */
 
-		//Load image
-		cv::Mat image32F;
-		mat.convertTo(image32F, CV_32FC1, 1);
-		af::array inputImage_af(mats_rows_af, mats_cols_af, (float*)(image32F.data));
+		//Convert the image into pinned memory and load it onto the GPU
+		image_buffer input_buf = image_buffer_from_mat(mat, layout);
+		af::array inputImage_af = buffer_array(input_buf);
 
 		//Fourier transform the Sobel filtrate
 		af_array fft_af;
@@ -58,17 +61,10 @@ namespace ba
 		af_array ifft;
 		af_fft2_c2r(&ifft, (gauss_fft_af*annulus*fft).get(), 1.0f, false);
 
-		//Get the maximum value of the cross-correlation
-		af::array max1, idx1;
-		af::array max, idx;
-		af::max(max1, idx1, af::abs(af::array(ifft)), 1);
-		af::max(max, idx, max1, 0);
-
-		//Transfer the maximum back to the host
-		max.host(&spectrum[0]);
-
-		//Divide by radius of annulus to normalise results
-		spectrum[0] /= sum_annulus_px(min_rad, init_thickness);
+		//Queue the maximum value of the cross-correlation to be transferred back to the host. The maxima for all radii are
+		//transferred together so that the GPU doesn't wait for the host between radii
+		readback_queue readbacks;
+		queue_readback(readbacks, af::max(af::flat(af::abs(af::array(ifft)))), &spectrum[0]);
 
 		//Increment spot radius
 		for (int r = min_rad+init_thickness, i = 1; r < max_rad; r += init_thickness, i++)
@@ -82,14 +78,14 @@ namespace ba
 			//to create the cross-correlation space space
 			af_fft2_c2r(&ifft, (gauss_fft_af*af::array(annulus_fft_af)*fft).get(), 1.0f, false);
 
-			//Get the maximum value of the cross-correlation
-			af::max(max1, idx1, af::abs(af::array(ifft)), 1);
-			af::max(max, idx, max1, 0);
-
-			//Transfer the maximum back to the host
-			max.host(&spectrum[i]);
+			//Queue the maximum value of the cross-correlation to be transferred back to the host
+			queue_readback(readbacks, af::max(af::flat(af::abs(af::array(ifft)))), &spectrum[i]);
+		}
+		flush_readbacks(readbacks);
 
-			//Divide by radius of annulus to normalise results
+		//Divide by radius of annulus to normalise results
+		for (int r = min_rad, i = 0; i < spectrum_size; r += init_thickness, i++)
+		{
 			spectrum[i] /= sum_annulus_px(r, init_thickness);
 		}
 
@@ -156,13 +152,10 @@ namespace ba
 					af_array ifft;
 					af_fft2_c2r(&ifft, (gauss_fft_af*af::array(annulus_fft_af)*fft).get(), 1.0f, false);
 
-					//Get the maximum value of the cross-correlation
-					af::array max1, idx1;
-					af::array max, idx;
-					af::max(max1, idx1, af::abs(af::array(ifft)), 1);
-					af::max(max, idx, max1, 0);
-
-					max.host(&local_xcorr);
+					//Get the maximum value of the cross-correlation. Whether to try the next thickness depends on it, so it is
+					//read back straight away
+					local_xcorr = af::max<float>(af::abs(af::array(ifft)));
+					BA_COUNT(INSTR_DEVICE_TO_HOST, sizeof(float));
 
 					local_xcorr /= sum_annulus_px(r, t);
 				}
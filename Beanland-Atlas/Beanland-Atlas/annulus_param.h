@@ -2,6 +2,8 @@
 
 #include <includes.h>
 
+#include <device_transfer.h>
+#include <image_buffer.h>
 #include <kernel_launchers.h>
 
 namespace ba
@@ -16,19 +18,16 @@ namespace ba
 	**init_thickness: int, Thickness to use when getting initial radius of annulus. The radii tested are separated by this value
 	**max_contrib: int, Maximum number of images to use. If the autocorrelation of the autocorrelation of the cross correlation
 	**still hasn't decreased after this many images, the parameters will be calculated from the images processed so far
-	**mats_rows_af: int, Number of rows of ArrayFire array containing the images. This is transpositional to the OpenCV mat
-	**mats_cols_af: int, Number of cols of ArrayFire array containing the images. This is transpositional to the OpenCV mat
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
 	**gauss_fft_af: Fourier transform of Gaussian to blur annuluses with
 	**af_context: cl_context, ArrayFire context
 	**af_device_id: cl_device_id, ArrayFire device
 	**af_queue: cl_command_queue, ArrayFire command queue
-	**NUM_THREADS: const int, Number of threads supported for OpenMP
 	**Returns:
 	**std::vector<int>, Refined radius and thickness of annulus, in that order
 	*/
 	std::vector<int> get_annulus_param(cv::Mat &mat, int min_rad, int max_rad, int init_thickness, int max_contrib,
-		int mats_rows_af, int mats_cols_af, af::array &gauss_fft_af, cl_kernel create_annulus_kernel, cl_command_queue af_queue, 
-		int NUM_THREADS);
+		const image_layout &layout, af::array &gauss_fft_af, cl_kernel create_annulus_kernel, cl_command_queue af_queue);
 
 	/*Calculates relative area of annulus to divide cross-correlations by so that they can be compared
 	**Inputs:
@@ -15,8 +15,6 @@ namespace ba
 	*/
 	std::vector<float> symmetry_axes(cv::Mat &amalg, int origin_x, int origin_y, size_t num_angles, float target_size) {
 
-		float inv_num_angles = 1.0f/num_angles;
-
 		float offset_accr = (float)origin_x;
 		float offset_down = (float)origin_y;
 
@@ -33,56 +31,19 @@ namespace ba
 			d_samp = amalg;
 		}
 
-		std::vector<float> pearson_corr(num_angles);
-
-		//For each angle
-		#pragma omp parallel for 
-		for (int k = 0; k < num_angles; k++){
-
-			//Gradients for reflection
-			float grad_accr = std::cos(k*PI*inv_num_angles);
-			float grad_down = std::sin(k*PI*inv_num_angles);
-			float inv_grad2 = 1.0f/(grad_accr*grad_accr+grad_down*grad_down);
-
-			//Sums for Pearson product moment correlation coefficient
-			int count = 0;
-			float sum_xy = 0.0f;
-			float sum_x = 0.0f;
-			float sum_y = 0.0f;
-			float sum_x2 = 0.0f;
-			float sum_y2 = 0.0f;
+		//Sample the polar grid at a multiple of the number of angles so that every mirror line is on it. The angular resolution
+		//is at least that used to refine the mirror lines
+		int samp_per_angle = std::max(1, (int)std::ceil((float)(NUM_PERIM*(d_samp.rows+d_samp.cols)) / num_angles));
+		polar_plan plan = create_polar_plan(samp_per_angle*num_angles);
 
-			//Reflect points across mirror line and compare them to the nearest pixel
-			for (int i = 0; i < d_samp.cols; i++) {
-				for (int j = 0; j < d_samp.rows; j++) {
+		//Resample the pattern once around the origin and correlate it with its reflections for all angles at once
+		polar_img polar = polar_resample(d_samp, cv::Point2f(offset_accr, offset_down), plan);
+		polar_corr corr = polar_sym_corr(polar, plan, true, false);
 
-					//Get coordinates relative to center of symmetry
-					int x = i-offset_accr;
-					int y = j-offset_down;
 
-					//Only perform calculation on points on one side of the mirror line
-					if(x*grad_down-y*grad_accr > 0.0f){
-
-						//Reflect
-						int refl_col = 2*(int)((grad_accr*x+grad_down*y)*inv_grad2)*grad_accr - x + offset_accr;
-						int refl_row = 2*(int)((grad_accr*x+grad_down*y)*inv_grad2)*grad_down - y + offset_down;
-
-						//If reflected point is in the image, add it's contribution to Pearson's correlation coefficient
-						if(refl_col < d_samp.cols && refl_row < d_samp.rows && refl_col > 0 && refl_row > 0){
-
-							//Contribute to Pearson correlation coefficient
-							count++;
-							sum_xy += d_samp.at<float>(j, i)*d_samp.at<float>(refl_row, refl_col);
-							sum_x += d_samp.at<float>(j, i);
-							sum_y += d_samp.at<float>(refl_row, refl_col);
-							sum_x2 += d_samp.at<float>(j, i)*d_samp.at<float>(j, i);
-							sum_y2 += d_samp.at<float>(refl_row, refl_col)*d_samp.at<float>(refl_row, refl_col);
-						}
-					}
-				}
-			}
-
-			pearson_corr[k] = (count*sum_xy - sum_x*sum_y) / (std::sqrt(count*sum_x2 - sum_x*sum_x) * std::sqrt(count*sum_y2 - sum_y*sum_y));
+		std::vector<float> pearson_corr(num_angles);
+		for (int k = 0; k < num_angles; k++){
+			pearson_corr[k] = corr.mirror[k*samp_per_angle];
 		}
 
 		return pearson_corr;
@@ -2,6 +2,8 @@
 
 #include <includes.h>
 
+#include <polar_symmetry.h>
+
 namespace ba
 {
 	/*Downsamples amalgamation of aligned diffraction patterns, then finds approximate axes of symmetry
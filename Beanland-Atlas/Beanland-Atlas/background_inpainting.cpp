@@ -0,0 +1,216 @@
+#include <background_inpainting.h>
+
+namespace ba
+{
+	/*Downsample a mask so that coarse pixels are masked if any of the fine pixels they cover are
+	**Inputs:
+	**mask: cv::Mat &, 8-bit mask
+	**levels: const int, Number of times to halve the resolution
+	**Returns:
+	**cv::Mat, Downsampled 8-bit mask
+	*/
+	static cv::Mat downsample_mask(cv::Mat &mask, const int levels)
+	{
+		const int f = 1 << levels;
+		cv::Mat full = mask != 0, low;
+		cv::resize(full, low, cv::Size((mask.cols + f-1) / f, (mask.rows + f-1) / f), 0, 0, cv::INTER_AREA);
+		return low > 0;
+	}
+
+	/*Work out the regions to inpaint for disks that are in the same place in every aligned frame
+	**Inputs:
+	**spot_pos: std::vector<cv::Point> &, Positions of the disks in aligned coordinates
+	**radius: const int, Radius of the disks
+	**method: const int, Method for cv::inpaint to use
+	**levels: const int, Number of times to halve the resolution before inpainting. If negative, this is chosen from the radius
+	**Returns:
+	**bg_inpaint_plan, Regions to inpaint
+	*/
+	bg_inpaint_plan create_bg_inpaint_plan(std::vector<cv::Point> &spot_pos, const int radius, const int method, 
+		const int levels)
+	{
+		bg_inpaint_plan plan;
+		plan.method = method;
+
+		plan.levels = levels;
+		if (plan.levels < 0)
+		{
+			plan.levels = 0;
+			while (plan.levels < BG_INPAINT_MAX_LEVELS && (radius >> (plan.levels+1)) >= BG_INPAINT_MIN_RADIUS)
+			{
+				plan.levels++;
+			}
+		}
+
+		//Disks are surrounded by enough of the frame to fill the inpainting neighbourhoods on the coarsest level
+		int margin = radius + ((BG_INPAINT_RADIUS+1) << plan.levels);
+		std::vector<cv::Rect> rects(spot_pos.size());
+		std::vector<std::vector<int>> members(spot_pos.size());
+		for (int k = 0; k < spot_pos.size(); k++)
+		{
+			rects[k] = cv::Rect(spot_pos[k].x - margin, spot_pos[k].y - margin, 2*margin+1, 2*margin+1);
+			members[k].push_back(k);
+		}
+
+		//Merge overlapping boxes until none overlap so that each disk is inpainted once, with all of its neighbours masked
+		bool merged = true;
+		while (merged)
+		{
+			merged = false;
+			for (int i = 0; i < rects.size(); i++)
+			{
+				for (int j = i+1; j < rects.size(); j++)
+				{
+					if ((rects[i] & rects[j]).area())
+					{
+						rects[i] |= rects[j];
+						members[i].insert(members[i].end(), members[j].begin(), members[j].end());
+						rects.erase(rects.begin() + j);
+						members.erase(members.begin() + j);
+						merged = true;
+						j = i;
+					}
+				}
+			}
+		}
+
+		//Draw the disks in each box
+		plan.rects = rects;
+		plan.masks.resize(rects.size());
+		plan.low_masks.resize(rects.size());
+		for (int i = 0; i < rects.size(); i++)
+		{
+			plan.masks[i] = cv::Mat::zeros(rects[i].size(), CV_8UC1);
+			for (int k = 0; k < members[i].size(); k++)
+			{
+				cv::circle(plan.masks[i], spot_pos[members[i][k]] - rects[i].tl(), radius, cv::Scalar(1), -1, 8, 0);
+			}
+
+			plan.low_masks[i] = downsample_mask(plan.masks[i], plan.levels);
+		}
+
+		return plan;
+	}
+
+	/*Draw the disks of a plan onto a frame's mask
+	**Inputs:
+	**plan: bg_inpaint_plan &, Regions to inpaint
+	**size: cv::Size, Size of the frame
+	**origin: cv::Point, Position of the frame's top left pixel in aligned coordinates
+	**Returns:
+	**cv::Mat, 8-bit mask that is non-zero where the frame is covered by disks
+	*/
+	cv::Mat bg_inpaint_mask(bg_inpaint_plan &plan, cv::Size size, cv::Point origin)
+	{
+		cv::Mat mask = cv::Mat::zeros(size, CV_8UC1);
+		cv::Rect frame(origin, size);
+		for (int i = 0; i < plan.rects.size(); i++)
+		{
+			cv::Rect overlap = plan.rects[i] & frame;
+			if (overlap.area())
+			{
+				plan.masks[i](overlap - plan.rects[i].tl()).copyTo(mask(overlap - origin));
+			}
+		}
+
+		return mask;
+	}
+
+	/*Estimate the background under the disks in a frame by inpainting them. Only the boxes around the disks are inpainted, on a
+	**downsampled pyramid level, and the smooth result is upsampled. Pixels outside the disks are copied from the frame
+	**Inputs:
+	**img: cv::Mat &, 32-bit frame
+	**origin: cv::Point, Position of the frame's top left pixel in aligned coordinates
+	**plan: bg_inpaint_plan &, Regions to inpaint
+	**background: cv::Mat &, Output 32-bit frame with the disks inpainted
+	*/
+	void inpaint_background(cv::Mat &img, cv::Point origin, bg_inpaint_plan &plan, cv::Mat &background)
+	{
+		img.copyTo(background);
+
+		const int f = 1 << plan.levels;
+		cv::Rect frame(origin, img.size());
+		for (int i = 0; i < plan.rects.size(); i++)
+		{
+			cv::Rect overlap = plan.rects[i] & frame;
+			if (!overlap.area())
+			{
+				continue;
+			}
+
+			//Boxes that are cut by the edge of the frame need their masks cropping and downsampling again
+			cv::Mat mask = plan.masks[i](overlap - plan.rects[i].tl());
+			if (!cv::countNonZero(mask))
+			{
+				continue;
+			}
+			cv::Mat low_mask = overlap == plan.rects[i] ? plan.low_masks[i] : downsample_mask(mask, plan.levels);
+
+			cv::Mat roi = img(overlap - origin);
+			cv::Mat inpainted;
+			if (plan.levels)
+			{
+				cv::Mat low, low_inpainted;
+				cv::resize(roi, low, low_mask.size(), 0, 0, cv::INTER_AREA);
+				cv::inpaint(low, low_mask, low_inpainted, BG_INPAINT_RADIUS, plan.method);
+				cv::resize(low_inpainted, inpainted, roi.size(), 0, 0, cv::INTER_LINEAR);
+			}
+			else
+			{
+				cv::inpaint(roi, mask, inpainted, BG_INPAINT_RADIUS, plan.method);
+			}
+
+			inpainted.copyTo(background(overlap - origin), mask);
+		}
+	}
+
+	/*Time inpainting the boxes around the disks on a downsampled pyramid level against inpainting whole frames at full 
+	**resolution, and print the timings and the differences between them
+	**Inputs:
+	**mats: std::vector<cv::Mat> &, 32-bit frames
+	**origins: std::vector<cv::Point> &, Positions of the frames' top left pixels in aligned coordinates
+	**plan: bg_inpaint_plan &, Regions to inpaint
+	*/
+	void bench_bg_inpainting(std::vector<cv::Mat> &mats, std::vector<cv::Point> &origins, bg_inpaint_plan &plan)
+	{
+		std::vector<cv::Mat> full(mats.size()), fast(mats.size()), masks(mats.size());
+		for (int j = 0; j < mats.size(); j++)
+		{
+			masks[j] = bg_inpaint_mask(plan, mats[j].size(), origins[j]);
+		}
+
+		int64 start = cv::getTickCount();
+		parallel_for(0, mats.size(), [&](int j)
+		{
+			cv::inpaint(mats[j], masks[j], full[j], BG_INPAINT_RADIUS, plan.method);
+		});
+		double full_time = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+		start = cv::getTickCount();
+		parallel_for(0, mats.size(), [&](int j)
+		{
+			inpaint_background(mats[j], origins[j], plan, fast[j]);
+		});
+		double fast_time = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+		//Differences between the backgrounds in the inpainted regions, relative to the spread of the full resolution background
+		double sum_sqr = 0.0, max_diff = 0.0;
+		int num = 0;
+		for (int j = 0; j < mats.size(); j++)
+		{
+			cv::Mat diff = fast[j] - full[j];
+			sum_sqr += cv::norm(diff, cv::NORM_L2SQR, masks[j]);
+			max_diff = std::max(max_diff, cv::norm(diff, cv::NORM_INF, masks[j]));
+			num += cv::countNonZero(masks[j]);
+		}
+
+		cv::Scalar mean, stddev;
+		cv::meanStdDev(full[0], mean, stddev, masks[0]);
+
+		std::cout << "Full resolution inpainting: " << 1e3*full_time/mats.size() << " ms per frame" << std::endl;
+		std::cout << "Pyramid level " << plan.levels << " inpainting of " << plan.rects.size() << " regions: " << 
+			1e3*fast_time/mats.size() << " ms per frame (" << full_time/fast_time << "x faster)" << std::endl;
+		std::cout << "RMS difference in inpainted regions: " << (num ? std::sqrt(sum_sqr/num) : 0.0) << ", maximum: " << 
+			max_diff << ", first frame background standard deviation: " << stddev[0] << std::endl;
+	}
+}
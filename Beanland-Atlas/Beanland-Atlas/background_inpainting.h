@@ -0,0 +1,69 @@
+#pragma once
+
+#include <includes.h>
+
+#include <task_scheduler.h>
+
+namespace ba
+{
+	//Radius of the neighbourhoods used to inpaint each pixel, in pixels of the pyramid level being inpainted
+    #define BG_INPAINT_RADIUS 7
+
+	//Pyramid levels are added until the masked disks would be smaller than this radius on the coarsest level
+    #define BG_INPAINT_MIN_RADIUS 4
+
+	//Maximum number of times to halve the resolution before inpainting
+    #define BG_INPAINT_MAX_LEVELS 3
+
+	//Custom data structure to hold the geometry of the regions to inpaint in every frame of a stack. Frames only translate 
+	//relative to each other, so the same regions are used for every frame
+	struct bg_inpaint_plan_param {
+		std::vector<cv::Rect> rects; //Boxes around clusters of overlapping masked disks, with margins, in aligned coordinates
+		std::vector<cv::Mat> masks; //8-bit masks that are non-zero where the disks in each box are
+		std::vector<cv::Mat> low_masks; //Masks downsampled to the coarsest pyramid level
+		int levels; //Number of times to halve the resolution before inpainting
+		int method; //Method that cv::inpaint uses
+	};
+	typedef bg_inpaint_plan_param bg_inpaint_plan;
+
+	/*Work out the regions to inpaint for disks that are in the same place in every aligned frame
+	**Inputs:
+	**spot_pos: std::vector<cv::Point> &, Positions of the disks in aligned coordinates
+	**radius: const int, Radius of the disks
+	**method: const int, Method for cv::inpaint to use
+	**levels: const int, Number of times to halve the resolution before inpainting. If negative, this is chosen from the radius
+	**Returns:
+	**bg_inpaint_plan, Regions to inpaint
+	*/
+	bg_inpaint_plan create_bg_inpaint_plan(std::vector<cv::Point> &spot_pos, const int radius, const int method = cv::INPAINT_NS,
+		const int levels = -1);
+
+	/*Draw the disks of a plan onto a frame's mask
+	**Inputs:
+	**plan: bg_inpaint_plan &, Regions to inpaint
+	**size: cv::Size, Size of the frame
+	**origin: cv::Point, Position of the frame's top left pixel in aligned coordinates
+	**Returns:
+	**cv::Mat, 8-bit mask that is non-zero where the frame is covered by disks
+	*/
+	cv::Mat bg_inpaint_mask(bg_inpaint_plan &plan, cv::Size size, cv::Point origin);
+
+	/*Estimate the background under the disks in a frame by inpainting them. Only the boxes around the disks are inpainted, on a
+	**downsampled pyramid level, and the smooth result is upsampled. Pixels outside the disks are copied from the frame
+	**Inputs:
+	**img: cv::Mat &, 32-bit frame
+	**origin: cv::Point, Position of the frame's top left pixel in aligned coordinates
+	**plan: bg_inpaint_plan &, Regions to inpaint
+	**background: cv::Mat &, Output 32-bit frame with the disks inpainted
+	*/
+	void inpaint_background(cv::Mat &img, cv::Point origin, bg_inpaint_plan &plan, cv::Mat &background);
+
+	/*Time inpainting the boxes around the disks on a downsampled pyramid level against inpainting whole frames at full 
+	**resolution, and print the timings and the differences between them
+	**Inputs:
+	**mats: std::vector<cv::Mat> &, 32-bit frames
+	**origins: std::vector<cv::Point> &, Positions of the frames' top left pixels in aligned coordinates
+	**plan: bg_inpaint_plan &, Regions to inpaint
+	*/
+	void bench_bg_inpainting(std::vector<cv::Mat> &mats, std::vector<cv::Point> &origins, bg_inpaint_plan &plan);
+}
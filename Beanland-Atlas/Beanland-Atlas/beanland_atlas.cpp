@@ -1,9 +1,480 @@
 #include <beanland_atlas.h>
 
+//The symmetry library is too slow for the pipeline, but the benchmark checks its tiled transform
+#include <symmetry_func.h>
+
 //Use Beanland Atlas library functions
 using namespace ba;
 
-int main()
+//Frame sizes, numbers of beam tilts either side of the centre of the scan and numbers of reflections either side of the direct
+//beam of the synthetic tilt series that the benchmark runs the pipeline on
+static const std::array<int, 2> bench_sizes = { 256, 512 };
+static const std::array<int, 2> bench_tilts = { 2, 4 };
+static const std::array<int, 2> bench_reflections = { 1, 2 };
+
+//Reference limits that each synthetic series must meet for the benchmark to pass. The frame rates are the slowest expected for
+//each of the frame sizes, with margin for slower machines
+static const float bench_max_shift_error = 0.5f; //Largest RMS error of the relative image positions, px
+static const float bench_max_spot_error = 1.0f; //Largest RMS error of the spot positions, px
+static const float bench_min_recall = 0.9f; //Smallest fraction of spots that must be found
+static const std::array<double, 2> bench_min_frames_per_s = { 20.0, 5.0 };
+
+//Radii of the disks that the disk span microbenchmark accumulates
+static const std::array<int, 6> bench_disk_radii = { 5, 10, 20, 50, 100, 200 };
+
+/*Add the stages that create the atlas to a pipeline and run it
+**Inputs:
+**p: pipeline &, Pipeline containing the image stack as its "raw" value
+**af_context: cl_context, ArrayFire context
+**af_device_id: cl_device_id, ArrayFire device
+**af_queue: cl_command_queue, ArrayFire command queue
+**checkpoint: const bool, If true, stages save checkpoints and reuse them
+**Returns:
+**bool, True if every stage completed
+*/
+static bool run_atlas_pipeline(pipeline &p, cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue,
+	const bool checkpoint)
+{
+	//Preprocessing pads the images to powers of 2. ArrayFire arrays are column-major, so their rows are the images' columns
+	image_layout layout = padded_layout(get_pipeline_value(p, "raw")[0].size());
+	af::dim4 dims_af = af_dims(layout);
+	int mats_rows_af = (int)dims_af[0];
+	int mats_cols_af = (int)dims_af[1];
+
+	//Create extended Gaussian creating kernel
+	cl_kernel gauss_kernel = create_kernel(gauss_kernel_ext_source, gauss_kernel_ext_kernel, af_context, af_device_id);
+
+	//Create the extended Gaussian
+	af::array ext_gauss = extended_gauss(mats_cols_af, mats_rows_af, 0.25*UBOUND_GAUSS_SIZE+0.75, gauss_kernel, af_queue);
+
+	//Fourier transform the Gaussian
+	af_array gauss_fft2_af;
+	af_fft2_r2c(&gauss_fft2_af, ext_gauss.get(), 1.0f, mats_rows_af, mats_cols_af);
+	af::array gauss_fft = af::array(gauss_fft2_af);
+
+	//Create annulus making kernel
+	cl_kernel create_annulus_kernel = create_kernel(annulus_source, annulus_kernel, af_context, af_device_id);
+
+	//Create circle creating kernel
+	cl_kernel circle_creator = create_kernel(circle_source, circle_kernel, af_context, af_device_id);
+
+	//Preprocess the image stack. At the moment, this just involves median filtering, resizing the images and converting them 
+	p.stages.push_back({ "preprocess", { "raw" }, { "mats" }, std::to_string(PREPROC_MED_FILT_SIZE), 1, checkpoint,
+		[&](stage_values &in, stage_values &out)
+	{
+		std::vector<cv::Mat> mats = in["raw"];
+		preprocess(mats, PREPROC_MED_FILT_SIZE);
+		out["mats"] = mats;
+	} });
+
+	//Use Fourier analysis to place upper bound on the size of the circles
+	p.stages.push_back({ "circ_size_ubound", { "mats" }, { "ubound" }, 
+		std::to_string(MIN_CIRC_SIZE) + "," + std::to_string(MAX_AUTO_CONTRIB) + "," + std::to_string(UBOUND_GAUSS_SIZE), 
+		2, checkpoint, [&](stage_values &in, stage_values &out)
+	{
+		std::vector<cv::Mat> &mats = in["mats"];
+		int ubound = circ_size_ubound(mats, layout, gauss_fft, MIN_CIRC_SIZE, 
+			std::min((int)mats.size(), MAX_AUTO_CONTRIB), af_context, af_device_id, af_queue);
+		out["ubound"] = std::vector<cv::Mat>(1, pack_values(std::vector<int>(1, ubound)));
+	} });
+
+	//Calculate annulus radius and thickness that describe the gradiation of the spots best. Set lower bound, assuming that 
+	//spots in data will have at least a few pixels diameter
+	p.stages.push_back({ "annulus_param", { "mats", "ubound" }, { "annulus_param" }, 
+		std::to_string(MIN_CIRC_SIZE) + "," + std::to_string(INIT_ANNULUS_THICKNESS) + "," + std::to_string(MAX_SIZE_CONTRIB), 
+		1, checkpoint, [&](stage_values &in, stage_values &out)
+	{
+		int ubound = unpack_values<int>(in["ubound"][0])[0];
+		std::vector<int> annulus_param = get_annulus_param(in["mats"][0], MIN_CIRC_SIZE, ubound, INIT_ANNULUS_THICKNESS, 
+			MAX_SIZE_CONTRIB, layout, gauss_fft, create_annulus_kernel, af_queue);
+		out["annulus_param"] = std::vector<cv::Mat>(1, pack_values(annulus_param));
+	} });
+
+	//Find alignment of successive images
+	p.stages.push_back({ "img_rel_pos", { "mats", "ubound", "annulus_param" }, { "rel_pos", "refined_pos" }, "", 1, checkpoint,
+		[&](stage_values &in, stage_values &out)
+	{
+		int ubound = unpack_values<int>(in["ubound"][0])[0];
+		std::vector<int> annulus_param = unpack_values<int>(in["annulus_param"][0]);
+
+		//Create the Gaussian blurred annulus and circle that the images are primed with
+		af::array annulus_fft, circle_fft;
+		create_align_filters(annulus_param, ubound, gauss_fft, create_annulus_kernel, circle_creator, af_queue, layout,
+			annulus_fft, circle_fft);
+
+		std::vector<std::array<float, 5>> rel_pos = img_rel_pos(in["mats"], annulus_fft, circle_fft, layout);
+
+		//Refine the relative position combinations to get the positions relative to the first image
+		//Index 0 - rows, Index 1 - cols
+		std::vector<std::vector<int>> refined_pos = refine_rel_pos(rel_pos);
+
+		out["rel_pos"] = std::vector<cv::Mat>(1, pack_values(rel_pos));
+		for (int i = 0; i < refined_pos.size(); i++)
+		{
+			out["refined_pos"].push_back(pack_values(refined_pos[i]));
+		}
+	} });
+
+	//Align the diffraction patterns to create average diffraction pattern
+	p.stages.push_back({ "align_and_avg", { "mats", "refined_pos" }, { "acc", "num_overlap" }, "", 1, checkpoint,
+		[&](stage_values &in, stage_values &out)
+	{
+		std::vector<std::vector<int>> refined_pos;
+		for (int i = 0; i < in["refined_pos"].size(); i++)
+		{
+			refined_pos.push_back(unpack_values<int>(in["refined_pos"][i]));
+		}
+
+		cv::Mat acc, num_overlap;
+		align_and_avg(in["mats"], refined_pos, acc, num_overlap);
+		out["acc"] = std::vector<cv::Mat>(1, acc);
+		out["num_overlap"] = std::vector<cv::Mat>(1, num_overlap);
+	} });
+
+	//Get the positions of the spots in the aligned images average
+	p.stages.push_back({ "get_spot_pos", { "acc", "annulus_param" }, { "spot_pos", "samp_to_detect_sphere" }, 
+		std::to_string(DISCARD_SPOTS_DEFAULT), 2, checkpoint, [&](stage_values &in, stage_values &out)
+	{
+		std::vector<int> annulus_param = unpack_values<int>(in["annulus_param"][0]);
+		cv::Mat &acc = in["acc"][0];
+
+		cv::Vec2f samp_to_detect_sphere;
+		std::vector<cv::Point> spot_pos = get_spot_pos(acc, annulus_param[0], annulus_param[0], create_annulus_kernel, 
+			circle_creator, gauss_kernel, af_queue, acc.cols, acc.rows, samp_to_detect_sphere);
+
+		out["spot_pos"] = std::vector<cv::Mat>(1, pack_values(spot_pos));
+		out["samp_to_detect_sphere"] = std::vector<cv::Mat>(1, pack_values(std::vector<cv::Vec2f>(1, samp_to_detect_sphere)));
+	} });
+
+	//Index the frames that each spot is on, so that later stages only visit them. The index is checkpointed with the alignment
+	//results
+	p.stages.push_back({ "spot_frame_index", { "mats", "spot_pos", "refined_pos" }, { "spot_index" }, "", 2, checkpoint,
+		[&](stage_values &in, stage_values &out)
+	{
+		std::vector<cv::Point> spot_pos = unpack_values<cv::Point>(in["spot_pos"][0]);
+		std::vector<std::vector<int>> refined_pos;
+		for (int i = 0; i < in["refined_pos"].size(); i++)
+		{
+			refined_pos.push_back(unpack_values<int>(in["refined_pos"][i]));
+		}
+
+		//The aligned pattern is positioned by the maximum relative positions
+		int col_max = *std::max_element(refined_pos[0].begin(), refined_pos[0].end());
+		int row_max = *std::max_element(refined_pos[1].begin(), refined_pos[1].end());
+
+		spot_frame_index index = create_spot_frame_index(spot_pos, refined_pos, col_max, row_max, in["mats"][0].size());
+		out["spot_index"] = pack_spot_frame_index(index);
+	} });
+
+	//Combine the compendiums of maps mapped out by each spot to create maps showing the whole k spaces surveyed by each of the spots,
+	//then combine these surveys into an atlas to show the whole k space mapped out
+	p.stages.push_back({ "create_spot_maps", { "mats", "spot_pos", "refined_pos", "spot_index", "acc", "annulus_param" }, 
+		{ "surveys" }, "-1", 2, checkpoint, [&](stage_values &in, stage_values &out)
+	{
+		std::vector<int> annulus_param = unpack_values<int>(in["annulus_param"][0]);
+		std::vector<cv::Point> spot_pos = unpack_values<cv::Point>(in["spot_pos"][0]);
+		std::vector<std::vector<int>> refined_pos;
+		for (int i = 0; i < in["refined_pos"].size(); i++)
+		{
+			refined_pos.push_back(unpack_values<int>(in["refined_pos"][i]));
+		}
+		spot_frame_index index = unpack_spot_frame_index(in["spot_index"]);
+
+		//Background subtraction works on the images in place, so work on copies to leave the stage's input unchanged
+		std::vector<cv::Mat> mats(in["mats"].size());
+		for (int i = 0; i < mats.size(); i++)
+		{
+			mats[i] = in["mats"][i].clone();
+		}
+
+		out["surveys"] = create_spot_maps(mats, spot_pos, refined_pos, index, in["acc"][0], 0.9*annulus_param[0], 
+			annulus_param[0]+2*annulus_param[1], -1);
+	} });
+
+	bool completed = run_pipeline(p);
+
+	clReleaseKernel(gauss_kernel);
+	clReleaseKernel(create_annulus_kernel);
+	clReleaseKernel(circle_creator);
+
+	return completed;
+}
+
+/*Time accumulating disks of several radii with the cached disk span tables against calculating the run of each row with a
+**square root and accumulating it with a scalar loop, as accumulate_circle used to
+*/
+static void bench_disk_spans()
+{
+	std::cout << "Disk accumulation" << std::endl;
+	for (int i = 0; i < bench_disk_radii.size(); i++)
+	{
+		int rad = bench_disk_radii[i];
+		int size = 2*rad+1;
+		cv::Mat src = cv::Mat(size, size, CV_32FC1);
+		cv::randu(src, cv::Scalar(0.0f), cv::Scalar(1.0f));
+		cv::Mat acc = cv::Mat::zeros(size, size, CV_32FC1);
+
+		//Enough repetitions that each radius accumulates about the same number of pixels
+		int reps = std::max(1, (int)(2e7 / (PI*rad*rad)));
+
+		int64 start = cv::getTickCount();
+		for (int n = 0; n < reps; n++)
+		{
+			for (int y = -rad; y <= rad; y++)
+			{
+				float *p = src.ptr<float>(y+rad);
+				float *q = acc.ptr<float>(y+rad);
+				int c = (int)std::sqrt(rad*rad-y*y);
+				for (int x = rad-c; x <= rad+c; x++)
+				{
+					q[x] += p[x];
+				}
+			}
+		}
+		double row_sqrt_ms = 1e3*(cv::getTickCount() - start) / cv::getTickFrequency();
+
+		const disk_spans &disk = get_disk_spans(rad);
+		start = cv::getTickCount();
+		for (int n = 0; n < reps; n++)
+		{
+			disk_add<float>(src, cv::Point(rad, rad), acc, cv::Point(rad, rad), disk);
+		}
+		double spans_ms = 1e3*(cv::getTickCount() - start) / cv::getTickFrequency();
+
+		std::cout << "Radius " << rad << " px: " << row_sqrt_ms << " ms per row square root, " << spans_ms << 
+			" ms with span tables, " << row_sqrt_ms/spans_ms << "x speedup" << std::endl;
+	}
+}
+
+/*Model the backgrounds under the disks of the smallest synthetic tilt series. Bicubic spline backgrounds and inpainting only
+**the boxes around the disks on a downsampled pyramid level are each timed against full resolution inpainting of whole frames,
+**and the differences from it are printed. The disks are masked at their ground truth positions
+*/
+static void bench_backgrounds()
+{
+	synth_cbed_spec spec = default_synth_cbed_spec(bench_sizes[0], bench_sizes[0], bench_tilts[0], bench_reflections[0]);
+	synth_cbed data = create_synth_cbed(spec);
+
+	//Frames are positioned relative to the first, so the disks in each are shifted from their positions in the first
+	std::vector<cv::Point> spot_pos(data.spot_pos.size());
+	for (int i = 0; i < spot_pos.size(); i++)
+	{
+		spot_pos[i] = cv::Point((int)std::round(data.spot_pos[i].x), (int)std::round(data.spot_pos[i].y));
+	}
+	std::vector<cv::Point> origins(data.frames.size());
+	for (int j = 0; j < origins.size(); j++)
+	{
+		origins[j] = -data.shifts[j];
+	}
+
+	//Mask a pixel beyond the disks' edges so that no disk intensity leaks into the backgrounds
+	int radius = (int)std::ceil(spec.radius) + 1;
+	bg_inpaint_plan plan = create_bg_inpaint_plan(spot_pos, radius);
+	std::vector<cv::Mat> masks(data.frames.size());
+	for (int j = 0; j < masks.size(); j++)
+	{
+		masks[j] = bg_inpaint_mask(plan, data.frames[j].size(), origins[j]);
+	}
+
+	std::cout << std::endl << "Backgrounds of " << data.frames.size() << " frames of " << spec.cols << "x" << spec.rows << 
+		" px" << std::endl;
+	bench_background_models(data.frames, masks, radius, plan.method);
+	bench_bg_inpainting(data.frames, origins, plan);
+}
+
+/*Check the symmetry library's tiled transform with rectangular regions against its per-point reference on a random image
+**that spans several tiles
+**Returns:
+**bool, True if every score matches the reference
+*/
+static bool check_symmetry_tiles()
+{
+	int at_boundary;
+	double max_err;
+	int mismatches = sym::check_symmetry_transform_rect(at_boundary, max_err);
+
+	std::cout << "Tiled symmetry transform: " << mismatches << " scores differ from the per-point reference (" << at_boundary << 
+		" at tile boundaries), max relative error " << max_err << std::endl;
+	if (mismatches)
+	{
+		std::cout << "FAIL: tiled symmetry transform doesn't match the per-point reference" << std::endl;
+	}
+
+	return !mismatches;
+}
+
+/*Run the pipeline on synthetic tilt series of several sizes, without checkpoints, and print the throughput of each stage and
+**the accuracy of the relative image positions and spot positions against the ground truth. Each series is checked against the
+**reference limits. The largest series is then rerun with increasing numbers of threads to show how the pipeline scales
+**Inputs:
+**af_context: cl_context, ArrayFire context
+**af_device_id: cl_device_id, ArrayFire device
+**af_queue: cl_command_queue, ArrayFire command queue
+**NUM_THREADS: const int, Maximum number of threads to run the scaling benchmark with
+**Returns:
+**bool, True if the pipeline completed every run and every series met the reference limits
+*/
+static bool bench_atlas_pipeline(cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue, 
+	const int NUM_THREADS)
+{
+	bool passed = true;
+	for (int i = 0; i < bench_sizes.size(); i++)
+	{
+		for (int j = 0; j < bench_tilts.size(); j++)
+		{
+			for (int k = 0; k < bench_reflections.size(); k++)
+			{
+				synth_cbed_spec spec = default_synth_cbed_spec(bench_sizes[i], bench_sizes[i], bench_tilts[j], 
+					bench_reflections[k]);
+				synth_cbed data = create_synth_cbed(spec);
+
+				std::cout << std::endl << data.frames.size() << " frames of " << spec.cols << "x" << spec.rows << " px with " << 
+					(2*spec.num_g1+1)*(2*spec.num_g2+1) << " disks" << std::endl;
+
+				pipeline p;
+				set_pipeline_value(p, "raw", data.frames);
+				if (!run_atlas_pipeline(p, af_context, af_device_id, af_queue, false))
+				{
+					std::cout << "Pipeline failed" << std::endl;
+					passed = false;
+					continue;
+				}
+
+				double total_ms = 0.0;
+				for (int s = 0; s < p.stages.size(); s++)
+				{
+					double ms = p.stage_ms[p.stages[s].name];
+					total_ms += ms;
+					std::cout << p.stages[s].name << ": " << ms << " ms, " << 1e3*data.frames.size()/ms << " frames/s" << std::endl;
+				}
+				std::cout << "Total: " << total_ms << " ms, " << 1e3*data.frames.size()/total_ms << " frames/s" << std::endl;
+
+				std::vector<std::vector<int>> refined_pos;
+				std::vector<cv::Mat> &packed_pos = get_pipeline_value(p, "refined_pos");
+				for (int n = 0; n < packed_pos.size(); n++)
+				{
+					refined_pos.push_back(unpack_values<int>(packed_pos[n]));
+				}
+				std::vector<cv::Point> spot_pos = unpack_values<cv::Point>(get_pipeline_value(p, "spot_pos")[0]);
+
+				float recall;
+				float spot_err = synth_spot_error(data, spot_pos, spec.radius, recall);
+				float shift_err = synth_shift_error(data, refined_pos);
+				std::cout << "Relative position RMS error: " << shift_err << " px" << std::endl;
+				std::cout << "Spot position RMS error: " << spot_err << " px, " << 100*recall << "% of spots found" << std::endl;
+
+				//Check the series against the reference limits
+				if (shift_err > bench_max_shift_error)
+				{
+					std::cout << "FAIL: relative position error exceeds " << bench_max_shift_error << " px" << std::endl;
+					passed = false;
+				}
+				if (spot_err > bench_max_spot_error || recall < bench_min_recall)
+				{
+					std::cout << "FAIL: spot position error exceeds " << bench_max_spot_error << " px or fewer than " << 
+						100*bench_min_recall << "% of spots found" << std::endl;
+					passed = false;
+				}
+				if (1e3*data.frames.size()/total_ms < bench_min_frames_per_s[i])
+				{
+					std::cout << "FAIL: throughput below " << bench_min_frames_per_s[i] << " frames/s" << std::endl;
+					passed = false;
+				}
+			}
+		}
+	}
+
+	//Rerun the largest series with doubling numbers of threads. Both the task scheduler and OpenMP are limited so that
+	//the number of threads is the total used by the pipeline
+	synth_cbed_spec spec = default_synth_cbed_spec(bench_sizes.back(), bench_sizes.back(), bench_tilts.back(), 
+		bench_reflections.back());
+	synth_cbed data = create_synth_cbed(spec);
+
+	std::cout << std::endl << "Scaling with " << data.frames.size() << " frames of " << spec.cols << "x" << spec.rows << " px" << 
+		std::endl;
+
+	std::vector<int> thread_counts;
+	for (int t = 1; t < NUM_THREADS; t *= 2)
+	{
+		thread_counts.push_back(t);
+	}
+	thread_counts.push_back(NUM_THREADS);
+
+	double serial_ms = 0.0;
+	for (int i = 0; i < thread_counts.size(); i++)
+	{
+		int t = thread_counts[i];
+		init_task_scheduler(t);
+
+		pipeline p;
+		set_pipeline_value(p, "raw", data.frames);
+		if (!run_atlas_pipeline(p, af_context, af_device_id, af_queue, false))
+		{
+			std::cout << "Pipeline failed with " << t << " threads" << std::endl;
+			passed = false;
+			continue;
+		}
+
+		double total_ms = 0.0;
+		for (int s = 0; s < p.stages.size(); s++)
+		{
+			total_ms += p.stage_ms[p.stages[s].name];
+		}
+		serial_ms = t == 1 ? total_ms : serial_ms;
+
+		std::cout << t << " threads: " << total_ms << " ms, " << serial_ms/total_ms << "x speedup" << std::endl;
+	}
+
+	init_task_scheduler(NUM_THREADS);
+
+	return passed;
+}
+
+/*Build the atlas as frames arrive from the microscope. The paths of the image files it writes are read from the standard input,
+**one per line, so that the acquisition software can pipe them in as they are saved. Each file can hold several frames. Once the
+**input ends, the parts of the atlas still waiting for frames are finished and its symmetry is identified
+**Inputs:
+**af_context: cl_context, ArrayFire context
+**af_device_id: cl_device_id, ArrayFire device
+**af_queue: cl_command_queue, ArrayFire command queue
+*/
+static void stream_atlas(cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue)
+{
+	online_atlas atlas;
+	init_online_atlas(atlas, af_context, af_device_id, af_queue, -1);
+
+	std::string path;
+	int64 last_frame = cv::getTickCount();
+	while (std::getline(std::cin, path))
+	{
+		std::vector<cv::Mat> frames;
+		if (path.empty() || !imreadmulti(path, frames, CV_LOAD_IMAGE_UNCHANGED))
+		{
+			std::cerr << "Could not read frames from " << path << std::endl;
+			continue;
+		}
+
+		for (int i = 0; i < frames.size(); i++)
+		{
+			add_online_frame(atlas, frames[i]);
+		}
+		last_frame = cv::getTickCount();
+	}
+
+	if (finish_online_atlas(atlas))
+	{
+		std::vector<cv::Point> spot_pos;
+		std::vector<cv::Mat> surveys = online_atlas_surveys(atlas, spot_pos);
+		std::cout << atlas.num_frames << " frames, atlas ready " << 1e3*(cv::getTickCount() - last_frame)/cv::getTickFrequency() << 
+			" ms after the last frame" << std::endl;
+
+		atlas_sym atlas_symmetry = identify_symmetry(surveys, spot_pos, EQUIDST_THRESH, FRAC_FOR_SYM);
+	}
+
+	close_online_atlas(atlas);
+}
+
+int main(int argc, char *argv[])
 {
 	//Get number of concurrent processors. Use same number of threads
 	int NUM_THREADS;
@@ -17,8 +488,13 @@ int main()
 		NUM_THREADS = 1; //OpenMP will use 1 thread
 	}
 
-	omp_set_num_threads(NUM_THREADS);
-	omp_set_nested(1); //Enable nested parallelism
+	//Parallel loops share one pool of threads, so nested loops split their work instead of oversubscribing the processors.
+	//OpenMP is only used for simd, and the scheduler limits every thread that runs tasks to 1 OpenMP thread
+	init_task_scheduler(NUM_THREADS);
+	omp_set_max_active_levels(1);
+
+	//Load the FFTW wisdom from previous runs so that CPU-side transforms are planned quickly
+	init_fft_service();
 
 	//Create OpenCL context and queue for GPU acceleration 
 	cl::Context context(CL_DEVICE_TYPE_GPU);
@@ -34,13 +510,6 @@ int main()
 	//auto success = matlabPtr->
 	//	feval(matlab::engine::convertUTF8StringToUTF16String("share_matlab_engine"), factory.createCharArray(MATLAB_SHARED));
 
-	//Read in the image stack
-	std::vector<cv::Mat> mats;
-	imreadmulti(inputImagePath, mats, CV_LOAD_IMAGE_UNCHANGED);
-
-	//Preprocess the image stack. At the moment, this just involves median filtering, resizing the images and converting them 
-	preprocess(mats, PREPROC_MED_FILT_SIZE);
-
 	//cv::Mat rot = in_plane_rotate(mats[0], 0.1, 0);
 	
 	//Instruct ArrayFire to use the OpenCL. First, create a device from the current OpenCL device + context + queue
@@ -54,93 +523,58 @@ int main()
 	static cl_device_id af_device_id = afcl::getDeviceId();
 	static cl_command_queue af_queue = afcl::getQueue();
 
-	//ArrayFire arrays store images in memory transpositionally to OpenCV mats
-	int mats_cols_af = mats[0].rows;
-	int mats_rows_af = mats[0].cols;
-
-	//Create extended Gaussian creating kernel
-	cl_kernel gauss_kernel = create_kernel(gauss_kernel_ext_source, gauss_kernel_ext_kernel, af_context, af_device_id);
-
-	//Create the extended Gaussian
-	af::array ext_gauss = extended_gauss(mats[0].rows, mats[0].cols, 0.25*UBOUND_GAUSS_SIZE+0.75, gauss_kernel, af_queue);
-
-	//Fourier transform the Gaussian
-	af_array gauss_fft2_af;
-	af_fft2_r2c(&gauss_fft2_af, ext_gauss.get(), 1.0f, mats_rows_af, mats_cols_af);
-	af::array gauss_fft = af::array(gauss_fft2_af);
-
-	//Use Fourier analysis to place upper bound on the size of the circles
-	int ubound = circ_size_ubound(mats, mats_rows_af, mats_cols_af, gauss_fft, MIN_CIRC_SIZE, std::min((int)mats.size(), MAX_AUTO_CONTRIB), 
-		af_context, af_device_id, af_queue, NUM_THREADS);
-
-	//Set lower bound, assuming that spots in data will have at least a few pixels diameter
-	int lbound = MIN_CIRC_SIZE;
-
-	//Create annulus making kernel
-	cl_kernel create_annulus_kernel = create_kernel(annulus_source, annulus_kernel, af_context, af_device_id);
-
-	//Calculate annulus radius and thickness that describe the gradiation of the spots best
-	std::vector<int> annulus_param = get_annulus_param(mats[0], lbound, ubound, INIT_ANNULUS_THICKNESS, MAX_SIZE_CONTRIB, 
-		mats_rows_af, mats_cols_af, gauss_fft, create_annulus_kernel, af_queue, NUM_THREADS);
-
-	//Number of times to recursively cross correlate annulus with itself
-	int order = ubound/(2*annulus_param[0]);
-
-	//Use best annulus parameters to create the annulus to perform cross correlations with
-	af::array best_annulus = create_annulus(mats_cols_af*mats_rows_af, mats_cols_af, mats_cols_af/2, mats_rows_af, mats_rows_af/2, 
-		annulus_param[0], annulus_param[1], create_annulus_kernel, af_queue);
-
-	//Gaussian blur the annulus in the Fourier domain
-	af_array annulus_fft_c;
-	af_fft2_r2c(&annulus_fft_c, best_annulus.get(), 1.0f, mats_rows_af, mats_cols_af);
-	af::array annulus_fft = recur_conv(gauss_fft*af::array(annulus_fft_c), order);
-
-	//Create circle creating kernel
-	cl_kernel circle_creator = create_kernel(circle_source, circle_kernel, af_context, af_device_id);
-
-	//Create circle
-	af::array circle = create_circle(mats_cols_af*mats_rows_af, mats_cols_af, mats_cols_af/2, mats_rows_af, mats_rows_af/2, 
-		annulus_param[0], circle_creator, af_queue);
-
-	//Gaussian blur the circle in the Fourier domain
-	af_array circle_c;
-	af_fft2_r2c(&circle_c, circle.get(), 1.0f, mats_rows_af, mats_cols_af);
-	af::array circle_fft = gauss_fft*af::array(circle_c);
-
-	//Find alignment of successive images
-	std::vector<std::array<float, 5>> rel_pos = img_rel_pos(mats, annulus_fft, circle_fft, mats_rows_af, mats_cols_af);
-
-	//Refine the relative position combinations to get the positions relative to the first image
-	//Index 0 - rows, Index 1 - cols
-	std::vector<std::vector<int>> refined_pos = refine_rel_pos(rel_pos);
-
-	//Align the diffraction patterns to create average diffraction pattern
-	cv::Mat acc, num_overlap;
-	align_and_avg(mats, refined_pos, acc, num_overlap);
-
-	//Get the positions of the spots in the aligned images average
-	cv::Vec2f samp_to_detect_sphere;
-	std::vector<cv::Point> spot_pos = get_spot_pos(acc, annulus_param[0], annulus_param[0], create_annulus_kernel, 
-		circle_creator, gauss_kernel, af_queue, acc.cols, acc.rows, samp_to_detect_sphere);
-
-	//Combine the compendiums of maps mapped out by each spot to create maps showing the whole k spaces surveyed by each of the spots,
-	//then combine these surveys into an atlas to show the whole k space mapped out
-	std::vector<cv::Mat> surveys = create_spot_maps(mats, spot_pos, refined_pos, acc, 0.9*annulus_param[0], 
-		annulus_param[0]+2*annulus_param[1], -1);
-
-	atlas_sym atlas_symmetry = identify_symmetry(surveys, spot_pos, EQUIDST_THRESH, FRAC_FOR_SYM);
+	//Benchmark the pipeline on synthetic data with known ground truth, build the atlas as frames arrive, or run it on the input data.
+	//The benchmark exits with a non-zero status if the symmetry check fails or any series misses the reference limits
+	int status = 0;
+	if (argc > 1 && std::string(argv[1]) == "--bench")
+	{
+		bench_disk_spans();
+		bench_backgrounds();
+		bool passed = check_symmetry_tiles();
+		passed = bench_atlas_pipeline(af_context, af_device_id, af_queue, NUM_THREADS) && passed;
+		if (!passed)
+		{
+			std::cerr << "Benchmark failed: see the FAIL lines above" << std::endl;
+			status = 1;
+		}
+	}
+	else if (argc > 1 && std::string(argv[1]) == "--stream")
+	{
+		stream_atlas(af_context, af_device_id, af_queue);
+	}
+	else
+	{
+		//Read in the image stack
+		std::vector<cv::Mat> raw;
+		imreadmulti(inputImagePath, raw, CV_LOAD_IMAGE_UNCHANGED);
+
+		//Stages are skipped when their checkpoints match their inputs and parameters, so reruns resume from the first stage
+		//affected by a change or failure
+		pipeline p;
+		p.checkpoint_prefix = checkpoint_prefix;
+		set_pipeline_value(p, "raw", raw);
+
+		if (run_atlas_pipeline(p, af_context, af_device_id, af_queue, true))
+		{
+			std::vector<cv::Point> spot_pos = unpack_values<cv::Point>(get_pipeline_value(p, "spot_pos")[0]);
+			atlas_sym atlas_symmetry = identify_symmetry(get_pipeline_value(p, "surveys"), spot_pos, EQUIDST_THRESH, FRAC_FOR_SYM);
+		}
+	}
 
 	//Free OpenCL resources
 	clFlush(af_queue);	
 	clFinish(af_queue);
-	clReleaseKernel(gauss_kernel);
-	clReleaseKernel(create_annulus_kernel);
-	clReleaseKernel(circle_creator);
 	clReleaseCommandQueue(af_queue);
 	clReleaseContext(af_context);
 
+	//Save the FFTW wisdom and free the cached plans and buffers
+	close_fft_service();
+
+	//Stop the task threads
+	close_task_scheduler();
+
 	//Terminate the MATLAB engine
 	matlab::engine::terminateEngineClient();
 
-	return 0;
+	return status;
 }
\ No newline at end of file
@@ -7,23 +7,42 @@
 #include <align_and_avg.h>
 #include <annulus_param.h>
 #include <approx_symmetry_axes.h>
+#include <background_inpainting.h>
 #include <commensuration.h>
 #include <commensuration_utility.h>
 #include <commensuration_ellipses.h>
+#include <conic_fitting.h>
 #include <bright_field_sym.h>
 #include <circ_size_upper_bound.h>
 #include <correct_distortions.h>
+#include <corr_moments.h>
+#include <device_transfer.h>
+#include <disk_spans.h>
+#include <fft_service.h>
 #include <get_spot_positions.h>
 #include <ident_sym_utility.h> //Symmetry identification utility functions
 #include <identify_symmetry.h>
+#include <image_buffer.h>
 #include <img_rel_pos.h>
+#include <instrumentation.h>
 #include <kernel_launchers.h>
 #include <matlab.h>
+#include <online_atlas.h>
+#include <overlap_spans.h>
+#include <pipeline.h>
+#include <polar_symmetry.h>
 #include <postprocessing.h>
 #include <preprocessing.h>
+#include <radial_profile.h>
 #include <refine_mir_pos.h>
 #include <repeating_max_loc.h>
+#include <spline_background.h>
 #include <spot_extraction.h>
+#include <spot_frame_index.h>
+#include <synthetic_cbed.h>
+#include <sym_quantification.h>
+#include <task_scheduler.h>
 #include <template_matching.h> //Matching images of the same size
 #include <utility.h>
+#include <valid_region.h>
 #include <window_functions.h>
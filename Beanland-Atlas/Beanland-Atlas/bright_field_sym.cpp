@@ -15,11 +15,10 @@ namespace ba
 		//Rotate the bright field survey to produce a stack of images that can be compared
 		std::vector<cv::Mat> surveys(num_spots);
 		surveys[0] = img;
-        #pragma omp parallel for
-		for (int i = 0; i < num_spots; i++)
+		parallel_for(0, num_spots, [&](int i)
 		{
 			surveys[i] = rotate_CV(img, angles[i]);
-		}
+		});
 
 		//Get the rotational symmetry
 		std::vector<std::vector<float>> rot_sym = get_rotational_between_sym(surveys);
@@ -3,6 +3,7 @@
 #include <includes.h>
 
 #include <identify_symmetry.h>
+#include <task_scheduler.h>
 
 namespace ba
 {
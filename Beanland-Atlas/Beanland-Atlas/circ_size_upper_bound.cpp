@@ -9,8 +9,7 @@ namespace ba
 	**the separation of the circles
 	**Inputs:
 	**&mats: std::vector<cv::Mat>, Vector of input images
-	**mats_rows_af: int, Rows in ArrayFire array containing an input image. ArrayFire arrays are transpositional to OpenCV mats
-	**mats_cols_af: int, Rows in ArrayFire array containing an input image. ArrayFire arrays are transpositional to OpenCV mats
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
 	**gauss: af::array, ArrayFire array containing Fourier transform of a gaussian blurring filter to reduce high frequency components of
 	**the Fourier transforms of images with
 	**min_circ_size: int, Minimum dimeter of circles, in px
@@ -18,13 +17,19 @@ namespace ba
 	**af_context: cl_context, ArrayFire context
 	**af_device_id: cl_device_id, ArrayFire device
 	**af_queue: cl_command_queue, ArrayFire command queue
-	**NUM_THREADS: const int, Number of threads supported for OpenMP
 	**Returns:
 	**int, Upper bound for circles size
 	*/
-	int circ_size_ubound(std::vector<cv::Mat> &mats, int mats_rows_af, int mats_cols_af, af::array &gauss, int min_circ_size,
-		int max_num_imgs, cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue, const int NUM_THREADS)
+	int circ_size_ubound(std::vector<cv::Mat> &mats, const image_layout &layout, af::array &gauss, int min_circ_size,
+		int max_num_imgs, cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue)
 	{
+		BA_TIME_FUNCTION();
+
+		//ArrayFire arrays are column-major, so their rows are the images' columns
+		af::dim4 dims_af = af_dims(layout);
+		int mats_rows_af = (int)dims_af[0];
+		int mats_cols_af = (int)dims_af[1];
+
 		//Create kernel
 		cl_kernel freq_spectrum_kernel = create_kernel(freq_spectrum1D_source, freq_spectrum1D_kernel, af_context, af_device_id);
 
@@ -42,10 +47,10 @@ namespace ba
 		std::vector<float> spectrum_err(spectrum_size, 0);
 
 		//Calculate expected number of contributions to each element of the 1D frequency spectrum on CPU to avoid
-		//having to compile a 2nd kernel on the GPU as that kernel would only have 1 use
+		//having to compile a 2nd kernel on the GPU as that kernel would only have 1 use. Every index increments a shared
+		//histogram and the count is cheap, so this is done serially
 		int half_width = mats_cols_af/2;
-		#pragma omp parallel for num_threads(NUM_THREADS)
-		for (int i = 0; i < reduced_height * mats_cols_af; i++) 
+		for (int i = 0; i < reduced_height * mats_cols_af; i++)
 		{
 			//Get distances from center of shifted 2D fft
 			int y = i%(half_width+1);
@@ -68,10 +73,9 @@ namespace ba
 			}
 		}
 
-		//Load first image onto GPU
-		cv::Mat image32F;
-		mats[0].convertTo(image32F, CV_32FC1, 1);
-		af::array inputImage_af(mats_rows_af, mats_cols_af, (float*)(image32F.data));
+		//Convert the first image into pinned memory and load it onto the GPU
+		image_buffer input_buf = image_buffer_from_mat(mats[0], layout);
+		af::array inputImage_af = buffer_array(input_buf);
 
 		//Fourier transform the image
 		af_array fft2_af;
@@ -80,10 +84,11 @@ namespace ba
 		//Get the 1D frequency spectrum of that FFT
 		freq_spectrum1D(af::abs(af::array(fft2_af)*gauss), spectrum_size, mats_rows_af, mats_cols_af,
 			reduced_height, inv_height2, inv_width2, freq_spectrum_kernel, af_queue).host(&spectrum_host[0]);
+		BA_COUNT(INSTR_DEVICE_TO_HOST, spectrum_size*sizeof(float));
 
 		//Use a lagged, weighted Pearson normalised product moment correlation coefficient as a proxy for the Durbin-Watson
 		//autocorrelation statistic, which is approx 2*(1-r_p)
-		float spectrum_autocorr = weighted_pearson_autocorr(spectrum_host, spectrum_err, NUM_THREADS);
+		float spectrum_autocorr = weighted_pearson_autocorr(spectrum_host, spectrum_err);
 
 		//Use the weighted centroid of the 1D Fourier spectrum to estimate the spot separation
 		float weighted_sum = 0.0f, sum_err = spectrum_host[0] / spectrum_err[0];
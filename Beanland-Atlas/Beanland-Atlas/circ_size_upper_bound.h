@@ -2,7 +2,10 @@
 
 #include <includes.h>
 
+#include <device_transfer.h>
+#include <image_buffer.h>
 #include <kernel_launchers.h>
+#include <task_scheduler.h>
 #include <utility.h>
 
 namespace ba
@@ -14,8 +17,7 @@ namespace ba
 	**the separation of the circles
 	**Inputs:
 	**&mats: std::vector<cv::Mat>, Vector of input images
-	**mats_rows_af: int, Rows in ArrayFire array containing an input image. ArrayFire arrays are transpositional to OpenCV mats
-	**mats_cols_af: int, Rows in ArrayFire array containing an input image. ArrayFire arrays are transpositional to OpenCV mats
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
 	**gauss: af::array, ArrayFire array containing Fourier transform of a gaussian blurring filter to reduce high frequency components of
 	**the Fourier transforms of images with
 	**min_circ_size: int, Minimum dimeter of circles, in px
@@ -23,10 +25,9 @@ namespace ba
 	**af_context: cl_context, ArrayFire context
 	**af_device_id: cl_device_id, ArrayFire device
 	**af_queue: cl_command_queue, ArrayFire command queue
-	**NUM_THREADS: const int, Number of threads supported for OpenMP
 	**Returns:
 	**int, Upper bound for circles size
 	*/
-	int circ_size_ubound(std::vector<cv::Mat> &mats, int mats_rows_af, int mats_cols_af, af::array &gauss, int min_circ_size,
-		int max_num_imgs, cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue, const int NUM_THREADS);
+	int circ_size_ubound(std::vector<cv::Mat> &mats, const image_layout &layout, af::array &gauss, int min_circ_size,
+		int max_num_imgs, cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue);
 }
\ No newline at end of file
@@ -7,6 +7,7 @@ namespace ba
 	**mats: std::vector<cv::Mat> &, Individual floating point images that have been stereographically corrected to extract
 	**spots from
 	**spot_pos: cv::Point2d, Position of located spot in the aligned diffraction pattern
+	**hits: std::vector<spot_hit> &, Frames that the spot is on
 	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images
 	**col_max: const int, Maximum column difference between spot positions
 	**row_max: const int, Maximum row difference between spot positions
@@ -14,8 +15,8 @@ namespace ba
 	**Returns:
 	**std::vector<cv::Mat>, Dynamical diffraction effect decoupled Bragg profile
 	*/
-	std::vector<cv::Mat> bragg_envelope(std::vector<cv::Mat> &mats, cv::Point2d &spot_pos, std::vector<std::vector<int>> &rel_pos,
-		const int col_max, const int row_max, const int radius)
+	std::vector<cv::Mat> bragg_envelope(std::vector<cv::Mat> &mats, cv::Point2d &spot_pos, std::vector<spot_hit> &hits,
+		std::vector<std::vector<int>> &rel_pos, const int col_max, const int row_max, const int radius)
 	{
 		//Find the non-consecutively same position spots and record the indices of multiple spots with the same positions
 		std::vector<std::vector<int>> grouped_idx = consec_same_pos_spots(rel_pos);
@@ -25,7 +26,7 @@ namespace ba
 		std::vector<cv::Mat> groups;
 		std::vector<cv::Point> group_pos;
 		std::vector<bool> is_in_img;
-		grouping_preproc(mats, grouped_idx, spot_pos, rel_pos, col_max, row_max, radius, diam, groups, group_pos, is_in_img);
+		grouping_preproc(mats, grouped_idx, hits, radius, diam, groups, group_pos, is_in_img);
 
 		pearson_overlap_register(groups, group_pos, spot_pos, rel_pos, grouped_idx, is_in_img, radius, 
 			col_max, row_max, mats[0].cols, mats[0].rows, diam);
@@ -95,53 +96,48 @@ namespace ba
 	**Inputs:
 	**mats: std::vector<cv::Mat> &, Images to extract the spots from
 	**grouped_idx: std::vector<std::vector<int>> &, Groups of consecutive image indices where the spots are all in the same position
-	**spot_pos: cv::Point2d &, Position of the spot on the aligned images average px values diffraction pattern
-	**rel_pos: std::vector<std::vector<int>> &, Relative positions of the spots in the input images to the first image
-	**col_max: const int &, Maximum column difference between spot positions
-	**row_max: const int &, Maximum row difference between spot positions
+	**hits: std::vector<spot_hit> &, Frames that the spot is on
 	**radius: const int &, Radius of the spot
 	**diam: const int &, Diameter of the spot
 	**groups: std::vector<cv::Mat> &, Output preprocessed Bragg peaks, ready for dark field decoupled profile extraction
 	**group_pos: std::vector<cv::Point> &, Positions of top left corners of circles' bounding squares
 	**is_in_img: std::vector<bool> &, Output to mark true when the spot is in the image so that indices can be grouped
 	*/
-	void grouping_preproc(std::vector<cv::Mat> &mats, std::vector<std::vector<int>> &grouped_idx, cv::Point2d &spot_pos, 
-		std::vector<std::vector<int>> &rel_pos, const int &col_max, const int &row_max, const int &radius,
-		const int &diam, std::vector<cv::Mat> &groups, std::vector<cv::Point> &group_pos, std::vector<bool> &is_in_img)
+	void grouping_preproc(std::vector<cv::Mat> &mats, std::vector<std::vector<int>> &grouped_idx, std::vector<spot_hit> &hits,
+		const int &radius, const int &diam, std::vector<cv::Mat> &groups, std::vector<cv::Point> &group_pos, std::vector<bool> &is_in_img)
 	{
 		groups.clear();
 		group_pos.clear();
 		is_in_img = std::vector<bool>(grouped_idx.size());
 
+		//Hit of the spot on each image
+		std::vector<int> by_frame = hits_by_frame(hits, mats.size());
+
 		//For each group of spots...
 		for (int i = 0; i < grouped_idx.size(); i++)
 		{
-			//Index of the first image in the group
-			int j = grouped_idx[i][0];
-
-			is_in_img[i] = spot_pos.y >= row_max-rel_pos[1][j] && spot_pos.y < row_max-rel_pos[1][j]+mats[j].rows &&
-				spot_pos.x >= col_max-rel_pos[0][j] && spot_pos.x < col_max-rel_pos[0][j]+mats[j].cols;
-
 			//Check if the spot is in the image. If the first in the group isn't, none of them are as they are all in the same position
+			is_in_img[i] = by_frame[grouped_idx[i][0]] != -1;
 			if (is_in_img[i])
 			{
 				//Accumulate the mats in the group for averaging
 				cv::Mat acc = cv::Mat(diam, diam, CV_32FC1, cv::Scalar(0.0));
 
 				//...extract the group of spots, averaging them together if there are multiple in the group
+				cv::Point origin;
 				for (int k = 0; k < grouped_idx[i].size(); k++)
 				{
 					//Index of image in the image stack
-					j = grouped_idx[i][k];
+					int j = grouped_idx[i][k];
+					origin = hits[by_frame[j]].origin;
 
 					//Accumulate the circle in the accumulator
-					accumulate_circle(mats[j], spot_pos.x-col_max+rel_pos[0][j], spot_pos.y-row_max+rel_pos[1][j], radius,
-						acc, radius, radius);
+					accumulate_circle(mats[j], origin.x, origin.y, radius, acc, radius, radius);
 				}
 
 				//Store the preprocessed Bragg peak
 				groups.push_back( acc / grouped_idx[i].size() );
-				group_pos.push_back( cv::Point( spot_pos.x-col_max+rel_pos[0][j]-radius, spot_pos.y-row_max+rel_pos[1][j]-radius ) );
+				group_pos.push_back( cv::Point( origin.x-radius, origin.y-radius ) );
 			}
 		}
 	}
@@ -159,33 +155,7 @@ namespace ba
 	void accumulate_circle(cv::Mat &mat, const int &col, const int &row, const int &rad, cv::Mat &acc, const int &acc_col,
 		const int &acc_row)
 	{
-		//Get the minimum and maximum rows and columns to iterate between
-		int min_col, max_col, min_row, max_row;
-		min_col = std::max(0, col-rad);
-		max_col = std::min(mat.cols-1, col+rad);
-		min_row = std::max(0, row-rad);
-		max_row = std::min(mat.rows-1, row+rad);
-
-		//Iterate accross the circle rows
-		float *p, *q;
-        #pragma omp parallel for
-		for (int i = min_row, rel_row = min_row-row, k = acc_row-rad; i <= max_row; i++, rel_row++, k++)
-		{
-			//Create C-style pointers to interate across the circle with
-			p = mat.ptr<float>(i);
-			q = acc.ptr<float>(k);
-
-			//Get columns to iterate between
-			int c = (int)std::sqrt(rad*rad-rel_row*rel_row);
-			int min = std::max(min_col, col-c);
-			int max = std::min(max_col, col+c);
-
-			//Iterate across columns
-			for (int j = min, l = acc_col-c; j <= max; j++, l++)
-			{
-				q[l] += p[j];
-			}
-		}
+		disk_add<float>(mat, cv::Point(col, row), acc, cv::Point(acc_col, acc_row), get_disk_spans(rad));
 	}
 
 	/*Calculate an initial estimate for the dark field decoupled Bragg profile using the preprocessed Bragg peaks. This function is redundant.
@@ -278,11 +248,11 @@ namespace ba
 							//Find if the overlapping region is entirely on the image
 							if (on_img(co.bounding_rect[0], cols, rows) && on_img(co.bounding_rect[1], cols, rows))
 							{
-								//Create a mask idicating where the circles overlap to extract the values from the images
-								cv::Mat co_mask = gen_circ_overlap_mask(co.P1, radius, co.P2, radius, cols, rows);
+								//Get the runs of pixels where the circles overlap to extract the values from the images
+								span_region co_spans = gen_circ_overlap_spans(co.P1, radius, co.P2, radius, cols, rows);
 
-								//Get the number of overlapping pixels from the mask
-								int num_overlap = cv::countNonZero(co_mask);
+								//Get the number of overlapping pixels
+								int num_overlap = co_spans.num_px;
 								px_tot += num_overlap;
 
 								//Parameters describing each overlap. By index: 0 - Fraction of circle radius from the first circle's center,
@@ -291,27 +261,24 @@ namespace ba
 								std::vector<cv::Vec3d> overlaps(num_overlap);
 
 								//Get the pixel value and distances from circle centers for pixels in the overlapping region
-								byte *b;
-								for (int i = 0, co_num = 0; i < co_mask.rows; i++)
+								for (int s = 0, co_num = 0; s < co_spans.spans.size(); s++)
 								{
-									b = co_mask.ptr<byte>(i);
-									for (int j = 0; j < co_mask.cols; j++)
+									int i = co_spans.spans[s].row;
+									float *p = groups[m].ptr<float>(i-group_pos[m].y);
+									float *q = groups[n].ptr<float>(i-group_pos[n].y);
+									for (int j = co_spans.spans[s].start; j < co_spans.spans[s].end; j++)
 									{
-										//If the pixel is marked as an overlapping region pixel
-										if (b[j])
-										{
-											//Get distances from the circle centres
-											double dist1, dist2;
-											dist1 = std::sqrt((j-co.P1.x)*(j-co.P1.x) + (i-co.P1.y)*(i-co.P1.y));
-											dist2 = std::sqrt((j-co.P2.x)*(j-co.P2.x) + (i-co.P2.y)*(i-co.P2.y));
-
-											//Get the values of the pixels
-											double val1, val2;
-											val1 = groups[m].at<float>(i-group_pos[m].y, j-group_pos[m].x);
-											val2 = groups[n].at<float>(i-group_pos[n].y, j-group_pos[n].x);
-
-											overlaps[co_num++] = cv::Vec3d(dist1, dist2, val1/val2);
-										}
+										//Get distances from the circle centres
+										double dist1, dist2;
+										dist1 = std::sqrt((j-co.P1.x)*(j-co.P1.x) + (i-co.P1.y)*(i-co.P1.y));
+										dist2 = std::sqrt((j-co.P2.x)*(j-co.P2.x) + (i-co.P2.y)*(i-co.P2.y));
+
+										//Get the values of the pixels
+										double val1, val2;
+										val1 = p[j-group_pos[m].x];
+										val2 = q[j-group_pos[n].x];
+
+										overlaps[co_num++] = cv::Vec3d(dist1, dist2, val1/val2);
 									}
 								}
 
@@ -507,72 +474,9 @@ namespace ba
 	cv::Mat gen_circ_overlap_mask(cv::Point2d P1, const int r1, cv::Point2d P2, const int r2, const int cols,
 		const int rows, const byte val)
 	{
-		//Create separate masks to draw the circles on
-		cv::Mat circle1 = cv::Mat(rows, cols, CV_8UC1, cv::Scalar(0));
-		cv::Mat circle2 = cv::Mat(rows, cols, CV_8UC1, cv::Scalar(0));
-
-		//Draw first circle
-		{
-			//Get the minimum and maximum rows and columns to iterate between
-			int min_col, max_col, min_row, max_row;
-			min_col = std::max(0, (int)(P1.x-r1));
-			max_col = std::min(cols-1, (int)(P1.x+r1));
-			min_row = std::max(0, (int)(P1.y-r1));
-			max_row = std::min(rows-1, (int)(P1.y+r1));
-
-			//Iterate accross the circle rows
-			byte *p;
-            #pragma omp parallel for
-			for (int i = min_row, rel_row = min_row-P1.y; i <= max_row; i++, rel_row++)
-			{
-				//Create C-style pointers to interate across the circle with
-				p = circle1.ptr<byte>(i);
-
-				//Get columns to iterate between
-				int c = (int)std::sqrt(r1*r1-rel_row*rel_row);
-				int min = std::max(min_col, (int)(P1.x-c));
-				int max = std::min(max_col, (int)(P1.x+c));
-
-				//Iterate across columns
-				for (int j = min; j <= max; j++)
-				{
-					p[j] = val;
-				}
-			}
-		}
-
-		//Draw second circle
-		{
-			//Get the minimum and maximum rows and columns to iterate between
-			int min_col, max_col, min_row, max_row;
-			min_col = std::max(0, (int)(P2.x-r2));
-			max_col = std::min(cols-1, (int)(P2.x+r2));
-			min_row = std::max(0, (int)(P2.y-r2));
-			max_row = std::min(rows-1, (int)(P2.y+r2));
-
-			//Iterate accross the circle rows
-			byte *p;
-            #pragma omp parallel for
-			for (int i = min_row, rel_row = min_row-P2.y; i <= max_row; i++, rel_row++)
-			{
-				//Create C-style pointers to interate across the circle with
-				p = circle2.ptr<byte>(i);
-
-				//Get columns to iterate between
-				int c = (int)std::sqrt(r2*r2-rel_row*rel_row);
-				int min = std::max(min_col, (int)(P2.x-c));
-				int max = std::min(max_col, (int)(P2.x+c));
-
-				//Iterate across columns
-				for (int j = min; j <= max; j++)
-				{
-					p[j] = val;
-				}
-			}
-		}
-		
-		//The overlapping region is where both circles are marked
-		return circle1 & circle2;
+		//Calculate the overlapping region's runs of pixels from the circle equations and mark them
+		span_region region = gen_circ_overlap_spans(P1, r1, P2, r2, cols, rows);
+		return span_region_to_mask(region, cols, rows, cv::Point(0, 0), val);
 	}
 
 	/*Overload the << operator to print circ_overlap structures
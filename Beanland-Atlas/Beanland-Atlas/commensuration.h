@@ -3,7 +3,10 @@
 #include <includes.h>
 
 #include <commensuration_utility.h>
+#include <disk_spans.h>
 #include <distortion_correction.h>
+#include <overlap_spans.h>
+#include <spot_frame_index.h>
 #include <matlab.h> //Matlab-specific includes
 
 namespace ba
@@ -32,6 +35,7 @@ namespace ba
 	**Inputs:
 	**mats: std::vector<cv::Mat> &, Individual floating point images that have been stereographically corrected to extract spots from
 	**spot_pos: cv::Point2d, Position of located spot in the aligned diffraction pattern
+	**hits: std::vector<spot_hit> &, Frames that the spot is on
 	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images
 	**col_max: const int, Maximum column difference between spot positions
 	**row_max: const int, Maximum row difference between spot positions
@@ -39,8 +43,8 @@ namespace ba
 	**Returns:
 	**std::vector<cv::Mat>, Dynamical diffraction effect decoupled Bragg profile
 	*/
-	std::vector<cv::Mat> bragg_envelope(std::vector<cv::Mat> &mats, cv::Point2d &spot_pos, std::vector<std::vector<int>> &rel_pos,
-		const int col_max, const int row_max, const int radius);
+	std::vector<cv::Mat> bragg_envelope(std::vector<cv::Mat> &mats, cv::Point2d &spot_pos, std::vector<spot_hit> &hits,
+		std::vector<std::vector<int>> &rel_pos, const int col_max, const int row_max, const int radius);
 
 	/*Identify groups of consecutive spots that all have the same position
 	**Input:
@@ -54,19 +58,15 @@ namespace ba
 	**Inputs:
 	**mats: std::vector<cv::Mat> &, Images to extract the spots from
 	**grouped_idx: std::vector<std::vector<int>> &, Groups of consecutive image indices where the spots are all in the same position
-	**spot_pos: cv::Point2d &, Position of the spot on the aligned images average px values diffraction pattern
-	**rel_pos: std::vector<std::vector<int>> &, Relative positions of the spots in the input images to the first image
-	**col_max: const int &, Maximum column difference between spot positions
-	**row_max: const int &, Maximum row difference between spot positions
+	**hits: std::vector<spot_hit> &, Frames that the spot is on
 	**radius: const int &, Radius of the spot
 	**diam: const int &, Diameter of the spot
 	**groups: std::vector<cv::Mat> &, Output preprocessed Bragg peaks, ready for dark field decoupled profile extraction
 	**group_pos: std::vector<cv::Point> &, Positions of top left corners of circles' bounding squares
 	**is_in_img: std::vector<bool> &, Output to mark true when the spot is in the image so that indices can be grouped
 	*/
-	void grouping_preproc(std::vector<cv::Mat> &mats, std::vector<std::vector<int>> &grouped_idx, cv::Point2d &spot_pos, 
-		std::vector<std::vector<int>> &rel_pos, const int &col_max, const int &row_max, const int &radius,
-		const int &diam, std::vector<cv::Mat> &groups, std::vector<cv::Point> &group_pos, std::vector<bool> &is_in_img);
+	void grouping_preproc(std::vector<cv::Mat> &mats, std::vector<std::vector<int>> &grouped_idx, std::vector<spot_hit> &hits,
+		const int &radius, const int &diam, std::vector<cv::Mat> &groups, std::vector<cv::Point> &group_pos, std::vector<bool> &is_in_img);
 
 	/*Extracts a circle of data from an OpenCV mat and accumulates it in another mat. It is assumed that the dimensions specified for
 	**the accumulator will allow the full circle-sized extraction to be accumulated
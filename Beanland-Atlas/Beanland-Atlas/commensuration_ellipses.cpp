@@ -8,19 +8,16 @@ namespace ba
 	**Inputs:
 	**mats: std::vector<cv::Mat> &, Individual images to extract spots from
 	**spot_pos: std::vector<cv::Point> &, Positions of located spots in aligned diffraction pattern
-	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images to first image
-	**col_max: const int &, Maximum column difference between spot positions
-	**row_max: const int &, Maximum row difference between spot positions
+	**index: spot_frame_index &, Frames that each spot is on
 	**ellipses: std::vector<std::vector<std::vector<double>>> &, For each image, for each spot that an ellipse can be fitted 
-	**to, a set of 5 parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - major axis, 3 - minor axis,
+	**to, a set of 5 parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major axis, 3 - semi-minor axis,
 	**4 - Angle between the major axis and the x axis
 	**acc: cv::Mat &, Average of the aligned diffraction patterns
 	**rad_llim: const int, Lower limit for spot radii to consider.
 	**rad_ulim: const int, Upper limit for spot radii to consider. SHould be at least 1 higher than the lower limit
 	*/
-	void get_spot_ellipses(std::vector<cv::Mat> &mats, std::vector<cv::Point> &spot_pos, std::vector<std::vector<int>> &rel_pos,
-		const int &col_max,	const int &row_max,	cv::Mat &acc, std::vector<std::vector<std::vector<double>>> &ellipses,
-		const int rad_llim, const int rad_ulim)
+	void get_spot_ellipses(std::vector<cv::Mat> &mats, std::vector<cv::Point> &spot_pos, spot_frame_index &index, cv::Mat &acc,
+		std::vector<std::vector<std::vector<double>>> &ellipses, const int rad_llim, const int rad_ulim)
 	{
 		//Use the Scharr filtrate of the aligned diffraction patterns to estimate the ellipses
 		std::vector<std::vector<cv::Point>> acc_ellipses;
@@ -29,47 +26,16 @@ namespace ba
 		cv::Mat scharr;
 		scharr_amp(acc, scharr);
 
-		//Create mask for drawing annuluses on
-		byte *p;
-		int mask_size = 2*rad_ulim+1;
-		cv::Mat mask = cv::Mat(mask_size, mask_size, CV_8UC1, cv::Scalar(0));
+		//Bins of the pixels about each spot. Every spot uses the same window, so it is only binned once
+		const radial_bins &bins = get_radial_bins(rad_ulim);
 
 		//Get the approximate sizes of the annuluses
 		std::vector<cv::Vec2f> annulus_radii(spot_pos.size());
-        #pragma omp parallel for
-		for (int i = 0; i < spot_pos.size(); i++)
+		parallel_for(0, spot_pos.size(), [&](int i)
 		{
-			//Generate a radial spectrum of the Scharr filtrate centered at the point
-			cv::Mat radial_scharr = cv::Mat(rad_ulim-rad_llim+1, 1, CV_8UC1);
-			for (int r = rad_llim, k = 0; r <= rad_ulim; r++, k++)
-			{
-				//Draw the annulus on the mask
-				cv::circle(mask, cv::Point(rad_ulim, rad_ulim), r, cv::Scalar(1), 1, 8, 0);
-
-				//Count the pixels indicated by non-zero pixels on the mask
-				float sum = 0.0f;
-				int count = 0;
-				for (int m = 0; m < mask.rows; m++)
-				{
-					p = mask.ptr<byte>(m);
-					for (int n = 0; n < mask.cols; n++)
-					{
-						//Only accumulate pixels indicated by the mask
-						if (p[n])
-						{
-							sum += scharr.at<float>(m+spot_pos[i].y, n+spot_pos[i].x);
-
-							count++;
-						}
-					}
-				}
-
-				//Record the average Scharr filtrate at this radius about the point
-				radial_scharr.at<float>(k, 0) = sum / count;
-
-				//Blacken the annulus on the mask so that it can be reused
-				cv::circle(mask, cv::Point(rad_ulim, rad_ulim), r, cv::Scalar(0), 1, 8, 0);
-			}
+			//Radial spectrum of the Scharr filtrate centered at the point between the radii being considered, from a single pass
+			//over the window
+			cv::Mat radial_scharr = radial_profile(scharr, spot_pos[i], bins).rowRange(rad_llim, rad_ulim+1).clone();
 
 			//Position and value of maximum
 			double max;
@@ -77,14 +43,10 @@ namespace ba
 			cv::minMaxLoc(radial_scharr, NULL, &max, NULL, &maxLoc);
 			int max_pos = maxLoc.y;
 
-			std::cout << radial_scharr << std::endl;
-
 			//k-means cluster the radial intensities into high and low values
 			cv::Mat mask;
 			kmeans_mask(radial_scharr, mask, 2, 0); //The low intensity values will be marked with non-zeros
 
-			std::cout << mask << std::endl;
-
 			//Find the extent of the maximum by fitting linear lines to the lower intensity values on either side of it
 			int l = 0, u = rad_ulim - rad_llim;
 			
@@ -144,40 +106,54 @@ namespace ba
 						if (ssd < min_ssd)
 						{
 							min_ssd = ssd;
-							l = uidx;
+							u = uidx;
 						}
 					}
 				}
 			}
-			std::cout << l << ", " << u << std::endl;
-			std::getchar();
-
 			//Record the lower and upper radial intercepts to constrain the range of radii to look for the ellipse in
 			annulus_radii[i] = cv::Vec2f(rad_llim+l, rad_llim+u);
+		});
+
+		//Get the positions of spots in each image from the frames each spot is on
+		std::vector<std::vector<cv::Point>> img_spot_pos(mats.size());
+		std::vector<std::vector<cv::Vec2f>> img_annulus_rad(mats.size());
+		for (int j = 0; j < spot_pos.size(); j++)
+		{
+			for (int k = 0; k < index.hits[j].size(); k++)
+			{
+				img_spot_pos[index.hits[j][k].frame].push_back(index.hits[j][k].origin);
+				img_annulus_rad[index.hits[j][k].frame].push_back(annulus_radii[j]);
+			}
 		}
 
-		//Get the positions of spots in each image
+		//Calculate the amplitudes of the images' Scharr filtrates
+		std::vector<cv::Mat> scharrs(mats.size());
+		parallel_for(0, mats.size(), [&](int i)
+		{
+			scharr_amp(mats[i], scharrs[i]);
+		});
+
+		//List the image and index in it of every spot so that the fits can all be batched together, rather than only
+		//the spots on each image
+		std::vector<std::pair<int, int>> fits;
 		ellipses = std::vector<std::vector<std::vector<double>>>(mats.size());
-        #pragma omp parallel for
 		for (int i = 0; i < mats.size(); i++)
 		{
-			//Try to fit an ellipse to each spot in the image
-			std::vector<cv::Point> img_spot_pos;
-			std::vector<cv::Vec2f> img_annulus_rad;
-			for (int j = 0; j < spot_pos.size(); j++)
+			ellipses[i] = std::vector<std::vector<double>>(img_spot_pos[i].size());
+			for (int j = 0; j < img_spot_pos[i].size(); j++)
 			{
-				//Get the position of this spot in the image
-				cv::Point point = cv::Point(spot_pos[j].x-col_max+rel_pos[0][i], spot_pos[j].y-row_max+rel_pos[1][i]);
-
-				//Prepare vectors for spots in the image
-				if ( on_img(mats[i], point) )
-				{
-					img_spot_pos.push_back(point);
-					img_annulus_rad.push_back(annulus_radii[j]);
-				}
+				fits.push_back(std::make_pair(i, j));
 			}
-			get_ellipses(mats[i], img_spot_pos, img_annulus_rad, ellipses[i]);
 		}
+
+		//Try to fit an ellipse to each spot in each image. The fits run in parallel up to their weighted k-means clustering,
+		//which uses MATLAB and is serialised, so that step limits how well the fits scale
+		parallel_for(0, fits.size(), [&](int k)
+		{
+			int i = fits[k].first, j = fits[k].second;
+			ellipses[i][j] = fit_spot_ellipse(scharrs[i], img_spot_pos[i][j], img_annulus_rad[i][j]);
+		});
 	}
 
 	/*Amplitude of image's Scharr filtrate
@@ -193,106 +169,117 @@ namespace ba
 		cv::Sobel(img, grady, CV_32FC1, 1, 0, CV_SCHARR);
 
 		//Sum the gradients in quadrature
-		float *p, *q;
-        #pragma omp parallel for
-		for (int i = 0; i < img.rows; i++)
+		parallel_for(0, img.rows, [&](int i)
 		{
-			p = gradx.ptr<float>(i);
-			q = grady.ptr<float>(i);
+			float *p = gradx.ptr<float>(i);
+			float *q = grady.ptr<float>(i);
 			for (int j = 0; j < img.cols; j++)
 			{
 				p[j] = std::sqrt(p[j]*p[j] + q[j]*q[j]);
 			}
-		}
+		});
 
 		scharr_amp = gradx;
 	}
 
-	/*Use weighted sums of squared differences to calculate the sizes of the ellipses from an image's Scharr filtrate
+	/*Fit an ellipse to a spot using its Scharr filtrate
 	**Inputs:
-	**img: cv::Mat &, Image to find the size of ellipses at the estimated positions in
-	**spot_pos: std::vector<cv::Point>, Positions of spots in the image
-	**est_rad: std::vector<cv::Vec2f> &, Two radii to look for the ellipse between
-	**ellipses: std::vector<std::vector<std::vector<double>>> &, For each spot that an ellipse can be fitted to, a set of
-	**5 parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - major axis, 3 - minor axis, 4 - Angle
-	**between the major axis and the x axis
+	**scharr: cv::Mat &, Amplitude of the Scharr filtrate of the image the spot is on
+	**spot_pos: cv::Point, Position of the spot in the image
+	**est_rad: cv::Vec2f, Two radii to look for the ellipse between
+	**Returns:
+	**std::vector<double>, 5 parameters describing the ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major axis,
+	**3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians. The vector is empty if an ellipse
+	**cannot be fitted to the spot
 	*/
-	void get_ellipses(cv::Mat &img, std::vector<cv::Point> spot_pos, std::vector<cv::Vec2f> est_rad,
-		std::vector<std::vector<double>> &ellipses)
+	std::vector<double> fit_spot_ellipse(cv::Mat &scharr, cv::Point spot_pos, cv::Vec2f est_rad)
 	{
-		//Calculate the amplitude of the image's Scharr filtrate
-		cv::Mat scharr;
-		scharr_amp(img, scharr);
-
-		//Get the 5 degrees of freedom describing each ellipse on the image
-		ellipses = std::vector<std::vector<double>>(spot_pos.size());
-        #pragma omp parallel for
-		for (int i = 0; i < spot_pos.size(); i++)
+		//Length scale of the ellipse
+		double f0 = 0.5*(est_rad[0]+est_rad[1]);
+
+		//Region where the ellipse is located, clipped to the part of it that is on the image
+		int outer_rad = (int)std::ceil(est_rad[1]);
+		cv::Point top_left = cv::Point(spot_pos.x-outer_rad, spot_pos.y-outer_rad);
+		cv::Rect window = cv::Rect(top_left.x, top_left.y, 2*outer_rad+1, 2*outer_rad+1) & cv::Rect(0, 0, scharr.cols, scharr.rows);
+		if (!window.area())
 		{
-			//Length scale of the ellipse
-			double f0 = 0.5*(est_rad[i][0]+est_rad[i][1]);
+			return std::vector<double>();
+		}
 
-			//Extract the region where the ellipse is located
-			cv::Mat annulus_mask, annulus;
-			create_annular_mask(annulus_mask, 2*est_rad[i][1]+1, est_rad[i][0], est_rad[i][1]);
-			get_mask_values( scharr, annulus, annulus_mask, cv::Point2i( spot_pos[i].y-est_rad[i][1], spot_pos[i].y-est_rad[i][1] ) );
+		//Extract the Scharr filtrate on the annulus where the ellipse is located
+		cv::Mat full_mask;
+		create_annular_mask(full_mask, 2*outer_rad+1, est_rad[0], est_rad[1]);
+		cv::Mat annulus_mask = full_mask(window - top_left);
+		cv::Mat annulus = cv::Mat::zeros(annulus_mask.size(), CV_32FC1);
+		scharr(window).copyTo(annulus, annulus_mask);
 
-			//Refine the mask using k-means clustering to create a mask identifying the pixels of high gradiation
-			cv::Mat mask;
-			kmeans_mask(annulus, mask, 2, 1, annulus_mask);
-
-			//Use weighted hyper-renormalisation to fit a conic to the data
-			std::vector<double> ellipse = hyper_renorm_ellipse(mask, annulus, f0);
-
-			//Calculate the distances of points from the ellipse
-			std::vector<double> dists;
-			dists_from_ellipse(annulus_mask, annulus, ellipse, dists);
-
-			//Get the weights corresponding to the distances
-			int nnz_px = cv::countNonZero(annulus_mask);
-			std::vector<double> weights;
-			img_2D_to_1D(annulus, weights, annulus_mask);
-
-			//Use weighted k-means clustering to cluster intensity-weighted distances from the initial ellipse estimate
-			//into 3 groups
-			std::vector<std::vector<double>> dists_packaged(1, dists);
-			std::vector<std::vector<double>> centers;
-			std::vector<int> labels;
-			weighted_kmeans(dists_packaged, weights, 3, centers, labels);
-
-			//Identify the low and high centers
-			std::vector<double> center_vals(3);
-			center_vals[0] = centers[0][0]; center_vals[1] = centers[1][0]; center_vals[2] = centers[2][0];
-			std::sort(center_vals.begin(), center_vals.end());
-			double llim = center_vals[0];
-			double ulim = center_vals[2];
-
-			//Identify all pixels between the low and high distance center values
-			cv::Mat refined_mask = cv::Mat(annulus_mask.size(), CV_8UC1, cv::Scalar(0));
-			byte *p, *q;
-			for (int y = 0, k = 0; y < annulus_mask.rows; y++)
+		//Refine the mask using k-means clustering to create a mask identifying the pixels of high gradiation
+		cv::Mat mask;
+		kmeans_mask(annulus, mask, 2, 1, annulus_mask);
+
+		//Use weighted hyper-renormalisation to fit a conic to the data
+		std::vector<double> ellipse = hyper_renorm_ellipse(mask, annulus, f0);
+		if (ellipse.empty())
+		{
+			return ellipse;
+		}
+
+		//Calculate the distances of points from the ellipse
+		std::vector<double> dists;
+		dists_from_ellipse(annulus_mask, annulus, ellipse, dists);
+
+		//Get the weights corresponding to the distances
+		std::vector<double> weights;
+		img_2D_to_1D(annulus, weights, annulus_mask);
+
+		//Use weighted k-means clustering to cluster intensity-weighted distances from the initial ellipse estimate
+		//into 3 groups
+		std::vector<std::vector<double>> dists_packaged(1, dists);
+		std::vector<std::vector<double>> centers;
+		std::vector<int> labels;
+		weighted_kmeans(dists_packaged, weights, 3, centers, labels);
+
+		//Identify the low and high centers
+		std::vector<double> center_vals(3);
+		center_vals[0] = centers[0][0]; center_vals[1] = centers[1][0]; center_vals[2] = centers[2][0];
+		std::sort(center_vals.begin(), center_vals.end());
+		double llim = center_vals[0];
+		double ulim = center_vals[2];
+
+		//Identify all pixels between the low and high distance center values
+		cv::Mat refined_mask = cv::Mat(annulus_mask.size(), CV_8UC1, cv::Scalar(0));
+		byte *p, *q;
+		for (int y = 0, k = 0; y < annulus_mask.rows; y++)
+		{
+			p = annulus_mask.ptr<byte>(y);
+			q = refined_mask.ptr<byte>(y);
+			for (int x = 0; x < annulus_mask.cols; x++)
 			{
-				p = annulus_mask.ptr<byte>(y);
-				q = refined_mask.ptr<byte>(y);
-				for (int x = 0; x < annulus_mask.cols; x++)
+				//If the value is on the mask...
+				if (p[x])
 				{
-					//If the value is on the mask...
-					if (p[x])
+					//...check if the distance is within the range
+					if (centers[labels[k]][0] >= llim && centers[labels[k]][0] <= ulim)
 					{
-						//...check if the distance is within the range
-						if (centers[labels[k]][0] >= llim && centers[labels[k]][0] <= ulim)
-						{
-							q[x] = 1;
-						}
-
-						k++;
+						q[x] = 1;
 					}
+
+					k++;
 				}
 			}
+		}
+
+		//Repeat the weighted hyper-renormalisation using the refined mask
+		ellipse = hyper_renorm_ellipse(refined_mask, annulus, f0);
 
-			//Repeat the weighted hyper-renormalisation using the refined mask
-			ellipses[i] = hyper_renorm_ellipse(refined_mask, annulus, f0);
+		//Move the ellipse from the region to the image
+		if (!ellipse.empty())
+		{
+			ellipse[0] += window.x;
+			ellipse[1] += window.y;
 		}
+
+		return ellipse;
 	}
 
 	/*Create annular mask
@@ -302,7 +289,7 @@ namespace ba
 	**outer_rad: const int, Outer radius of the annulus
 	**val, const byte, Value to set the elements withing the annulus. Defaults to 1
 	*/
-	void create_annular_mask(cv::Mat annulus, const int size, const int inner_rad, const int outer_rad, const byte val)
+	void create_annular_mask(cv::Mat &annulus, const int size, const int inner_rad, const int outer_rad, const byte val)
 	{
 		//Create mask
 		annulus = cv::Mat::zeros(cv::Size(size, size), CV_8UC1);
@@ -311,11 +298,9 @@ namespace ba
 		cv::Point origin = cv::Point((int)(size/2), (int)(size/2));
 
 		//Set the elements in the annulus to the default value
-		byte *p;
-        #pragma omp parallel for
-		for (int i = 0; i < size; i++)
+		parallel_for(0, size, [&](int i)
 		{
-			p = annulus.ptr<byte>(i);
+			byte *p = annulus.ptr<byte>(i);
 			for (int j = 0; j < size; j++)
 			{
 				//Mark the position if it is in the annulus
@@ -325,7 +310,7 @@ namespace ba
 					p[j] = val;
 				}
 			}
-		}
+		});
 	}
 
 	/*Extracts values at non-zero masked elements in an image, constraining the boundaries of a mask so that only maked 
@@ -441,28 +426,23 @@ namespace ba
 	**weights: cv::Mat &, 32-bit mask. Weights of the individual data points
 	**f0: const double, Approximate size of the ellipse. This is arbitrary, but choosing a value close
 	**to the correct size reduces numerical errors
-	**thresh: const double, Iterations will be concluded if the cosine of the angle between successive eigenvectors divided
-	**by the amplitude ratio (larger divided by the smaller) is smaller than the threshold
+	**thresh: const double, Iterations will be concluded when the norm of the difference between successive unit coefficient
+	**vectors is smaller than the threshold
 	**max_iter: const int, The maximum number of iterations to perform. If this limit is reached, the last iteration's conic
-	**coefficients will be returned
+	**coefficients will be used
 	**Returns:
-	**std::vector<double>, Coefficients of the conic equation
+	**std::vector<double>, 5 parameters describing the ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major axis,
+	**3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians. The vector is empty if the fitted conic
+	**is not an ellipse
 	*/
 	std::vector<double> hyper_renorm_ellipse(cv::Mat &mask, cv::Mat weights, const double f0, const double thresh, 
 		const int max_iter)
 	{
-		//Initialise the MATLAB engine
-		matlab::data::ArrayFactory factory;
-		std::unique_ptr<matlab::engine::MATLABEngine> matlabPtr = matlab::engine::connectMATLAB();
-
-		//Package the mask positions and weights into vectors so that they can be passed to MATLAB
-		size_t nnz_px = cv::countNonZero(mask);
-		std::vector<double> x(nnz_px); //x position
-		std::vector<double> y(nnz_px); //y position
-		std::vector<double> w(nnz_px); //Weight
+		//Package the mask positions and weights into a batch of points
+		conic_points pts;
 		byte *p;
 		float *q;
-		for (int i = 0, k = 0; i < mask.rows; i++)
+		for (int i = 0; i < mask.rows; i++)
 		{
 			p = mask.ptr<byte>(i);
 			q = weights.ptr<float>(i);
@@ -471,41 +451,21 @@ namespace ba
 				//Prepare the data for points marked on the mask
 				if (p[j])
 				{
-					x[k] = (double)j;
-					y[k] = (double)i;
-					w[k] = (double)q[j];
-
-					k++;
+					pts.x.push_back((double)j);
+					pts.y.push_back((double)i);
+					pts.w.push_back((double)q[j]);
 				}
 			}
 		}
 
-		//Package data for the cubic Bezier profile calculator
-		std::vector<matlab::data::Array> args({
-			factory.createArray( { nnz_px, 1 }, x.begin(), x.end() ), //Point x positions
-			factory.createArray( { nnz_px, 1 }, y.begin(), y.end() ), //Point y positions
-			factory.createArray( { nnz_px, 1 }, w.begin(), w.end() ), //Point weights
-			factory.createScalar<double>(f0), //Size scale
-			factory.createScalar<int32_t>(max_iter), //Maximum number of iterations
-			factory.createScalar<double>(thresh) //Minimum desired similarity of parameters from successive iterations
-		});
-
-		//Pass data to MATLAB to calculate the cubic Bezier profile
-		matlab::data::TypedArray<double> const el = matlabPtr->feval(
-			matlab::engine::convertUTF8StringToUTF16String("hyper_renorm_ellipse"), args);
-
-		//Return the ellipse parameters in an easy-to-use vector
-		std::vector<double> ellipse_param(5);
+		//Fit a conic to the points and get the ellipse it describes
+		std::vector<double> conic = hyper_renorm_conic(pts, f0, thresh, max_iter);
+		if (conic.empty())
 		{
-			int k = 0;
-			for (auto val : el)
-			{
-				ellipse_param[k] = val;
-				k++;
-			}
+			return conic;
 		}
 
-		return ellipse_param;
+		return ellipse_param_from_conic(conic);
 	}
 
 	/*Calculate the center and 4 extremal points of an ellipse (at maximum and minimum distances from the center) from
@@ -621,13 +581,11 @@ namespace ba
 		}
 
 		//Sum along the rows of the rotated matrix, skipping zero-valued elements
-		float *p;
 		std::vector<float> row_sums;
-        #pragma omp parallel for
-		for (int i = 0; i < rot.rows; i++)
+		parallel_for(0, rot.rows, [&](int i)
 		{
 			int num_contrib = 0;
-			p = rot.ptr<float>(i);
+			float *p = rot.ptr<float>(i);
 			for (int j = 0; j < rot.cols; j++)
 			{
 				//If the element is non-zero
@@ -639,7 +597,7 @@ namespace ba
 			}
 
 			row_sums[i] /= num_contrib;
-		}
+		});
 
 		/* Set up matrices to find the least squares solution that fits the intensity profile */
 
@@ -678,7 +636,8 @@ namespace ba
 		}
 	}
 
-	/*Perform weighted k-means clustering using a MATLAB script
+	/*Perform weighted k-means clustering using a MATLAB script. The MATLAB engine is shared, so calls are serialised and
+	**parallel callers wait for each other here
 	**Inputs:
 	**data: std::vector<std::vector<double>> &, Data set to apply weighted k-means clustering to. The data set for each variable
 	**should be the same size. The inner vector is the values for a particular varaible
@@ -690,6 +649,10 @@ namespace ba
 	void weighted_kmeans(std::vector<std::vector<double>> &data, std::vector<double> &weights, const int k, 
 		std::vector<std::vector<double>> &centers, std::vector<int> &labels)
 	{
+		//The MATLAB engine is not thread-safe, so only one call uses it at a time
+		static std::mutex matlab_mutex;
+		std::lock_guard<std::mutex> lock(matlab_mutex);
+
 		//Initialise the MATLAB engine
 		matlab::data::ArrayFactory factory;
 		std::unique_ptr<matlab::engine::MATLABEngine> matlabPtr = matlab::engine::connectMATLAB();
@@ -749,23 +712,18 @@ namespace ba
 	**Inputs:
 	**mask: cv::Mat &, 8-bit mask whose non-zero values indicate the positions of points
 	**img: cv::Mat &, Image to record the values of at the positions marked on the mask
-	**param: std::vector<double> &, Parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - major
-	**axis, 3 - minor axis, 4 - Angle between the major axis and the x axis
-	**dists: std::vector<double> &, Output distances from the ellipse,
-	**accuracy: const double, Accuracy to find distances from ellipses to
+	**param: std::vector<double> &, Parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major
+	**axis, 3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians
+	**dists: std::vector<double> &, Output distances from the ellipse. Distances of points inside the ellipse are negative
+	**accuracy: const double, Accuracy to find distances from ellipses to in px
 	*/
 	void dists_from_ellipse(cv::Mat &mask, cv::Mat &img, std::vector<double> &param, std::vector<double> &dists,
 		const double accuracy)
 	{
-		//Initialise the MATLAB engine
-		matlab::data::ArrayFactory factory;
-		std::unique_ptr<matlab::engine::MATLABEngine> matlabPtr = matlab::engine::connectMATLAB();
-
-		//If the data set has multiple variables, rearrange them so that they can be packaged for MATLAB
-		size_t nnz_px = cv::countNonZero(mask);
-		std::vector<double> x(2*nnz_px); //1D set of mask point positions
+		//Package the positions of points on the mask into a batch
+		conic_points pts;
 		byte *b;
-		for (int i = 0, k = 0; i < mask.rows; i++)
+		for (int i = 0; i < mask.rows; i++)
 		{
 			b = mask.ptr<byte>(i);
 			for (int j = 0; j < mask.cols; j++)
@@ -773,41 +731,12 @@ namespace ba
 				//Record the positions of points on the mask
 				if (b[j])
 				{
-					x[k++] = (double)j;
-					x[k++] = (double)i;
+					pts.x.push_back((double)j);
+					pts.y.push_back((double)i);
 				}
 			}
 		}
 
-		//Package data for projection onto the ellipse
-		std::vector<matlab::data::Array> args({
-			factory.createArray( { nnz_px, 2 }, x.begin(), x.end() ), //Positions of points
-			factory.createArray( { 5, 1 }, param.begin(), param.end() ) //Ellipse parameters
-		});
-
-		//Pass data to MATLAB to calculate the positions of points projected onto the ellipse
-		matlab::data::TypedArray<double> const d = matlabPtr->feval(
-			matlab::engine::convertUTF8StringToUTF16String("project_onto_ellipse"), args);
-
-
-		//Return distances in a convenient-to-use vector
-		dists = std::vector<double>(nnz_px);
-		{
-			//Get the distances between points and their projections onto the ellipse
-			double c = std::cos(param[4]);
-			double s = std::sin(param[4]);
-			for (int i = 0, k = 0; i < 2*nnz_px; i += 2, k++)
-			{
-				dists[k] = std::sqrt((d[i]-x[i])*(d[i]-x[i]) + (d[i+1]-x[i+1])*(d[i+1]-x[i+1]));
-				
-				//Make distances to points inside the ellipse negative
-				double r = d[i]*c - d[i+1]*s;
-				double z = d[i]*s + d[i+1]*c;
-				if (r*r/(param[2]*param[2]) + z*z/(param[3]*param[3]) <= 1.0)
-				{
-					dists[k] = -dists[k];
-				}
-			}
-		}
+		ellipse_dists(pts, param, dists, accuracy);
 	}
 }
\ No newline at end of file
@@ -4,8 +4,12 @@
 
 #include <aberration_correction.h>
 #include <commensuration.h>
+#include <conic_fitting.h>
 #include <ident_sym_utility.h>
 #include <matlab.h> //Matlab-specific includes
+#include <radial_profile.h>
+#include <spot_frame_index.h>
+#include <task_scheduler.h>
 #include <utility.hpp>
 
 namespace ba
@@ -15,10 +19,10 @@ namespace ba
 
 	//Hyper-renormalisation ellipse fitting defaults
     #define HYPER_RENORM_DEFAULT_SCALE 1 //Scale of the ellipe. 1 is arbitrary. Choosing a better value will reduce numberical errors
-    #define HYPER_RENORM_DEFAULT_THRESH 0.9 //Cosine of angle between eigenvectors divided by ratio of higher sized to smaller for conclusion of iterations
+    #define HYPER_RENORM_DEFAULT_THRESH 1.0e-6 //Norm of the difference between successive unit coefficient vectors for conclusion of iterations
     #define HYPER_RENORM_DEFAULT_ITER 15 //Maximum number of iterations
 
-	//Accuracy to find distances from ellipses as a fraction of the pixel size
+	//Accuracy to find distances from ellipses in px
     #define DISTS_FROM_EL_ACC 0.1
 
 	//Custom data structure to hold ellipse parameters
@@ -36,19 +40,16 @@ namespace ba
 	**Inputs:
 	**mats: std::vector<cv::Mat> &, Individual images to extract spots from
 	**spot_pos: std::vector<cv::Point> &, Positions of located spots in aligned diffraction pattern
-	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images to first image
-	**col_max: const int &, Maximum column difference between spot positions
-	**row_max: const int &, Maximum row difference between spot positions
+	**index: spot_frame_index &, Frames that each spot is on
 	**ellipses: std::vector<std::vector<std::vector<double>>> &, For each image, for each spot that an ellipse can be fitted 
-	**to, a set of 5 parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - major axis, 3 - minor axis,
+	**to, a set of 5 parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major axis, 3 - semi-minor axis,
 	**4 - Angle between the major axis and the x axis
 	**acc: cv::Mat &, Average of the aligned diffraction patterns
 	**rad_llim: const int, Lower limit for spot radii to consider.
 	**rad_ulim: const int, Upper limit for spot radii to consider. SHould be at least 1 higher than the lower limit
 	*/
-	void get_spot_ellipses(std::vector<cv::Mat> &mats, std::vector<cv::Point> &spot_pos, std::vector<std::vector<int>> &rel_pos,
-		const int &col_max,	const int &row_max,	cv::Mat &acc, std::vector<std::vector<std::vector<double>>> &ellipses,
-		const int rad_llim, const int rad_ulim);
+	void get_spot_ellipses(std::vector<cv::Mat> &mats, std::vector<cv::Point> &spot_pos, spot_frame_index &index, cv::Mat &acc,
+		std::vector<std::vector<std::vector<double>>> &ellipses, const int rad_llim, const int rad_ulim);
 
 	/*Amplitude of image's Scharr filtrate
 	**Inputs:
@@ -57,17 +58,17 @@ namespace ba
 	*/
 	void scharr_amp(cv::Mat &img, cv::Mat &scharr_amp);
 
-	/*Use weighted sums of squared differences to calculate the sizes of the ellipses from an image's Scharr filtrate
+	/*Fit an ellipse to a spot using its Scharr filtrate
 	**Inputs:
-	**img: cv::Mat &, Image to find the size of ellipses at the estimated positions in
-	**spot_pos: std::vector<cv::Point>, Positions of spots in the image
-	**est_rad: std::vector<cv::Vec2f> &, Two radii to look for the ellipse between
-	**ellipses: std::vector<std::vector<std::vector<double>>> &, For each spot that an ellipse can be fitted to, a set of
-	**5 parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - major axis, 3 - minor axis, 4 - Angle
-	**between the major axis and the x axis
+	**scharr: cv::Mat &, Amplitude of the Scharr filtrate of the image the spot is on
+	**spot_pos: cv::Point, Position of the spot in the image
+	**est_rad: cv::Vec2f, Two radii to look for the ellipse between
+	**Returns:
+	**std::vector<double>, 5 parameters describing the ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major axis,
+	**3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians. The vector is empty if an ellipse
+	**cannot be fitted to the spot
 	*/
-	void get_ellipses(cv::Mat &img, std::vector<cv::Point> spot_pos, std::vector<cv::Vec2f> est_rad,
-		std::vector<std::vector<double>> &ellipses);
+	std::vector<double> fit_spot_ellipse(cv::Mat &scharr, cv::Point spot_pos, cv::Vec2f est_rad);
 
 	/*Create annular mask
 	**Inputs:
@@ -76,7 +77,7 @@ namespace ba
 	**outer_rad: const int, Outer radius of the annulus
 	**val, const byte, Value to set the elements withing the annulus. Defaults to 1
 	*/
-	void create_annular_mask(cv::Mat annulus, const int size, const int inner_rad, const int outer_rad, const byte val = 1);
+	void create_annular_mask(cv::Mat &annulus, const int size, const int inner_rad, const int outer_rad, const byte val = 1);
 
 	/*Extracts values at non-zero masked elements in an image, constraining the boundaries of a mask so that only maked 
 	**points that lie in the image are extracted. It is assumed that at least some of the mask is on the image
@@ -104,19 +105,21 @@ namespace ba
 		const int hist_bins = THRESH_PROP_HIST_SIZE, const bool non_zero = false);
 
 	/*Weight the fit an ellipse to a noisy set of data using hyper-renormalisation. The function generates the coefficients
-	**A0 to A5 when the data is fit to the equation A0*x*x + 2*A1*x*y + A2*y*y + 2*f0*(A3*x + A4*y) + f0*f0*A5 = 0, in
-	**that order
+	**A0 to A5 when the data is fit to the equation A0*x*x + 2*A1*x*y + A2*y*y + 2*f0*(A3*x + A4*y) + f0*f0*A5 = 0 and uses
+	**them to fit an ellipse to the data
 	**Inputs:
 	**mask: cv::Mat &, 8-bit mask. Data points to be used are non-zeros
 	**weights: cv::Mat &, 32-bit mask. Weights of the individual data points
 	**f0: const double, Approximate size of the ellipse. This is arbitrary, but choosing a value close
 	**to the correct size reduces numerical errors
-	**thresh: const double, Iterations will be concluded if the cosine of the angle between successive eigenvectors divided
-	**by the amplitude ratio (larger divided by the smaller) is smaller than the threshold
+	**thresh: const double, Iterations will be concluded when the norm of the difference between successive unit coefficient
+	**vectors is smaller than the threshold
 	**max_iter: const int, The maximum number of iterations to perform. If this limit is reached, the last iteration's conic
-	**coefficients will be returned
+	**coefficients will be used
 	**Returns:
-	**std::vector<double>, Coefficients of the conic equation
+	**std::vector<double>, 5 parameters describing the ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major axis,
+	**3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians. The vector is empty if the fitted conic
+	**is not an ellipse
 	*/
 	std::vector<double> hyper_renorm_ellipse(cv::Mat &mask, cv::Mat weights, const double f0 = HYPER_RENORM_DEFAULT_SCALE,
 		const double thresh = HYPER_RENORM_DEFAULT_THRESH, const int max_iter = HYPER_RENORM_DEFAULT_ITER);
@@ -151,7 +154,8 @@ namespace ba
 	*/
 	double inv_sqr_inciding_sign(cv::Mat img, std::vector<ellipse> &ellipses, const float fear, cv::Vec2d &dir);
 
-	/*Perform weighted k-means clustering using a MATLAB script
+	/*Perform weighted k-means clustering using a MATLAB script. The MATLAB engine is shared, so calls are serialised and
+	**parallel callers wait for each other here
 	**Inputs:
 	**data: std::vector<std::vector<double>> &, Data set to apply weighted k-means clustering to. The data set for each variable
 	**should be the same size. The inner vector is the values for a particular varaible
@@ -167,10 +171,10 @@ namespace ba
 	**Inputs:
 	**mask: cv::Mat &, 8-bit mask whose non-zero values indicate the positions of points
 	**img: cv::Mat &, Image to record the values of at the positions marked on the mask
-	**param: std::vector<double> &, Parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - major
-	**axis, 3 - minor axis, 4 - Angle between the major axis and the x axis
-	**dists: std::vector<double> &, Output distances from the ellipse,
-	**accuracy: const double, Accuracy to find distances from ellipses to
+	**param: std::vector<double> &, Parameters describing an ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major
+	**axis, 3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians
+	**dists: std::vector<double> &, Output distances from the ellipse. Distances of points inside the ellipse are negative
+	**accuracy: const double, Accuracy to find distances from ellipses to in px
 	*/
 	void dists_from_ellipse(cv::Mat &mask, cv::Mat &img, std::vector<double> &param, std::vector<double> &dists,
 		const double accuracy = DISTS_FROM_EL_ACC);
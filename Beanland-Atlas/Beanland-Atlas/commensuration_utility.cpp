@@ -195,8 +195,7 @@ namespace ba
 		std::vector<std::vector<std::vector<int>>> group_rel_pos(grouped_idx.size());
 
 		//Compare the positions of each consecutive group of same position spots...
-        #pragma omp parallel for
-		for (int i = 0; i < grouped_idx.size(); i++)
+		parallel_for(0, grouped_idx.size(), [&](int i)
 		{
 			//Assign memory to store relative positions of other consecutive groups with significant overlap with this spot
 			std::vector<std::vector<int>> rel_pos_overlappers;
@@ -224,7 +223,7 @@ namespace ba
 
 			//Record this group of relative positions
 			group_rel_pos[i] = rel_pos_overlappers;
-		}
+		});
 
 		return group_rel_pos;
 	}
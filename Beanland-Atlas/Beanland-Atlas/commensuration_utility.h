@@ -3,6 +3,7 @@
 #include <includes.h>
 
 #include <get_spot_positions.h>
+#include <task_scheduler.h>
 
 namespace ba
 {
@@ -0,0 +1,506 @@
+#include <conic_fitting.h>
+
+namespace ba
+{
+	/*Weighted sum of the outer products of 2 sets of 6-vectors stored in structure-of-arrays order. The sums are accumulated in
+	**a single pass over the vectors, with CONIC_SCATTER_LANES partial sums for each matrix element so that the pass vectorises
+	**Inputs:
+	**u: const std::vector<double> *, 6 arrays holding the components of the left vectors
+	**v: const std::vector<double> *, 6 arrays holding the components of the right vectors
+	**c: const std::vector<double> &, Weight of each outer product
+	**symmetric: const bool, If true, u and v are the same so only the upper triangle is accumulated
+	**Returns:
+	**Eigen::Matrix<double, 6, 6>, Sum of c*u*v^T
+	*/
+	static Eigen::Matrix<double, 6, 6> weighted_scatter(const std::vector<double> *u, const std::vector<double> *v,
+		const std::vector<double> &c, const bool symmetric)
+	{
+		//Matrix elements that are accumulated: 21 for the upper triangle, otherwise all 36
+		int row[36], col[36];
+		int num_elems = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			for (int j = symmetric ? i : 0; j < 6; j++)
+			{
+				row[num_elems] = i;
+				col[num_elems] = j;
+				num_elems++;
+			}
+		}
+
+		const double *pc = c.data();
+		const double *pu[6], *pv[6];
+		for (int i = 0; i < 6; i++)
+		{
+			pu[i] = u[i].data();
+			pv[i] = v[i].data();
+		}
+		const int n = (int)c.size();
+
+		//Each block of points is loaded once and its products are added to the partial sums of every element
+		double acc[36][CONIC_SCATTER_LANES] = {};
+		int k = 0;
+		for (; k + CONIC_SCATTER_LANES <= n; k += CONIC_SCATTER_LANES)
+		{
+			double cu[6][CONIC_SCATTER_LANES], bv[6][CONIC_SCATTER_LANES];
+			for (int i = 0; i < 6; i++)
+			{
+				for (int l = 0; l < CONIC_SCATTER_LANES; l++)
+				{
+					cu[i][l] = pc[k+l]*pu[i][k+l];
+					bv[i][l] = pv[i][k+l];
+				}
+			}
+			for (int m = 0; m < num_elems; m++)
+			{
+				for (int l = 0; l < CONIC_SCATTER_LANES; l++)
+				{
+					acc[m][l] += cu[row[m]][l]*bv[col[m]][l];
+				}
+			}
+		}
+
+		//Remaining points that don't fill a block
+		for (; k < n; k++)
+		{
+			for (int m = 0; m < num_elems; m++)
+			{
+				acc[m][0] += pc[k]*pu[row[m]][k]*pv[col[m]][k];
+			}
+		}
+
+		Eigen::Matrix<double, 6, 6> scatter;
+		for (int m = 0; m < num_elems; m++)
+		{
+			double sum = 0.0;
+			for (int l = 0; l < CONIC_SCATTER_LANES; l++)
+			{
+				sum += acc[m][l];
+			}
+			scatter(row[m], col[m]) = sum;
+			if (symmetric)
+			{
+				scatter(col[m], row[m]) = sum;
+			}
+		}
+
+		return scatter;
+	}
+
+	/*Weighted sum of the normalised covariance matrices, V0, of the conic coefficient vectors of points. Each is the sum of the
+	**outer products of the derivatives of the coefficient vector with respect to x and y, so the sum only needs the weighted
+	**second moments of the points
+	**Inputs:
+	**x: const std::vector<double> &, x positions of the points
+	**y: const std::vector<double> &, y positions of the points
+	**c: const std::vector<double> &, Weight of each point's covariance matrix
+	**f0: const double, Scale of the conic
+	**Returns:
+	**Eigen::Matrix<double, 6, 6>, Sum of c*V0
+	*/
+	static Eigen::Matrix<double, 6, 6> weighted_v0(const std::vector<double> &x, const std::vector<double> &y,
+		const std::vector<double> &c, const double f0)
+	{
+		const double *px = x.data(), *py = y.data(), *pc = c.data();
+		const int n = (int)c.size();
+		double sxx = 0.0, sxy = 0.0, syy = 0.0, sx = 0.0, sy = 0.0, s1 = 0.0;
+		#pragma omp simd reduction(+:sxx,sxy,syy,sx,sy,s1)
+		for (int k = 0; k < n; k++)
+		{
+			sxx += pc[k]*px[k]*px[k];
+			sxy += pc[k]*px[k]*py[k];
+			syy += pc[k]*py[k]*py[k];
+			sx += pc[k]*px[k];
+			sy += pc[k]*py[k];
+			s1 += pc[k];
+		}
+
+		Eigen::Matrix<double, 6, 6> v0;
+		v0 << sxx,    sxy,       0.0,    f0*sx,     0.0,       0.0,
+		      sxy,    sxx+syy,   sxy,    f0*sy,     f0*sx,     0.0,
+		      0.0,    sxy,       syy,    0.0,       f0*sy,     0.0,
+		      f0*sx,  f0*sy,     0.0,    f0*f0*s1,  0.0,       0.0,
+		      0.0,    f0*sx,     f0*sy,  0.0,       f0*f0*s1,  0.0,
+		      0.0,    0.0,       0.0,    0.0,       0.0,       0.0;
+
+		return 4.0*v0;
+	}
+
+	/*Weighted fit of a conic to a set of points using hyper-renormalisation. Each iteration accumulates the 6x6 scatter
+	**matrices in single vectorised passes over the points and solves the generalised eigenproblem for the small matrices,
+	**rather than forming a matrix for every point. The points are centred on their mean before fitting to reduce numerical
+	**errors
+	**Inputs:
+	**pts: conic_points &, Points to fit the conic to, with their weights
+	**f0: const double, Approximate size of the conic. This is arbitrary, but choosing a value close to the correct size
+	**reduces numerical errors
+	**thresh: const double, Iterations are concluded when the norm of the difference between successive unit coefficient
+	**vectors is smaller than this
+	**max_iter: const int, Maximum number of iterations to perform
+	**Returns:
+	**std::vector<double>, Coefficients of the conic equation A*x*x + B*x*y + C*y*y + D*x + E*y + F = 0, in that order. The
+	**vector is empty if there are too few points to fit a conic to
+	*/
+	std::vector<double> hyper_renorm_conic(conic_points &pts, const double f0, const double thresh, const int max_iter)
+	{
+		const int n = (int)pts.x.size();
+		if (n < 5)
+		{
+			return std::vector<double>();
+		}
+
+		//Normalise the weights and centre the points on their mean
+		double sum_w = 0.0, mx = 0.0, my = 0.0;
+		for (int k = 0; k < n; k++)
+		{
+			sum_w += pts.w[k];
+			mx += pts.x[k];
+			my += pts.y[k];
+		}
+		if (sum_w <= 0.0)
+		{
+			return std::vector<double>();
+		}
+		mx /= n;
+		my /= n;
+
+		//Coefficient vectors of the points, (x*x, 2*x*y, y*y, 2*f0*x, 2*f0*y, f0*f0), stored component by component
+		std::vector<double> x(n), y(n), w(n);
+		std::vector<double> xi[6];
+		for (int i = 0; i < 6; i++)
+		{
+			xi[i] = std::vector<double>(n);
+		}
+		for (int k = 0; k < n; k++)
+		{
+			x[k] = pts.x[k] - mx;
+			y[k] = pts.y[k] - my;
+			w[k] = pts.w[k] / sum_w;
+
+			xi[0][k] = x[k]*x[k];
+			xi[1][k] = 2.0*x[k]*y[k];
+			xi[2][k] = y[k]*y[k];
+			xi[3][k] = 2.0*f0*x[k];
+			xi[4][k] = 2.0*f0*y[k];
+			xi[5][k] = f0*f0;
+		}
+
+		//Per-point quantities recomputed each iteration
+		std::vector<double> W(n, 1.0); //Hyper-renormalisation weights
+		std::vector<double> c(n), g(n), gq(n);
+		std::vector<double> kv[6];
+		for (int i = 0; i < 6; i++)
+		{
+			kv[i] = std::vector<double>(n, 0.0);
+		}
+
+		Eigen::Matrix<double, 6, 1> e;
+		e << 1.0, 0.0, 1.0, 0.0, 0.0, 0.0;
+
+		Eigen::Matrix<double, 6, 1> theta = Eigen::Matrix<double, 6, 1>::Zero();
+		Eigen::Matrix<double, 6, 1> theta_old = Eigen::Matrix<double, 6, 1>::Zero();
+		for (int iter = 0; iter < max_iter; iter++)
+		{
+			#pragma omp simd
+			for (int k = 0; k < n; k++)
+			{
+				c[k] = w[k]*W[k];
+				g[k] = c[k]*c[k];
+			}
+
+			//Weighted moment matrix
+			Eigen::Matrix<double, 6, 6> M = weighted_scatter(xi, xi, c, true);
+			Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 6, 6>> es(M);
+
+			//If the moment matrix is singular, the points lie exactly on a conic
+			if (es.eigenvalues()(0) <= DBL_EPSILON*es.eigenvalues()(5))
+			{
+				theta = es.eigenvectors().col(0);
+				break;
+			}
+
+			//Pseudo-inverse of the moment matrix with rank 5
+			Eigen::Matrix<double, 6, 6> Minv = Eigen::Matrix<double, 6, 6>::Zero();
+			for (int i = 1; i < 6; i++)
+			{
+				Minv += es.eigenvectors().col(i) * es.eigenvectors().col(i).transpose() / es.eigenvalues()(i);
+			}
+			double m[6][6];
+			for (int i = 0; i < 6; i++)
+			{
+				for (int j = 0; j < 6; j++)
+				{
+					m[i][j] = Minv(i, j);
+				}
+			}
+
+			//First-order term of the weight matrix
+			Eigen::Matrix<double, 6, 1> sum_xi;
+			for (int i = 0; i < 6; i++)
+			{
+				const double *p = xi[i].data();
+				double sum = 0.0;
+				#pragma omp simd reduction(+:sum)
+				for (int k = 0; k < n; k++)
+				{
+					sum += c[k]*p[k];
+				}
+				sum_xi(i) = sum;
+			}
+			Eigen::Matrix<double, 6, 6> N = weighted_v0(x, y, c, f0) + sum_xi*e.transpose() + e*sum_xi.transpose();
+
+			//Second-order term. V0 is the sum of the outer products of the derivatives of the coefficient vector, a and b, so
+			//V0*Minv*xi*xi^T = (a.h*a + b.h*b)*xi^T, where h = Minv*xi
+			#pragma omp simd
+			for (int k = 0; k < n; k++)
+			{
+				double h[6];
+				for (int i = 0; i < 6; i++)
+				{
+					h[i] = m[i][0]*xi[0][k] + m[i][1]*xi[1][k] + m[i][2]*xi[2][k] + m[i][3]*xi[3][k] + m[i][4]*xi[4][k] +
+						m[i][5]*xi[5][k];
+				}
+				double q = xi[0][k]*h[0] + xi[1][k]*h[1] + xi[2][k]*h[2] + xi[3][k]*h[3] + xi[4][k]*h[4] + xi[5][k]*h[5];
+				double alpha = 2.0*(x[k]*h[0] + y[k]*h[1] + f0*h[3]);
+				double beta = 2.0*(x[k]*h[1] + y[k]*h[2] + f0*h[4]);
+
+				gq[k] = g[k]*q;
+				kv[0][k] = 2.0*alpha*x[k];
+				kv[1][k] = 2.0*(alpha*y[k] + beta*x[k]);
+				kv[2][k] = 2.0*beta*y[k];
+				kv[3][k] = 2.0*alpha*f0;
+				kv[4][k] = 2.0*beta*f0;
+			}
+			Eigen::Matrix<double, 6, 6> K = weighted_scatter(kv, xi, g, false);
+			N -= weighted_v0(x, y, gq, f0) + K + K.transpose();
+
+			//The coefficients are the generalised eigenvector with the largest absolute eigenvalue
+			Eigen::GeneralizedSelfAdjointEigenSolver<Eigen::Matrix<double, 6, 6>> ges(N, M);
+			int idx = std::abs(ges.eigenvalues()(0)) > std::abs(ges.eigenvalues()(5)) ? 0 : 5;
+			theta = ges.eigenvectors().col(idx).normalized();
+			if (theta.dot(theta_old) < 0.0)
+			{
+				theta = -theta;
+			}
+
+			//Check for convergence
+			if ((theta - theta_old).norm() < thresh)
+			{
+				break;
+			}
+			theta_old = theta;
+
+			//Update the weights using the normalised covariance matrices, theta^T*V0*theta = (a.theta)^2 + (b.theta)^2
+			#pragma omp simd
+			for (int k = 0; k < n; k++)
+			{
+				double at = 2.0*(x[k]*theta(0) + y[k]*theta(1) + f0*theta(3));
+				double bt = 2.0*(x[k]*theta(1) + y[k]*theta(2) + f0*theta(4));
+				double den = at*at + bt*bt;
+				W[k] = den > 0.0 ? 1.0 / den : 0.0;
+			}
+		}
+
+		//Convert to the coefficients of the conic equation in the centred coordinates
+		double A = theta(0);
+		double B = 2.0*theta(1);
+		double C = theta(2);
+		double D = 2.0*f0*theta(3);
+		double E = 2.0*f0*theta(4);
+		double F = f0*f0*theta(5);
+
+		//Undo the centring
+		std::vector<double> conic(6);
+		conic[0] = A;
+		conic[1] = B;
+		conic[2] = C;
+		conic[3] = D - 2.0*A*mx - B*my;
+		conic[4] = E - B*mx - 2.0*C*my;
+		conic[5] = A*mx*mx + B*mx*my + C*my*my - D*mx - E*my + F;
+
+		return conic;
+	}
+
+	/*Get the parameters of the ellipse described by a conic
+	**Inputs:
+	**conic: std::vector<double> &, Coefficients of the conic equation A*x*x + B*x*y + C*y*y + D*x + E*y + F = 0
+	**Returns:
+	**std::vector<double>, Parameters describing the ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major axis,
+	**3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians, in [0, pi). The vector is empty if the
+	**conic does not describe a real ellipse
+	*/
+	std::vector<double> ellipse_param_from_conic(std::vector<double> &conic)
+	{
+		double A = conic[0], B = conic[1], C = conic[2], D = conic[3], E = conic[4], F = conic[5];
+
+		//The quadratic terms must be definite for the conic to be an ellipse
+		double det = 4.0*A*C - B*B;
+		if (det <= 0.0)
+		{
+			return std::vector<double>();
+		}
+
+		//Centre of the ellipse and the value of the conic there
+		double xc = (B*E - 2.0*C*D) / det;
+		double yc = (B*D - 2.0*A*E) / det;
+		double Fc = F + 0.5*(D*xc + E*yc);
+
+		//Eigenvalues of the quadratic form. The larger one is along the direction at theta to the x axis
+		double r = std::sqrt((A-C)*(A-C) + B*B);
+		double l_plus = 0.5*(A+C+r);
+		double l_minus = 0.5*(A+C-r);
+		double theta = 0.5*std::atan2(B, A-C);
+
+		//The semi-axes are real if the value at the centre has the opposite sign to the eigenvalues
+		double sq_plus = -Fc / l_plus;
+		double sq_minus = -Fc / l_minus;
+		if (sq_plus <= 0.0 || sq_minus <= 0.0)
+		{
+			return std::vector<double>();
+		}
+
+		//The major axis is along the eigenvector with the smaller absolute eigenvalue
+		std::vector<double> param(5);
+		param[0] = xc;
+		param[1] = yc;
+		if (sq_minus >= sq_plus)
+		{
+			param[2] = std::sqrt(sq_minus);
+			param[3] = std::sqrt(sq_plus);
+			theta += 0.5*PI;
+		}
+		else
+		{
+			param[2] = std::sqrt(sq_plus);
+			param[3] = std::sqrt(sq_minus);
+		}
+
+		//Wrap the angle into [0, pi)
+		theta = std::fmod(theta, PI);
+		param[4] = theta < 0.0 ? theta + PI : theta;
+
+		return param;
+	}
+
+	/*Get the signed distances of a batch of points from an ellipse. Points are projected onto the ellipse by Newton's method
+	**in the ellipse's frame, with all the points stepped together so that the steps vectorise
+	**Inputs:
+	**pts: conic_points &, Points to get the distances of. Their weights are not used
+	**param: std::vector<double> &, Parameters describing the ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major
+	**axis, 3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians
+	**dists: std::vector<double> &, Output distances of the points from the ellipse. Distances of points inside the ellipse
+	**are negative
+	**accuracy: const double, Accuracy to find distances to in px
+	*/
+	void ellipse_dists(conic_points &pts, std::vector<double> &param, std::vector<double> &dists, const double accuracy)
+	{
+		const int n = (int)pts.x.size();
+		dists = std::vector<double>(n);
+
+		double a = param[2], b = param[3];
+		double aa = a*a, bb = b*b;
+		double cos_t = std::cos(param[4]), sin_t = std::sin(param[4]);
+
+		//Positions of the points in the frame of the ellipse
+		std::vector<double> u(n), v(n);
+		#pragma omp simd
+		for (int k = 0; k < n; k++)
+		{
+			double dx = pts.x[k] - param[0];
+			double dy = pts.y[k] - param[1];
+			u[k] = dx*cos_t + dy*sin_t;
+			v[k] = -dx*sin_t + dy*cos_t;
+		}
+
+		//Distances from circles are radial
+		if (std::abs(a-b) < CONIC_DIST_TOL*a)
+		{
+			#pragma omp simd
+			for (int k = 0; k < n; k++)
+			{
+				dists[k] = std::sqrt(u[k]*u[k] + v[k]*v[k]) - a;
+			}
+			return;
+		}
+
+		//By symmetry, project the points in the first quadrant. Find the root of the secular equation
+		//(a*u/(t+a*a))^2 + (b*v/(t+b*b))^2 = 1 by Newton's method, starting at a point where it is positive so that the
+		//convex function's root is approached monotonically
+		std::vector<double> ua(n), vb(n), t(n);
+		#pragma omp simd
+		for (int k = 0; k < n; k++)
+		{
+			double abs_u = std::abs(u[k]), abs_v = std::abs(v[k]);
+			ua[k] = a*abs_u;
+			vb[k] = b*abs_v;
+			t[k] = std::max(a*(abs_u-a), b*(abs_v-b));
+		}
+
+		//A change in t changes the distance by at most a factor of 1/b of it
+		const double t_tol = accuracy*b;
+		for (int iter = 0; iter < CONIC_DIST_MAX_ITER; iter++)
+		{
+			double max_step = 0.0;
+			#pragma omp simd reduction(max:max_step)
+			for (int k = 0; k < n; k++)
+			{
+				double taa = t[k] + aa;
+				double tbb = t[k] + bb;
+				double pp1 = (ua[k]/taa)*(ua[k]/taa);
+				double pp2 = (vb[k]/tbb)*(vb[k]/tbb);
+				double f = pp1 + pp2 - 1.0;
+				double fder = 2.0*(pp1/taa + pp2/tbb);
+				double step = f > 0.0 && fder > 0.0 ? f / fder : 0.0;
+				t[k] += step;
+				max_step = std::max(max_step, step);
+			}
+
+			if (max_step < t_tol)
+			{
+				break;
+			}
+		}
+
+		//Project the points and get their distances from their projections
+		double tol_a = CONIC_DIST_TOL*a, tol_b = CONIC_DIST_TOL*b;
+		for (int k = 0; k < n; k++)
+		{
+			double abs_u = std::abs(u[k]), abs_v = std::abs(v[k]);
+			double xproj, yproj;
+
+			//Points on the minor axis project onto its end
+			if (abs_u < tol_a)
+			{
+				xproj = 0.0;
+				yproj = b;
+			}
+			//Points on the major axis inside its evolute project off the axis
+			else if (abs_v < tol_b)
+			{
+				if (abs_u < a - bb/a)
+				{
+					xproj = aa*abs_u / (aa-bb);
+					yproj = b*std::sqrt(std::max(0.0, 1.0 - (xproj/a)*(xproj/a)));
+				}
+				else
+				{
+					xproj = a;
+					yproj = 0.0;
+				}
+			}
+			else
+			{
+				xproj = std::min(a, aa*abs_u / (t[k]+aa));
+				yproj = b*std::sqrt(std::max(0.0, 1.0 - (xproj/a)*(xproj/a)));
+			}
+
+			dists[k] = std::sqrt((abs_u-xproj)*(abs_u-xproj) + (abs_v-yproj)*(abs_v-yproj));
+
+			//Make distances to points inside the ellipse negative
+			if (abs_u*abs_u/aa + abs_v*abs_v/bb < 1.0)
+			{
+				dists[k] = -dists[k];
+			}
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <includes.h>
+
+namespace ba
+{
+	//Maximum number of Newton steps used to project points onto ellipses. Steps typically converge in 4-5
+    #define CONIC_DIST_MAX_ITER 16
+
+	//Relative tolerance below which ellipses are treated as circles and points as lying on an ellipse's axes
+    #define CONIC_DIST_TOL 1.0e-9
+
+	//Number of partial sums kept for each element of the scatter matrices, so that accumulating them vectorises
+    #define CONIC_SCATTER_LANES 4
+
+	//Custom data structure to hold a batch of weighted points in structure-of-arrays order so that loops over them vectorise
+	struct conic_points_param {
+		std::vector<double> x; //x positions
+		std::vector<double> y; //y positions
+		std::vector<double> w; //Weights
+	};
+	typedef conic_points_param conic_points;
+
+	/*Weighted fit of a conic to a set of points using hyper-renormalisation. Each iteration accumulates the 6x6 scatter
+	**matrices in single vectorised passes over the points and solves the generalised eigenproblem for the small matrices,
+	**rather than forming a matrix for every point. The points are centred on their mean before fitting to reduce numerical
+	**errors
+	**Inputs:
+	**pts: conic_points &, Points to fit the conic to, with their weights
+	**f0: const double, Approximate size of the conic. This is arbitrary, but choosing a value close to the correct size
+	**reduces numerical errors
+	**thresh: const double, Iterations are concluded when the norm of the difference between successive unit coefficient
+	**vectors is smaller than this
+	**max_iter: const int, Maximum number of iterations to perform
+	**Returns:
+	**std::vector<double>, Coefficients of the conic equation A*x*x + B*x*y + C*y*y + D*x + E*y + F = 0, in that order. The
+	**vector is empty if there are too few points to fit a conic to
+	*/
+	std::vector<double> hyper_renorm_conic(conic_points &pts, const double f0, const double thresh, const int max_iter);
+
+	/*Get the parameters of the ellipse described by a conic
+	**Inputs:
+	**conic: std::vector<double> &, Coefficients of the conic equation A*x*x + B*x*y + C*y*y + D*x + E*y + F = 0
+	**Returns:
+	**std::vector<double>, Parameters describing the ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major axis,
+	**3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians, in [0, pi). The vector is empty if the
+	**conic does not describe a real ellipse
+	*/
+	std::vector<double> ellipse_param_from_conic(std::vector<double> &conic);
+
+	/*Get the signed distances of a batch of points from an ellipse. Points are projected onto the ellipse by Newton's method
+	**in the ellipse's frame, with all the points stepped together so that the steps vectorise
+	**Inputs:
+	**pts: conic_points &, Points to get the distances of. Their weights are not used
+	**param: std::vector<double> &, Parameters describing the ellipse. By index: 0 - x position, 1 - y position, 2 - semi-major
+	**axis, 3 - semi-minor axis, 4 - Angle between the major axis and the x axis in radians
+	**dists: std::vector<double> &, Output distances of the points from the ellipse. Distances of points inside the ellipse
+	**are negative
+	**accuracy: const double, Accuracy to find distances to in px
+	*/
+	void ellipse_dists(conic_points &pts, std::vector<double> &param, std::vector<double> &dists, const double accuracy);
+}
@@ -0,0 +1,219 @@
+#include <corr_moments.h>
+
+namespace ba
+{
+	/*Create empty moments that other moments can be merged into
+	**Returns:
+	**corr_moments, Moments of an empty dataset
+	*/
+	corr_moments zero_moments()
+	{
+		corr_moments m;
+		m.n = 0.0;
+		m.mean_x = 0.0;
+		m.mean_y = 0.0;
+		m.m2_x = 0.0;
+		m.m2_y = 0.0;
+		m.c_xy = 0.0;
+
+		return m;
+	}
+
+	/*Merge the moments of 2 datasets to get the moments of their union
+	**Inputs:
+	**a: const corr_moments &, Moments of one of the datasets
+	**b: const corr_moments &, Moments of the other dataset
+	**Returns:
+	**corr_moments, Moments of both datasets
+	*/
+	corr_moments merge_moments(const corr_moments &a, const corr_moments &b)
+	{
+		if (a.n == 0.0)
+		{
+			return b;
+		}
+		if (b.n == 0.0)
+		{
+			return a;
+		}
+
+		//Pairwise update of the centred moments
+		corr_moments m;
+		m.n = a.n + b.n;
+		double dx = b.mean_x - a.mean_x;
+		double dy = b.mean_y - a.mean_y;
+		double f = a.n * b.n / m.n;
+		m.mean_x = a.mean_x + dx * b.n / m.n;
+		m.mean_y = a.mean_y + dy * b.n / m.n;
+		m.m2_x = a.m2_x + b.m2_x + dx*dx*f;
+		m.m2_y = a.m2_y + b.m2_y + dy*dy*f;
+		m.c_xy = a.c_xy + b.c_xy + dx*dy*f;
+
+		return m;
+	}
+
+	/*Calculate the moments of 2 contiguous runs of floats in a single pass over blocks of the data. Each block is reduced
+	**with SIMD in single precision before being merged into the double precision totals
+	**Inputs:
+	**x: const float *, First dataset
+	**y: const float *, Second dataset
+	**n: const int, Number of elements in each dataset
+	**w: const float *, Optional weights of the elements. Elements are equally weighted if this is NULL
+	**mask: const byte *, Optional mask whose non-zero elements indicate the elements to use. All are used if this is NULL
+	**skip_black: const bool, If true, elements where either dataset is zero are not used
+	**Returns:
+	**corr_moments, Moments of the datasets
+	*/
+	corr_moments span_moments(const float *x, const float *y, const int n, const float *w, const byte *mask,
+		const bool skip_black)
+	{
+		corr_moments total = zero_moments();
+
+		//Effective weights of the elements in a block
+		float wb[MOMENTS_BLOCK_SIZE];
+
+		for (int b = 0; b < n; b += MOMENTS_BLOCK_SIZE)
+		{
+			int len = std::min(MOMENTS_BLOCK_SIZE, n-b);
+			const float *xb = x+b;
+			const float *yb = y+b;
+
+			//Combine the weights, mask and black pixel exclusion into a single weight per element
+			if (w)
+			{
+				std::memcpy(wb, w+b, len*sizeof(float));
+			}
+			else
+			{
+				std::fill(wb, wb+len, 1.0f);
+			}
+			if (mask)
+			{
+				const byte *mb = mask+b;
+				#pragma omp simd
+				for (int j = 0; j < len; j++)
+				{
+					wb[j] = mb[j] ? wb[j] : 0.0f;
+				}
+			}
+			if (skip_black)
+			{
+				#pragma omp simd
+				for (int j = 0; j < len; j++)
+				{
+					wb[j] = xb[j] && yb[j] ? wb[j] : 0.0f;
+				}
+			}
+
+			//First pass over the block: weighted sums to get the block means
+			float sum_w = 0.0f, sum_x = 0.0f, sum_y = 0.0f;
+			#pragma omp simd reduction(+:sum_w,sum_x,sum_y)
+			for (int j = 0; j < len; j++)
+			{
+				sum_w += wb[j];
+				sum_x += wb[j]*xb[j];
+				sum_y += wb[j]*yb[j];
+			}
+
+			if (sum_w == 0.0f)
+			{
+				continue;
+			}
+
+			//Second pass over the block, which is still in the cache: centred sums
+			float mean_x = sum_x / sum_w;
+			float mean_y = sum_y / sum_w;
+			float m2_x = 0.0f, m2_y = 0.0f, c_xy = 0.0f;
+			#pragma omp simd reduction(+:m2_x,m2_y,c_xy)
+			for (int j = 0; j < len; j++)
+			{
+				float dx = xb[j] - mean_x;
+				float dy = yb[j] - mean_y;
+				m2_x += wb[j]*dx*dx;
+				m2_y += wb[j]*dy*dy;
+				c_xy += wb[j]*dx*dy;
+			}
+
+			corr_moments block;
+			block.n = sum_w;
+			block.mean_x = mean_x;
+			block.mean_y = mean_y;
+			block.m2_x = m2_x;
+			block.m2_y = m2_y;
+			block.c_xy = c_xy;
+
+			total = merge_moments(total, block);
+		}
+
+		return total;
+	}
+
+	/*Calculate the moments of 2 vectors of floats. The vectors are split into contiguous chunks that are reduced by different
+	**tasks and then merged
+	**Inputs:
+	**x: const std::vector<float> &, First dataset
+	**y: const std::vector<float> &, Second dataset
+	**w: const std::vector<float> &, Optional weights of the elements. Elements are equally weighted if this is empty
+	**Returns:
+	**corr_moments, Moments of the datasets
+	*/
+	corr_moments vect_moments(const std::vector<float> &x, const std::vector<float> &y, const std::vector<float> &w)
+	{
+		int n = (int)std::min(x.size(), y.size());
+
+		return parallel_reduce<corr_moments>(0, n, zero_moments(), [&](int start, int stop)
+		{
+			return span_moments(&x[0]+start, &y[0]+start, stop-start, w.empty() ? NULL : &w[0]+start);
+		}, merge_moments, MOMENTS_CHUNK_SIZE);
+	}
+
+	/*Calculate the moments of 2 same-size 32-bit OpenCV mats. The mats can be strided views e.g. regions of interest of
+	**larger mats. Ranges of elements, or blocks of rows for strided mats, are reduced by different tasks into moments that are
+	**merged at the end
+	**Inputs:
+	**img1: cv::Mat &, First dataset
+	**img2: cv::Mat &, Second dataset
+	**mask: cv::Mat &, Optional 8-bit mask whose non-zero pixels indicate the pixels to use. All are used if it is empty
+	**skip_black: const bool, If true, pixels where either image is black are not used
+	**Returns:
+	**corr_moments, Moments of the images
+	*/
+	corr_moments mat_moments(cv::Mat &img1, cv::Mat &img2, cv::Mat &mask, const bool skip_black)
+	{
+		//Continuous mats are split into ranges of elements, so that they are shared between tasks however few rows they have
+		if (img1.isContinuous() && img2.isContinuous() && (mask.empty() || mask.isContinuous()))
+		{
+			const float *x = img1.ptr<float>(0), *y = img2.ptr<float>(0);
+			const byte *b = mask.empty() ? NULL : mask.ptr<byte>(0);
+			return parallel_reduce<corr_moments>(0, (int)img1.total(), zero_moments(), [&](int start, int stop)
+			{
+				return span_moments(x+start, y+start, stop-start, NULL, b ? b+start : NULL, skip_black);
+			}, merge_moments, MOMENTS_CHUNK_SIZE);
+		}
+
+		//Strided mats are split into blocks of rows, each with about MOMENTS_CHUNK_SIZE elements
+		int chunk_rows = std::max(1, MOMENTS_CHUNK_SIZE / std::max(1, img1.cols));
+		return parallel_reduce<corr_moments>(0, img1.rows, zero_moments(), [&](int start, int stop)
+		{
+			corr_moments chunk_total = zero_moments();
+			for (int i = start; i < stop; i++)
+			{
+				chunk_total = merge_moments(chunk_total, span_moments(img1.ptr<float>(i), img2.ptr<float>(i), img1.cols, NULL,
+					mask.empty() ? NULL : mask.ptr<byte>(i), skip_black));
+			}
+
+			return chunk_total;
+		}, merge_moments, chunk_rows);
+	}
+
+	/*Pearson's normalised product moment correlation coefficient from the moments of 2 datasets
+	**Inputs:
+	**m: const corr_moments &, Moments of the datasets
+	**Returns:
+	**double, Pearson normalised product moment correlation coefficient between the datasets
+	*/
+	double pearson_from_moments(const corr_moments &m)
+	{
+		return m.c_xy / (std::sqrt(m.m2_x) * std::sqrt(m.m2_y));
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <includes.h>
+
+#include <task_scheduler.h>
+
+namespace ba
+{
+	//Number of elements to accumulate in single precision before the block's moments are merged into the double precision
+	//totals. Blocks are small enough to stay in the L1 cache for the centred second pass
+    #define MOMENTS_BLOCK_SIZE 256
+
+	//Number of elements that each task reduces. Chunks have a fixed size rather than one per thread, so that the order the
+	//moments are merged in, and hence the result, is the same for every number of threads
+    #define MOMENTS_CHUNK_SIZE (16*MOMENTS_BLOCK_SIZE)
+
+	//Custom data structure to hold the centred moments needed to calculate Pearson's product moment correlation coefficient
+	//between 2 datasets. Centred moments are merged pairwise so that large datasets do not suffer from the catastrophic
+	//cancellation of raw sums of squares
+	struct corr_moments_param {
+		double n; //Number of elements or, if weighted, the sum of the weights
+		double mean_x; //Mean of the first dataset
+		double mean_y; //Mean of the second dataset
+		double m2_x; //Sum of squared deviations of the first dataset from its mean
+		double m2_y; //Sum of squared deviations of the second dataset from its mean
+		double c_xy; //Sum of products of the datasets' deviations from their means
+	};
+	typedef corr_moments_param corr_moments;
+
+	/*Create empty moments that other moments can be merged into
+	**Returns:
+	**corr_moments, Moments of an empty dataset
+	*/
+	corr_moments zero_moments();
+
+	/*Merge the moments of 2 datasets to get the moments of their union
+	**Inputs:
+	**a: const corr_moments &, Moments of one of the datasets
+	**b: const corr_moments &, Moments of the other dataset
+	**Returns:
+	**corr_moments, Moments of both datasets
+	*/
+	corr_moments merge_moments(const corr_moments &a, const corr_moments &b);
+
+	/*Calculate the moments of 2 contiguous runs of floats in a single pass over blocks of the data. Each block is reduced
+	**with SIMD in single precision before being merged into the double precision totals
+	**Inputs:
+	**x: const float *, First dataset
+	**y: const float *, Second dataset
+	**n: const int, Number of elements in each dataset
+	**w: const float *, Optional weights of the elements. Elements are equally weighted if this is NULL
+	**mask: const byte *, Optional mask whose non-zero elements indicate the elements to use. All are used if this is NULL
+	**skip_black: const bool, If true, elements where either dataset is zero are not used
+	**Returns:
+	**corr_moments, Moments of the datasets
+	*/
+	corr_moments span_moments(const float *x, const float *y, const int n, const float *w = NULL, const byte *mask = NULL,
+		const bool skip_black = false);
+
+	/*Calculate the moments of 2 vectors of floats. The vectors are split into contiguous chunks that are reduced by different
+	**tasks and then merged
+	**Inputs:
+	**x: const std::vector<float> &, First dataset
+	**y: const std::vector<float> &, Second dataset
+	**w: const std::vector<float> &, Optional weights of the elements. Elements are equally weighted if this is empty
+	**Returns:
+	**corr_moments, Moments of the datasets
+	*/
+	corr_moments vect_moments(const std::vector<float> &x, const std::vector<float> &y,
+		const std::vector<float> &w = std::vector<float>());
+
+	/*Calculate the moments of 2 same-size 32-bit OpenCV mats. The mats can be strided views e.g. regions of interest of
+	**larger mats. Ranges of elements, or blocks of rows for strided mats, are reduced by different tasks into moments that are
+	**merged at the end
+	**Inputs:
+	**img1: cv::Mat &, First dataset
+	**img2: cv::Mat &, Second dataset
+	**mask: cv::Mat &, Optional 8-bit mask whose non-zero pixels indicate the pixels to use. All are used if it is empty
+	**skip_black: const bool, If true, pixels where either image is black are not used
+	**Returns:
+	**corr_moments, Moments of the images
+	*/
+	corr_moments mat_moments(cv::Mat &img1, cv::Mat &img2, cv::Mat &mask = cv::Mat(), const bool skip_black = false);
+
+	/*Pearson's normalised product moment correlation coefficient from the moments of 2 datasets
+	**Inputs:
+	**m: const corr_moments &, Moments of the datasets
+	**Returns:
+	**double, Pearson normalised product moment correlation coefficient between the datasets
+	*/
+	double pearson_from_moments(const corr_moments &m);
+}
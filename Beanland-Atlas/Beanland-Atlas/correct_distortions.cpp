@@ -38,8 +38,7 @@ namespace ba
 		float varying_step_in = varying_frac * varying_rad_in;
 
 		//Compare supposedly symmetrical regions to determine warps
-        #pragma omp parallel for
-		for (int i = 0; i < surveys.size(); i++)
+		parallel_for(0, surveys.size(), [&](int i)
 		{
 			//Use the average feature size to determine the size of the regions to compare
 			float feature_size = get_avg_feature_size(surveys[i]);
@@ -47,6 +46,6 @@ namespace ba
 			//Find the position of highest Pearson product moment correlation
 			//cv::Mat pear;
 			//cv::matchTemplate(pad1, src2, pear, CV_TM_CCOEFF);
-		}
+		});
 	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <includes.h>
 
+#include <task_scheduler.h>
 #include <utility.h>
 
 namespace ba
@@ -101,7 +101,6 @@ namespace ba
 	{
 		//Find spots with minimum value for the maximum value of their row or column separations
 		float min_sep = INT_MAX;
-        #pragma omp parallel for reduction(min:min_sep)
 		for (int m = 0; m < spot_pos.size(); m++) {
 			for (int n = m+1; n < spot_pos.size(); n++) {
 
@@ -115,7 +114,6 @@ namespace ba
 
 		//Get the maximum rows and columns of the spots in the aligned average image
 		int col_max = 0, row_max = 0, col_min = INT_MAX, row_min = INT_MAX;
-        #pragma omp parallel for reduction(max:col_max), reduction(max:row_max), reduction(min:col_min), reduction(min:row_min)
 		for (int i = 0; i < spot_pos.size(); i++)
 		{
 			//Minimum spot position column
@@ -0,0 +1,100 @@
+#include <device_transfer.h>
+
+namespace ba
+{
+	/*Find the position and value of the maximum of an ArrayFire array on the GPU, so that only they are read back
+	**Inputs:
+	**arr: af::array &, 2D ArrayFire array to find the maximum of
+	**max: float *, Optional host memory to store the maximum value in
+	**Returns:
+	**cv::Point, Position of the maximum. ArrayFire arrays are transpositional to OpenCV mats, so its x is the ArrayFire row
+	*/
+	cv::Point device_argmax(af::array &arr, float *max)
+	{
+		float val;
+		unsigned idx;
+		af::imax(&val, &idx, arr);
+		BA_COUNT(INSTR_DEVICE_TO_HOST, sizeof(float) + sizeof(unsigned));
+
+		if (max)
+		{
+			*max = val;
+		}
+
+		return cv::Point((int)(idx % arr.dims(0)), (int)(idx / arr.dims(0)));
+	}
+
+	/*Set pixels within a radius of a point to zero on the GPU
+	**Inputs:
+	**arr: af::array &, 2D ArrayFire array to blacken a circle on
+	**col: const int, Column of the circle origin in the OpenCV mat the array is transpositional to
+	**row: const int, Row of the circle origin in the OpenCV mat the array is transpositional to
+	**rad: const int, Radius of the circle to blacken
+	*/
+	void device_blacken_circle(af::array &arr, const int col, const int row, const int rad)
+	{
+		af::array dx = af::range(arr.dims(), 0) - col;
+		af::array dy = af::range(arr.dims(), 1) - row;
+		arr = af::select(dx*dx + dy*dy <= rad*rad, 0.0, arr);
+	}
+
+	/*Queue a small result to be read back to the host when the queue is flushed
+	**Inputs:
+	**queue: readback_queue &, Queue to add the result to
+	**arr: const af::array &, Result. Its elements are converted to 32-bit floating point and copied in ArrayFire order
+	**dest: float *, Host memory to copy the result to. It must stay valid until the queue is flushed
+	*/
+	void queue_readback(readback_queue &queue, const af::array &arr, float *dest)
+	{
+		//Start calculating the result now rather than when the queue is flushed
+		af::array flat = af::flat(arr).as(f32);
+		flat.eval();
+
+		queue.arrays.push_back(flat);
+		queue.dests.push_back(dest);
+	}
+
+	/*Read back all queued results to the host with one transfer and empty the queue
+	**Inputs:
+	**queue: readback_queue &, Queue to flush
+	*/
+	void flush_readbacks(readback_queue &queue)
+	{
+		if (queue.arrays.empty())
+		{
+			return;
+		}
+
+		//Gather the results into one array on the GPU
+		dim_t total = 0;
+		for (int i = 0; i < queue.arrays.size(); i++)
+		{
+			total += queue.arrays[i].elements();
+		}
+
+		af::array gathered(total, f32);
+		dim_t offset = 0;
+		for (int i = 0; i < queue.arrays.size(); i++)
+		{
+			dim_t n = queue.arrays[i].elements();
+			gathered(af::seq((double)offset, (double)(offset + n - 1))) = queue.arrays[i];
+			offset += n;
+		}
+
+		std::vector<float> host(total);
+		gathered.host(&host[0]);
+		BA_COUNT(INSTR_DEVICE_TO_HOST, total*sizeof(float));
+
+		//Copy each result to its destination
+		offset = 0;
+		for (int i = 0; i < queue.arrays.size(); i++)
+		{
+			dim_t n = queue.arrays[i].elements();
+			std::copy(host.begin() + offset, host.begin() + offset + n, queue.dests[i]);
+			offset += n;
+		}
+
+		queue.arrays.clear();
+		queue.dests.clear();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <includes.h>
+
+namespace ba
+{
+	//Custom data structure to collect small results that are still being calculated on the GPU so that they can all be read
+	//back to the host with one transfer. Queueing results doesn't wait for them, so the GPU isn't left idle between them
+	struct readback_queue_param {
+		std::vector<af::array> arrays; //Results waiting to be read back
+		std::vector<float*> dests; //Host memory each result is copied to
+	};
+	typedef readback_queue_param readback_queue;
+
+	/*Find the position and value of the maximum of an ArrayFire array on the GPU, so that only they are read back
+	**Inputs:
+	**arr: af::array &, 2D ArrayFire array to find the maximum of
+	**max: float *, Optional host memory to store the maximum value in
+	**Returns:
+	**cv::Point, Position of the maximum. ArrayFire arrays are transpositional to OpenCV mats, so its x is the ArrayFire row
+	*/
+	cv::Point device_argmax(af::array &arr, float *max = NULL);
+
+	/*Set pixels within a radius of a point to zero on the GPU
+	**Inputs:
+	**arr: af::array &, 2D ArrayFire array to blacken a circle on
+	**col: const int, Column of the circle origin in the OpenCV mat the array is transpositional to
+	**row: const int, Row of the circle origin in the OpenCV mat the array is transpositional to
+	**rad: const int, Radius of the circle to blacken
+	*/
+	void device_blacken_circle(af::array &arr, const int col, const int row, const int rad);
+
+	/*Queue a small result to be read back to the host when the queue is flushed
+	**Inputs:
+	**queue: readback_queue &, Queue to add the result to
+	**arr: const af::array &, Result. Its elements are converted to 32-bit floating point and copied in ArrayFire order
+	**dest: float *, Host memory to copy the result to. It must stay valid until the queue is flushed
+	*/
+	void queue_readback(readback_queue &queue, const af::array &arr, float *dest);
+
+	/*Read back all queued results to the host with one transfer and empty the queue
+	**Inputs:
+	**queue: readback_queue &, Queue to flush
+	*/
+	void flush_readbacks(readback_queue &queue);
+}
@@ -0,0 +1,113 @@
+#include <disk_spans.h>
+
+namespace ba
+{
+	/*Area of the part of a rectangle in the first quadrant that is inside a circle centred on the origin
+	**Inputs:
+	**radius: const double, Radius of the circle
+	**x0: const double, Smallest x of the rectangle. It must not be negative
+	**x1: const double, Largest x of the rectangle
+	**y0: const double, Smallest y of the rectangle. It must not be negative
+	**y1: const double, Largest y of the rectangle
+	**Returns:
+	**double, Area of the rectangle inside the circle
+	*/
+	static double quadrant_coverage(const double radius, const double x0, const double x1, const double y0, const double y1)
+	{
+		//The circle's edge crosses the top of the rectangle at t1 and its bottom at t0
+		double t1 = std::sqrt(std::max(0.0, radius*radius-y1*y1));
+		double t0 = std::sqrt(std::max(0.0, radius*radius-y0*y0));
+
+		//Columns left of t1 are covered over the full height of the rectangle
+		double area = (y1-y0)*std::max(0.0, std::min(x1, t1)-x0);
+
+		//Between t1 and t0 the columns are covered up to the edge, so integrate sqrt(radius^2-t^2)-y0 over them
+		double a = std::max(x0, t1), b = std::min(x1, t0);
+		if (a < b)
+		{
+			auto integral = [&](const double t)
+			{
+				return 0.5*(t*std::sqrt(std::max(0.0, radius*radius-t*t)) + radius*radius*std::asin(std::min(1.0, t/radius))) 
+					- y0*t;
+			};
+			area += integral(b) - integral(a);
+		}
+
+		return area;
+	}
+
+	/*Fraction of a pixel that a disk centred on the centre of the pixel at the origin covers
+	**Inputs:
+	**radius: const double, Radius of the disk
+	**x: const int, Column of the pixel relative to the disk's centre
+	**y: const int, Row of the pixel relative to the disk's centre
+	**Returns:
+	**double, Fraction of the pixel inside the disk
+	*/
+	static double pixel_coverage(const double radius, const int x, const int y)
+	{
+		//The disk is symmetric, so the pixel is reflected into the first quadrant. The centre pixels straddle the axes, so
+		//they are split into the halves either side of them, which are equal
+		double ax = std::abs(x), ay = std::abs(y);
+		double x0 = ax ? ax-0.5 : 0.0, x1 = ax+0.5;
+		double y0 = ay ? ay-0.5 : 0.0, y1 = ay+0.5;
+
+		return (ax ? 1 : 2) * (ay ? 1 : 2) * quadrant_coverage(radius, x0, x1, y0, y1);
+	}
+
+	/*Get the runs of pixels of a disk. The runs are the same as the pixels within the integer part of the disk's half width on
+	**each row. The fraction of each pixel that the disk covers is also tabulated for anti-aliased accumulation. Tables are 
+	**cached, so each radius is only rasterised once
+	**Inputs:
+	**radius: const int, Radius of the disk
+	**Returns:
+	**const disk_spans &, Runs of pixels of the disk. It stays valid for the rest of the program
+	*/
+	const disk_spans &get_disk_spans(const int radius)
+	{
+		//Elements of maps aren't moved when others are added, so references to them stay valid
+		static std::map<int, disk_spans> tables;
+		static std::mutex tables_mutex;
+
+		std::lock_guard<std::mutex> lock(tables_mutex);
+		std::map<int, disk_spans>::iterator it = tables.find(radius);
+		if (it != tables.end())
+		{
+			return it->second;
+		}
+
+		disk_spans &disk = tables[radius];
+		disk.radius = radius;
+		disk.half_widths = std::vector<int>(2*radius+1);
+		disk.covered_half_widths = std::vector<int>(2*radius+1);
+		disk.edge_offsets = std::vector<int>(2*radius+2);
+		disk.edge_weights.clear();
+		for (int y = -radius; y <= radius; y++)
+		{
+			disk.half_widths[y+radius] = (int)std::sqrt(radius*radius-y*y);
+
+			//Pixels are fully covered while their outer corner is inside the disk. Beyond them, the pixels are partially 
+			//covered until the disk's edge has passed. Rows further than the radius from the centre have no area in the disk
+			int covered = -1;
+			while ((covered+1.5)*(covered+1.5) + (std::abs(y)+0.5)*(std::abs(y)+0.5) <= radius*radius)
+			{
+				covered++;
+			}
+			disk.covered_half_widths[y+radius] = covered;
+
+			disk.edge_offsets[y+radius] = (int)disk.edge_weights.size();
+			for (int x = covered+1; x <= radius; x++)
+			{
+				double weight = pixel_coverage(radius, x, y);
+				if (weight <= 0.0)
+				{
+					break;
+				}
+				disk.edge_weights.push_back((float)weight);
+			}
+		}
+		disk.edge_offsets[2*radius+1] = (int)disk.edge_weights.size();
+
+		return disk;
+	}
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <includes.h>
+
+namespace ba
+{
+	//Custom data structure to hold the runs of pixels on each row of a disk relative to its centre, so that disks of the same
+	//radius are only rasterised once
+	struct disk_spans_param {
+		int radius; //Radius of the disk
+		std::vector<int> half_widths; //For each row from -radius to radius, number of pixels either side of the centre column in the disk
+		std::vector<int> covered_half_widths; //For each row, number of pixels either side of the centre column that the disk fully covers, or -1
+		std::vector<int> edge_offsets; //For each row and one past the last, index of the row's first weight in edge_weights
+		std::vector<float> edge_weights; //Fractions of the partially covered pixels beyond the fully covered ones, by row then outwards
+	};
+	typedef disk_spans_param disk_spans;
+
+	/*Get the runs of pixels of a disk. The runs are the same as the pixels within the integer part of the disk's half width on
+	**each row. The fraction of each pixel that the disk covers is also tabulated for anti-aliased accumulation. Tables are 
+	**cached, so each radius is only rasterised once
+	**Inputs:
+	**radius: const int, Radius of the disk
+	**Returns:
+	**const disk_spans &, Runs of pixels of the disk. It stays valid for the rest of the program
+	*/
+	const disk_spans &get_disk_spans(const int radius);
+
+	/*Call a function for each row of a disk's runs of pixels that is on an image, clipped to the image
+	**Inputs:
+	**disk: const disk_spans &, Runs of pixels of the disk
+	**pos: cv::Point, Position of the disk's centre on the image
+	**size: cv::Size, Size of the image
+	**fn: Fn, Function called with the row, the first column of the run and one past its last column
+	*/
+	template<typename Fn> void for_disk_spans(const disk_spans &disk, cv::Point pos, cv::Size size, Fn fn)
+	{
+		int min_row = std::max(0, pos.y-disk.radius);
+		int max_row = std::min(size.height-1, pos.y+disk.radius);
+		for (int i = min_row; i <= max_row; i++)
+		{
+			int half_width = disk.half_widths[i-pos.y+disk.radius];
+			int start = std::max(0, pos.x-half_width);
+			int end = std::min(size.width, pos.x+half_width+1);
+			if (start < end)
+			{
+				fn(i, start, end);
+			}
+		}
+	}
+
+	/*Set the pixels of a disk on an image to a value
+	**Inputs:
+	**mat: cv::Mat &, Image to set the pixels of. Its elements are of type T
+	**pos: cv::Point, Position of the disk's centre on the image
+	**disk: const disk_spans &, Runs of pixels of the disk
+	**val: const T, Value to set the pixels to
+	*/
+	template<typename T> void disk_set(cv::Mat &mat, cv::Point pos, const disk_spans &disk, const T val)
+	{
+		for_disk_spans(disk, pos, mat.size(), [&](int i, int start, int end)
+		{
+			T *p = mat.ptr<T>(i);
+			#pragma omp simd
+			for (int j = start; j < end; j++)
+			{
+				p[j] = val;
+			}
+		});
+	}
+
+	/*Add the pixels of a disk on one image to the pixels of a disk on another. Only pixels on both images are added
+	**Inputs:
+	**src: cv::Mat &, Image to add the pixels of. Its elements are of type T
+	**src_pos: cv::Point, Position of the disk's centre on the image to add the pixels of
+	**dst: cv::Mat &, Image to add the pixels to. Its elements are of type T
+	**dst_pos: cv::Point, Position of the disk's centre on the image to add the pixels to
+	**disk: const disk_spans &, Runs of pixels of the disk
+	**antialias: const bool, If true, every pixel is added in proportion to the exact fraction of it that the disk covers, rather
+	**than the pixels with centres in the disk being added in full
+	*/
+	template<typename T> void disk_add(cv::Mat &src, cv::Point src_pos, cv::Mat &dst, cv::Point dst_pos, const disk_spans &disk,
+		const bool antialias = false)
+	{
+		//Rows of the disk that are on both images
+		int min_rel_row = std::max(-disk.radius, std::max(-src_pos.y, -dst_pos.y));
+		int max_rel_row = std::min(disk.radius, std::min(src.rows-1-src_pos.y, dst.rows-1-dst_pos.y));
+		for (int y = min_rel_row; y <= max_rel_row; y++)
+		{
+			//Anti-aliased rows are the fully covered pixels with the partially covered pixels either side of them
+			int row = y+disk.radius;
+			int full = antialias ? disk.covered_half_widths[row] : disk.half_widths[row];
+			int half_width = antialias ? full + disk.edge_offsets[row+1] - disk.edge_offsets[row] : full;
+			const float *weights = antialias ? disk.edge_weights.data() + disk.edge_offsets[row] : NULL;
+
+			//Columns of the row relative to the centre that are on both images
+			int min_rel_col = std::max(-half_width, std::max(-src_pos.x, -dst_pos.x));
+			int max_rel_col = std::min(half_width, std::min(src.cols-1-src_pos.x, dst.cols-1-dst_pos.x));
+			if (min_rel_col > max_rel_col)
+			{
+				continue;
+			}
+
+			const T *p = src.ptr<T>(src_pos.y+y) + src_pos.x;
+			T *q = dst.ptr<T>(dst_pos.y+y) + dst_pos.x;
+
+			//Partially covered pixels left of the fully covered ones
+			int x = min_rel_col;
+			for (; x <= max_rel_col && x < -full; x++)
+			{
+				q[x] += (T)(weights[-x-full-1]*p[x]);
+			}
+
+			int max_full = std::min(max_rel_col, full);
+			#pragma omp simd
+			for (int k = x; k <= max_full; k++)
+			{
+				q[k] += p[k];
+			}
+
+			//Partially covered pixels right of the fully covered ones
+			for (x = std::max(x, full+1); x <= max_rel_col; x++)
+			{
+				q[x] += (T)(weights[x-full-1]*p[x]);
+			}
+		}
+	}
+
+	/*Gather the pixels of a disk on an image that are on it
+	**Inputs:
+	**mat: cv::Mat &, Image to gather the pixels of. Its elements are of type T
+	**pos: cv::Point, Position of the disk's centre on the image
+	**disk: const disk_spans &, Runs of pixels of the disk
+	**vals: std::vector<T> &, Output values, ordered by row and then column
+	*/
+	template<typename T> void disk_gather(cv::Mat &mat, cv::Point pos, const disk_spans &disk, std::vector<T> &vals)
+	{
+		vals.clear();
+		for_disk_spans(disk, pos, mat.size(), [&](int i, int start, int end)
+		{
+			const T *p = mat.ptr<T>(i);
+			vals.insert(vals.end(), p+start, p+end);
+		});
+	}
+
+	/*Scatter values to the pixels of a disk on an image. This is the inverse of disk_gather
+	**Inputs:
+	**mat: cv::Mat &, Image to scatter the values to. Its elements are of type T
+	**pos: cv::Point, Position of the disk's centre on the image
+	**disk: const disk_spans &, Runs of pixels of the disk
+	**vals: const std::vector<T> &, Values ordered by row and then column, as gathered by disk_gather
+	*/
+	template<typename T> void disk_scatter(cv::Mat &mat, cv::Point pos, const disk_spans &disk, const std::vector<T> &vals)
+	{
+		size_t k = 0;
+		for_disk_spans(disk, pos, mat.size(), [&](int i, int start, int end)
+		{
+			T *p = mat.ptr<T>(i);
+			std::copy(vals.begin()+k, vals.begin()+k+(end-start), p+start);
+			k += end-start;
+		});
+	}
+}
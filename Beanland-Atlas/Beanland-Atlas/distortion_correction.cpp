@@ -45,11 +45,11 @@ namespace ba
 							//Find if the overlapping region is entirely on the image
 							if (on_img(co.bounding_rect[0], cols, rows) && on_img(co.bounding_rect[1], cols, rows))
 							{
-								//Create a mask idicating where the circles overlap to extract the values from the images
-								cv::Mat co_mask = gen_circ_overlap_mask(co.P1, radius, co.P2, radius, cols, rows);
+								//Get the runs of pixels where the circles overlap to extract the values from the images
+								span_region co_spans = gen_circ_overlap_spans(co.P1, radius, co.P2, radius, cols, rows);
 
-								//Get the number of overlapping pixels from the mask
-								int num_overlap = cv::countNonZero(co_mask);
+								//Get the number of overlapping pixels
+								int num_overlap = co_spans.num_px;
 
 								//Check that there are enough pixels to make a meaningful estimate of the symmetry center
 								if (num_overlap > MIN_OVERLAP_PX_NUM)
@@ -62,7 +62,7 @@ namespace ba
 									//Get the ratios of the overlapping protions of the image
 									cv::Mat ratios, ratios_mask; //Overlapping intensity ratios; smaller divided by larger
 									cv::Point pos; //Positions of ratios and ratios_mask in groups[m]
-									get_overlap_ratios(co_mask, groups[m], groups[n], group_pos[m], group_pos[n], ratios, ratios_mask, pos);
+									get_overlap_ratios(co_spans, groups[m], groups[n], group_pos[m], group_pos[n], ratios, ratios_mask, pos);
 
 									////Package data into vectors so that it can be packed for MATLAB by the ArrayFactory
 									//float p; //Indicates the OpenCV mat type to the templated function
@@ -144,51 +144,24 @@ namespace ba
 
 	/*Get the ratio of the intensity profiles where 2 spots overlap
 	**Inputs:
-	**mask: cv::Mat &, 8-bit mask that's non-zero values indicate where the circles overlap
+	**region: span_region &, Runs of pixels where the circles overlap
 	**c1: cv::Mat &, One of the circles
 	**c2; cv::Mat &, The other circles
 	**p1: cv::Point &, Top left point of a square containing the first circle on the detector
 	**p2: cv::Point &, Top left point of a square containing the second circle on the detector
-	**max_shift: const float, Maximum shift to consider
-	**incr_shift: const float, Steps to adjust the shift by
 	**ratios: cv::Mat &, Output cropped image containing the overlap region containing the ratios of the intensity profiles.
 	**Ratios larger than 1.0 are reciprocated
 	**ratios_mask: cv::Mat &, Output mask indicating the ratios pixels containing ratios
 	**rel_pos: cv::Point &, The position of the top left corner of ratios and ratios_mask in the c1 mat
 	*/
-	void get_overlap_ratios(cv::Mat &mask, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, 
+	void get_overlap_ratios(span_region &region, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, 
 		cv::Mat &ratios, cv::Mat &ratios_mask, cv::Point &rel_pos)
 	{
-		//Create an image to store ratios on and a mask indicating them
-		cv::Mat pre_crop_ratios = cv::Mat(c1.size(), CV_32FC1, cv::Scalar(0.0));
-
-		//Get the pixel value and distances from circle centers for pixels in the overlapping region
-		byte *b;
-		for (int i = 0, co_num = 0; i < mask.rows; i++)
-		{
-			b = mask.ptr<byte>(i);
-			for (int j = 0; j < mask.cols; j++)
-			{
-				//If the pixel is marked as an overlapping region pixel
-				if (b[j])
-				{
-					//Get the values of the pixels
-					double val1, val2;
-					val1 = c1.at<float>(i-p1.y, j-p1.x);
-					val2 = c2.at<float>(i-p2.y, j-p2.x);
-
-					pre_crop_ratios.at<float>(i-p1.y, j-p1.x) = val1 > val2 ? val2 / val1 : val1 / val2;
-				}
-			}
-		}
+		//Calculate the ratios directly in the rectangle bounding the overlap so that no full size images are needed
+		span_overlap_ratios(c1, p1, c2, p2, region, ratios, ratios_mask);
 
-		//Get the rectangle needed to crop the images to reduce the amound of memory needed to store them
-		cv::Rect rect = get_non_zero_mask_px_bounds(mask);
-
-		//Output the overlap-containing region, along with it's position in the first spot mat
-		pre_crop_ratios(rect).copyTo(ratios);
-		mask(rect).copyTo(ratios_mask);
-		rel_pos = cv::Point(rect.x, rect.y);
+		//Output the overlap-containing region's position in the first spot mat
+		rel_pos = region.bounds.tl() - p1;
 	}
 
 	/*Create a rectangle containing the non-zero pixels in a mask that can be used to crop them from it
@@ -236,7 +209,7 @@ namespace ba
 	/*Calculate the affine transform that best matches the overlapping region between 2 overlapping circles. Not currently
 	**being used. May finish this function later
 	**co: circ_overlap &, Region where circles overlap
-	**mask: cv::Mat &, 8-bit mask that's non-zero values indicate where the circles overlap
+	**region: span_region &, Runs of pixels where the circles overlap
 	**c1: cv::Mat &, One of the circles
 	**c2; cv::Mat &, The other circles
 	**p1: cv::Point &, Top left point of a square containing the first circle on the detector
@@ -244,7 +217,7 @@ namespace ba
 	**max_affine_shift: const float, Maximum amount to try shifting affine control points
 	**incr_affine_shift: const float, Increment between affine control points being trialled
 	*/
-	void get_best_overlap(circ_overlap &co, cv::Mat &mask, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, 
+	void get_best_overlap(circ_overlap &co, span_region &region, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, 
 		const float max_affine_shift, const float incr_affine_shift, const int cols, const int rows, const int r)
 	{
 		//Create a circular mask of affine shifts to trial
@@ -268,13 +241,10 @@ namespace ba
 		srcTri[1] = cv::Point2f( c1.cols-1, 0 );
 		srcTri[2] = cv::Point2f( radius, c1.rows-1 );
 
-		//Calculate the improvements in matching for various combinations of the affine shifts
-		byte *bi, *bj, *bk;
-        #pragma omp parallel for
-		//Shift about control point i
-		for (int i1 = 0; i1 < affine_shifts.rows; i1++)
+		//Calculate the improvements in matching for various combinations of the affine shifts. Shift about control point i
+		parallel_for(0, affine_shifts.rows, [&](int i1)
 		{
-			bi = affine_shifts.ptr<byte>(i1);
+			byte *bi = affine_shifts.ptr<byte>(i1);
 			for (int i2 = 0; i2 < affine_shifts.cols; i2++)
 			{
 				//If the pixel is marked as a shift to perform
@@ -283,7 +253,7 @@ namespace ba
 					//Shift about control point j
 					for (int j1 = 0; j1 < affine_shifts.rows; j1++)
 					{
-						bj = affine_shifts.ptr<byte>(j1);
+						byte *bj = affine_shifts.ptr<byte>(j1);
 						for (int j2 = 0; j2 < affine_shifts.cols; j2++)
 						{
 							//If the pixel is marked as a shift to perform
@@ -292,7 +262,7 @@ namespace ba
 								//Shift about control point k
 								for (int k1 = 0; k1 < affine_shifts.rows; k1++)
 								{
-									bk = affine_shifts.ptr<byte>(k1);
+									byte *bk = affine_shifts.ptr<byte>(k1);
 									for (int k2 = 0; k2 < affine_shifts.cols; k2++)
 									{
 										//If the pixel is marked as a shift to perform
@@ -312,31 +282,10 @@ namespace ba
 											cv::warpAffine( c2, w, warp_mat, w.size(), cv::INTER_LANCZOS4 );
 
 											//Get the new overlapping region for this affine transform
-											cv::Mat affine_overlap = get_affine_overlap_mask( warp_mat, mask, co.P1, r, co.P2, r, cols, rows );
-
-											//Prepare vectors to store the values of the matrices in the overlapping region
-											int nnz_px = cv::countNonZero(affine_overlap);
-											std::vector<float> vals1(nnz_px);
-											std::vector<float> vals2(nnz_px);
-
-											//Get the pixel value and distances from circle centers for pixels in the overlapping region
-											byte *b;
-											for (int i = 0, k = 0; i < affine_overlap.rows; i++)
-											{
-												b = affine_overlap.ptr<byte>(i);
-												for (int j = 0; j < affine_overlap.cols; j++, k++)
-												{
-													//If the pixel is marked as an overlapping region pixel
-													if (b[j])
-													{
-														//Get the values of the pixels
-														vals1[k] = c1.at<float>(i-p1.y, j-p1.x);
-														vals2[k] = c2.at<float>(i-p2.y, j-p2.x);
-													}
-												}
-											}
-
-											double pear = pearson_corr(vals1, vals2);
+											span_region affine_overlap = get_affine_overlap_spans( warp_mat, region, co.P1, r, co.P2, r, cols, rows );
+
+											//Correlate the matrices straight from the runs of the overlapping region
+											double pear = span_pearson_corr(c1, p1, c2, p2, affine_overlap);
 
 											//Continue later if needed...
 										}
@@ -347,13 +296,13 @@ namespace ba
 					}
 				}
 			}
-		}
+		});
 	}
 
 	/*Create a matrix indicating where a spot overlaps with an affinely transformed spot
 	**Inputs:
 	**warp_mat: cv::Mat &, Affine warp matrix
-	**mask: cv::Mat &, Mask indicating the spot overlap in the absence of affine transformation
+	**region: span_region &, Runs of pixels where the spots overlap in the absence of affine transformation
 	**P1: cv::Point2d, Center of one of the circles
 	**r1: const int &, Radius of one of the circles
 	**P2: cv::Point2d, Center of the other circle
@@ -364,83 +313,12 @@ namespace ba
 	**Returns:
 	**cv::Mat, 8 bit image where the overlapping region is marked with ones
 	*/
-	cv::Mat get_affine_overlap_mask(cv::Mat &warp_mat, cv::Mat &mask, cv::Point2d P1, const int r1, cv::Point2d P2,
+	cv::Mat get_affine_overlap_mask(cv::Mat &warp_mat, span_region &region, cv::Point2d P1, const int r1, cv::Point2d P2,
 		const int r2, const int cols, const int rows, const byte val)
 	{
-		//Create separate masks to draw the circles on
-		cv::Mat circle1 = cv::Mat(rows, cols, CV_8UC1, cv::Scalar(0));
-		cv::Mat circle2 = cv::Mat(rows, cols, CV_8UC1, cv::Scalar(0));
-
-		//Draw first circle
-		{
-			//Get the minimum and maximum rows and columns to iterate between
-			int min_col, max_col, min_row, max_row;
-			min_col = std::max(0, (int)(P1.x-r1));
-			max_col = std::min(cols-1, (int)(P1.x+r1));
-			min_row = std::max(0, (int)(P1.y-r1));
-			max_row = std::min(rows-1, (int)(P1.y+r1));
-
-			//Iterate accross the circle rows
-			byte *p;
-            #pragma omp parallel for
-			for (int i = min_row, rel_row = min_row-P1.y; i <= max_row; i++, rel_row++)
-			{
-				//Create C-style pointers to interate across the circle with
-				p = circle1.ptr<byte>(i);
-
-				//Get columns to iterate between
-				int c = (int)std::sqrt(r1*r1-rel_row*rel_row);
-				int min = std::max(min_col, (int)(P1.x-c));
-				int max = std::min(max_col, (int)(P1.x+c));
-
-				//Iterate across columns
-				for (int j = min; j <= max; j++)
-				{
-					p[j] = val;
-				}
-			}
-		}
-
-		//Draw second circle
-		{
-			//Get the minimum and maximum rows and columns to iterate between
-			int min_col, max_col, min_row, max_row;
-			min_col = std::max(0, (int)(P2.x-r2));
-			max_col = std::min(cols-1, (int)(P2.x+r2));
-			min_row = std::max(0, (int)(P2.y-r2));
-			max_row = std::min(rows-1, (int)(P2.y+r2));
-
-			//Iterate accross the circle rows
-			byte *p;
-            #pragma omp parallel for
-			for (int i = min_row, rel_row = min_row-P2.y; i <= max_row; i++, rel_row++)
-			{
-				//Create C-style pointers to interate across the circle with
-				p = circle2.ptr<byte>(i);
-
-				//Get columns to iterate between
-				int c = (int)std::sqrt(r2*r2-rel_row*rel_row);
-				int min = std::max(min_col, (int)(P2.x-c));
-				int max = std::min(max_col, (int)(P2.x+c));
-
-				//Iterate across columns
-				for (int j = min; j <= max; j++)
-				{
-					p[j] = val;
-				}
-			}
-		}
-
-		//Affinely transform the second circle
-		cv::Mat w = cv::Mat(circle2.size(), circle2.type());
-		cv::warpAffine( circle2, w, warp_mat, w.size(), cv::INTER_LANCZOS4 );
-
-		//Erode the edges of the transform to compensate for edge effects
-		cv::erode(w, w, cv::Mat(), cv::Point(-1,-1), 1);
-
-		//The overlapping region is where the circle and the affinely transformed circle are marked, within
-		//the confines of the original region to ensure that nothing has gone off the edge of the image
-		return circle1 & w & mask;
+		//Find the overlap analytically from the affinely transformed circle equation and mark it
+		span_region overlap = get_affine_overlap_spans(warp_mat, region, P1, r1, P2, r2, cols, rows);
+		return span_region_to_mask(overlap, cols, rows, cv::Point(0, 0), val);
 	}
 
 	/*Get the relative positions of overlapping regions of spots using the ORB feature detector. This function was written to test
@@ -486,11 +364,11 @@ namespace ba
 							//Find if the overlapping region is entirely on the image
 							if (on_img(co.bounding_rect[0], cols, rows) && on_img(co.bounding_rect[1], cols, rows))
 							{
-								//Create a mask idicating where the circles overlap to extract the values from the images
-								cv::Mat co_mask = gen_circ_overlap_mask(co.P1, radius, co.P2, radius, cols, rows);
+								//Get the runs of pixels where the circles overlap to extract the values from the images
+								span_region co_spans = gen_circ_overlap_spans(co.P1, radius, co.P2, radius, cols, rows);
 
-								//Get the number of overlapping pixels from the mask
-								int num_overlap = cv::countNonZero(co_mask);
+								//Get the number of overlapping pixels
+								int num_overlap = co_spans.num_px;
 
 								//Check that there are enough pixels to make a meaningful estimate of the symmetry center
 								if (num_overlap > MIN_OVERLAP_PX_NUM)
@@ -502,7 +380,7 @@ namespace ba
 
 									//Get the ratios of the overlapping protions of the image
 									cv::Vec2f shift; //Shift of the second image relative to the first
-									get_overlap_rel_pos(co_mask, groups[m], groups[n], group_pos[m], group_pos[n], orb, num_overlap, shift);
+									get_overlap_rel_pos(co_spans, groups[m], groups[n], group_pos[m], group_pos[n], orb, num_overlap, shift);
 								}
 							}
 						}
@@ -521,7 +399,7 @@ namespace ba
 	/*Relative position of one spot overlapping with another using the ORB feature detector. This function was written to test
 	**the idea
 	**Inputs:
-	**mask: cv::Mat &, 8-bit mask that's non-zero values indicate where the circles overlap
+	**region: span_region &, Runs of pixels where the circles overlap
 	**c1: cv::Mat &, One of the circles
 	**c2; cv::Mat &, The other circles
 	**p1: cv::Point &, Top left point of a square containing the first circle on the detector
@@ -531,34 +409,31 @@ namespace ba
 	**nnz: const int, Number of non-zero pixels in the mask. The number of features looked for will be based on this
 	**shift: cv::Vec2f &, Output how much the second image needs to be shifted to align it
 	*/
-	void get_overlap_rel_pos(cv::Mat &mask, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2,
+	void get_overlap_rel_pos(span_region &region, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2,
 		cv::Ptr<cv::ORB> &orb, const int nnz, cv::Vec2f &shift)
 	{
 		//Create an image to store ratios on and a mask indicating them
 		cv::Mat overlap1 = cv::Mat(c1.size(), CV_32FC1, cv::Scalar(0.0));
 		cv::Mat overlap2 = cv::Mat(c1.size(), CV_32FC1, cv::Scalar(0.0));
 
-		//Get the pixel value and distances from circle centers for pixels in the overlapping region
-		byte *b;
-		for (int i = 0, co_num = 0; i < mask.rows; i++)
+		//Copy the runs of overlapping pixels onto the first circle's grid
+		for (int k = 0; k < region.spans.size(); k++)
 		{
-			b = mask.ptr<byte>(i);
-			for (int j = 0; j < mask.cols; j++)
+			int i = region.spans[k].row;
+			float *p = c1.ptr<float>(i-p1.y);
+			float *q = c2.ptr<float>(i-p2.y);
+			float *o1 = overlap1.ptr<float>(i-p1.y);
+			float *o2 = overlap2.ptr<float>(i-p1.y);
+			for (int j = region.spans[k].start; j < region.spans[k].end; j++)
 			{
-				//If the pixel is marked as an overlapping region pixel
-				if (b[j])
-				{
-					//Get the values of the pixels
-					double val1, val2;
-					val1 = c1.at<float>(i-p1.y, j-p1.x);
-					val2 = c2.at<float>(i-p2.y, j-p2.x);
-
-					overlap1.at<float>(i-p1.y, j-p1.x) = val1;
-					overlap2.at<float>(i-p1.y, j-p1.x) = val2;
-				}
+				o1[j-p1.x] = p[j-p1.x];
+				o2[j-p1.x] = q[j-p2.x];
 			}
 		}
 
+		//Mask marking the overlap on the first circle's grid
+		cv::Mat mask = span_region_to_mask(region, c1.cols, c1.rows, p1);
+
 		//Make number of keypoints to look for proportional to the area
 		int num_feat = 20;//nnz / OVERLAP_REL_POS_PX_PER_KEYPOINT;
 
@@ -627,18 +502,18 @@ namespace ba
 							//Find if the overlapping region is entirely on the image
 							if (on_img(co.bounding_rect[0], cols, rows) && on_img(co.bounding_rect[1], cols, rows))
 							{
-								//Create a mask idicating where the circles overlap to extract the values from the images
-								cv::Mat co_mask = gen_circ_overlap_mask(co.P1, radius, co.P2, radius, cols, rows);
+								//Get the runs of pixels where the circles overlap to extract the values from the images
+								span_region co_spans = gen_circ_overlap_spans(co.P1, radius, co.P2, radius, cols, rows);
 
-								//Get the number of overlapping pixels from the mask
-								int num_overlap = cv::countNonZero(co_mask);
+								//Get the number of overlapping pixels
+								int num_overlap = co_spans.num_px;
 
 								//Check that there are enough pixels to make a meaningful estimate of the symmetry center
 								if (num_overlap > MIN_OVERLAP_PX_NUM)
 								{
 									//Get the ratios of the overlapping protions of the image
 									cv::Vec3f shift = cv::Vec3f(m, n, 0); //Shift of the second image relative to the first
-									get_pearson_overlap_register(co_mask, groups[m], groups[n], group_pos[m], group_pos[n], 
+									get_pearson_overlap_register(co_spans, groups[m], groups[n], group_pos[m], group_pos[n], 
 										MIN_OVERLAP_PX_REG, cv::Vec2i(8, 8), shift);
 				
 									//Get the confidence interval for this pearson coefficient and sample size
@@ -668,7 +543,7 @@ namespace ba
 
 	/*Relative position of one spot overlapping with another using Pearson product moment correlation to register them
 	**Inputs:
-	**mask: cv::Mat &, 8-bit mask that's non-zero values indicate where the circles overlap
+	**region: span_region &, Runs of pixels where the circles overlap
 	**c1: cv::Mat &, One of the circles
 	**c2; cv::Mat &, The other circles
 	**p1: cv::Point &, Top left point of a square containing the first circle on the detector
@@ -677,41 +552,25 @@ namespace ba
 	**max_shift: cv::Vec2i &, Maximum displacent of the images
 	**shift: cv::Vec3f &, Output how much the second image needs to be shifted to align it and the Pearson coefficient
 	*/
-	void get_pearson_overlap_register(cv::Mat &mask, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, const int min_px,
+	void get_pearson_overlap_register(span_region &region, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, const int min_px,
 		cv::Vec2i &max_shift, cv::Vec3f &shift)
 	{
-		//Create an image to store ratios on and a mask indicating them
-		cv::Mat overlap1 = cv::Mat(c1.size(), CV_32FC1, cv::Scalar(0.0));
-		cv::Mat overlap2 = cv::Mat(c1.size(), CV_32FC1, cv::Scalar(0.0));
-		cv::Mat overlap_mask = cv::Mat(c1.size(), CV_8UC1, cv::Scalar(0));
+		//Extract the overlap directly into images the size of the rectangle bounding it
+		cv::Rect rect = region.bounds;
+		cv::Mat mini_overlap1 = cv::Mat(rect.size(), CV_32FC1, cv::Scalar(0.0));
+		cv::Mat mini_overlap2 = cv::Mat(rect.size(), CV_32FC1, cv::Scalar(0.0));
+		cv::Mat mini_mask = span_region_to_mask(region, rect.width, rect.height, rect.tl(), 255);
 
-		//Get the pixel value and distances from circle centers for pixels in the overlapping region
-		byte *b;
-		for (int i = 0, co_num = 0; i < mask.rows; i++)
+		for (int k = 0; k < region.spans.size(); k++)
 		{
-			b = mask.ptr<byte>(i);
-			for (int j = 0; j < mask.cols; j++)
-			{
-				//If the pixel is marked as an overlapping region pixel
-				if (b[j])
-				{
-					overlap1.at<float>(i-p1.y, j-p1.x) = c1.at<float>(i-p1.y, j-p1.x);
-					overlap2.at<float>(i-p1.y, j-p1.x) = c2.at<float>(i-p2.y, j-p2.x);
-
-					overlap_mask.at<byte>(i-p1.y, j-p1.x) = 255;
-				}
-			}
+			int i = region.spans[k].row;
+			int len = region.spans[k].end - region.spans[k].start;
+			std::memcpy(mini_overlap1.ptr<float>(i-rect.y) + region.spans[k].start-rect.x,
+				c1.ptr<float>(i-p1.y) + region.spans[k].start-p1.x, len*sizeof(float));
+			std::memcpy(mini_overlap2.ptr<float>(i-rect.y) + region.spans[k].start-rect.x,
+				c2.ptr<float>(i-p2.y) + region.spans[k].start-p2.x, len*sizeof(float));
 		}
 
-		//Get the rectangle needed to crop the images to reduce the amound of memory needed to store them
-		cv::Rect rect = get_non_zero_mask_px_bounds(overlap_mask);
-
-		//Output the overlap-containing region, along with it's position in the first spot mat
-		cv::Mat mini_overlap1, mini_overlap2, mini_mask;
-		overlap1(rect).copyTo(mini_overlap1);
-		overlap2(rect).copyTo(mini_overlap2);
-		overlap_mask(rect).copyTo(mini_mask);
-
 		if (shift[0] == 84 && shift[1] == 154)
 		{
 			//display_CV(overlap1);
@@ -865,45 +724,7 @@ namespace ba
 	*/
 	double masked_pearson_corr(cv::Mat &img1, cv::Mat &img2, cv::Mat &mask)
 	{
-		//Sums for Pearson product moment correlation coefficient
-		double sum_xy = 0.0f;
-		double sum_x = 0.0f;
-		double sum_y = 0.0f;
-		double sum_x2 = 0.0f;
-		double sum_y2 = 0.0f;
-
-		//Reflect points across mirror line and compare them to the nearest pixel
-		int nnz = 0; //Number of pixels contributing to the calculation
-		byte *b;
-		float *p, *q;
-		for (int i = 0; i < img1.rows; i++)
-		{
-			b = mask.ptr<byte>(i);
-			p = img1.ptr<float>(i);
-			q = img2.ptr<float>(i);
-			for (int j = 0; j < img1.cols; j++)
-			{
-				if (b[j])
-				{
-					//Contribute to Pearson correlation coefficient
-					sum_xy += p[j]*q[j];
-					sum_x += p[j];
-					sum_y += q[j];
-					sum_x2 += p[j]*p[j];
-					sum_y2 += q[j]*q[j];
-
-					nnz++;
-				}
-			}
-		}
-
-		double pear = (nnz*sum_xy - sum_x*sum_y) / (std::sqrt(nnz*sum_x2 - sum_x*sum_x) * std::sqrt(nnz*sum_y2 - sum_y*sum_y));
-		if (std::isnan(pear))
-		{
-			std::cout << nnz << ", " << sum_xy << ", " << sum_x << ", " << sum_y << ", " << sum_x2 << ", " << sum_y2 << std::endl;
-		}
-		
-		return pear;
+		return pearson_from_moments(mat_moments(img1, img2, mask));
 	}
 
 	/*Use the Fisher transform to get a confidence interval for Pearson's coefficient. Not tested: switched to MATLAB's
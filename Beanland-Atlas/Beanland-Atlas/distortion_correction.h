@@ -5,6 +5,8 @@
 #include <commensuration.h>
 #include <commensuration_utility.h>
 #include <matlab.h> //Matlab-specific includes
+#include <overlap_spans.h>
+#include <task_scheduler.h>
 #include <utility.hpp>
 
 namespace ba
@@ -46,7 +48,7 @@ namespace ba
 	/*Create a matrix indicating where a spot overlaps with an affinely transformed spot
 	**Inputs:
 	**warp_mat: cv::Mat &, Affine warp matrix
-	**mask: cv::Mat &, Mask indicating the spot overlap in the absence of affine transformation
+	**region: span_region &, Runs of pixels where the spots overlap in the absence of affine transformation
 	**P1: cv::Point2d, Center of one of the circles
 	**r1: const int &, Radius of one of the circles
 	**P2: cv::Point2d, Center of the other circle
@@ -57,7 +59,7 @@ namespace ba
 	**Returns:
 	**cv::Mat, 8 bit image where the overlapping region is marked with ones
 	*/
-	cv::Mat get_affine_overlap_mask(cv::Mat &warp_mat, cv::Mat &mask, cv::Point2d P1, const int r1, cv::Point2d P2,
+	cv::Mat get_affine_overlap_mask(cv::Mat &warp_mat, span_region &region, cv::Point2d P1, const int r1, cv::Point2d P2,
 		const int r2, const int cols, const int rows, const byte val = 255);
 
 	/*Create a rectangle containing the non-zero pixels in a mask that can be used to crop them from it
@@ -70,19 +72,17 @@ namespace ba
 
 	/*Get the ratio of the intensity profiles where 2 spots overlap
 	**Inputs:
-	**mask: cv::Mat &, 8-bit mask that's non-zero values indicate where the circles overlap
+	**region: span_region &, Runs of pixels where the circles overlap
 	**c1: cv::Mat &, One of the circles
 	**c2; cv::Mat &, The other circles
 	**p1: cv::Point &, Top left point of a square containing the first circle on the detector
 	**p2: cv::Point &, Top left point of a square containing the second circle on the detector
-	**max_shift: const float, Maximum shift to consider
-	**incr_shift: const float, Steps to adjust the shift by
 	**ratios: cv::Mat &, Output cropped image containing the overlap region containing the ratios of the intensity profiles.
 	**Ratios larger than 1.0 are reciprocated
 	**ratios_mask: cv::Mat &, Output mask indicating the ratios pixels containing ratios
 	**rel_pos: cv::Point &, The position of the top left corner of ratios and ratios_mask in the c1 mat
 	*/
-	void get_overlap_ratios(cv::Mat &mask, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, 
+	void get_overlap_ratios(span_region &region, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, 
 		cv::Mat &ratios, cv::Mat &ratios_mask, cv::Point &rel_pos);
 
 	/*Get the relative positions of overlapping regions of spots
@@ -105,7 +105,7 @@ namespace ba
 
 	/*Relative position of one spot overlapping with another
 	**Inputs:
-	**mask: cv::Mat &, 8-bit mask that's non-zero values indicate where the circles overlap
+	**region: span_region &, Runs of pixels where the circles overlap
 	**c1: cv::Mat &, One of the circles
 	**c2; cv::Mat &, The other circles
 	**p1: cv::Point &, Top left point of a square containing the first circle on the detector
@@ -115,7 +115,7 @@ namespace ba
 	**nnz: const int, Number of non-zero pixels in the mask. The number of features looked for will be based on this
 	**shift: cv::Vec2f &, Output how much the second image needs to be shifted to align it
 	*/
-	void get_overlap_rel_pos(cv::Mat &mask, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2,
+	void get_overlap_rel_pos(span_region &region, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2,
 		cv::Ptr<cv::ORB> &orb, const int nnz, cv::Vec2f &shift);
 
 	/*Use Pearson product moment correlation coefficients to determine the relative positions of 2 overlapping regions
@@ -139,7 +139,7 @@ namespace ba
 
 	/*Relative position of one spot overlapping with another using Pearson product moment correlation to register them
 	**Inputs:
-	**mask: cv::Mat &, 8-bit mask that's non-zero values indicate where the circles overlap
+	**region: span_region &, Runs of pixels where the circles overlap
 	**c1: cv::Mat &, One of the circles
 	**c2; cv::Mat &, The other circles
 	**p1: cv::Point &, Top left point of a square containing the first circle on the detector
@@ -148,7 +148,7 @@ namespace ba
 	**max_shift: cv::Vec2i &, Maximum displacent of the images
 	**shift: cv::Vec3f &, Output how much the second image needs to be shifted to align it and the Pearson coefficient
 	*/
-	void get_pearson_overlap_register(cv::Mat &mask, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, const int min_px,
+	void get_pearson_overlap_register(span_region &region, cv::Mat &c1, cv::Mat &c2, cv::Point &p1, cv::Point &p2, const int min_px,
 		cv::Vec2i &max_shift, cv::Vec3f &shift);
 
 	/*Use Pearson product moment correlation to register 2 masked images of the same size
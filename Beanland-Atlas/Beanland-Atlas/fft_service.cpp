@@ -0,0 +1,183 @@
+#include <fft_service.h>
+
+namespace ba
+{
+	//The FFTW planner is not thread-safe, so all planning and cache access is serialised. Executing plans on new arrays is
+	//thread-safe so transforms themselves are not serialised
+	static std::mutex fft_mutex;
+
+	//Cached plans, keyed by transform type, rows, columns, alignment and planning flags
+	static std::map<std::array<int, 5>, fftw_plan> fft_plans;
+
+	//Free aligned buffers, keyed by their size in bytes
+	static std::map<size_t, std::vector<void*>> fft_buffers;
+
+	//Planning effort for new plans
+	static unsigned fft_planning_flags = FFTW_ESTIMATE;
+
+	/*Load FFTW wisdom accumulated by previous runs. This should be called once at startup, before any plans are created
+	**Inputs:
+	**wisdom_path: const char *, File to load the wisdom from. It is fine for it not to exist yet
+	*/
+	void init_fft_service(const char *wisdom_path)
+	{
+		std::lock_guard<std::mutex> lock(fft_mutex);
+		fftw_import_wisdom_from_filename(wisdom_path);
+	}
+
+	/*Save the accumulated FFTW wisdom, then destroy all cached plans and free the buffer pool. This should be called once at
+	**shutdown, after all transforms have finished
+	**Inputs:
+	**wisdom_path: const char *, File to save the wisdom to
+	*/
+	void close_fft_service(const char *wisdom_path)
+	{
+		std::lock_guard<std::mutex> lock(fft_mutex);
+
+		if (!fftw_export_wisdom_to_filename(wisdom_path))
+		{
+			std::cerr << "Failed to save FFTW wisdom to " << wisdom_path << std::endl;
+		}
+
+		//Free fftw resources
+		for (std::map<std::array<int, 5>, fftw_plan>::iterator it = fft_plans.begin(); it != fft_plans.end(); it++)
+		{
+			fftw_destroy_plan(it->second);
+		}
+		fft_plans.clear();
+
+		for (std::map<size_t, std::vector<void*>>::iterator it = fft_buffers.begin(); it != fft_buffers.end(); it++)
+		{
+			for (int i = 0; i < it->second.size(); i++)
+			{
+				fftw_free(it->second[i]);
+			}
+		}
+		fft_buffers.clear();
+	}
+
+	/*Set how much effort FFTW spends planning new transforms. Plans created with different efforts are cached separately
+	**Inputs:
+	**flags: const unsigned, FFTW_ESTIMATE for interactive use or FFTW_MEASURE or FFTW_PATIENT for long batch jobs
+	*/
+	void set_fft_planning_mode(const unsigned flags)
+	{
+		std::lock_guard<std::mutex> lock(fft_mutex);
+		fft_planning_flags = flags;
+	}
+
+	/*Get a buffer with FFTW's SIMD alignment from the pool without locking it
+	**Inputs:
+	**bytes: const size_t, Size of the buffer
+	**Returns:
+	**void *, Aligned buffer
+	*/
+	static void *acquire_unlocked(const size_t bytes)
+	{
+		std::vector<void*> &free_bufs = fft_buffers[bytes];
+		if (free_bufs.empty())
+		{
+			return fftw_malloc(bytes);
+		}
+
+		void *buf = free_bufs.back();
+		free_bufs.pop_back();
+		return buf;
+	}
+
+	/*Get a plan for a transform from the cache, creating it if it doesn't exist. Plans are created on scratch buffers so that
+	**the planner doesn't overwrite data, and must be executed with fftw_execute_dft_r2c or fftw_execute_dft_c2r
+	**Inputs:
+	**type: const int, Type of transform. FFT_R2C or FFT_C2R
+	**rows: const int, Rows of the real data. If this is 1, the transform is 1D
+	**cols: const int, Columns of the real data
+	**aligned: const bool, True if the plan will only be executed on buffers with FFTW's SIMD alignment e.g. from the buffer pool
+	**Returns:
+	**fftw_plan, Cached plan. It is owned by the cache and must not be destroyed
+	*/
+	fftw_plan get_fft_plan(const int type, const int rows, const int cols, const bool aligned)
+	{
+		std::lock_guard<std::mutex> lock(fft_mutex);
+
+		std::array<int, 5> key = { type, rows, cols, aligned, (int)fft_planning_flags };
+		std::map<std::array<int, 5>, fftw_plan>::iterator it = fft_plans.find(key);
+		if (it != fft_plans.end())
+		{
+			return it->second;
+		}
+
+		//Scratch buffers for the planner to measure transforms on
+		size_t real_bytes = (size_t)rows*cols*sizeof(double);
+		size_t complex_bytes = (size_t)rows*(cols/2+1)*sizeof(fftw_complex);
+		double *real = (double*)acquire_unlocked(real_bytes);
+		fftw_complex *spectrum = (fftw_complex*)acquire_unlocked(complex_bytes);
+
+		unsigned flags = fft_planning_flags | (aligned ? 0 : FFTW_UNALIGNED);
+		fftw_plan plan;
+		if (type == FFT_R2C)
+		{
+			plan = rows == 1 ? fftw_plan_dft_r2c_1d(cols, real, spectrum, flags) :
+				fftw_plan_dft_r2c_2d(rows, cols, real, spectrum, flags);
+		}
+		else
+		{
+			plan = rows == 1 ? fftw_plan_dft_c2r_1d(cols, spectrum, real, flags) :
+				fftw_plan_dft_c2r_2d(rows, cols, spectrum, real, flags);
+		}
+
+		fft_buffers[real_bytes].push_back(real);
+		fft_buffers[complex_bytes].push_back(spectrum);
+
+		fft_plans[key] = plan;
+		return plan;
+	}
+
+	/*Get a buffer with FFTW's SIMD alignment from the pool, allocating it if none of the requested size are free
+	**Inputs:
+	**bytes: const size_t, Size of the buffer
+	**Returns:
+	**void *, Aligned buffer. It must be returned to the pool with fft_buffer_release
+	*/
+	void *fft_buffer_acquire(const size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(fft_mutex);
+		return acquire_unlocked(bytes);
+	}
+
+	/*Return a buffer to the pool so that it can be reused
+	**Inputs:
+	**buf: void *, Buffer from fft_buffer_acquire
+	**bytes: const size_t, Size the buffer was acquired with
+	*/
+	void fft_buffer_release(void *buf, const size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(fft_mutex);
+		fft_buffers[bytes].push_back(buf);
+	}
+
+	/*Real to complex forward transform using a cached plan. Only the non-redundant half of the spectrum is calculated
+	**Inputs:
+	**rows: const int, Rows of the real data. If this is 1, the transform is 1D
+	**cols: const int, Columns of the real data
+	**in: double *, Real data
+	**out: fftw_complex *, Output rows x (cols/2+1) spectrum
+	*/
+	void fft_r2c(const int rows, const int cols, double *in, fftw_complex *out)
+	{
+		bool aligned = !fftw_alignment_of(in) && !fftw_alignment_of((double*)out);
+		fftw_execute_dft_r2c(get_fft_plan(FFT_R2C, rows, cols, aligned), in, out);
+	}
+
+	/*Complex to real inverse transform using a cached plan. The result is not normalised and the input is overwritten
+	**Inputs:
+	**rows: const int, Rows of the real data. If this is 1, the transform is 1D
+	**cols: const int, Columns of the real data
+	**in: fftw_complex *, rows x (cols/2+1) spectrum
+	**out: double *, Output real data
+	*/
+	void fft_c2r(const int rows, const int cols, fftw_complex *in, double *out)
+	{
+		bool aligned = !fftw_alignment_of((double*)in) && !fftw_alignment_of(out);
+		fftw_execute_dft_c2r(get_fft_plan(FFT_C2R, rows, cols, aligned), in, out);
+	}
+}
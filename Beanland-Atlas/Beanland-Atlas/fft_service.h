@@ -0,0 +1,74 @@
+#pragma once
+
+#include <includes.h>
+
+namespace ba
+{
+	//Types of transform that plans can be created for
+    #define FFT_R2C 0 //Real to complex forward transform
+    #define FFT_C2R 1 //Complex to real inverse transform
+
+	/*Load FFTW wisdom accumulated by previous runs. This should be called once at startup, before any plans are created
+	**Inputs:
+	**wisdom_path: const char *, File to load the wisdom from. It is fine for it not to exist yet
+	*/
+	void init_fft_service(const char *wisdom_path = fft_wisdom_path);
+
+	/*Save the accumulated FFTW wisdom, then destroy all cached plans and free the buffer pool. This should be called once at
+	**shutdown, after all transforms have finished
+	**Inputs:
+	**wisdom_path: const char *, File to save the wisdom to
+	*/
+	void close_fft_service(const char *wisdom_path = fft_wisdom_path);
+
+	/*Set how much effort FFTW spends planning new transforms. Plans created with different efforts are cached separately
+	**Inputs:
+	**flags: const unsigned, FFTW_ESTIMATE for interactive use or FFTW_MEASURE or FFTW_PATIENT for long batch jobs
+	*/
+	void set_fft_planning_mode(const unsigned flags);
+
+	/*Get a plan for a transform from the cache, creating it if it doesn't exist. Plans are created on scratch buffers so that
+	**the planner doesn't overwrite data, and must be executed with fftw_execute_dft_r2c or fftw_execute_dft_c2r
+	**Inputs:
+	**type: const int, Type of transform. FFT_R2C or FFT_C2R
+	**rows: const int, Rows of the real data. If this is 1, the transform is 1D
+	**cols: const int, Columns of the real data
+	**aligned: const bool, True if the plan will only be executed on buffers with FFTW's SIMD alignment e.g. from the buffer pool
+	**Returns:
+	**fftw_plan, Cached plan. It is owned by the cache and must not be destroyed
+	*/
+	fftw_plan get_fft_plan(const int type, const int rows, const int cols, const bool aligned = true);
+
+	/*Get a buffer with FFTW's SIMD alignment from the pool, allocating it if none of the requested size are free
+	**Inputs:
+	**bytes: const size_t, Size of the buffer
+	**Returns:
+	**void *, Aligned buffer. It must be returned to the pool with fft_buffer_release
+	*/
+	void *fft_buffer_acquire(const size_t bytes);
+
+	/*Return a buffer to the pool so that it can be reused
+	**Inputs:
+	**buf: void *, Buffer from fft_buffer_acquire
+	**bytes: const size_t, Size the buffer was acquired with
+	*/
+	void fft_buffer_release(void *buf, const size_t bytes);
+
+	/*Real to complex forward transform using a cached plan. Only the non-redundant half of the spectrum is calculated
+	**Inputs:
+	**rows: const int, Rows of the real data. If this is 1, the transform is 1D
+	**cols: const int, Columns of the real data
+	**in: double *, Real data
+	**out: fftw_complex *, Output rows x (cols/2+1) spectrum
+	*/
+	void fft_r2c(const int rows, const int cols, double *in, fftw_complex *out);
+
+	/*Complex to real inverse transform using a cached plan. The result is not normalised and the input is overwritten
+	**Inputs:
+	**rows: const int, Rows of the real data. If this is 1, the transform is 1D
+	**cols: const int, Columns of the real data
+	**in: fftw_complex *, rows x (cols/2+1) spectrum
+	**out: double *, Output real data
+	*/
+	void fft_c2r(const int rows, const int cols, fftw_complex *in, double *out);
+}
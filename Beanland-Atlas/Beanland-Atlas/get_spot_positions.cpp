@@ -5,7 +5,7 @@ namespace ba
 	/*Find the positions of the spots in the aligned image average pattern. Most of these spots are made from the contributions of many images
 	**so it can be assumed that they are relatively featureless
 	**Inputs:
-	**align_avg: cv::Mat &, Average values of px in aligned diffraction patterns
+	**align_avg: cv::Mat &, 32-bit average values of px in aligned diffraction patterns
 	**initial_radius: int, Radius of the spots
 	**initial_thickness: int, Thickness of the annulus to convolve with spots
 	**annulus_creator: cl_kernel, OpenCL kernel to create padded unblurred annulus to cross correlate the aligned image average pattern Sobel
@@ -24,6 +24,8 @@ namespace ba
 		cl_kernel circle_creator, cl_kernel gauss_creator, cl_command_queue af_queue, int align_avg_cols, int align_avg_rows, 
 		cv::Vec2f &samp_to_detect_sphere, const int discard_outer)
 	{
+		BA_TIME_FUNCTION();
+
 		//Create vector to hold the spot positions
 		std::vector<cv::Point> positions;
 
@@ -31,10 +33,12 @@ namespace ba
 		int cols = ceil_power_2(align_avg_cols);
 		int rows = ceil_power_2(align_avg_rows);
 
-		//Use an intermediate image to load the resized aligned average pixel values onto the GPU, otherwise memory is not contiguous
-		cv::Mat contig_align_avg;
-		cv::resize(align_avg, contig_align_avg, cv::Size(cols, rows), 0, 0, cv::INTER_LANCZOS4); //Resize the array so that it is a power of 2 in size
-		af::array align_avg_af(cols, rows, (float*)contig_align_avg.data);
+		//Resize the aligned average pixel values straight into pinned memory so that it is a power of 2 in size. The destination
+		//is a view of the right size and type, so OpenCV doesn't reallocate it
+		image_buffer align_avg_buf = create_image_buffer(rows, cols);
+		cv::Mat contig_align_avg = buffer_mat(align_avg_buf, true);
+		cv::resize(align_avg, contig_align_avg, cv::Size(cols, rows), 0, 0, cv::INTER_LANCZOS4);
+		af::array align_avg_af = buffer_array(align_avg_buf);
 
 		//Approximately resize the annulus and circle parameters if the pattern was resized
 		int radius, thickness;
@@ -97,30 +101,29 @@ namespace ba
 		af_array annulus_xcorr;
 		af_fft2_c2r(&annulus_xcorr, (1e-10 * gauss_fft*annulus_fft*af::array(sobel_filtrate_fft_c)).get(), 1.0f, false);
 
-		//Transfer the product of the circular and annular cross correlations back to the host
-		float *xcorr_data = (af::array(circle_xcorr)*af::array(annulus_xcorr)).host<float>();
+		//Product of the circular and annular cross correlations. Its maximum is the position of the brightest spot and therefore
+		//the center of the diffraction pattern
+		af::array xcorr_af = af::array(circle_xcorr)*af::array(annulus_xcorr);
 
-		//Modify the dimensions of the 1D array returned from the device to the host so that it is the correct size
-		cv::Mat xcorr = cv::Mat(cols, rows, CV_32FC1, xcorr_data);
+		//Keep the product to estimate the sample-to-detector sphere from. It is only transferred to the host when it is used, so
+		//the transfer doesn't hold up the spot search
+		image_buffer xcorr_buf = create_image_buffer(rows, cols);
+		set_buffer_array(xcorr_buf, xcorr_af);
 
-		//Find the location of the maximum cross correlation. This gives the position of the brightest spot and therefore the center of the
-		//diffraction pattern
-		cv::Point maxLoc;
-		cv::minMaxLoc(xcorr, NULL, NULL, NULL, &maxLoc);
+		//Find the location of the maximum on the GPU so that only it is read back
+		cv::Point maxLoc = device_argmax(xcorr_af);
 
 		//Store the position of the maximum
 		positions.push_back(maxLoc);
 
 		//Assume spots are squarely packed as this gives the lowest packing densisty. Black out spots until a set proportion of the spots
-		// have been blacked out under this assumption
+		// have been blacked out under this assumption. The blackened image stays on the GPU
+		af::array blackened_af = align_avg_af;
 		const int search_num = rows*cols / (ubound*ubound);
 		for (int i = 0; i < search_num; i++) 
 		{
 			//Blacken the brightest spot and find the next brightest
-			blacken_circle(contig_align_avg, maxLoc.x, maxLoc.y, ubound/2);
-
-			//Load the blackened image onto the GPU
-			af::array blackened_af(cols, rows, (float*)contig_align_avg.data);
+			device_blacken_circle(blackened_af, maxLoc.x, maxLoc.y, ubound/2);
 
 			/* Repeat the Fourier analysis to find the next brightest spot */
 			//Fourier transform the Sobel filtrate
@@ -135,15 +138,10 @@ namespace ba
 			//Cross correlate the image with the circle
 			af_fft2_c2r(&circle_xcorr, (1e-10 * gauss_fft*circle_fft*af::array(align_avg_fft_c)).get(), 1.0f, false);
 
-			//Transfer the product of the annulus and circle cross correlations back to the host
-			xcorr_data = (af::array(circle_xcorr)*af::array(annulus_xcorr)).host<float>();
-
-			//Modify the dimensions of the 1D array returned from the device to the host so that it is the correct size
-			cv::Mat xcorr = cv::Mat(cols, rows, CV_32FC1, xcorr_data);
-
-			//Find the location of the maximum cross correlation. This gives the position of the brightest spot and therefore the center of the
-			//diffraction pattern
-			cv::minMaxLoc(xcorr, NULL, NULL, NULL, &maxLoc);
+			//Find the location of the maximum of the product of the annulus and circle cross correlations. This gives the position
+			//of the next brightest spot
+			af::array next_xcorr_af = af::array(circle_xcorr)*af::array(annulus_xcorr);
+			maxLoc = device_argmax(next_xcorr_af);
 
 			//Store the position of the maximum
 			positions.push_back(maxLoc);
@@ -167,70 +165,31 @@ namespace ba
 		find_other_spots(on_latt_spots, refined_latt_vect, cols, rows, radius);
 
 		//Rescale the spot positions to the origninal dimensions of the aligned average image
-        #pragma omp parallel for
-		for (int i = 0; i < on_latt_spots.size(); i++)
+		parallel_for(0, on_latt_spots.size(), [&](int i)
 		{
 			on_latt_spots[i].x = (on_latt_spots[i].x * align_avg_cols) / cols;
 			on_latt_spots[i].y = (on_latt_spots[i].y * align_avg_rows) / rows;
-		}
+		});
 
 		//Discard spots that are not at least a specified distance from the peripheries of the image
 		//on_latt_spots = discard_outer_spots(on_latt_spots, cols, rows, discard_outer == -1 ? initial_radius : discard_outer);
 
-		//Estimate the parameters decribing the sample-to-detector sphere
+		//Estimate the parameters decribing the sample-to-detector sphere. The cross correlation is transferred straight into
+		//pinned memory on the host
+		cv::Mat xcorr = buffer_mat(xcorr_buf);
 		samp_to_detect_sphere = get_sample_to_detector_sphere(on_latt_spots, xcorr, discard_outer == -1 || discard_outer >= initial_radius ? 0 : initial_radius,
 			cols, rows);
 
 		//Return original positions for now - something wrong with lattice vector refinement and I don't feel I have time to fix it
-        #pragma omp parallel for
-		for (int i = 0; i < on_latt_spots.size(); i++)
+		parallel_for(0, on_latt_spots.size(), [&](int i)
 		{
 			positions[i].x = (positions[i].x * align_avg_cols) / cols;
 			positions[i].y = (positions[i].y * align_avg_rows) / rows;
-		}
-
-		//Free memory
-		free(xcorr_data);
+		});
 
 		return positions /*on_latt_spots*/;
 	}
 
-	/*Blackens the circle of pixels within a certain radius of a point in a floating point OpenCV mat
-	**Inputs:
-	**mat: cv::Mat &, Reference to a floating point OpenCV mat to blacken a circle on
-	**col: const int, column of circle origin
-	**row: const int, row of circle origin
-	**rad: const int, radius of the circle to blacken
-	*/
-	void blacken_circle(cv::Mat &mat, const int col, const int row, const int rad)
-	{
-		//Get the minimum and maximum rows and columns to iterate between
-		int min_col = std::max(0, col-rad);
-		int max_col = std::min(mat.cols-1, col+rad);
-		int min_row = std::max(0, row-rad);
-		int max_row = std::min(mat.rows-1, row+rad);
-
-		//Iterate accross the circle rows
-		float *p;
-		#pragma omp parallel for
-		for (int i = min_row, rel_row = -rad; i <= max_row; i++, rel_row++)
-		{
-			//Create C style pointer to interate across the circle with
-			p = mat.ptr<float>(i);
-
-			//Get columns to iterate between
-			int c = (int)std::sqrt(rad*rad-rel_row*rel_row);
-			int min = std::max(min_col, col-c);
-			int max = std::min(max_col, col+c);
-
-			//Iterate across columns
-			for (int j = min; j <= max; j++)
-			{
-				p[j] = 0.0f;
-			}
-		}
-	}
-
 	/*Uses a set of know spot positions to extract approximate lattice vectors for a diffraction pattern
 	**Input:
 	**positions: std::vector<cv::Point> &, Known positions of spots in the diffraction pattern
@@ -326,47 +285,32 @@ namespace ba
 		int max_vect2 = 1;
 		int min_vect2 = -1;
 
-		#pragma omp parallel sections
+		//Calculate the maximum multiple of the first lattice vector from the central spot that is in range
+		while (max_vect1*lattice_vectors[0][0] + positions[0].x < cols && max_vect1*lattice_vectors[0][1] + positions[0].y < rows &&
+			max_vect1*lattice_vectors[0][0] + positions[0].x >= 0 && max_vect1*lattice_vectors[0][1] + positions[0].y >= 0)
 		{
-			#pragma omp section
-			{
-				//Calculate the maximum multiple of the first lattice vector from the central spot that is in range
-				while (max_vect1*lattice_vectors[0][0] + positions[0].x < cols && max_vect1*lattice_vectors[0][1] + positions[0].y < rows &&
-					max_vect1*lattice_vectors[0][0] + positions[0].x >= 0 && max_vect1*lattice_vectors[0][1] + positions[0].y >= 0)
-				{
-					max_vect1++;
-				}
-			}
+			max_vect1++;
+		}
 
-			#pragma omp section
-			{
-				//Calculate the minimum multiple of the first lattice vector from the central spot that is in range
-				while (min_vect1*lattice_vectors[0][0] + positions[0].x < cols && min_vect1*lattice_vectors[0][1] + positions[0].y < rows &&
-					min_vect1*lattice_vectors[0][0] + positions[0].x >= 0 && min_vect1*lattice_vectors[0][1] + positions[0].y >= 0)
-				{
-					min_vect1--;
-				}
-			}
+		//Calculate the minimum multiple of the first lattice vector from the central spot that is in range
+		while (min_vect1*lattice_vectors[0][0] + positions[0].x < cols && min_vect1*lattice_vectors[0][1] + positions[0].y < rows &&
+			min_vect1*lattice_vectors[0][0] + positions[0].x >= 0 && min_vect1*lattice_vectors[0][1] + positions[0].y >= 0)
+		{
+			min_vect1--;
+		}
 
-			#pragma omp section
-			{
-				//Calculate the maximum multiple of the second lattice vector from the central spot that is in range
-				while (max_vect2*lattice_vectors[1][0] + positions[0].x < cols && max_vect2*lattice_vectors[1][1] + positions[0].y < rows && 
-					max_vect2*lattice_vectors[1][0] + positions[0].x >= 0 && max_vect2*lattice_vectors[1][1] + positions[0].y >= 0) 
-				{
-					max_vect2++;
-				}
-			}
+		//Calculate the maximum multiple of the second lattice vector from the central spot that is in range
+		while (max_vect2*lattice_vectors[1][0] + positions[0].x < cols && max_vect2*lattice_vectors[1][1] + positions[0].y < rows && 
+			max_vect2*lattice_vectors[1][0] + positions[0].x >= 0 && max_vect2*lattice_vectors[1][1] + positions[0].y >= 0) 
+		{
+			max_vect2++;
+		}
 
-			#pragma omp section
-			{
-				//Calculate the minimum multiple of the second lattice vector from the central spot that is in range
-				while (min_vect2*lattice_vectors[1][0] + positions[0].x < cols && min_vect2*lattice_vectors[1][1] + positions[0].y < rows && 
-					min_vect2*lattice_vectors[1][0] + positions[0].x >= 0 && min_vect2*lattice_vectors[1][1] + positions[0].y >= 0) 
-				{
-					min_vect2--;
-				}
-			}
+		//Calculate the minimum multiple of the second lattice vector from the central spot that is in range
+		while (min_vect2*lattice_vectors[1][0] + positions[0].x < cols && min_vect2*lattice_vectors[1][1] + positions[0].y < rows && 
+			min_vect2*lattice_vectors[1][0] + positions[0].x >= 0 && min_vect2*lattice_vectors[1][1] + positions[0].y >= 0) 
+		{
+			min_vect2--;
 		}
 
 		//Iterate across multiples of the first lattice vector
@@ -428,47 +372,32 @@ namespace ba
 		int max_vect2 = 1;
 		int min_vect2 = -1;
 
-        #pragma omp parallel sections
+		//Calculate the maximum multiple of the first lattice vector from the central spot that is in range
+		while (max_vect1*lattice_vectors[0][0] + positions[0].x < cols && max_vect1*lattice_vectors[0][1] + positions[0].y < rows &&
+			max_vect1*lattice_vectors[0][0] + positions[0].x >= 0 && max_vect1*lattice_vectors[0][1] + positions[0].y >= 0)
 		{
-            #pragma omp section
-			{
-				//Calculate the maximum multiple of the first lattice vector from the central spot that is in range
-				while (max_vect1*lattice_vectors[0][0] + positions[0].x < cols && max_vect1*lattice_vectors[0][1] + positions[0].y < rows &&
-					max_vect1*lattice_vectors[0][0] + positions[0].x >= 0 && max_vect1*lattice_vectors[0][1] + positions[0].y >= 0)
-				{
-					max_vect1++;
-				}
-			}
+			max_vect1++;
+		}
 
-            #pragma omp section
-			{
-				//Calculate the minimum multiple of the first lattice vector from the central spot that is in range
-				while (min_vect1*lattice_vectors[0][0] + positions[0].x < cols && min_vect1*lattice_vectors[0][1] + positions[0].y < rows &&
-					min_vect1*lattice_vectors[0][0] + positions[0].x >= 0 && min_vect1*lattice_vectors[0][1] + positions[0].y >= 0)
-				{
-					min_vect1--;
-				}
-			}
+		//Calculate the minimum multiple of the first lattice vector from the central spot that is in range
+		while (min_vect1*lattice_vectors[0][0] + positions[0].x < cols && min_vect1*lattice_vectors[0][1] + positions[0].y < rows &&
+			min_vect1*lattice_vectors[0][0] + positions[0].x >= 0 && min_vect1*lattice_vectors[0][1] + positions[0].y >= 0)
+		{
+			min_vect1--;
+		}
 
-            #pragma omp section
-			{
-				//Calculate the maximum multiple of the second lattice vector from the central spot that is in range
-				while (max_vect2*lattice_vectors[1][0] + positions[0].x < cols && max_vect2*lattice_vectors[1][1] + positions[0].y < rows && 
-					max_vect2*lattice_vectors[1][0] + positions[0].x >= 0 && max_vect2*lattice_vectors[1][1] + positions[0].y >= 0) 
-				{
-					max_vect2++;
-				}
-			}
+		//Calculate the maximum multiple of the second lattice vector from the central spot that is in range
+		while (max_vect2*lattice_vectors[1][0] + positions[0].x < cols && max_vect2*lattice_vectors[1][1] + positions[0].y < rows && 
+			max_vect2*lattice_vectors[1][0] + positions[0].x >= 0 && max_vect2*lattice_vectors[1][1] + positions[0].y >= 0) 
+		{
+			max_vect2++;
+		}
 
-            #pragma omp section
-			{
-				//Calculate the minimum multiple of the second lattice vector from the central spot that is in range
-				while (min_vect2*lattice_vectors[1][0] + positions[0].x < cols && min_vect2*lattice_vectors[1][1] + positions[0].y < rows && 
-					min_vect2*lattice_vectors[1][0] + positions[0].x >= 0 && min_vect2*lattice_vectors[1][1] + positions[0].y >= 0) 
-				{
-					min_vect2--;
-				}
-			}
+		//Calculate the minimum multiple of the second lattice vector from the central spot that is in range
+		while (min_vect2*lattice_vectors[1][0] + positions[0].x < cols && min_vect2*lattice_vectors[1][1] + positions[0].y < rows && 
+			min_vect2*lattice_vectors[1][0] + positions[0].x >= 0 && min_vect2*lattice_vectors[1][1] + positions[0].y >= 0) 
+		{
+			min_vect2--;
 		}
 
 		//Iterate across multiples of the first lattice vector
@@ -626,8 +555,7 @@ namespace ba
 
 		//For each position...
 		mult_latt_vect[0] = cv::Point2i(0, 0);
-        #pragma omp parallel for
-		for (int i = 1; i < positions.size(); i++)
+		parallel_for(1, positions.size(), [&](int i)
 		{
 			//...find the multiple of the lattice vectors that it is closest to...
 			float min_dst2 = INT_MAX;
@@ -648,7 +576,7 @@ namespace ba
 				//Record the details of the lattice point of minimum distance
 				mult_latt_vect[i] = cv::Point2i(latt_pos[min_dst_idx][0], latt_pos[min_dst_idx][1]);
 			}
-		}
+		});
 
 		return mult_latt_vect;
 	}
@@ -672,47 +600,32 @@ namespace ba
 		int max_vect2 = 1;
 		int min_vect2 = -1;
 
-        #pragma omp parallel sections
+		//Calculate the maximum multiple of the first lattice vector from the central spot that is in range
+		while (max_vect1*lattice_vectors[0][0] + origin.x < cols && max_vect1*lattice_vectors[0][1] + origin.y < rows &&
+			max_vect1*lattice_vectors[0][0] + origin.x >= 0 && max_vect1*lattice_vectors[0][1] + origin.y >= 0)
 		{
-            #pragma omp section
-			{
-				//Calculate the maximum multiple of the first lattice vector from the central spot that is in range
-				while (max_vect1*lattice_vectors[0][0] + origin.x < cols && max_vect1*lattice_vectors[0][1] + origin.y < rows &&
-					max_vect1*lattice_vectors[0][0] + origin.x >= 0 && max_vect1*lattice_vectors[0][1] + origin.y >= 0)
-				{
-					max_vect1++;
-				}
-			}
+			max_vect1++;
+		}
 
-            #pragma omp section
-			{
-				//Calculate the minimum multiple of the first lattice vector from the central spot that is in range
-				while (min_vect1*lattice_vectors[0][0] + origin.x < cols && min_vect1*lattice_vectors[0][1] + origin.y < rows &&
-					min_vect1*lattice_vectors[0][0] + origin.x >= 0 && min_vect1*lattice_vectors[0][1] + origin.y >= 0)
-				{
-					min_vect1--;
-				}
-			}
+		//Calculate the minimum multiple of the first lattice vector from the central spot that is in range
+		while (min_vect1*lattice_vectors[0][0] + origin.x < cols && min_vect1*lattice_vectors[0][1] + origin.y < rows &&
+			min_vect1*lattice_vectors[0][0] + origin.x >= 0 && min_vect1*lattice_vectors[0][1] + origin.y >= 0)
+		{
+			min_vect1--;
+		}
 
-            #pragma omp section
-			{
-				//Calculate the maximum multiple of the second lattice vector from the central spot that is in range
-				while (max_vect2*lattice_vectors[1][0] + origin.x < cols && max_vect2*lattice_vectors[1][1] + origin.y < rows && 
-					max_vect2*lattice_vectors[1][0] + origin.x >= 0 && max_vect2*lattice_vectors[1][1] + origin.y >= 0) 
-				{
-					max_vect2++;
-				}
-			}
+		//Calculate the maximum multiple of the second lattice vector from the central spot that is in range
+		while (max_vect2*lattice_vectors[1][0] + origin.x < cols && max_vect2*lattice_vectors[1][1] + origin.y < rows && 
+			max_vect2*lattice_vectors[1][0] + origin.x >= 0 && max_vect2*lattice_vectors[1][1] + origin.y >= 0) 
+		{
+			max_vect2++;
+		}
 
-            #pragma omp section
-			{
-				//Calculate the minimum multiple of the second lattice vector from the central spot that is in range
-				while (min_vect2*lattice_vectors[1][0] + origin.x < cols && min_vect2*lattice_vectors[1][1] + origin.y < rows && 
-					min_vect2*lattice_vectors[1][0] + origin.x >= 0 && min_vect2*lattice_vectors[1][1] + origin.y >= 0) 
-				{
-					min_vect2--;
-				}
-			}
+		//Calculate the minimum multiple of the second lattice vector from the central spot that is in range
+		while (min_vect2*lattice_vectors[1][0] + origin.x < cols && min_vect2*lattice_vectors[1][1] + origin.y < rows && 
+			min_vect2*lattice_vectors[1][0] + origin.x >= 0 && min_vect2*lattice_vectors[1][1] + origin.y >= 0) 
+		{
+			min_vect2--;
 		}
 
 		//Iterate across multiples of the first lattice vector
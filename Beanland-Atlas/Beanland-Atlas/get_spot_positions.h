@@ -3,7 +3,10 @@
 #include <includes.h>
 
 #include <commensuration_utility.h>
+#include <device_transfer.h>
+#include <image_buffer.h>
 #include <kernel_launchers.h>
+#include <task_scheduler.h>
 #include <utility.h>
 
 namespace ba
@@ -11,7 +14,7 @@ namespace ba
 	/*Find the positions of the spots in the aligned image average pattern. Most of these spots are made from the contributions of many images
 	**so it can be assumed that they are relatively featureless
 	**Inputs:
-	**align_avg: cv::Mat &, Average values of px in aligned diffraction patterns
+	**align_avg: cv::Mat &, 32-bit average values of px in aligned diffraction patterns
 	**initial_radius: int, Radius of the spots
 	**initial_thickness: int, Thickness of the annulus to convolve with spots
 	**annulus_creator: cl_kernel, OpenCL kernel to create padded unblurred annulus to cross correlate the aligned image average pattern Sobel
@@ -30,15 +33,6 @@ namespace ba
 		cl_kernel circle_creator, cl_kernel gauss_creator, cl_command_queue af_queue, int align_avg_cols, int align_avg_rows, cv::Vec2f &ewald_rad,
 		const int discard_outer = DISCARD_SPOTS_DEFAULT);
 
-	/*Blackens the circle of pixels within a certain radius of a point in a floating point OpenCV mat
-	**Inputs:
-	**mat: cv::Mat &, Reference to a floating point OpenCV mat to blacken a circle on
-	**col: const int, column of circle origin
-	**row: const int, row of circle origin
-	**rad: const int, radius of the circle to blacken
-	*/
-	void blacken_circle(cv::Mat &mat, const int col, const int row, const int rad);
-
 	/*Uses a set of know spot positions to extract approximate lattice vectors for a diffraction pattern
 	**Input:
 	**positions: std::vector<cv::Point> &, Known positions of spots in the diffraction pattern
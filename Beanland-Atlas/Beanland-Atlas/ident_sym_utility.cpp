@@ -32,123 +32,120 @@ namespace ba
 		cv::Mat blur1 = blur_by_size(img1(resized_rois[0])) / (resized_rois[0].width * resized_rois[0].height);
 		cv::Mat blur2 = blur_by_size(img2(resized_rois[1])) / (resized_rois[1].width * resized_rois[1].height);
 
-		//Find the minimum sum of squared differences...
-		cv::Point minLoc;
+		//Calculate the sum of squared differences
+		cv::Mat sum_sqr_diff = ssd(blur1, blur2, use_frac);
 
-		//...applying wisdom to find the correct relative shift
-		if (wisdom == REL_SHIFT_WIS_NONE)
+		//Estimate the symmetry to constrain internal rotations
+		cv::Mat sym_mask;
+		if (wisdom == REL_SHIFT_WIS_INTERNAL_ROT)
 		{
-			//Calculate the sum of squared differences
-			cv::Mat sum_sqr_diff = ssd(blur1, blur2);
-
-			//Find the minimum sum of squared differences location
-			cv::minMaxLoc(sum_sqr_diff, NULL, NULL, &minLoc, NULL);
+			cv::Mat est_sym = est_global_sym(blur1, wisdom);
+			threshold_proportion(est_sym, sym_mask, grad_sym_use_frac, cv::THRESH_BINARY_INV);
 		}
-		else
+
+		//Find the minimum sum of squared differences, applying wisdom to find the correct relative shift
+		cv::Point minLoc = rel_shift_min_loc(sum_sqr_diff, wisdom, sym_mask);
+
+		//Get the relative positions of the centres of highest symmetry
+		std::vector<float> sym_pos(3);
+		int pad_cols = (int)(use_frac*blur1.cols);
+		int pad_rows = (int)(use_frac*blur2.rows);
+		sym_pos[1] = roi2.x - roi1.x + pad_cols - minLoc.x;
+		sym_pos[2] = roi2.y - roi1.y + pad_rows - minLoc.y;
+
+		//Calculate Pearson normalised product moment correlation coefficient at lowest sum of squared differences and around it
+		sym_pos[0] = max_pearson_near(img1, img2, (int)sym_pos[1], (int)sym_pos[2], (int)(QUANT_GAUSS_FRAC*blur1.cols),
+			(int)(QUANT_GAUSS_FRAC*blur1.rows));
+
+		return sym_pos;
+	}
+
+	/*Find the relative shift with the lowest sum of squared differences that is allowed by wisdom about the images
+	**Inputs:
+	**sum_sqr_diff: cv::Mat &, Sums of squared differences for each relative shift
+	**wisdom: const int, Information about the images being compared to constrain the relative shift
+	**sym_mask: cv::Mat &, Thresholded gradient based symmetry estimate of the first image's blurred region of interest. Non-zero
+	**where symmetry centres are allowed. Only used for internal rotational symmetry
+	**Returns:
+	**cv::Point, Location of the lowest allowed sum of squared differences
+	*/
+	cv::Point rel_shift_min_loc(cv::Mat &sum_sqr_diff, const int wisdom, cv::Mat &sym_mask)
+	{
+		cv::Point minLoc;
+		float min_ssd = FLT_MAX;
+
+		if (wisdom == REL_SHIFT_WIS_INTERNAL_MIR0)
 		{
-			if (wisdom == REL_SHIFT_WIS_INTERNAL_MIR0)
+			//This mirror symmetry will only shift the rows
+			for (int i = 0; i < sum_sqr_diff.rows; i++)
 			{
-				//Calculate the sum of squared differences
-				cv::Mat sum_sqr_diff = ssd(blur1, blur2);
-
-				//Calculate the minimum sum of squared differences that is allowed by the mask
-				float min_ssd = FLT_MAX;
-				for (int i = 0; i < sum_sqr_diff.rows; i++) //Iterate over rows...
+				if (sum_sqr_diff.at<float>(i, 0) < min_ssd)
 				{
-					int j = 0; //This mirror symmetry will only shift the rows
-
-					//Check if this is smaller than the minimum
-					if (sum_sqr_diff.at<float>(i, j) < min_ssd)
-					{
-						min_ssd = sum_sqr_diff.at<float>(i, j);
-						minLoc.x = j;
-						minLoc.y = i;
-					}
+					min_ssd = sum_sqr_diff.at<float>(i, 0);
+					minLoc = cv::Point(0, i);
 				}
 			}
-			else
+		}
+		else if (wisdom == REL_SHIFT_WIS_INTERNAL_MIR1)
+		{
+			//This mirror symmetry will only shift the columns
+			float *s = sum_sqr_diff.ptr<float>(0);
+			for (int j = 0; j < sum_sqr_diff.cols; j++)
 			{
-				if (wisdom == REL_SHIFT_WIS_INTERNAL_MIR1)
+				if (s[j] < min_ssd)
 				{
-					//Calculate the sum of squared differences
-					cv::Mat sum_sqr_diff = ssd(blur1, blur2);
-
-					//Calculate the minimum sum of squared differences that is allowed by the mask
-					float min_ssd = FLT_MAX;
-					float *s;
-					int i = 0; //This mirror symmetry will only shift the rows	
-					s = sum_sqr_diff.ptr<float>(i);
-					for (int j = 0; j < sum_sqr_diff.cols; j++) //...and iterate over columns
-					{
-						//Check if this is smaller than the minimum
-						if (s[j] < min_ssd)
-						{
-							min_ssd = s[j];
-							minLoc.x = j;
-							minLoc.y = i;
-						}
-					}
+					min_ssd = s[j];
+					minLoc = cv::Point(j, 0);
 				}
-				else
+			}
+		}
+		else if (wisdom == REL_SHIFT_WIS_INTERNAL_ROT)
+		{
+			//Calculate the minimum sum of squared differences that is allowed by the mask
+			for (int i = 0; i < sum_sqr_diff.rows; i++)
+			{
+				float *s = sum_sqr_diff.ptr<float>(i);
+				for (int j = 0; j < sum_sqr_diff.cols; j++)
 				{
-					//Calculate the minimum ssd allowed by the mask
-					if (wisdom == REL_SHIFT_WIS_INTERNAL_ROT)
+					//Check that this position is allowed by the mask
+					if (s[j] < min_ssd && sym_mask.at<float>((int)((sym_mask.rows - i - 1) / 2), (int)((sym_mask.cols - j - 1) / 2)))
 					{
-						//Calculate the sum of squared differences
-						cv::Mat sum_sqr_diff = ssd(blur1, blur2);
-
-						//Estimate the symmetry
-						cv::Mat est_sym = est_global_sym(blur1, wisdom);
-
-						//Threshold the lowest proportion of values from the symmetry space
-						cv::Mat thresh;
-						threshold_proportion(est_sym, thresh, grad_sym_use_frac, cv::THRESH_BINARY_INV);
-
-						//Calculate the minimum sum of squared differences that is allowed by the mask
-						float min_ssd = FLT_MAX;
-						float *s;
-						for (int i = 0; i < sum_sqr_diff.rows; i++) //Iterate over rows...
-						{
-							s = sum_sqr_diff.ptr<float>(i);
-							for (int j = 0; j < sum_sqr_diff.cols; j++) //...and iterate over columns
-							{
-								//Check if this is smaller than the minimum
-								if (s[j] < min_ssd)
-								{
-									//Check that this position is allowed by the mask
-									if (thresh.at<float>((int)((blur1.rows - i - 1) / 2), (int)((blur1.cols - j - 1) / 2)))
-									{
-										min_ssd = s[j];
-										minLoc.x = j;
-										minLoc.y = i;
-									}
-								}
-							}
-						}
+						min_ssd = s[j];
+						minLoc = cv::Point(j, i);
 					}
 				}
 			}
 		}
-		
-		//Get the relative positions of the centres of highest symmetry
-		std::vector<float> sym_pos(3);
-		int pad_cols = (int)(use_frac*blur1.cols);
-		int pad_rows = (int)(use_frac*blur2.rows);
-		sym_pos[1] = roi2.x - roi1.x + pad_cols - minLoc.x;
-		sym_pos[2] = roi2.y - roi1.y + pad_rows - minLoc.y;
+		else
+		{
+			cv::minMaxLoc(sum_sqr_diff, NULL, NULL, &minLoc, NULL);
+		}
 
-		//Calculate Pearson normalised product moment correlation coefficient at lowest sum of squared differences and around it
-		int search_x = (int)(QUANT_GAUSS_FRAC*blur1.cols);
-		int search_y = (int)(QUANT_GAUSS_FRAC*blur1.rows);
+		return minLoc;
+	}
 
+	/*Find the highest Pearson normalised product moment correlation coefficient between 2 images for relative shifts in a window
+	**around a relative shift
+	**Inputs:
+	**img1: cv::Mat &, One of the images
+	**img2: cv::Mat &, The second image
+	**shift_x: const int, Relative column shift of the second image at the centre of the window
+	**shift_y: const int, Relative row shift of the second image at the centre of the window
+	**search_x: const int, Number of columns to search either side of the centre of the window
+	**search_y: const int, Number of rows to search either side of the centre of the window
+	**Returns:
+	**float, Highest Pearson normalised product moment correlation coefficient in the window
+	*/
+	float max_pearson_near(cv::Mat &img1, cv::Mat &img2, const int shift_x, const int shift_y, const int search_x, const int search_y)
+	{
 		//Calculate range of offsets around minimum sum of squared differences to calculate Pearson normalised product moment 
 		//correlation coefficient at
 		int max_col_idx = std::min(img1.cols, img2.cols) - 1 - search_x;
 		int max_row_idx = std::min(img1.rows, img2.rows) - 1 - search_y;
-		int llimx = sym_pos[1] - search_x > -max_col_idx ? sym_pos[1] - search_x : -max_col_idx;
-		int ulimx = sym_pos[1] + search_x < max_col_idx ? sym_pos[1] + search_x : max_col_idx;
-		int llimy = sym_pos[2] - search_y > -max_row_idx ? sym_pos[2] - search_y : -max_row_idx;
-		int ulimy = sym_pos[2] + search_y < max_row_idx ? sym_pos[2] + search_y : max_row_idx;
+		int llimx = shift_x - search_x > -max_col_idx ? shift_x - search_x : -max_col_idx;
+		int ulimx = shift_x + search_x < max_col_idx ? shift_x + search_x : max_col_idx;
+		int llimy = shift_y - search_y > -max_row_idx ? shift_y - search_y : -max_row_idx;
+		int ulimy = shift_y + search_y < max_row_idx ? shift_y + search_y : max_row_idx;
 
 		//Find the maximum Pearson normalised product moment correlation coefficient in the search range
 		float max_pear = -1.0f;
@@ -163,11 +160,8 @@ namespace ba
 				max_pear = pear > max_pear ? pear : max_pear;
 			}
 		}
-		
-		//Record the maximum Pearson normalised product moment correlation coefficient
-		sym_pos[0] = max_pear;
 
-		return sym_pos;
+		return max_pear;
 	}
 
 	/*Get the largest rectangular portion of an image inside a surrounding black background
@@ -178,104 +172,7 @@ namespace ba
 	*/
 	cv::Rect biggest_not_black(cv::Mat &img)
 	{
-		//Work inwards from the top and bottom of every column to find the length of the non-black region
-		std::vector<int> col_thick(img.cols);
-		std::vector<int> col_top(img.cols);
-		std::vector<int> col_bot(img.cols);
-		for (int i = 0; i < img.cols; i++)
-		{
-			//From the top of the image
-			int j_top;
-			for (j_top = 0; j_top < img.rows; j_top++)
-			{
-				if (img.at<float>(j_top, i))
-				{
-					break;
-				}
-			}
-
-			//From the bottom of the image
-			int j_bot;
-			for (j_bot = img.rows-1; j_bot >= 0; j_bot--)
-			{
-				if (img.at<float>(j_bot, i))
-				{
-					break;
-				}
-			}
-
-			col_thick[i] = j_bot > j_top ? j_bot - j_top + 1 : 0;
-			col_top[i] = j_top;
-			col_bot[i] = j_bot;
-		}
-
-		//Work inwards from the top and bottom of every row to find the length of the non-black region
-		std::vector<int> row_thick(img.rows);
-		std::vector<int> row_top(img.rows);
-		std::vector<int> row_bot(img.rows);
-		for (int i = 0; i < img.rows; i++)
-		{
-			//From the top of the image
-			int j_top;
-			for (j_top = 0; j_top < img.cols; j_top++)
-			{
-				if (img.at<float>(i, j_top))
-				{
-					break;
-				}
-			}
-
-			//From the bottom of the image
-			int j_bot;
-			for (j_bot = img.cols-1; j_bot >= 0; j_bot--)
-			{
-				if (img.at<float>(i, j_bot))
-				{
-					break;
-				}
-			}
-
-			row_thick[i] = j_bot > j_top ? j_bot - j_top + 1 : 0;
-			row_top[i] = j_top;
-			row_bot[i] = j_bot;
-		}
-
-		//Find the combination that has the highest area
-		int max_area = -1;
-		int max_row, max_col, max_rows, max_cols;
-		for (int i = 0; i < img.rows; i++)
-		{
-			//For each non-black region of rows with non-zero thickness, find the column of minimum thickness
-			if(row_thick[i])
-			{
-				int min_thick_vert_idx = std::distance(col_thick.begin(),
-					std::min_element(col_thick.begin() + row_top[i], col_thick.begin() + row_bot[i]));
-
-				if(col_thick[min_thick_vert_idx])
-				{
-					//Find the minimum row thickness for the rowspan of this row of minimum thickness
-					int min_thick_horiz_idx = std::distance(row_thick.begin(),
-						std::min_element(row_thick.begin() + col_top[min_thick_vert_idx], row_thick.begin() + col_bot[min_thick_vert_idx]));
-
-					//Check if the area is higher than the maximum...
-					int area = row_thick[min_thick_horiz_idx]*col_thick[min_thick_vert_idx];
-					if (area > max_area)
-					{
-						//...and update the roi parameters if it is the largest
-						max_area = area;
-						max_row = row_top[min_thick_horiz_idx];
-						max_col = col_top[min_thick_vert_idx];
-						max_rows = row_thick[min_thick_horiz_idx];
-						max_cols = col_thick[min_thick_vert_idx];
-					}
-				}
-			}
-		}
-
-		//display_CV(img(cv::Rect(max_row, max_col, max_rows, max_cols)));
-
-		//return cv::Rect(max_col, max_row, max_cols, max_rows);
-		return cv::Rect(max_row, max_col, max_rows, max_cols);
+		return get_valid_region(img).rect;
 	}
 
 	/*Decrease the size of the larger rectangular region of interest so that it is the same size as the smaller
@@ -325,15 +222,167 @@ namespace ba
 		return same_size_rects;
 	}
 
+	/*Get the position of a rectangle in an image after the image has been flipped
+	**Inputs:
+	**rect: cv::Rect, Rectangle in the image
+	**size: cv::Size, Size of the image
+	**flip_code: const int, OpenCV flip code. 0 flips the rows, positive flips the columns and negative flips both
+	**Returns:
+	**cv::Rect, Rectangle in the flipped image
+	*/
+	cv::Rect flip_rect(cv::Rect rect, cv::Size size, const int flip_code)
+	{
+		if (flip_code <= 0)
+		{
+			rect.y = size.height - rect.y - rect.height;
+		}
+		if (flip_code != 0)
+		{
+			rect.x = size.width - rect.x - rect.width;
+		}
+
+		return rect;
+	}
+
+	/*Size of the largest axis-aligned rectangle that fits inside a rotated rectangle with the same centre
+	**Inputs:
+	**width: const double, Width of the rectangle before it is rotated
+	**height: const double, Height of the rectangle before it is rotated
+	**angle: const double, Angle the rectangle is rotated by, in rad
+	**Returns:
+	**cv::Size2d, Size of the largest axis-aligned rectangle
+	*/
+	static cv::Size2d inscribed_rect_size(const double width, const double height, const double angle)
+	{
+		double sin_a = std::abs(std::sin(angle));
+		double cos_a = std::abs(std::cos(angle));
+		bool width_is_longer = width >= height;
+		double side_long = width_is_longer ? width : height;
+		double side_short = width_is_longer ? height : width;
+
+		//If the rectangle is thin or rotated by 45 deg, 2 corners of the largest rectangle touch the longer sides...
+		if (side_short <= 2.0*sin_a*cos_a*side_long || std::abs(sin_a - cos_a) < 1e-10)
+		{
+			double half = 0.5*side_short;
+			return width_is_longer ? cv::Size2d(half/sin_a, half/cos_a) : cv::Size2d(half/cos_a, half/sin_a);
+		}
+
+		//...otherwise all of its corners touch the sides
+		double cos_2a = cos_a*cos_a - sin_a*sin_a;
+		return cv::Size2d((width*cos_a - height*sin_a) / cos_2a, (height*cos_a - width*sin_a) / cos_2a);
+	}
+
+	/*Get the remap tables for a rotation from the cache, creating them if they don't exist. The tables are in OpenCV's
+	**fixed-point format, which is what warpAffine uses internally, so they only have to be calculated once for surveys of the
+	**same size that are rotated by the same angle
+	**Inputs:
+	**size: cv::Size, Size of the image to rotate
+	**angle: float, Angle to rotate the image (anticlockwise) in degrees
+	**rot: cv::Mat &, Affine transformation from the image to the rotated image
+	**dst_size: cv::Size, Size of the rotated image
+	**map1: cv::Mat &, Output fixed-point positions to sample the image at
+	**map2: cv::Mat &, Output interpolation coefficient indices
+	*/
+	static void get_rot_maps(cv::Size size, float angle, cv::Mat &rot, cv::Size dst_size, cv::Mat &map1, cv::Mat &map2)
+	{
+		static std::map<std::tuple<int, int, float>, std::pair<cv::Mat, cv::Mat>> maps;
+		static std::mutex maps_mutex;
+
+		std::tuple<int, int, float> key = std::make_tuple(size.height, size.width, angle);
+		{
+			std::lock_guard<std::mutex> lock(maps_mutex);
+			std::map<std::tuple<int, int, float>, std::pair<cv::Mat, cv::Mat>>::iterator it = maps.find(key);
+			if (it != maps.end())
+			{
+				map1 = it->second.first;
+				map2 = it->second.second;
+				return;
+			}
+		}
+
+		//Positions in the image that each rotated image pixel comes from
+		cv::Mat inv;
+		cv::invertAffineTransform(rot, inv);
+		cv::Mat map_x = cv::Mat(dst_size, CV_32FC1);
+		cv::Mat map_y = cv::Mat(dst_size, CV_32FC1);
+		for (int i = 0; i < dst_size.height; i++)
+		{
+			float *p = map_x.ptr<float>(i);
+			float *q = map_y.ptr<float>(i);
+			for (int j = 0; j < dst_size.width; j++)
+			{
+				p[j] = (float)(inv.at<double>(0, 0)*j + inv.at<double>(0, 1)*i + inv.at<double>(0, 2));
+				q[j] = (float)(inv.at<double>(1, 0)*j + inv.at<double>(1, 1)*i + inv.at<double>(1, 2));
+			}
+		}
+		cv::convertMaps(map_x, map_y, map1, map2, CV_16SC2);
+
+		//Limit the size of the cache
+		std::lock_guard<std::mutex> lock(maps_mutex);
+		if (maps.size() >= ROT_MAP_CACHE_SIZE)
+		{
+			maps.clear();
+		}
+		maps[key] = std::make_pair(map1, map2);
+	}
+
 	/*Rotates an image keeping the image the same size, embedded in a larger black rectangle
 	**Inputs:
 	**src: cv::Mat &, Image to rotate
-	**angle: float, Angle to rotate the image (anticlockwise) in rad
+	**angle: float, Angle to rotate the image (anticlockwise) in degrees
 	**Returns:
 	**cv::Mat, Rotated image
 	*/
 	cv::Mat rotate_CV(cv::Mat src, float angle)
 	{
+		cv::Rect dst_valid;
+		return rotate_CV(src, angle, cv::Rect(0, 0, src.cols, src.rows), dst_valid);
+	}
+
+	/*Rotates an image keeping the image the same size, embedded in a larger black rectangle, and tracks where the valid data is.
+	**Rotations by multiples of 90 deg are exact permutations of the image's indices and are not interpolated
+	**Inputs:
+	**src: cv::Mat &, Image to rotate
+	**angle: float, Angle to rotate the image (anticlockwise) in degrees
+	**src_valid: cv::Rect, Rectangle of valid data in the image
+	**dst_valid: cv::Rect &, Output largest rectangle of valid data in the rotated image. This is at least 1 px inside the
+	**interpolated edges of the rotated valid data
+	**Returns:
+	**cv::Mat, Rotated image
+	*/
+	cv::Mat rotate_CV(cv::Mat src, float angle, cv::Rect src_valid, cv::Rect &dst_valid)
+	{
+		cv::Mat dst;
+
+		//Check if the angle is a multiple of 90 deg
+		float reduced = std::fmod(angle, 360.0f);
+		reduced = reduced < 0.0f ? reduced + 360.0f : reduced;
+		int quarters = (int)std::floor(reduced/90.0f + 0.5f);
+		if (std::abs(reduced - 90.0f*quarters) < ROT_EXACT_TOL)
+		{
+			switch (quarters % 4)
+			{
+			case 0:
+				dst = src.clone();
+				dst_valid = src_valid;
+				break;
+			case 1:
+				cv::rotate(src, dst, cv::ROTATE_90_COUNTERCLOCKWISE);
+				dst_valid = cv::Rect(src_valid.y, src.cols - src_valid.x - src_valid.width, src_valid.height, src_valid.width);
+				break;
+			case 2:
+				cv::flip(src, dst, -1);
+				dst_valid = flip_rect(src_valid, src.size(), -1);
+				break;
+			default:
+				cv::rotate(src, dst, cv::ROTATE_90_CLOCKWISE);
+				dst_valid = cv::Rect(src.rows - src_valid.y - src_valid.height, src_valid.x, src_valid.height, src_valid.width);
+				break;
+			}
+
+			return dst;
+		}
+
 		//Center of rotation
 		cv::Point2f pt(0.5*(src.cols-1.0f), 0.5*(src.rows-1.0f));
 
@@ -348,8 +397,23 @@ namespace ba
 		rot.at<double>(1,2) += bbox.height/2.0 - pt.y;
 
 		//Rotate the image
-		cv::Mat dst;
-		cv::warpAffine(src, dst, rot, bbox.size());
+		cv::Mat map1, map2;
+		get_rot_maps(src.size(), angle, rot, bbox.size(), map1, map2);
+		cv::remap(src, dst, map1, map2, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0.0));
+
+		//The valid data is a rotated rectangle about the rotated centre of the valid rectangle, spanning its pixel centres
+		double cx = src_valid.x + 0.5*(src_valid.width-1);
+		double cy = src_valid.y + 0.5*(src_valid.height-1);
+		double rcx = rot.at<double>(0,0)*cx + rot.at<double>(0,1)*cy + rot.at<double>(0,2);
+		double rcy = rot.at<double>(1,0)*cx + rot.at<double>(1,1)*cy + rot.at<double>(1,2);
+		cv::Size2d inscribed = inscribed_rect_size(src_valid.width-1, src_valid.height-1, angle/RAD_TO_DEG);
+
+		//Keep 1 px away from the interpolated edges
+		int left = (int)std::ceil(rcx - 0.5*inscribed.width) + 1;
+		int right = (int)std::floor(rcx + 0.5*inscribed.width) - 1;
+		int top = (int)std::ceil(rcy - 0.5*inscribed.height) + 1;
+		int bot = (int)std::floor(rcy + 0.5*inscribed.height) - 1;
+		dst_valid = cv::Rect(left, top, std::max(right-left+1, 0), std::max(bot-top+1, 0)) & cv::Rect(0, 0, dst.cols, dst.rows);
 
 		return dst;
 	}
@@ -6,6 +6,7 @@
 #include <identify_symmetry.h>
 #include <template_matching.h>
 #include <utility.h>
+#include <valid_region.h>
 
 namespace ba
 {
@@ -17,6 +18,12 @@ namespace ba
 		REL_SHIFT_WIS_INTERNAL_ROT //Rotation about point in the image
 	};
 
+	//Rotations within this many degrees of a multiple of 90 deg are performed exactly by permuting indices
+    #define ROT_EXACT_TOL 1e-4f
+
+	//Maximum number of rotation remap tables to cache
+    #define ROT_MAP_CACHE_SIZE 32
+
 	//Symmetry centers calculated from Scharr filtrates must use at least this fraction of the of the image area
     #define SYM_CENTER_USE_FRAC 0.0f
 
@@ -42,6 +49,31 @@ namespace ba
 	std::vector<float> quantify_rel_shift(cv::Mat &img1, cv::Mat &img2, const float use_frac = QUANT_SYM_USE_FRAC, 
 		const int wisdom = REL_SHIFT_WIS_NONE, const float grad_sym_use_frac = GRAD_SYM_USE);
 
+	/*Find the relative shift with the lowest sum of squared differences that is allowed by wisdom about the images
+	**Inputs:
+	**sum_sqr_diff: cv::Mat &, Sums of squared differences for each relative shift
+	**wisdom: const int, Information about the images being compared to constrain the relative shift
+	**sym_mask: cv::Mat &, Thresholded gradient based symmetry estimate of the first image's blurred region of interest. Non-zero
+	**where symmetry centres are allowed. Only used for internal rotational symmetry
+	**Returns:
+	**cv::Point, Location of the lowest allowed sum of squared differences
+	*/
+	cv::Point rel_shift_min_loc(cv::Mat &sum_sqr_diff, const int wisdom, cv::Mat &sym_mask);
+
+	/*Find the highest Pearson normalised product moment correlation coefficient between 2 images for relative shifts in a window
+	**around a relative shift
+	**Inputs:
+	**img1: cv::Mat &, One of the images
+	**img2: cv::Mat &, The second image
+	**shift_x: const int, Relative column shift of the second image at the centre of the window
+	**shift_y: const int, Relative row shift of the second image at the centre of the window
+	**search_x: const int, Number of columns to search either side of the centre of the window
+	**search_y: const int, Number of rows to search either side of the centre of the window
+	**Returns:
+	**float, Highest Pearson normalised product moment correlation coefficient in the window
+	*/
+	float max_pearson_near(cv::Mat &img1, cv::Mat &img2, const int shift_x, const int shift_y, const int search_x, const int search_y);
+
 	/*Get the largest rectangular portion of an image inside a surrounding black background
 	**Inputs:
 	**img: cv::Mat &, Input floating point image to extract the largest possible non-black region of
@@ -59,15 +91,38 @@ namespace ba
 	*/
 	std::vector<cv::Rect> same_size_rois(cv::Rect roi1, cv::Rect roi2);
 
+	/*Get the position of a rectangle in an image after the image has been flipped
+	**Inputs:
+	**rect: cv::Rect, Rectangle in the image
+	**size: cv::Size, Size of the image
+	**flip_code: const int, OpenCV flip code. 0 flips the rows, positive flips the columns and negative flips both
+	**Returns:
+	**cv::Rect, Rectangle in the flipped image
+	*/
+	cv::Rect flip_rect(cv::Rect rect, cv::Size size, const int flip_code);
+
 	/*Rotates an image keeping the image the same size, embedded in a larger black rectangle
 	**Inputs:
 	**src: cv::Mat &, Image to rotate
-	**angle: float, Angle to rotate the image (anticlockwise)
+	**angle: float, Angle to rotate the image (anticlockwise) in degrees
 	**Returns:
 	**cv::Mat, Rotated image
 	*/
 	cv::Mat rotate_CV(cv::Mat src, float angle);
 
+	/*Rotates an image keeping the image the same size, embedded in a larger black rectangle, and tracks where the valid data is.
+	**Rotations by multiples of 90 deg are exact permutations of the image's indices and are not interpolated
+	**Inputs:
+	**src: cv::Mat &, Image to rotate
+	**angle: float, Angle to rotate the image (anticlockwise) in degrees
+	**src_valid: cv::Rect, Rectangle of valid data in the image
+	**dst_valid: cv::Rect &, Output largest rectangle of valid data in the rotated image. This is at least 1 px inside the
+	**interpolated edges of the rotated valid data
+	**Returns:
+	**cv::Mat, Rotated image
+	*/
+	cv::Mat rotate_CV(cv::Mat src, float angle, cv::Rect src_valid, cv::Rect &dst_valid);
+
 	/*Order indices in order of increasing angle from the horizontal
 	**Inputs:
 	**angles: std::vector<float> &, Angles between the survey spots and a line drawn horizontally through the brightest spot
@@ -16,6 +16,8 @@ namespace ba
 	atlas_sym identify_symmetry(std::vector<cv::Mat> &surveys, std::vector<cv::Point> &spot_pos, const float threshold,
 		const float frac_for_sym)
 	{
+		BA_TIME_FUNCTION();
+
 		//Get the indices of the surveys to compare to identify the atlas symmetry and the angles of the spots used to create surveys
 		//relative to a horizontal line drawn through the brightest spot
 		std::vector<int> indices; 
@@ -26,19 +28,23 @@ namespace ba
 		order_indices_by_angle(angles, indices);
 
 		//Rotate the surveys so that they all have the same angle relative to a horizontal line drawn through the brightest spot
-		std::vector<cv::Mat> rot_to_align = rotate_to_align(surveys, angles, indices);
+		std::vector<cv::Rect> valid;
+		std::vector<cv::Mat> rot_to_align = rotate_to_align(surveys, angles, indices, valid);
+
+		//Quantify all the mirror and rotational symmetries in and between the surveys, preprocessing each survey once
+		sym_quant quant = quantify_symmetries(rot_to_align, valid);
 
 		//Mirror symmetry Pearson normalised product moment coefficient spectrums between surveys
-		std::vector<std::vector<float>> mirror_between = get_mirror_between_sym(rot_to_align);
+		std::vector<std::vector<float>> &mirror_between = quant.mirror_between;
 
 		//Mirror symmetry Pearson normalised product moment coefficient spectrums in surveys
-		std::vector<std::vector<float>> mirror_in0 = get_mirror_in_sym(rot_to_align);
+		std::vector<std::vector<float>> &mirror_in0 = quant.mirror_in0;
 
 		//Mirror radially outwards symmetry Pearson normalised product moment coefficient spectrums in surveys
-		std::vector<std::vector<float>> mirror_in1 = get_mirror_in_rad_sym(rot_to_align);
+		std::vector<std::vector<float>> &mirror_in1 = quant.mirror_in1;
 
 		//Rotation symmetry Pearson normalised product moment coefficient spectrums between surveys
-		std::vector<std::vector<float>> rot_between = get_rotational_between_sym(rot_to_align);
+		std::vector<std::vector<float>> &rot_between = quant.rot_between;
 
 		//Caclulate the average mirror symmetry quantifications between spots
 		float mean_mir_between = 0.0f;
@@ -114,8 +120,8 @@ namespace ba
 			std::cout << est_sym_centers[i] << std::endl;
 		}
 
-		//Calculate the internal rotational symmetry Pearson normalised product moment coefficient spectrums in surveys
-		rot_in = get_rotational_in_sym(rot_to_align, est_sym_centers);
+		//Internal rotational symmetry Pearson normalised product moment coefficient spectrums in surveys
+		rot_in = quant.rot_in;
 
 		//Mean rotational symmetry in surveys quntification
 		float mean_rot_in = 0.0f;
@@ -155,7 +161,6 @@ namespace ba
 	{
 		//Find the minimum distance from the central spot
 		int min_dst = INT_MAX;
-        #pragma omp parallel for reduction(min:min_dst)
 		for (int i = 1; i < spot_pos.size(); i++)
 		{
 			//Get position relative to the central spot
@@ -200,14 +205,33 @@ namespace ba
 	**std::vector<cv::Mat>, Images rotated so that they are all aligned.
 	*/
 	std::vector<cv::Mat> rotate_to_align(std::vector<cv::Mat> &surveys, std::vector<float> &angles, std::vector<int> &indices)
+	{
+		std::vector<cv::Rect> valid;
+		return rotate_to_align(surveys, angles, indices, valid);
+	}
+
+	/*Rotate the surveys so that they are all aligned at the same angle to a horizontal line drawn through the brightest spot and track
+	**the largest rectangles of valid data in them
+	**Inputs:
+	**surveys: std::vector<cv::Mat> &, Surveys of k space made by individual spots, some of which will be compared to identify the symmetry 
+	**group
+	**angles: std::vector<float> &, Angles between the survey spots and a line drawn horizontally through the brightest spot
+	**indices: std::vector<int> &, Indices of the surveys to compare to identify the atlas symmetry
+	**valid: std::vector<cv::Rect> &, Output largest rectangle of valid data in each rotated survey
+	**Returns:
+	**std::vector<cv::Mat>, Images rotated so that they are all aligned. 
+	*/
+	std::vector<cv::Mat> rotate_to_align(std::vector<cv::Mat> &surveys, std::vector<float> &angles, std::vector<int> &indices,
+		std::vector<cv::Rect> &valid)
 	{
 		//Rotate each mat so that they all have the same orientation to a horizontal line drawn through the brightest spot in the aligned patter
 		std::vector<cv::Mat> rot_to_align(indices.size());
-        #pragma omp parallel for
-		for (int i = 0; i < indices.size(); i++)
+		valid.resize(indices.size());
+		parallel_for(0, indices.size(), [&](int i)
 		{
-			rot_to_align[i] = rotate_CV(surveys[indices[i]], RAD_TO_DEG*angles[i]);
-		}
+			cv::Mat &survey = surveys[indices[i]];
+			rot_to_align[i] = rotate_CV(survey, RAD_TO_DEG*angles[i], cv::Rect(0, 0, survey.cols, survey.rows), valid[i]);
+		});
 
 		return rot_to_align;
 	}
@@ -347,8 +371,7 @@ namespace ba
 		std::vector<std::vector<float>> sym_param(rot_to_align.size());
 
 		//Look for rotational symmetry in each matrix
-        #pragma omp parallel for
-		for (int i = 0; i < rot_to_align.size(); i++)
+		parallel_for(0, rot_to_align.size(), [&](int i)
 		{
 			//Rotate the matrix 180 degrees
 			cv::Mat rot_180;
@@ -356,7 +379,7 @@ namespace ba
 
 			//Quantify the symmetry and record the shift of highest symmetry
 			sym_param[i] = quantify_rel_shift(rot_to_align[i], rot_180, INTERAL_ROT_SSD_FRAC, REL_SHIFT_WIS_INTERNAL_ROT);
-		}
+		});
 
 		return sym_param;
 	}
@@ -376,8 +399,7 @@ namespace ba
 		std::vector<float> sym_param(rot_to_align.size());
 
 		//Look for rotational symmetry in each matrix
-        #pragma omp parallel for
-		for (int i = 0; i < rot_to_align.size(); i++)
+		parallel_for(0, rot_to_align.size(), [&](int i)
 		{
 			//Partition matrix into 2 parts, along the known mirror line
 			cv::Rect roi_left = cv::Rect(0, 0, rot_to_align[i].cols, refl_lines[i]);
@@ -392,7 +414,7 @@ namespace ba
 			//Quantify the symmetry
 			std::vector<float> sym(3);
 			sym_param[i] = pearson_corr(rot_180, left,  rot_to_align[i].rows - 2*refl_lines[i], 0);
-		}
+		});
 
 		return sym_param;
 	}
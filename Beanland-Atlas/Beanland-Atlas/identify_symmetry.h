@@ -3,6 +3,8 @@
 #include <includes.h>
 
 #include <ident_sym_utility.h>
+#include <sym_quantification.h>
+#include <task_scheduler.h>
 #include <utility.h>
 
 namespace ba
@@ -67,6 +69,20 @@ namespace ba
 	*/
 	std::vector<cv::Mat> rotate_to_align(std::vector<cv::Mat> &surveys, std::vector<float> &angles, std::vector<int> &indices);
 
+	/*Rotate the surveys so that they are all aligned at the same angle to a horizontal line drawn through the brightest spot and track
+	**the largest rectangles of valid data in them
+	**Inputs:
+	**surveys: std::vector<cv::Mat> &, Surveys of k space made by individual spots, some of which will be compared to identify the symmetry 
+	**group
+	**angles: std::vector<float> &, Angles between the survey spots and a line drawn horizontally through the brightest spot
+	**indices: std::vector<int> &, Indices of the surveys to compare to identify the atlas symmetry
+	**valid: std::vector<cv::Rect> &, Output largest rectangle of valid data in each rotated survey
+	**Returns:
+	**std::vector<cv::Mat>, Images rotated so that they are all aligned. 
+	*/
+	std::vector<cv::Mat> rotate_to_align(std::vector<cv::Mat> &surveys, std::vector<float> &angles, std::vector<int> &indices,
+		std::vector<cv::Rect> &valid);
+
 	/*Calculate Pearson nomalised product moment correlation coefficients between the surveys and reflections of the other surveys in
 	**a mirror line between the 2 surveys
 	**Inputs:
@@ -0,0 +1,119 @@
+#include <image_buffer.h>
+
+namespace ba
+{
+	/*Get the layout of images padded to powers of 2 in size, as they must be for ArrayFire Fourier analysis
+	**Inputs:
+	**size: cv::Size, Size of the unpadded images
+	**Returns:
+	**image_layout, Layout of contiguous padded images
+	*/
+	image_layout padded_layout(cv::Size size)
+	{
+		int rows = ceil_power_2(size.height);
+		int cols = ceil_power_2(size.width);
+		return { rows, cols, cols*sizeof(float) };
+	}
+
+	/*Get the dimensions of the ArrayFire array an image is viewed as
+	**Inputs:
+	**layout: const image_layout &, Layout of the image
+	**Returns:
+	**af::dim4, Dimensions of the array. Its first dimension is the number of columns of the image
+	*/
+	af::dim4 af_dims(const image_layout &layout)
+	{
+		return af::dim4(layout.cols, layout.rows);
+	}
+
+	/*Create a buffer for a zeroed 32-bit image
+	**Inputs:
+	**rows: const int, Rows of the image
+	**cols: const int, Columns of the image
+	**Returns:
+	**image_buffer, Buffer with contiguous host memory
+	*/
+	image_buffer create_image_buffer(const int rows, const int cols)
+	{
+		image_buffer buf;
+		buf.layout = { rows, cols, cols*sizeof(float) };
+		buf.host = std::shared_ptr<float>((float*)af::pinned((size_t)rows*cols, f32), af::freePinned);
+		std::fill(buf.host.get(), buf.host.get() + (size_t)rows*cols, 0.0f);
+		buf.host_stale = false;
+		buf.device_stale = true;
+
+		return buf;
+	}
+
+	/*Create a buffer containing an image converted to 32-bit floating point. The image is converted straight into the buffer's
+	**host memory and zero padded if the buffer is larger than it. Views e.g. regions of interest are copied without a clone
+	**Inputs:
+	**img: cv::Mat &, Single channel image
+	**layout: const image_layout &, Layout of the buffer. It must have at least as many rows and columns as the image
+	**Returns:
+	**image_buffer, Buffer containing the image in its top left corner
+	*/
+	image_buffer image_buffer_from_mat(cv::Mat &img, const image_layout &layout)
+	{
+		image_buffer buf = create_image_buffer(layout.rows, layout.cols);
+
+		//The destination is a view of the right size and type, so OpenCV converts into it rather than reallocating
+		cv::Mat roi = buffer_mat(buf, true)(cv::Rect(0, 0, img.cols, img.rows));
+		img.convertTo(roi, CV_32FC1);
+
+		return buf;
+	}
+
+	/*View a buffer's host memory as an OpenCV mat without copying it. If the mirror on the GPU has been written, it is copied
+	**straight into the host memory first
+	**Inputs:
+	**buf: image_buffer &, Buffer to view
+	**write: const bool, True if the mat will be written to, so that the mirror must be updated the next time it is used
+	**Returns:
+	**cv::Mat, 32-bit mat using the host memory. It must not be used after the last copy of the buffer is destroyed
+	*/
+	cv::Mat buffer_mat(image_buffer &buf, const bool write)
+	{
+		if (buf.host_stale)
+		{
+			buf.device.host(buf.host.get());
+			BA_COUNT(INSTR_DEVICE_TO_HOST, (uint64_t)buf.layout.rows*buf.layout.step);
+			buf.host_stale = false;
+		}
+		buf.device_stale = buf.device_stale || write;
+
+		return cv::Mat(buf.layout.rows, buf.layout.cols, CV_32FC1, buf.host.get(), buf.layout.step);
+	}
+
+	/*Get a buffer's mirror on the GPU. If the host memory has been written, it is uploaded first
+	**Inputs:
+	**buf: image_buffer &, Buffer to get the mirror of
+	**write: const bool, True if the array will be written to, so that the host memory must be updated the next time it is used
+	**Returns:
+	**af::array &, Mirror with dimensions cols x rows. Its OpenCL memory can be locked with device<cl_mem>() to launch kernels on
+	*/
+	af::array &buffer_array(image_buffer &buf, const bool write)
+	{
+		if (buf.device_stale)
+		{
+			buf.device = af::array(af_dims(buf.layout), buf.host.get());
+			BA_COUNT(INSTR_HOST_TO_DEVICE, (uint64_t)buf.layout.rows*buf.layout.step);
+			buf.device_stale = false;
+		}
+		buf.host_stale = buf.host_stale || write;
+
+		return buf.device;
+	}
+
+	/*Replace a buffer's mirror on the GPU with the result of a calculation. The host memory is only updated when it is next used
+	**Inputs:
+	**buf: image_buffer &, Buffer to set the mirror of
+	**arr: const af::array &, 32-bit array with dimensions cols x rows
+	*/
+	void set_buffer_array(image_buffer &buf, const af::array &arr)
+	{
+		buf.device = arr;
+		buf.device_stale = false;
+		buf.host_stale = true;
+	}
+}
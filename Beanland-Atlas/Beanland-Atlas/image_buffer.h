@@ -0,0 +1,90 @@
+#pragma once
+
+#include <includes.h>
+
+#include <utility.h>
+
+namespace ba
+{
+	//Custom data structure to describe how a 32-bit image is laid out in memory. OpenCV mats are row-major and ArrayFire arrays
+	//are column-major, so the same memory is a rows x cols mat and a cols x rows array
+	struct image_layout_param {
+		int rows; //Rows of the image as an OpenCV mat
+		int cols; //Columns of the image as an OpenCV mat
+		size_t step; //Bytes between the starts of consecutive rows in host memory
+	};
+	typedef image_layout_param image_layout;
+
+	//Custom data structure that owns a 32-bit image in pinned host memory and mirrors it on the GPU. The host memory is shared
+	//by copies of the buffer and freed when the last of them is destroyed. The mirror is only updated when it is used after
+	//the host memory was written, and vice versa
+	struct image_buffer_param {
+		image_layout layout; //Layout of the host memory
+		std::shared_ptr<float> host; //Pinned host memory, so that transfers don't need to be staged
+		af::array device; //Mirror on the GPU. Its dimensions are cols x rows
+		bool host_stale; //True if the mirror has been written since the host memory was last updated
+		bool device_stale; //True if the host memory has been written since the mirror was last updated
+	};
+	typedef image_buffer_param image_buffer;
+
+	/*Get the layout of images padded to powers of 2 in size, as they must be for ArrayFire Fourier analysis
+	**Inputs:
+	**size: cv::Size, Size of the unpadded images
+	**Returns:
+	**image_layout, Layout of contiguous padded images
+	*/
+	image_layout padded_layout(cv::Size size);
+
+	/*Get the dimensions of the ArrayFire array an image is viewed as
+	**Inputs:
+	**layout: const image_layout &, Layout of the image
+	**Returns:
+	**af::dim4, Dimensions of the array. Its first dimension is the number of columns of the image
+	*/
+	af::dim4 af_dims(const image_layout &layout);
+
+	/*Create a buffer for a zeroed 32-bit image
+	**Inputs:
+	**rows: const int, Rows of the image
+	**cols: const int, Columns of the image
+	**Returns:
+	**image_buffer, Buffer with contiguous host memory
+	*/
+	image_buffer create_image_buffer(const int rows, const int cols);
+
+	/*Create a buffer containing an image converted to 32-bit floating point. The image is converted straight into the buffer's
+	**host memory and zero padded if the buffer is larger than it. Views e.g. regions of interest are copied without a clone
+	**Inputs:
+	**img: cv::Mat &, Single channel image
+	**layout: const image_layout &, Layout of the buffer. It must have at least as many rows and columns as the image
+	**Returns:
+	**image_buffer, Buffer containing the image in its top left corner
+	*/
+	image_buffer image_buffer_from_mat(cv::Mat &img, const image_layout &layout);
+
+	/*View a buffer's host memory as an OpenCV mat without copying it. If the mirror on the GPU has been written, it is copied
+	**straight into the host memory first
+	**Inputs:
+	**buf: image_buffer &, Buffer to view
+	**write: const bool, True if the mat will be written to, so that the mirror must be updated the next time it is used
+	**Returns:
+	**cv::Mat, 32-bit mat using the host memory. It must not be used after the last copy of the buffer is destroyed
+	*/
+	cv::Mat buffer_mat(image_buffer &buf, const bool write = false);
+
+	/*Get a buffer's mirror on the GPU. If the host memory has been written, it is uploaded first
+	**Inputs:
+	**buf: image_buffer &, Buffer to get the mirror of
+	**write: const bool, True if the array will be written to, so that the host memory must be updated the next time it is used
+	**Returns:
+	**af::array &, Mirror with dimensions cols x rows. Its OpenCL memory can be locked with device<cl_mem>() to launch kernels on
+	*/
+	af::array &buffer_array(image_buffer &buf, const bool write = false);
+
+	/*Replace a buffer's mirror on the GPU with the result of a calculation. The host memory is only updated when it is next used
+	**Inputs:
+	**buf: image_buffer &, Buffer to set the mirror of
+	**arr: const af::array &, 32-bit array with dimensions cols x rows
+	*/
+	void set_buffer_array(image_buffer &buf, const af::array &arr);
+}
@@ -8,15 +8,16 @@ namespace ba
 	**annulus_fft: af::array &, Fourier transform of Gaussian blurred annulus that has been recursively convolved with itself to convolve the gradiated
 	**image with
 	**circle_fft: af::array &, Fourier transform of Gaussian blurred circle to convolve gradiated image with to remove the annular cross correlation halo
-	**mats_rows_af: int, Number of rows of ArrayFire array containing the images. This is transpositional to the OpenCV mat
-	**mats_cols_af: int, Number of cols of ArrayFire array containing the images. This is transpositional to the OpenCV mat
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
 	**Return:
 	**std::vector<std::array<float, 5>>, Positions of each image relative to the first. The third element of the cv::Vec3f holds the value
 	**of the maximum phase correlation between successive images
 	*/
 	std::vector<std::array<float, 5>> img_rel_pos(std::vector<cv::Mat> &mats, af::array &annulus_fft, af::array &circle_fft,
-		int mats_rows_af, int mats_cols_af)
+		const image_layout &layout)
 	{
+		BA_TIME_FUNCTION();
+
 		//Assign memory to store relative image positions and their phase correlation weightings
 		std::vector<std::array<float, 5>> positions(mats.size());
 
@@ -25,32 +26,90 @@ namespace ba
 		positions[0] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
 
 		//Prepare first image to be aligned
-		af::array primed_fft_prev = prime_img(mats[0], annulus_fft, circle_fft, mats_rows_af, mats_cols_af);
+		af::array primed_fft_prev = prime_img(mats[0], annulus_fft, circle_fft, layout);
 
-		//Use the phase correlation to find the relative positions of images
+		//Use the phase correlation to find the relative positions of images. The positions are read back together once they have
+		//all been queued, so the GPU doesn't wait for the host between images
+		readback_queue readbacks;
 		for (int i = 1; i < mats.size(); i++)
 		{
 			//Prepare the image to be phase correlated
-			af::array primed_fft = prime_img(mats[i], annulus_fft, circle_fft, mats_rows_af, mats_cols_af);
+			af::array primed_fft = prime_img(mats[i], annulus_fft, circle_fft, layout);
 
 			//Find the position of the maximum phase correlation and its unnormalised value
-			positions[i] = max_phase_corr(primed_fft, primed_fft_prev, i, 0);
-
-			//Correct coordinates: phase correlation in the negative direction shows up in the second half of the image
-			if (positions[i][0] >= 128)
-			{
-				positions[i][0] -= 255;
-			}
-
-			if (positions[i][1] >= 128)
-			{
-				positions[i][1] -= 255;
-			}
+			max_phase_corr(primed_fft, primed_fft_prev, i, 0, positions[i], readbacks);
+		}
+		flush_readbacks(readbacks);
+
+		for (int i = 1; i < mats.size(); i++)
+		{
+			wrap_phase_corr_pos(positions[i]);
 		}
 
 		return positions;
 	}
 
+	/*Correct the coordinates of a maximum phase correlation: phase correlation in the negative direction shows up in the second 
+	**half of the image
+	**Inputs:
+	**position: std::array<float, 5> &, Position of the maximum phase correlation read back by max_phase_corr
+	*/
+	void wrap_phase_corr_pos(std::array<float, 5> &position)
+	{
+		if (position[0] >= 128)
+		{
+			position[0] -= 255;
+		}
+
+		if (position[1] >= 128)
+		{
+			position[1] -= 255;
+		}
+	}
+
+	/*Create the filters that images are primed with for alignment
+	**Inputs:
+	**annulus_param: std::vector<int> &, Radius and thickness of the annulus that describes the gradiation of the spots best
+	**ubound: const int, Upper bound on the size of the spots
+	**gauss_fft: af::array &, Fourier transform of the Gaussian to blur the filters with
+	**annulus_creator: cl_kernel, OpenCL kernel that creates annuluses
+	**circle_creator: cl_kernel, OpenCL kernel that creates circles
+	**af_queue: cl_command_queue, ArrayFire command queue
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
+	**annulus_fft: af::array &, Output Fourier transform of the Gaussian blurred annulus recursively convolved with itself
+	**circle_fft: af::array &, Output Fourier transform of the Gaussian blurred circle
+	*/
+	void create_align_filters(std::vector<int> &annulus_param, const int ubound, af::array &gauss_fft, cl_kernel annulus_creator,
+		cl_kernel circle_creator, cl_command_queue af_queue, const image_layout &layout, af::array &annulus_fft, 
+		af::array &circle_fft)
+	{
+		//ArrayFire arrays are column-major, so their rows are the images' columns
+		af::dim4 dims_af = af_dims(layout);
+		int mats_rows_af = (int)dims_af[0];
+		int mats_cols_af = (int)dims_af[1];
+
+		//Number of times to recursively cross correlate annulus with itself
+		int order = ubound/(2*annulus_param[0]);
+
+		//Use best annulus parameters to create the annulus to perform cross correlations with
+		af::array best_annulus = create_annulus(mats_cols_af*mats_rows_af, mats_cols_af, mats_cols_af/2, mats_rows_af, 
+			mats_rows_af/2, annulus_param[0], annulus_param[1], annulus_creator, af_queue);
+
+		//Gaussian blur the annulus in the Fourier domain
+		af_array annulus_fft_c;
+		af_fft2_r2c(&annulus_fft_c, best_annulus.get(), 1.0f, mats_rows_af, mats_cols_af);
+		annulus_fft = recur_conv(gauss_fft*af::array(annulus_fft_c), order);
+
+		//Create circle
+		af::array circle = create_circle(mats_cols_af*mats_rows_af, mats_cols_af, mats_cols_af/2, mats_rows_af, 
+			mats_rows_af/2, annulus_param[0], circle_creator, af_queue);
+
+		//Gaussian blur the circle in the Fourier domain
+		af_array circle_c;
+		af_fft2_r2c(&circle_c, circle.get(), 1.0f, mats_rows_af, mats_cols_af);
+		circle_fft = gauss_fft*af::array(circle_c);
+	}
+
 	/*Use the convolution theorem to create a filter that performs the recursive convolution of a convolution filter with itself
 	**Inputs:
 	**filter: af::array &, Filter to recursively convolved with its own convolution
@@ -68,15 +127,14 @@ namespace ba
 	**fft2: af::array &, Second of the 2 Fourier transforms
 	**img_idx1: int, index of the image used to create the first of the 2 Fourier transforms
 	**img_idx2: int, index of the image used to create the second of the 2 Fourier transforms
-	**Return:
-	**std::array<float, 5>, The 0th and 1st indices are the relative positions of images, the 2nd index is the value of the phase correlation
-	**and the 3rd and 4th indices hold the indices of the images being compared in the OpenCV mats container 
+	**position: std::array<float, 5> &, The 0th and 1st indices are set to the relative positions of images and the 2nd index to
+	**the value of the phase correlation when the readbacks are flushed. The 3rd and 4th indices are set to the indices of the
+	**images being compared in the OpenCV mats container
+	**readbacks: readback_queue &, Queue to add the position and value of the maximum to
 	*/
-	std::array<float, 5> max_phase_corr(af::array &fft1, af::array &fft2, int img_idx1, int img_idx2)
+	void max_phase_corr(af::array &fft1, af::array &fft2, int img_idx1, int img_idx2, std::array<float, 5> &position,
+		readback_queue &readbacks)
 	{
-		//Create array to store relative position, value of the phase correlation and the identities of the images being compared
-		std::array<float, 5> position;
-
 		//Fourier transform the element-wise normalised cross-power spectrum
 		af_array phase_corr;
 		af_fft2_c2r(&phase_corr, (fft1*af::conjg(fft2)/(af::abs(fft1*af::conjg(fft2)) + 1)).get(), 1.0f, false); // +1 to avoid divide by 0 errors
@@ -87,16 +145,12 @@ namespace ba
 		af::max(max1, idx1, af::abs(af::array(phase_corr)), 1);
 		af::max(max, idx, max1, 0);
 
-		//Transfer results back to the host
-		idx.as(f32).host(&position[0]);
-		idx1(idx).as(f32).host(&position[1]);
-		max.host(&position[2]);
+		//Queue the results to be transferred back to the host
+		queue_readback(readbacks, af::join(0, idx.as(f32), idx1(idx).as(f32), max), &position[0]);
 
 		//Record identities of images being compared
 		position[3] = img_idx1;
 		position[4] = img_idx2;
-
-		return position;
 	}
 
 	/*Primes images for alignment. The primed images are the Gaussian blurred cross correlation of their Hann windowed Sobel filtrate
@@ -104,19 +158,20 @@ namespace ba
 	**img: cv::Mat &, Image to prime for alignment
 	**annulus_fft: af::array &, Fourier transform of the convolution of a Gaussian and an annulus
 	**circle_fft: af::array &, Fourier transform of the convolution of a Gaussian and a circle
-	**mats_rows_af: int, Number of rows of ArrayFire array containing the images. This is transpositional to the OpenCV mat
-	**mats_cols_af: int, Number of cols of ArrayFire array containing the images. This is transpositional to the OpenCV mat
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
 	**Return:
 	**af::array, Image primed for alignment
 	*/
-	af::array prime_img(cv::Mat &img, af::array &annulus_fft, af::array &circle_fft, int mats_rows_af, int mats_cols_af)
+	af::array prime_img(cv::Mat &img, af::array &annulus_fft, af::array &circle_fft, const image_layout &layout)
 	{
-		//Convert image to known data type
-		cv::Mat image32F;
-		img.convertTo(image32F, CV_32FC1, 1);
-
-		//Load the image onto the GPU
-		af::array img_af(mats_rows_af, mats_cols_af, (float*)(image32F.data));
+		//ArrayFire arrays are column-major, so their rows are the images' columns
+		af::dim4 dims_af = af_dims(layout);
+		int mats_rows_af = (int)dims_af[0];
+		int mats_cols_af = (int)dims_af[1];
+
+		//Convert the image into pinned memory, zero padding it, and load it onto the GPU
+		image_buffer img_buf = image_buffer_from_mat(img, layout);
+		af::array img_af = buffer_array(img_buf);
 
 		//Fourier transform the Hanning windowed image's Sobel filtrate
 		af_array sobel_filtrate;
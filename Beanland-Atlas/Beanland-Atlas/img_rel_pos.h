@@ -2,6 +2,10 @@
 
 #include <includes.h>
 
+#include <device_transfer.h>
+#include <image_buffer.h>
+#include <kernel_launchers.h>
+
 namespace ba
 {
 	/*Calculate the relative positions between images needed to align them.
@@ -10,14 +14,36 @@ namespace ba
 	**annulus_fft: af::array &, Fourier transform of Gaussian blurred annulus that has been recursively convolved with itself to convolve the gradiated
 	**image with
 	**circle_fft: af::array &, Fourier transform of Gaussian blurred circle to convolve gradiated image with to remove the annular cross correlation halo
-	**mats_rows_af: int, Number of rows of ArrayFire array containing the images. This is transpositional to the OpenCV mat
-	**mats_cols_af: int, Number of cols of ArrayFire array containing the images. This is transpositional to the OpenCV mat
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
 	**Return:
 	**std::vector<std::array<float, 5>>, Positions of each image relative to the first. The third element of the cv::Vec3f holds the value
 	**of the maximum phase correlation between successive images
 	*/
 	std::vector<std::array<float, 5>> img_rel_pos(std::vector<cv::Mat> &mats, af::array &annulus_fft, af::array &circle_fft,
-		int mats_rows_af, int mats_cols_af);
+		const image_layout &layout);
+
+	/*Correct the coordinates of a maximum phase correlation: phase correlation in the negative direction shows up in the second 
+	**half of the image
+	**Inputs:
+	**position: std::array<float, 5> &, Position of the maximum phase correlation read back by max_phase_corr
+	*/
+	void wrap_phase_corr_pos(std::array<float, 5> &position);
+
+	/*Create the filters that images are primed with for alignment
+	**Inputs:
+	**annulus_param: std::vector<int> &, Radius and thickness of the annulus that describes the gradiation of the spots best
+	**ubound: const int, Upper bound on the size of the spots
+	**gauss_fft: af::array &, Fourier transform of the Gaussian to blur the filters with
+	**annulus_creator: cl_kernel, OpenCL kernel that creates annuluses
+	**circle_creator: cl_kernel, OpenCL kernel that creates circles
+	**af_queue: cl_command_queue, ArrayFire command queue
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
+	**annulus_fft: af::array &, Output Fourier transform of the Gaussian blurred annulus recursively convolved with itself
+	**circle_fft: af::array &, Output Fourier transform of the Gaussian blurred circle
+	*/
+	void create_align_filters(std::vector<int> &annulus_param, const int ubound, af::array &gauss_fft, cl_kernel annulus_creator,
+		cl_kernel circle_creator, cl_command_queue af_queue, const image_layout &layout, af::array &annulus_fft, 
+		af::array &circle_fft);
 
 	/*Use the convolution theorem to create a filter that performs the recursive convolution of a convolution filter with itself
 	**Inputs:
@@ -34,22 +60,23 @@ namespace ba
 	**fft2: af::array &, Second of the 2 Fourier transforms
 	**img_idx1: int, index of the image used to create the first of the 2 Fourier transforms
 	**img_idx2: int, index of the image used to create the second of the 2 Fourier transforms
-	**Return:
-	**std::array<float, 5>, The 0th and 1st indices are the relative positions of images, the 2nd index is the value of the phase correlation
-	**and the 3rd and 4th indices hold the indices of the images being compared in the OpenCV mats container 
+	**position: std::array<float, 5> &, The 0th and 1st indices are set to the relative positions of images and the 2nd index to
+	**the value of the phase correlation when the readbacks are flushed. The 3rd and 4th indices are set to the indices of the
+	**images being compared in the OpenCV mats container
+	**readbacks: readback_queue &, Queue to add the position and value of the maximum to
 	*/
-	std::array<float, 5> max_phase_corr(af::array &fft1, af::array &fft2, int img_idx1, int img_idx2);
+	void max_phase_corr(af::array &fft1, af::array &fft2, int img_idx1, int img_idx2, std::array<float, 5> &position,
+		readback_queue &readbacks);
 
 	/*Primes images for alignment. The primed images are the Gaussian blurred cross correlation of their Hann windowed Sobel filtrate
 	**with an annulus after it has been scaled by the cross correlation of the Hann windowed image with a circle
 	**img: cv::Mat &, Image to prime for alignment
 	**annulus_fft: af::array &, Fourier transform of the convolution of a Gaussian and an annulus
 	**circle_fft: af::array &, Fourier transform of the convolution of a Gaussian and a circle
-	**mats_rows_af: int, Number of rows of ArrayFire array containing the images. This is transpositional to the OpenCV mat
-	**mats_cols_af: int, Number of cols of ArrayFire array containing the images. This is transpositional to the OpenCV mat
+	**layout: const image_layout &, Layout of the padded images. Their ArrayFire arrays have dimensions af_dims(layout)
 	**Return:
 	**af::array, Image primed for alignment
 	*/
-	af::array prime_img(cv::Mat &img, af::array &annulus_fft, af::array &circle_fft, int mats_rows_af, int mats_cols_af);
+	af::array prime_img(cv::Mat &img, af::array &annulus_fft, af::array &circle_fft, const image_layout &layout);
 
 }
\ No newline at end of file
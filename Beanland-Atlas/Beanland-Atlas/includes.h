@@ -12,6 +12,29 @@
 //Data containers
 #include <vector>
 #include <array>
+#include <map>
+#include <tuple>
+#include <string>
+
+//Raw memory and fixed width integers for checkpoint files
+#include <cstdint>
+#include <cstring>
+
+//Pipeline stages
+#include <functional>
+
+//Thread-safe caches
+#include <mutex>
+
+//Task scheduler
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+
+//Noise of synthetic data
+#include <random>
 
 #include "opencv2/highgui/highgui.hpp" //Loading images
 #include <opencv2/imgproc/imgproc.hpp> //Convert RGB to greyscale
@@ -58,12 +81,21 @@
 //Developer utility functions
 #include <developer_helper_func.h>
 
+//Timing, counters and memory use of the pipeline. This must come after the FFT libraries
+#include <instrumentation.h>
+
 //Possible mirror symmetries
 static const std::array<int, 4> pos_mir_sym = {2, 3, 4, 6}; //Add to this - see Richard's paper on CBED atlas symmetry
 
 //Input data location
 static const char* inputImagePath = "D:/data/default2.tif";
 
+//FFTW wisdom location. Plans measured by previous runs are loaded from and saved to this file
+static const char* fft_wisdom_path = "fftw_wisdom.dat";
+
+//Pipeline checkpoint files start with this. Runs with the same data and parameters resume from them
+static const char* checkpoint_prefix = "ba_checkpoint_";
+
 //Locations of kernels. Note: will update these to use an environmental variable based on where the user installs the software
 static const char* annulus_source = "D:/Beanland-Atlas/Beanland-Atlas/Beanland-Atlas/create_annulus.cl"; //Create padded annulus
 static const char* gauss_kernel_ext_source = "D:/Beanland-Atlas/Beanland-Atlas/Beanland-Atlas/gauss_kernel_padded.cl"; //Create padded Gaussian blurring kernel
@@ -0,0 +1,259 @@
+#include <instrumentation.h>
+
+#ifdef BA_INSTRUMENT
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+//Process memory use is only available from platform APIs
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace ba
+{
+	//Names of the counters in the trace and summary
+	static const char *instr_counter_names[INSTR_NUM_COUNTERS] = { "FFTW transforms", "ArrayFire transforms", 
+		"Bytes to device", "Bytes to host", "Device buffers" };
+
+	//Custom data structure to hold a completed scope
+	struct instr_event_param {
+		std::string name;
+		bool stage;
+		int tid; //Thread that the scope ran on
+		int64_t start; //Microseconds since the first timer
+		int64_t dur; //Microseconds
+		uint64_t counters[INSTR_NUM_COUNTERS]; //Increase in the counters over the scope. Only recorded for stages
+		size_t rss; //Resident memory at the end of the scope, in bytes. Only recorded for stages
+		size_t peak_rss; //Peak resident memory of the process by the end of the scope, in bytes. Only recorded for stages
+	};
+	typedef instr_event_param instr_event;
+
+	static std::atomic<uint64_t> instr_counters[INSTR_NUM_COUNTERS];
+	static std::atomic<int> instr_next_tid(0);
+
+	/*Get the current and peak resident memory of the process
+	**Inputs:
+	**current: size_t &, Output current resident memory in bytes
+	**peak: size_t &, Output peak resident memory in bytes
+	*/
+	static void memory_use(size_t &current, size_t &peak)
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS pmc;
+		GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+		current = pmc.WorkingSetSize;
+		peak = pmc.PeakWorkingSetSize;
+#else
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		peak = (size_t)usage.ru_maxrss * 1024;
+
+		long size = 0, resident = 0;
+		std::ifstream statm("/proc/self/statm");
+		statm >> size >> resident;
+		current = (size_t)resident * sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	//Recorded scopes. They are written out when the program exits
+	static struct instr_log_param {
+		std::mutex mutex;
+		std::vector<instr_event> events;
+		std::chrono::steady_clock::time_point origin;
+
+		instr_log_param() : origin(std::chrono::steady_clock::now()) {}
+		~instr_log_param() { write_instrumentation(INSTR_TRACE_PATH); }
+	} instr_log;
+
+	/*Microseconds since the log was created
+	**Returns:
+	**int64_t, Time in microseconds
+	*/
+	static int64_t instr_now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - instr_log.origin).count();
+	}
+
+	/*Small identifier for the calling thread, assigned in the order threads first record a scope
+	**Returns:
+	**int, Thread identifier
+	*/
+	static int instr_tid()
+	{
+		static thread_local int tid = instr_next_tid++;
+		return tid;
+	}
+
+	/*Start timing a scope
+	**Inputs:
+	**name: const char *, Name of the scope
+	**stage: const bool, True if the scope is a pipeline stage
+	*/
+	scoped_timer_param::scoped_timer_param(const char *name, const bool stage) : name(name), stage(stage)
+	{
+		if (stage)
+		{
+			for (int i = 0; i < INSTR_NUM_COUNTERS; i++)
+			{
+				counters[i] = instr_counters[i];
+			}
+		}
+		start = instr_now();
+	}
+
+	/*Record the scope when it ends*/
+	scoped_timer_param::~scoped_timer_param()
+	{
+		instr_event e;
+		e.dur = instr_now() - start;
+		e.name = name;
+		e.stage = stage;
+		e.tid = instr_tid();
+		e.start = start;
+		e.rss = e.peak_rss = 0;
+		for (int i = 0; i < INSTR_NUM_COUNTERS; i++)
+		{
+			e.counters[i] = stage ? instr_counters[i] - counters[i] : 0;
+		}
+		if (stage)
+		{
+			memory_use(e.rss, e.peak_rss);
+		}
+
+		std::lock_guard<std::mutex> lock(instr_log.mutex);
+		instr_log.events.push_back(e);
+	}
+
+	/*Add to one of the counters. This is thread-safe
+	**Inputs:
+	**counter: const int, Counter to add to
+	**n: const uint64_t, Amount to add
+	*/
+	void instr_count(const int counter, const uint64_t n)
+	{
+		instr_counters[counter] += n;
+	}
+
+	/*Escape a string for a JSON string literal
+	**Inputs:
+	**s: const std::string &, String to escape
+	**Returns:
+	**std::string, Escaped string
+	*/
+	static std::string json_escape(const std::string &s)
+	{
+		std::string escaped;
+		for (size_t i = 0; i < s.size(); i++)
+		{
+			if (s[i] == '"' || s[i] == '\\')
+			{
+				escaped += '\\';
+			}
+			escaped += s[i];
+		}
+		return escaped;
+	}
+
+	/*Write the recorded scopes as a Chrome trace and print a summary of them. This is called automatically at exit
+	**Inputs:
+	**trace_path: const char *, File to write the trace to. It can be opened with chrome://tracing or Perfetto
+	*/
+	void write_instrumentation(const char *trace_path)
+	{
+		std::lock_guard<std::mutex> lock(instr_log.mutex);
+		std::vector<instr_event> &events = instr_log.events;
+		if (events.empty())
+		{
+			return;
+		}
+
+		//Complete events for every scope and counter events for the memory use at the end of each stage
+		std::ofstream trace(trace_path);
+		trace << "{\"traceEvents\":[";
+		for (int i = 0; i < events.size(); i++)
+		{
+			instr_event &e = events[i];
+			trace << (i ? ",\n" : "\n") << "{\"name\":\"" << json_escape(e.name) << "\",\"cat\":\"" << 
+				(e.stage ? "stage" : "function") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid << ",\"ts\":" << e.start << 
+				",\"dur\":" << e.dur;
+			if (e.stage)
+			{
+				trace << ",\"args\":{";
+				for (int c = 0; c < INSTR_NUM_COUNTERS; c++)
+				{
+					trace << "\"" << instr_counter_names[c] << "\":" << e.counters[c] << ",";
+				}
+				trace << "\"Peak RSS MB\":" << e.peak_rss / 1048576.0 << "}}";
+				trace << ",\n{\"name\":\"RSS MB\",\"ph\":\"C\",\"pid\":1,\"ts\":" << e.start + e.dur << 
+					",\"args\":{\"RSS\":" << e.rss / 1048576.0 << "}";
+			}
+			trace << "}";
+		}
+		trace << "\n]}\n";
+
+		//Totals for each scope name
+		struct total { int calls; int64_t dur, max_dur; };
+		std::map<std::string, total> totals;
+		for (int i = 0; i < events.size(); i++)
+		{
+			total &t = totals[events[i].name];
+			t.calls++;
+			t.dur += events[i].dur;
+			t.max_dur = std::max(t.max_dur, events[i].dur);
+		}
+
+		std::cout << std::endl << "Timings (trace written to " << trace_path << ")" << std::endl;
+		std::cout << std::left << std::setw(40) << "Scope" << std::right << std::setw(8) << "Calls" << std::setw(14) << 
+			"Total ms" << std::setw(14) << "Mean ms" << std::setw(14) << "Max ms" << std::endl;
+		for (std::map<std::string, total>::iterator it = totals.begin(); it != totals.end(); it++)
+		{
+			std::cout << std::left << std::setw(40) << it->first << std::right << std::setw(8) << it->second.calls << 
+				std::fixed << std::setprecision(2) << std::setw(14) << it->second.dur / 1e3 << std::setw(14) << 
+				it->second.dur / 1e3 / it->second.calls << std::setw(14) << it->second.max_dur / 1e3 << std::endl;
+		}
+
+		std::cout << std::endl << std::left << std::setw(24) << "Stage";
+		for (int c = 0; c < INSTR_NUM_COUNTERS; c++)
+		{
+			std::cout << std::right << std::setw(22) << instr_counter_names[c];
+		}
+		std::cout << std::setw(16) << "Peak RSS MB" << std::endl;
+		for (int i = 0; i < events.size(); i++)
+		{
+			if (!events[i].stage)
+			{
+				continue;
+			}
+
+			std::cout << std::left << std::setw(24) << events[i].name << std::right;
+			for (int c = 0; c < INSTR_NUM_COUNTERS; c++)
+			{
+				std::cout << std::setw(22) << events[i].counters[c];
+			}
+			std::cout << std::setw(16) << std::setprecision(1) << events[i].peak_rss / 1048576.0 << std::endl;
+		}
+
+		std::cout << std::endl << "Totals:";
+		for (int c = 0; c < INSTR_NUM_COUNTERS; c++)
+		{
+			std::cout << " " << instr_counter_names[c] << " " << instr_counters[c];
+		}
+		std::cout << std::endl;
+	}
+}
+
+#endif
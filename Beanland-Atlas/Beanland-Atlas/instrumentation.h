@@ -0,0 +1,88 @@
+#pragma once
+
+#include <defines.h>
+
+#include <cstdint>
+#include <string>
+
+//Timers, counters and memory use are only recorded if BA_INSTRUMENT is defined, here or in the project's preprocessor 
+//definitions. Otherwise the instrumentation macros expand to nothing
+//#define BA_INSTRUMENT
+
+namespace ba
+{
+	//Counters that instrumented code can add to
+    #define INSTR_FFT_CPU 0 //FFTW transforms
+    #define INSTR_FFT_GPU 1 //ArrayFire transforms
+    #define INSTR_HOST_TO_DEVICE 2 //Bytes uploaded to the GPU
+    #define INSTR_DEVICE_TO_HOST 3 //Bytes downloaded from the GPU
+    #define INSTR_DEVICE_PTR 4 //OpenCL buffers taken from ArrayFire arrays to launch kernels on
+    #define INSTR_NUM_COUNTERS 5
+
+	//File the Chrome trace of the recorded scopes is written to at exit
+    #define INSTR_TRACE_PATH "ba_trace.json"
+}
+
+#ifdef BA_INSTRUMENT
+namespace ba
+{
+	//Custom data structure that times its own scope. Stages also record the counters and memory use over their scope
+	struct scoped_timer_param {
+		std::string name; //Name of the scope in the trace and summary
+		bool stage; //True for pipeline stages
+		int64_t start; //Start time in microseconds since the first timer
+		uint64_t counters[INSTR_NUM_COUNTERS]; //Counters at the start of the scope
+
+		/*Start timing a scope
+		**Inputs:
+		**name: const char *, Name of the scope
+		**stage: const bool, True if the scope is a pipeline stage
+		*/
+		scoped_timer_param(const char *name, const bool stage = false);
+
+		/*Record the scope when it ends*/
+		~scoped_timer_param();
+	};
+	typedef scoped_timer_param scoped_timer;
+
+	/*Add to one of the counters. This is thread-safe
+	**Inputs:
+	**counter: const int, Counter to add to
+	**n: const uint64_t, Amount to add
+	*/
+	void instr_count(const int counter, const uint64_t n);
+
+	/*Write the recorded scopes as a Chrome trace and print a summary of them. This is called automatically at exit
+	**Inputs:
+	**trace_path: const char *, File to write the trace to. It can be opened with chrome://tracing or Perfetto
+	*/
+	void write_instrumentation(const char *trace_path);
+}
+
+    #define BA_INSTR_CONCAT_(a, b) a##b
+    #define BA_INSTR_CONCAT(a, b) BA_INSTR_CONCAT_(a, b)
+
+	//Time the rest of the enclosing scope
+    #define BA_TIME_SCOPE(name) ba::scoped_timer BA_INSTR_CONCAT(ba_timer_, __LINE__)(name)
+
+	//Time the rest of the enclosing function
+    #define BA_TIME_FUNCTION() BA_TIME_SCOPE(__FUNCTION__)
+
+	//Time the rest of the enclosing scope as a pipeline stage, recording counters and memory use
+    #define BA_TIME_STAGE(name) ba::scoped_timer BA_INSTR_CONCAT(ba_timer_, __LINE__)(name, true)
+
+	//Add to a counter
+    #define BA_COUNT(counter, n) ba::instr_count(counter, n)
+
+	//Count transforms where they are called. A function-like macro doesn't expand inside its own expansion, so these still 
+	//call the libraries. This header must be included after fftw3.h and arrayfire.h
+    #define fftw_execute_dft_r2c(...) (ba::instr_count(INSTR_FFT_CPU, 1), fftw_execute_dft_r2c(__VA_ARGS__))
+    #define fftw_execute_dft_c2r(...) (ba::instr_count(INSTR_FFT_CPU, 1), fftw_execute_dft_c2r(__VA_ARGS__))
+    #define af_fft2_r2c(...) (ba::instr_count(INSTR_FFT_GPU, 1), af_fft2_r2c(__VA_ARGS__))
+    #define af_fft2_c2r(...) (ba::instr_count(INSTR_FFT_GPU, 1), af_fft2_c2r(__VA_ARGS__))
+#else
+    #define BA_TIME_SCOPE(name)
+    #define BA_TIME_FUNCTION()
+    #define BA_TIME_STAGE(name)
+    #define BA_COUNT(counter, n)
+#endif
@@ -67,6 +67,7 @@ namespace ba
 		size_t length = rows*cols;
 		af::array output_af = af::constant(0, length, f32);
 		cl_mem * output_cl = output_af.device<cl_mem>();
+		BA_COUNT(INSTR_DEVICE_PTR, 1);
 
 		//Pass arguments to kernel
 		clSetKernelArg(kernel, 0, sizeof(cl_mem), output_cl);
@@ -105,10 +106,12 @@ namespace ba
 	{
 		size_t num_data = reduced_height * width;
 		cl_mem * input_cl = af::moddims(input_af, num_data).device<cl_mem>();
+		BA_COUNT(INSTR_DEVICE_PTR, 1);
 
 		//Create ArrayFire memory to hold spectrum and transfer it to OpenCL
 		af::array output_af = af::constant(0, length, f32);
 		cl_mem * output_cl = output_af.device<cl_mem>();
+		BA_COUNT(INSTR_DEVICE_PTR, 1);
 
 		//Prepare additional arguments for kernel
 		int half_width = width/2;
@@ -157,6 +160,7 @@ namespace ba
 		//Create ArrayFire memory to hold spectrum and transfer it to OpenCL
 		af::array output_af = af::constant(0, length, f32);
 		cl_mem * output_cl = output_af.device<cl_mem>();
+		BA_COUNT(INSTR_DEVICE_PTR, 1);
 
 		//Prepare additional arguments for kernel
 		int inner_rad2 = (radius - thickness/2)*(radius - thickness/2);
@@ -198,6 +202,7 @@ namespace ba
 		//Create ArrayFire memory to hold spectrum and transfer it to OpenCL
 		af::array output_af = af::constant(0, length, f32);
 		cl_mem * output_cl = output_af.device<cl_mem>();
+		BA_COUNT(INSTR_DEVICE_PTR, 1);
 
 		//Prepare additional arguments for kernel
 		int radius_squared = radius*radius;
@@ -0,0 +1,398 @@
+#include <online_atlas.h>
+
+namespace ba
+{
+	/*Prepare an atlas to be built as frames arrive
+	**Inputs:
+	**atlas: online_atlas &, Atlas to prepare
+	**af_context: cl_context, ArrayFire context
+	**af_device_id: cl_device_id, ArrayFire device
+	**af_queue: cl_command_queue, ArrayFire command queue
+	**inpainting_method: const int, Method to inpaint the Bragg peak regions in the diffraction pattern. BACKGROUND_SPLINE to
+	**fit a spline background through the rest of the pattern instead, or -1 to leave the background
+	*/
+	void init_online_atlas(online_atlas &atlas, cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue,
+		const int inpainting_method)
+	{
+		atlas.af_context = af_context;
+		atlas.af_device_id = af_device_id;
+		atlas.af_queue = af_queue;
+
+		//Create the kernels once for all the frames
+		atlas.gauss_kernel = create_kernel(gauss_kernel_ext_source, gauss_kernel_ext_kernel, af_context, af_device_id);
+		atlas.annulus_kernel = create_kernel(annulus_source, annulus_kernel, af_context, af_device_id);
+		atlas.circle_kernel = create_kernel(circle_source, circle_kernel, af_context, af_device_id);
+
+		atlas.inpainting_method = inpainting_method;
+		atlas.num_frames = 0;
+		atlas.ubound = 0;
+		atlas.frames_since_ref = 0;
+		atlas.rel_pos = std::vector<std::vector<int>>(2);
+		atlas.canvas = cv::Rect();
+	}
+
+	/*Free the OpenCL resources of an atlas built as frames arrived
+	**Inputs:
+	**atlas: online_atlas &, Atlas to free the resources of
+	*/
+	void close_online_atlas(online_atlas &atlas)
+	{
+		clReleaseKernel(atlas.gauss_kernel);
+		clReleaseKernel(atlas.annulus_kernel);
+		clReleaseKernel(atlas.circle_kernel);
+	}
+
+	/*Divide the sum of the registered frames by the number of frames that contributed to each px
+	**Inputs:
+	**atlas: online_atlas &, Atlas to get the average of
+	**Returns:
+	**cv::Mat, 32-bit average of the registered frames over the canvas
+	*/
+	static cv::Mat average_unlocked(online_atlas &atlas)
+	{
+		cv::Mat counts;
+		atlas.num_overlap.convertTo(counts, CV_32FC1);
+
+		cv::Mat avg;
+		cv::divide(atlas.acc_sum, cv::max(counts, 1.0), avg);
+		return avg;
+	}
+
+	/*Prime the running average in the region of the first frame to register the following frames against. Registering against
+	**the average rather than the first frame keeps the reference similar to the frames as the beam tilts
+	**Inputs:
+	**atlas: online_atlas &, Atlas to update the reference of
+	*/
+	static void update_online_ref(online_atlas &atlas)
+	{
+		cv::Mat ref = average_unlocked(atlas)(cv::Rect(-atlas.canvas.x, -atlas.canvas.y, atlas.layout.cols, atlas.layout.rows));
+		atlas.ref_fft = prime_img(ref, atlas.annulus_fft, atlas.circle_fft, atlas.layout);
+		atlas.frames_since_ref = 0;
+	}
+
+	/*Add a registered frame to the running sums, growing them if the frame extends past them
+	**Inputs:
+	**atlas: online_atlas &, Atlas to add the frame to
+	**frame: cv::Mat &, Preprocessed frame
+	**x: const int, Position of the frame relative to the first in x
+	**y: const int, Position of the frame relative to the first in y
+	*/
+	static void accumulate_frame(online_atlas &atlas, cv::Mat &frame, const int x, const int y)
+	{
+		//Frames are shifted by the negative of their relative positions to align them, as in align_and_avg
+		cv::Rect frame_rect(-x, -y, frame.cols, frame.rows);
+
+		cv::Rect grown = atlas.canvas.area() ? atlas.canvas | frame_rect : frame_rect;
+		if (grown != atlas.canvas)
+		{
+			cv::Mat acc_sum = cv::Mat::zeros(grown.size(), CV_32FC1);
+			cv::Mat num_overlap = cv::Mat::zeros(grown.size(), CV_16UC1);
+			if (atlas.canvas.area())
+			{
+				cv::Rect prev_roi(atlas.canvas.tl() - grown.tl(), atlas.canvas.size());
+				atlas.acc_sum.copyTo(acc_sum(prev_roi));
+				atlas.num_overlap.copyTo(num_overlap(prev_roi));
+			}
+
+			atlas.acc_sum = acc_sum;
+			atlas.num_overlap = num_overlap;
+			atlas.canvas = grown;
+		}
+
+		cv::Rect roi(frame_rect.tl() - atlas.canvas.tl(), frame_rect.size());
+		cv::Mat acc_roi = atlas.acc_sum(roi);
+		cv::Mat overlap_roi = atlas.num_overlap(roi);
+		acc_roi += frame;
+		overlap_roi += 1;
+	}
+
+	/*Subtract the background from a registered frame and add the pixels about each spot to the spot's map
+	**Inputs:
+	**atlas: online_atlas &, Atlas with known spot positions
+	**frame: cv::Mat &, Preprocessed frame. Its background is subtracted in place
+	**x: const int, Position of the frame relative to the first in x
+	**y: const int, Position of the frame relative to the first in y
+	*/
+	static void map_frame(online_atlas &atlas, cv::Mat &frame, const int x, const int y)
+	{
+		//Spot positions are relative to the first frame, so the frame is at the negative of its relative position
+		std::vector<cv::Mat> mats(1, frame);
+		std::vector<std::vector<int>> rel_pos = { std::vector<int>(1, x), std::vector<int>(1, y) };
+		subtract_background(mats, atlas.spot_pos, rel_pos, atlas.inpainting_method, 0, 0, atlas.ns_radius);
+
+		cv::Rect frame_rect(0, 0, frame.cols, frame.rows);
+		const disk_spans &disk = get_disk_spans(atlas.radius+1);
+		parallel_for(0, atlas.spot_pos.size(), [&](int k)
+		{
+			//Check if the spot is in the frame
+			cv::Point center(atlas.spot_pos[k].x + x, atlas.spot_pos[k].y + y);
+			if (!frame_rect.contains(center))
+			{
+				return;
+			}
+
+			//Add the disk about the spot to its map
+			for_disk_spans(disk, center, frame.size(), [&](int m, int start, int end)
+			{
+				float *r = atlas.map_sums[k].ptr<float>(m);
+				ushort *s = atlas.map_counts[k].ptr<ushort>(m);
+				float *t = frame.ptr<float>(m);
+				#pragma omp simd
+				for (int n = start; n < end; n++)
+				{
+					r[n] += t[n];
+					s[n]++;
+				}
+			});
+		});
+	}
+
+	/*Register a preprocessed frame against the reference and add it to the running sums. It is also added to the maps of the
+	**spots if they have been found, otherwise it is kept until they are
+	**Inputs:
+	**atlas: online_atlas &, Atlas to add the frame to
+	**frame: cv::Mat &, Preprocessed frame
+	*/
+	static void register_frame(online_atlas &atlas, cv::Mat &frame)
+	{
+		int x = 0, y = 0;
+		if (atlas.canvas.area())
+		{
+			af::array primed_fft = prime_img(frame, atlas.annulus_fft, atlas.circle_fft, atlas.layout);
+
+			std::array<float, 5> position;
+			readback_queue readbacks;
+			max_phase_corr(primed_fft, atlas.ref_fft, (int)atlas.rel_pos[0].size(), 0, position, readbacks);
+			flush_readbacks(readbacks);
+			wrap_phase_corr_pos(position);
+
+			x = position[0];
+			y = position[1];
+		}
+		atlas.rel_pos[0].push_back(x);
+		atlas.rel_pos[1].push_back(y);
+
+		accumulate_frame(atlas, frame, x, y);
+
+		if (atlas.spot_pos.size())
+		{
+			map_frame(atlas, frame, x, y);
+		}
+		else
+		{
+			atlas.unmapped.push_back(frame);
+		}
+
+		//Keep the reference up to date with the running average
+		if (atlas.rel_pos[0].size() == 1 || ++atlas.frames_since_ref >= ONLINE_REF_INTERVAL)
+		{
+			update_online_ref(atlas);
+		}
+	}
+
+	/*Estimate the size of the spots and the annulus that describes their gradiation from the buffered frames, then register them
+	**Inputs:
+	**atlas: online_atlas &, Atlas with buffered frames
+	*/
+	static void start_registration(online_atlas &atlas)
+	{
+		BA_TIME_FUNCTION();
+
+		std::vector<cv::Mat> &mats = atlas.unregistered;
+		atlas.ubound = circ_size_ubound(mats, atlas.layout, atlas.gauss_fft, MIN_CIRC_SIZE,
+			std::min((int)mats.size(), MAX_AUTO_CONTRIB), atlas.af_context, atlas.af_device_id, atlas.af_queue);
+		atlas.annulus_param = get_annulus_param(mats[0], MIN_CIRC_SIZE, atlas.ubound, INIT_ANNULUS_THICKNESS, MAX_SIZE_CONTRIB,
+			atlas.layout, atlas.gauss_fft, atlas.annulus_kernel, atlas.af_queue);
+
+		create_align_filters(atlas.annulus_param, atlas.ubound, atlas.gauss_fft, atlas.annulus_kernel, atlas.circle_kernel,
+			atlas.af_queue, atlas.layout, atlas.annulus_fft, atlas.circle_fft);
+
+		//Extract spots the same way as the batch pipeline
+		atlas.radius = 0.9*atlas.annulus_param[0];
+		atlas.ns_radius = atlas.annulus_param[0]+2*atlas.annulus_param[1];
+
+		for (int i = 0; i < mats.size(); i++)
+		{
+			register_frame(atlas, mats[i]);
+		}
+		mats.clear();
+	}
+
+	/*Find the spots in the running average, then add the frames that were waiting for them to their maps
+	**Inputs:
+	**atlas: online_atlas &, Atlas with registered frames
+	*/
+	static void start_mapping(online_atlas &atlas)
+	{
+		BA_TIME_FUNCTION();
+
+		cv::Mat avg = average_unlocked(atlas);
+		std::vector<cv::Point> spot_pos = get_spot_pos(avg, atlas.annulus_param[0], atlas.annulus_param[0],
+			atlas.annulus_kernel, atlas.circle_kernel, atlas.gauss_kernel, atlas.af_queue, avg.cols, avg.rows,
+			atlas.samp_to_detect_sphere);
+
+		//Store the positions relative to the first frame so that they don't change as the canvas grows
+		for (int i = 0; i < spot_pos.size(); i++)
+		{
+			spot_pos[i] += atlas.canvas.tl();
+		}
+		atlas.spot_pos = spot_pos;
+
+		atlas.map_sums = std::vector<cv::Mat>(spot_pos.size());
+		atlas.map_counts = std::vector<cv::Mat>(spot_pos.size());
+		for (int k = 0; k < spot_pos.size(); k++)
+		{
+			atlas.map_sums[k] = cv::Mat::zeros(atlas.layout.rows, atlas.layout.cols, CV_32FC1);
+			atlas.map_counts[k] = cv::Mat::zeros(atlas.layout.rows, atlas.layout.cols, CV_16UC1);
+		}
+
+		//Frames that were waiting are the first registered, so their positions are at the start
+		for (int i = 0; i < atlas.unmapped.size(); i++)
+		{
+			map_frame(atlas, atlas.unmapped[i], atlas.rel_pos[0][i], atlas.rel_pos[1][i]);
+		}
+		atlas.unmapped.clear();
+	}
+
+	/*Add a frame to an atlas. The first frames are buffered until the size of the spots can be estimated from them. Frames are
+	**then registered and added to the running average, and are added to the maps of the spots once there are enough of them
+	**to find the spots in the average
+	**Inputs:
+	**atlas: online_atlas &, Atlas to add the frame to
+	**frame: cv::Mat &, Frame from the microscope. It is the same size as the previous frames
+	*/
+	void add_online_frame(online_atlas &atlas, cv::Mat &frame)
+	{
+		BA_TIME_FUNCTION();
+
+		std::vector<cv::Mat> mats(1, frame);
+		preprocess(mats, PREPROC_MED_FILT_SIZE);
+
+		std::lock_guard<std::mutex> lock(atlas.mutex);
+
+		//The size of the arrays and the Gaussian that blurs the filters are set by the first frame
+		if (!atlas.num_frames)
+		{
+			atlas.layout = padded_layout(frame.size());
+			af::dim4 dims_af = af_dims(atlas.layout);
+
+			af::array ext_gauss = extended_gauss(atlas.layout.rows, atlas.layout.cols, 0.25*UBOUND_GAUSS_SIZE+0.75,
+				atlas.gauss_kernel, atlas.af_queue);
+			af_array gauss_fft2_af;
+			af_fft2_r2c(&gauss_fft2_af, ext_gauss.get(), 1.0f, dims_af[0], dims_af[1]);
+			atlas.gauss_fft = af::array(gauss_fft2_af);
+		}
+		atlas.num_frames++;
+
+		if (!atlas.ubound)
+		{
+			atlas.unregistered.push_back(mats[0]);
+			if (atlas.unregistered.size() >= ONLINE_WARMUP_FRAMES)
+			{
+				start_registration(atlas);
+			}
+		}
+		else
+		{
+			register_frame(atlas, mats[0]);
+		}
+
+		if (atlas.spot_pos.empty() && atlas.rel_pos[0].size() >= ONLINE_SPOT_FRAMES)
+		{
+			start_mapping(atlas);
+		}
+	}
+
+	/*Finish the parts of an atlas that are still waiting for frames, using the frames that have arrived. Frames can still be
+	**added afterwards
+	**Inputs:
+	**atlas: online_atlas &, Atlas to finish
+	**Returns:
+	**bool, True if any frames have been added, so that the atlas has spots
+	*/
+	bool finish_online_atlas(online_atlas &atlas)
+	{
+		BA_TIME_FUNCTION();
+
+		std::lock_guard<std::mutex> lock(atlas.mutex);
+
+		if (!atlas.num_frames)
+		{
+			std::cerr << "No frames were added to the atlas" << std::endl;
+			return false;
+		}
+
+		if (!atlas.ubound)
+		{
+			start_registration(atlas);
+		}
+
+		if (atlas.spot_pos.empty())
+		{
+			start_mapping(atlas);
+		}
+
+		return true;
+	}
+
+	/*Get the current average of the aligned frames
+	**Inputs:
+	**atlas: online_atlas &, Atlas to get the average of
+	**Returns:
+	**cv::Mat, 32-bit average of the registered frames. This is empty until the first frames have been registered
+	*/
+	cv::Mat online_atlas_average(online_atlas &atlas)
+	{
+		std::lock_guard<std::mutex> lock(atlas.mutex);
+
+		if (!atlas.canvas.area())
+		{
+			return cv::Mat();
+		}
+
+		return average_unlocked(atlas);
+	}
+
+	/*Get the current regions of k space surveyed by the spots
+	**Inputs:
+	**atlas: online_atlas &, Atlas to get the surveys of
+	**spot_pos: std::vector<cv::Point> &, Output positions of the spots in the current average of the aligned frames
+	**Returns:
+	**std::vector<cv::Mat>, Regions of k space surveyed by the spots. This is empty until the spots have been found
+	*/
+	std::vector<cv::Mat> online_atlas_surveys(online_atlas &atlas, std::vector<cv::Point> &spot_pos)
+	{
+		BA_TIME_FUNCTION();
+
+		std::lock_guard<std::mutex> lock(atlas.mutex);
+
+		spot_pos.clear();
+		if (atlas.spot_pos.empty())
+		{
+			return std::vector<cv::Mat>();
+		}
+
+		//The canvas starts at the negative of the maximum relative positions, so positions in the average are offset by them
+		for (int k = 0; k < atlas.spot_pos.size(); k++)
+		{
+			spot_pos.push_back(atlas.spot_pos[k] - atlas.canvas.tl());
+		}
+
+		//Normalise the maps using the number of frames contributing to each pixel
+		std::vector<cv::Mat> indv_maps(atlas.spot_pos.size());
+		parallel_for(0, atlas.spot_pos.size(), [&](int k)
+		{
+			cv::Mat counts;
+			atlas.map_counts[k].convertTo(counts, CV_32FC1);
+			cv::divide(atlas.map_sums[k], cv::max(counts, 1.0), indv_maps[k]);
+		});
+
+		//Differences between maxima and minima are how far the spots travelled
+		int cols_diff = *std::max_element(atlas.rel_pos[0].begin(), atlas.rel_pos[0].end()) -
+			*std::min_element(atlas.rel_pos[0].begin(), atlas.rel_pos[0].end());
+		int rows_diff = *std::max_element(atlas.rel_pos[1].begin(), atlas.rel_pos[1].end()) -
+			*std::min_element(atlas.rel_pos[1].begin(), atlas.rel_pos[1].end());
+
+		return crop_spot_maps(indv_maps, spot_pos, cols_diff, rows_diff, atlas.radius);
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <includes.h>
+
+#include <annulus_param.h>
+#include <circ_size_upper_bound.h>
+#include <disk_spans.h>
+#include <get_spot_positions.h>
+#include <image_buffer.h>
+#include <img_rel_pos.h>
+#include <kernel_launchers.h>
+#include <preprocessing.h>
+#include <spot_extraction.h>
+
+namespace ba
+{
+	//Number of frames to buffer before the spot size and annulus are estimated and frames start being registered
+    #define ONLINE_WARMUP_FRAMES 8
+	//Number of registered frames to average before the spot positions are found and frames start being added to the spot maps
+    #define ONLINE_SPOT_FRAMES 32
+	//Number of registered frames between updates of the running average that frames are registered against
+    #define ONLINE_REF_INTERVAL 16
+
+	//Custom data structure to hold the state of an atlas that is built as frames arrive. Each frame is preprocessed, registered
+	//against the running average and added to it and to the maps of the spots in place, so a frame is only kept until the
+	//quantities it needs are known. Positions are relative to the top left of the first frame, so they don't change as the
+	//running average grows
+	struct online_atlas_param {
+		std::mutex mutex; //Serialises adding frames and queries, so that the atlas can be queried while frames arrive
+		cl_context af_context; //ArrayFire context
+		cl_device_id af_device_id; //ArrayFire device
+		cl_command_queue af_queue; //ArrayFire command queue
+		cl_kernel gauss_kernel; //OpenCL kernel that creates extended Gaussians
+		cl_kernel annulus_kernel; //OpenCL kernel that creates annuluses
+		cl_kernel circle_kernel; //OpenCL kernel that creates circles
+		int inpainting_method; //Method to inpaint the Bragg peak regions, as for create_spot_maps
+		int num_frames; //Number of frames added
+		image_layout layout; //Layout of the padded frames. The ArrayFire arrays they are primed in have dimensions af_dims(layout)
+		af::array gauss_fft; //Fourier transform of the Gaussian that blurs the alignment filters
+		int ubound; //Upper bound on the size of the spots. This is 0 until the warm up frames have arrived
+		std::vector<int> annulus_param; //Radius and thickness of the annulus that describes the gradiation of the spots best
+		af::array annulus_fft; //Fourier transform of the annulus the frames are primed with
+		af::array circle_fft; //Fourier transform of the circle the frames are primed with
+		af::array ref_fft; //Primed Fourier transform of the running average in the region of the first frame
+		int frames_since_ref; //Number of frames registered since the reference was primed
+		std::vector<cv::Mat> unregistered; //Preprocessed frames waiting for the annulus to be estimated
+		std::vector<cv::Mat> unmapped; //Registered frames waiting for the spot positions to be found
+		std::vector<std::vector<int>> rel_pos; //Positions of the frames relative to the first. Index 0 - x, 1 - y
+		cv::Rect canvas; //Region covered by the running average
+		cv::Mat acc_sum; //Sum of the registered frames over the canvas
+		cv::Mat num_overlap; //Number of frames that contributed to each px of the sum
+		std::vector<cv::Point> spot_pos; //Positions of the spots. This is empty until they are found
+		cv::Vec2f samp_to_detect_sphere; //Estimate of the sample to detector sphere from the spot positions
+		int radius; //Radius about the spot locations to extract pixels from
+		int ns_radius; //Radius to Navier-Stokes infill when removing the diffuse background
+		std::vector<cv::Mat> map_sums; //Sums of the pixels extracted for each spot
+		std::vector<cv::Mat> map_counts; //Number of frames that contributed to each px of the sums for each spot
+	};
+	typedef online_atlas_param online_atlas;
+
+	/*Prepare an atlas to be built as frames arrive
+	**Inputs:
+	**atlas: online_atlas &, Atlas to prepare
+	**af_context: cl_context, ArrayFire context
+	**af_device_id: cl_device_id, ArrayFire device
+	**af_queue: cl_command_queue, ArrayFire command queue
+	**inpainting_method: const int, Method to inpaint the Bragg peak regions in the diffraction pattern. BACKGROUND_SPLINE to
+	**fit a spline background through the rest of the pattern instead, or -1 to leave the background
+	*/
+	void init_online_atlas(online_atlas &atlas, cl_context af_context, cl_device_id af_device_id, cl_command_queue af_queue,
+		const int inpainting_method = -1);
+
+	/*Free the OpenCL resources of an atlas built as frames arrived
+	**Inputs:
+	**atlas: online_atlas &, Atlas to free the resources of
+	*/
+	void close_online_atlas(online_atlas &atlas);
+
+	/*Add a frame to an atlas. The first frames are buffered until the size of the spots can be estimated from them. Frames are
+	**then registered and added to the running average, and are added to the maps of the spots once there are enough of them
+	**to find the spots in the average
+	**Inputs:
+	**atlas: online_atlas &, Atlas to add the frame to
+	**frame: cv::Mat &, Frame from the microscope. It is the same size as the previous frames
+	*/
+	void add_online_frame(online_atlas &atlas, cv::Mat &frame);
+
+	/*Finish the parts of an atlas that are still waiting for frames, using the frames that have arrived. Frames can still be
+	**added afterwards
+	**Inputs:
+	**atlas: online_atlas &, Atlas to finish
+	**Returns:
+	**bool, True if any frames have been added, so that the atlas has spots
+	*/
+	bool finish_online_atlas(online_atlas &atlas);
+
+	/*Get the current average of the aligned frames
+	**Inputs:
+	**atlas: online_atlas &, Atlas to get the average of
+	**Returns:
+	**cv::Mat, 32-bit average of the registered frames. This is empty until the first frames have been registered
+	*/
+	cv::Mat online_atlas_average(online_atlas &atlas);
+
+	/*Get the current regions of k space surveyed by the spots
+	**Inputs:
+	**atlas: online_atlas &, Atlas to get the surveys of
+	**spot_pos: std::vector<cv::Point> &, Output positions of the spots in the current average of the aligned frames
+	**Returns:
+	**std::vector<cv::Mat>, Regions of k space surveyed by the spots. This is empty until the spots have been found
+	*/
+	std::vector<cv::Mat> online_atlas_surveys(online_atlas &atlas, std::vector<cv::Point> &spot_pos);
+}
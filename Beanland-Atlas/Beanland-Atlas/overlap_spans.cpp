@@ -0,0 +1,271 @@
+#include <overlap_spans.h>
+
+namespace ba
+{
+	/*Get the columns of a row that are marked when a circle is rasterised. This uses the same integer arithmetic as the
+	**circle drawing loops so that the spans match the rasterised circles exactly
+	**Inputs:
+	**P: cv::Point2d, Center of the circle
+	**r: const int, Radius of the circle
+	**i: const int, Row to get the columns of
+	**cols: const int, Number of columns in the image the circle is on
+	**rows: const int, Number of rows in the image the circle is on
+	**lo: int &, Output first column marked on the row
+	**hi: int &, Output last column marked on the row
+	**Returns:
+	**bool, True if any columns on the row are marked
+	*/
+	static bool circ_row_bounds(cv::Point2d P, const int r, const int i, const int cols, const int rows, int &lo, int &hi)
+	{
+		int min_row = std::max(0, (int)(P.y-r));
+		int max_row = std::min(rows-1, (int)(P.y+r));
+		if (i < min_row || i > max_row)
+		{
+			return false;
+		}
+
+		//Row relative to the circle center, as it is incremented from the first row of the circle
+		int rel_row = (int)(min_row-P.y) + i - min_row;
+		int rad2 = r*r - rel_row*rel_row;
+		if (rad2 < 0)
+		{
+			return false;
+		}
+
+		int c = (int)std::sqrt(rad2);
+		lo = std::max(std::max(0, (int)(P.x-r)), (int)(P.x-c));
+		hi = std::min(std::min(cols-1, (int)(P.x+r)), (int)(P.x+c));
+
+		return lo <= hi;
+	}
+
+	/*Append a span to a span region, updating the region's pixel count and bounds
+	**Inputs:
+	**region: span_region &, Region to append the span to
+	**i: const int, Row of the span
+	**lo: const int, First column of the span
+	**hi: const int, Last column of the span
+	*/
+	static void append_span(span_region &region, const int i, const int lo, const int hi)
+	{
+		row_span s;
+		s.row = i;
+		s.start = lo;
+		s.end = hi+1;
+		region.spans.push_back(s);
+		region.num_px += s.end - s.start;
+
+		//Update the bounding rectangle
+		if (region.spans.size() == 1)
+		{
+			region.bounds = cv::Rect(lo, i, hi-lo+1, 1);
+		}
+		else
+		{
+			region.bounds |= cv::Rect(lo, i, hi-lo+1, 1);
+		}
+	}
+
+	/*Calculate the per-row runs of pixels where 2 circles overlap directly from the circle equations. The runs are the same
+	**as the pixels marked by rasterising each of the circles and taking their intersection
+	**Inputs:
+	**P1: cv::Point2d, Center of one of the circles
+	**r1: const int, Radius of one of the circles
+	**P2: cv::Point2d, Center of the other circle
+	**r2: const int, Radius of the other circle
+	**cols: const int, Number of columns in the image the circles are on
+	**rows: const int, Number of rows in the image the circles are on
+	**Returns:
+	**span_region, Runs of pixels in the overlapping region
+	*/
+	span_region gen_circ_overlap_spans(cv::Point2d P1, const int r1, cv::Point2d P2, const int r2, const int cols,
+		const int rows)
+	{
+		span_region region;
+		region.num_px = 0;
+		region.bounds = cv::Rect(0, 0, 0, 0);
+
+		//Only rows that both circles are on can contain overlapping pixels
+		int min_row = std::max(std::max(0, (int)(P1.y-r1)), std::max(0, (int)(P2.y-r2)));
+		int max_row = std::min(std::min(rows-1, (int)(P1.y+r1)), std::min(rows-1, (int)(P2.y+r2)));
+		region.spans.reserve(std::max(0, max_row-min_row+1));
+
+		for (int i = min_row; i <= max_row; i++)
+		{
+			//Intersect the columns marked by each circle on this row
+			int lo1, hi1, lo2, hi2;
+			if (circ_row_bounds(P1, r1, i, cols, rows, lo1, hi1) && circ_row_bounds(P2, r2, i, cols, rows, lo2, hi2))
+			{
+				int lo = std::max(lo1, lo2);
+				int hi = std::min(hi1, hi2);
+				if (lo <= hi)
+				{
+					append_span(region, i, lo, hi);
+				}
+			}
+		}
+
+		return region;
+	}
+
+	/*Calculate the per-row runs of pixels where a circle overlaps with an affinely transformed circle, within the confines
+	**of another region. The affinely transformed circle is an ellipse whose row intersections are found analytically
+	**Inputs:
+	**warp_mat: cv::Mat &, 2x3 affine warp matrix applied to the second circle
+	**region: span_region &, Region to confine the overlap to e.g. the overlap in the absence of affine transformation
+	**P1: cv::Point2d, Center of one of the circles
+	**r1: const int, Radius of one of the circles
+	**P2: cv::Point2d, Center of the circle that is affinely transformed
+	**r2: const int, Radius of the circle that is affinely transformed
+	**cols: const int, Number of columns in the image the circles are on
+	**rows: const int, Number of rows in the image the circles are on
+	**Returns:
+	**span_region, Runs of pixels in the overlapping region
+	*/
+	span_region get_affine_overlap_spans(cv::Mat &warp_mat, span_region &region, cv::Point2d P1, const int r1,
+		cv::Point2d P2, const int r2, const int cols, const int rows)
+	{
+		span_region overlap;
+		overlap.num_px = 0;
+		overlap.bounds = cv::Rect(0, 0, 0, 0);
+		overlap.spans.reserve(region.spans.size());
+
+		//Map destination points back onto the circle before it was transformed
+		cv::Mat inv_warp;
+		cv::invertAffineTransform(warp_mat, inv_warp);
+		inv_warp.convertTo(inv_warp, CV_64F);
+		double *w0 = inv_warp.ptr<double>(0);
+		double *w1 = inv_warp.ptr<double>(1);
+
+		//Shrink the transformed circle to compensate for edge effects
+		double re = std::max(0, r2 - AFFINE_OVERLAP_EDGE_ERODE);
+
+		//Coefficient of the quadratic in the column that does not depend on the row
+		double a = w0[0]*w0[0] + w1[0]*w1[0];
+
+		for (int k = 0; k < region.spans.size(); k++)
+		{
+			int i = region.spans[k].row;
+
+			//The pixels in the first circle
+			int lo, hi;
+			if (!circ_row_bounds(P1, r1, i, cols, rows, lo, hi))
+			{
+				continue;
+			}
+
+			//Solve |inv_warp*(j, i, 1) - P2|^2 <= re^2 for the columns on this row
+			double vx = w0[1]*i + w0[2] - P2.x;
+			double vy = w1[1]*i + w1[2] - P2.y;
+			double b = 2.0*(w0[0]*vx + w1[0]*vy);
+			double c = vx*vx + vy*vy - re*re;
+			double disc = b*b - 4.0*a*c;
+			if (a <= 0.0 || disc < 0.0)
+			{
+				continue;
+			}
+
+			double sqrt_disc = std::sqrt(disc);
+			lo = std::max(lo, (int)std::ceil((-b - sqrt_disc) / (2.0*a)));
+			hi = std::min(hi, (int)std::floor((-b + sqrt_disc) / (2.0*a)));
+
+			//Confine the overlap to the region
+			lo = std::max(lo, region.spans[k].start);
+			hi = std::min(hi, region.spans[k].end-1);
+			if (lo <= hi)
+			{
+				append_span(overlap, i, lo, hi);
+			}
+		}
+
+		return overlap;
+	}
+
+	/*Rasterise a span region into an 8-bit mask
+	**Inputs:
+	**region: span_region &, Region to rasterise
+	**cols: const int, Number of columns in the mask
+	**rows: const int, Number of rows in the mask
+	**offset: cv::Point, Position of the top left corner of the mask in the region's coordinates
+	**val: const byte, Value to set the region's pixels to
+	**Returns:
+	**cv::Mat, 8-bit mask where the region's pixels are marked
+	*/
+	cv::Mat span_region_to_mask(span_region &region, const int cols, const int rows, cv::Point offset, const byte val)
+	{
+		cv::Mat mask = cv::Mat(rows, cols, CV_8UC1, cv::Scalar(0));
+
+		for (int k = 0; k < region.spans.size(); k++)
+		{
+			int i = region.spans[k].row - offset.y;
+			if (i >= 0 && i < rows)
+			{
+				int lo = std::max(0, region.spans[k].start - offset.x);
+				int hi = std::min(cols, region.spans[k].end - offset.x);
+				if (lo < hi)
+				{
+					std::memset(mask.ptr<byte>(i) + lo, val, hi-lo);
+				}
+			}
+		}
+
+		return mask;
+	}
+
+	/*Calculate Pearson's product moment correlation coefficient between the pixels of 2 32-bit images in a span region
+	**Inputs:
+	**img1: cv::Mat &, One of the images
+	**offset1: cv::Point, Position of the top left corner of the first image in the region's coordinates
+	**img2: cv::Mat &, The other image
+	**offset2: cv::Point, Position of the top left corner of the second image in the region's coordinates
+	**region: span_region &, Region to calculate the correlation over
+	**Returns:
+	**double, Pearson product moment correlation coefficient between the images in the region
+	*/
+	double span_pearson_corr(cv::Mat &img1, cv::Point offset1, cv::Mat &img2, cv::Point offset2, span_region &region)
+	{
+		//Merge the moments of each run of pixels
+		corr_moments m = zero_moments();
+		for (int k = 0; k < region.spans.size(); k++)
+		{
+			int len = region.spans[k].end - region.spans[k].start;
+			float *p = img1.ptr<float>(region.spans[k].row - offset1.y) + region.spans[k].start - offset1.x;
+			float *q = img2.ptr<float>(region.spans[k].row - offset2.y) + region.spans[k].start - offset2.x;
+
+			m = merge_moments(m, span_moments(p, q, len));
+		}
+
+		return pearson_from_moments(m);
+	}
+
+	/*Calculate the ratios of 2 32-bit images' pixel values in a span region. Ratios larger than 1.0 are reciprocated
+	**Inputs:
+	**img1: cv::Mat &, One of the images
+	**offset1: cv::Point, Position of the top left corner of the first image in the region's coordinates
+	**img2: cv::Mat &, The other image
+	**offset2: cv::Point, Position of the top left corner of the second image in the region's coordinates
+	**region: span_region &, Region to calculate the ratios in
+	**ratios: cv::Mat &, Output image the size of the region's bounding rectangle containing the ratios
+	**ratios_mask: cv::Mat &, Output 8-bit mask marking the ratios pixels that are in the region
+	*/
+	void span_overlap_ratios(cv::Mat &img1, cv::Point offset1, cv::Mat &img2, cv::Point offset2, span_region &region,
+		cv::Mat &ratios, cv::Mat &ratios_mask)
+	{
+		ratios = cv::Mat(region.bounds.size(), CV_32FC1, cv::Scalar(0.0));
+		ratios_mask = span_region_to_mask(region, region.bounds.width, region.bounds.height, region.bounds.tl());
+
+		for (int k = 0; k < region.spans.size(); k++)
+		{
+			int len = region.spans[k].end - region.spans[k].start;
+			float *p = img1.ptr<float>(region.spans[k].row - offset1.y) + region.spans[k].start - offset1.x;
+			float *q = img2.ptr<float>(region.spans[k].row - offset2.y) + region.spans[k].start - offset2.x;
+			float *r = ratios.ptr<float>(region.spans[k].row - region.bounds.y) + region.spans[k].start - region.bounds.x;
+
+			#pragma omp simd
+			for (int j = 0; j < len; j++)
+			{
+				r[j] = p[j] > q[j] ? q[j] / p[j] : p[j] / q[j];
+			}
+		}
+	}
+}
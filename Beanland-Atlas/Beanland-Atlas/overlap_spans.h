@@ -0,0 +1,98 @@
+#pragma once
+
+#include <includes.h>
+
+#include <corr_moments.h>
+
+namespace ba
+{
+	//Number of pixels to shrink the radius of an affinely transformed circle by to compensate for edge effects. This
+	//replaces the single erosion that was applied to rasterised affine overlap masks
+    #define AFFINE_OVERLAP_EDGE_ERODE 1
+
+	//Custom data structure to hold a run of pixels on a single row of a region
+	struct row_span_param {
+		int row; //Row of the run
+		int start; //First column of the run
+		int end; //One past the last column of the run
+	};
+	typedef row_span_param row_span;
+
+	//Custom data structure to hold a region as per-row runs of pixels so that it can be iterated over without a mask
+	struct span_region_param {
+		std::vector<row_span> spans; //Runs of pixels in the region, ordered by row
+		int num_px; //Number of pixels in the region
+		cv::Rect bounds; //Rectangle bounding the region
+	};
+	typedef span_region_param span_region;
+
+	/*Calculate the per-row runs of pixels where 2 circles overlap directly from the circle equations. The runs are the same
+	**as the pixels marked by rasterising each of the circles and taking their intersection
+	**Inputs:
+	**P1: cv::Point2d, Center of one of the circles
+	**r1: const int, Radius of one of the circles
+	**P2: cv::Point2d, Center of the other circle
+	**r2: const int, Radius of the other circle
+	**cols: const int, Number of columns in the image the circles are on
+	**rows: const int, Number of rows in the image the circles are on
+	**Returns:
+	**span_region, Runs of pixels in the overlapping region
+	*/
+	span_region gen_circ_overlap_spans(cv::Point2d P1, const int r1, cv::Point2d P2, const int r2, const int cols,
+		const int rows);
+
+	/*Calculate the per-row runs of pixels where a circle overlaps with an affinely transformed circle, within the confines
+	**of another region. The affinely transformed circle is an ellipse whose row intersections are found analytically
+	**Inputs:
+	**warp_mat: cv::Mat &, 2x3 affine warp matrix applied to the second circle
+	**region: span_region &, Region to confine the overlap to e.g. the overlap in the absence of affine transformation
+	**P1: cv::Point2d, Center of one of the circles
+	**r1: const int, Radius of one of the circles
+	**P2: cv::Point2d, Center of the circle that is affinely transformed
+	**r2: const int, Radius of the circle that is affinely transformed
+	**cols: const int, Number of columns in the image the circles are on
+	**rows: const int, Number of rows in the image the circles are on
+	**Returns:
+	**span_region, Runs of pixels in the overlapping region
+	*/
+	span_region get_affine_overlap_spans(cv::Mat &warp_mat, span_region &region, cv::Point2d P1, const int r1,
+		cv::Point2d P2, const int r2, const int cols, const int rows);
+
+	/*Rasterise a span region into an 8-bit mask
+	**Inputs:
+	**region: span_region &, Region to rasterise
+	**cols: const int, Number of columns in the mask
+	**rows: const int, Number of rows in the mask
+	**offset: cv::Point, Position of the top left corner of the mask in the region's coordinates
+	**val: const byte, Value to set the region's pixels to
+	**Returns:
+	**cv::Mat, 8-bit mask where the region's pixels are marked
+	*/
+	cv::Mat span_region_to_mask(span_region &region, const int cols, const int rows, cv::Point offset = cv::Point(0, 0),
+		const byte val = 1);
+
+	/*Calculate Pearson's product moment correlation coefficient between the pixels of 2 32-bit images in a span region
+	**Inputs:
+	**img1: cv::Mat &, One of the images
+	**offset1: cv::Point, Position of the top left corner of the first image in the region's coordinates
+	**img2: cv::Mat &, The other image
+	**offset2: cv::Point, Position of the top left corner of the second image in the region's coordinates
+	**region: span_region &, Region to calculate the correlation over
+	**Returns:
+	**double, Pearson product moment correlation coefficient between the images in the region
+	*/
+	double span_pearson_corr(cv::Mat &img1, cv::Point offset1, cv::Mat &img2, cv::Point offset2, span_region &region);
+
+	/*Calculate the ratios of 2 32-bit images' pixel values in a span region. Ratios larger than 1.0 are reciprocated
+	**Inputs:
+	**img1: cv::Mat &, One of the images
+	**offset1: cv::Point, Position of the top left corner of the first image in the region's coordinates
+	**img2: cv::Mat &, The other image
+	**offset2: cv::Point, Position of the top left corner of the second image in the region's coordinates
+	**region: span_region &, Region to calculate the ratios in
+	**ratios: cv::Mat &, Output image the size of the region's bounding rectangle containing the ratios
+	**ratios_mask: cv::Mat &, Output 8-bit mask marking the ratios pixels that are in the region
+	*/
+	void span_overlap_ratios(cv::Mat &img1, cv::Point offset1, cv::Mat &img2, cv::Point offset2, span_region &region,
+		cv::Mat &ratios, cv::Mat &ratios_mask);
+}
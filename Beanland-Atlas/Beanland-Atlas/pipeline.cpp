@@ -0,0 +1,522 @@
+#include <pipeline.h>
+
+namespace ba
+{
+	//Identifies checkpoint files
+	static const char checkpoint_magic[4] = { 'B', 'A', 'C', 'P' };
+
+	/*Mix bytes into a hash. Data is consumed 8 bytes at a time so that large stacks hash quickly
+	**Inputs:
+	**data: const void *, Bytes to mix in
+	**bytes: const size_t, Number of bytes
+	**h: uint64_t, Hash to mix the bytes into
+	**Returns:
+	**uint64_t, Updated hash
+	*/
+	static uint64_t hash_bytes(const void *data, const size_t bytes, uint64_t h)
+	{
+		const unsigned char *p = static_cast<const unsigned char *>(data);
+
+		size_t words = bytes / 8;
+		for (size_t i = 0; i < words; i++)
+		{
+			uint64_t w;
+			std::memcpy(&w, p + 8*i, 8);
+			h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+			h ^= h >> 32;
+		}
+
+		for (size_t i = 8*words; i < bytes; i++)
+		{
+			h = (h ^ p[i]) * 0x100000001B3ULL;
+		}
+
+		return h;
+	}
+
+	/*Hash the contents of a value so that stages can tell if their inputs have changed
+	**Inputs:
+	**value: std::vector<cv::Mat> &, Value to hash
+	**Returns:
+	**uint64_t, Hash of the sizes, types and elements of the mats
+	*/
+	uint64_t hash_value(std::vector<cv::Mat> &value)
+	{
+		uint64_t h = 0xCBF29CE484222325ULL;
+		for (int i = 0; i < value.size(); i++)
+		{
+			int header[3] = { value[i].rows, value[i].cols, value[i].type() };
+			h = hash_bytes(header, sizeof(header), h);
+
+			size_t row_bytes = value[i].cols*value[i].elemSize();
+			for (int y = 0; y < value[i].rows; y++)
+			{
+				h = hash_bytes(value[i].ptr(y), row_bytes, h);
+			}
+		}
+
+		return h;
+	}
+
+	/*Save values and their hashes to a checkpoint. The file is written under a temporary name and renamed when it is complete 
+	**so that a crash can't leave a partial checkpoint
+	**Inputs:
+	**path: const std::string &, Checkpoint file
+	**values: stage_values &, Values to save
+	**hashes: std::map<std::string, uint64_t> &, Content hashes of the values
+	**Returns:
+	**bool, True if the checkpoint was saved
+	*/
+	static bool save_checkpoint(const std::string &path, stage_values &values, std::map<std::string, uint64_t> &hashes)
+	{
+		std::string tmp_path = path + ".tmp";
+		{
+			std::ofstream out(tmp_path.c_str(), std::ios::binary);
+
+			//Header lists the values and their hashes so that they can be read without loading the data
+			uint32_t header[2] = { CHECKPOINT_VERSION, (uint32_t)values.size() };
+			out.write(checkpoint_magic, sizeof(checkpoint_magic));
+			out.write(reinterpret_cast<const char *>(header), sizeof(header));
+			for (stage_values::iterator it = values.begin(); it != values.end(); it++)
+			{
+				uint32_t len = (uint32_t)it->first.size();
+				uint64_t h = hashes[it->first];
+				out.write(reinterpret_cast<const char *>(&len), sizeof(len));
+				out.write(it->first.data(), len);
+				out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+			}
+
+			//Data
+			for (stage_values::iterator it = values.begin(); it != values.end(); it++)
+			{
+				uint32_t num_mats = (uint32_t)it->second.size();
+				out.write(reinterpret_cast<const char *>(&num_mats), sizeof(num_mats));
+				for (int i = 0; i < num_mats; i++)
+				{
+					cv::Mat &mat = it->second[i];
+					int32_t mat_header[3] = { mat.rows, mat.cols, mat.type() };
+					out.write(reinterpret_cast<const char *>(mat_header), sizeof(mat_header));
+
+					size_t row_bytes = mat.cols*mat.elemSize();
+					for (int y = 0; y < mat.rows; y++)
+					{
+						out.write(reinterpret_cast<const char *>(mat.ptr(y)), row_bytes);
+					}
+				}
+			}
+
+			if (!out)
+			{
+				std::cerr << "Failed to save checkpoint " << path << std::endl;
+				return false;
+			}
+		}
+
+		std::remove(path.c_str());
+		return !std::rename(tmp_path.c_str(), path.c_str());
+	}
+
+	/*Read the names and hashes of the values in a checkpoint
+	**Inputs:
+	**in: std::ifstream &, Checkpoint file. It is left at the start of the data
+	**hashes: std::map<std::string, uint64_t> &, Output content hashes of the values
+	**names: std::vector<std::string> &, Output names of the values, in the order their data is stored
+	**Returns:
+	**bool, True if the file is a checkpoint with the current version
+	*/
+	static bool read_checkpoint_header(std::ifstream &in, std::map<std::string, uint64_t> &hashes, 
+		std::vector<std::string> &names)
+	{
+		char magic[4];
+		uint32_t header[2];
+		in.read(magic, sizeof(magic));
+		in.read(reinterpret_cast<char *>(header), sizeof(header));
+		if (!in || std::memcmp(magic, checkpoint_magic, sizeof(magic)) || header[0] != CHECKPOINT_VERSION)
+		{
+			return false;
+		}
+
+		names.resize(header[1]);
+		for (int i = 0; i < names.size(); i++)
+		{
+			uint32_t len;
+			uint64_t h;
+			in.read(reinterpret_cast<char *>(&len), sizeof(len));
+			names[i].resize(len);
+			in.read(&names[i][0], len);
+			in.read(reinterpret_cast<char *>(&h), sizeof(h));
+			hashes[names[i]] = h;
+		}
+
+		return (bool)in;
+	}
+
+	/*Load the values in a checkpoint
+	**Inputs:
+	**path: const std::string &, Checkpoint file
+	**values: stage_values &, Values to add the loaded values to
+	**Returns:
+	**bool, True if the checkpoint was loaded
+	*/
+	static bool load_checkpoint(const std::string &path, stage_values &values)
+	{
+		std::ifstream in(path.c_str(), std::ios::binary);
+		std::map<std::string, uint64_t> hashes;
+		std::vector<std::string> names;
+		if (!read_checkpoint_header(in, hashes, names))
+		{
+			return false;
+		}
+
+		for (int i = 0; i < names.size(); i++)
+		{
+			uint32_t num_mats;
+			in.read(reinterpret_cast<char *>(&num_mats), sizeof(num_mats));
+			if (!in)
+			{
+				return false;
+			}
+
+			std::vector<cv::Mat> value(num_mats);
+			for (int j = 0; j < num_mats; j++)
+			{
+				int32_t mat_header[3];
+				in.read(reinterpret_cast<char *>(mat_header), sizeof(mat_header));
+				if (!in)
+				{
+					return false;
+				}
+
+				value[j] = cv::Mat(mat_header[0], mat_header[1], mat_header[2]);
+				in.read(reinterpret_cast<char *>(value[j].data), value[j].total()*value[j].elemSize());
+			}
+
+			values[names[i]] = value;
+		}
+
+		return (bool)in;
+	}
+
+	/*Add a value that isn't produced by a stage e.g. the input data
+	**Inputs:
+	**p: pipeline &, Pipeline to add the value to
+	**name: const std::string &, Name of the value
+	**value: std::vector<cv::Mat> &, Value
+	*/
+	void set_pipeline_value(pipeline &p, const std::string &name, std::vector<cv::Mat> &value)
+	{
+		p.values[name] = value;
+		p.hashes[name] = hash_value(value);
+		p.unloaded.erase(name);
+	}
+
+	/*Load a value from its checkpoint if it hasn't been loaded yet. A checkpoint that can't be loaded is treated as a cache miss:
+	**it is deleted and the values it held are forgotten, so that the stage that saved it runs again
+	**Inputs:
+	**p: pipeline &, Pipeline containing the value
+	**name: const std::string &, Name of the value
+	**Returns:
+	**bool, True if the value is available
+	*/
+	static bool load_pipeline_value(pipeline &p, const std::string &name)
+	{
+		std::map<std::string, std::string>::iterator it = p.unloaded.find(name);
+		if (it == p.unloaded.end())
+		{
+			return p.hashes.count(name) > 0;
+		}
+
+		std::string path = it->second;
+		bool loaded = load_checkpoint(path, p.values);
+		if (!loaded)
+		{
+			std::cerr << "Failed to load checkpoint " << path << ", its stage will run again" << std::endl;
+			std::remove(path.c_str());
+		}
+
+		//Every value in the checkpoint is loaded or forgotten together
+		for (std::map<std::string, std::string>::iterator u = p.unloaded.begin(); u != p.unloaded.end();)
+		{
+			if (u->second != path)
+			{
+				++u;
+				continue;
+			}
+
+			if (!loaded)
+			{
+				p.values.erase(u->first);
+				p.hashes.erase(u->first);
+			}
+			u = p.unloaded.erase(u);
+		}
+
+		return loaded;
+	}
+
+	/*Get a value, loading it from its checkpoint if it hasn't been loaded yet. If the checkpoint can't be loaded, the pipeline
+	**is run again to recalculate it
+	**Inputs:
+	**p: pipeline &, Pipeline containing the value
+	**name: const std::string &, Name of the value
+	**Returns:
+	**std::vector<cv::Mat> &, Value. It is empty if the value isn't available
+	*/
+	std::vector<cv::Mat> &get_pipeline_value(pipeline &p, const std::string &name)
+	{
+		bool unloaded = p.unloaded.count(name) > 0;
+		if (!load_pipeline_value(p, name) && unloaded)
+		{
+			run_pipeline(p);
+		}
+
+		return p.values[name];
+	}
+
+	/*Mark done stages as not done if any of their inputs or outputs are no longer available e.g. because a checkpoint couldn't
+	**be loaded. Their outputs are forgotten, so the stages that depend on them are marked too. The stages are checked against
+	**their checkpoints again once they are ready, so stages whose inputs are recalculated unchanged don't run again
+	**Inputs:
+	**p: pipeline &, Pipeline containing the stages
+	**done: std::vector<bool> &, Whether each stage is done. Stages are marked as not done in place
+	**Returns:
+	**int, Number of stages marked as not done
+	*/
+	static int reset_unavailable_stages(pipeline &p, std::vector<bool> &done)
+	{
+		int num_reset = 0;
+		for (bool changed = true; changed;)
+		{
+			changed = false;
+			for (int s = 0; s < p.stages.size(); s++)
+			{
+				pipeline_stage &stage = p.stages[s];
+				bool available = true;
+				for (int i = 0; i < stage.inputs.size() && available; i++)
+				{
+					available = p.hashes.count(stage.inputs[i]) > 0;
+				}
+				for (int i = 0; i < stage.outputs.size() && available; i++)
+				{
+					available = p.hashes.count(stage.outputs[i]) > 0;
+				}
+				if (!done[s] || available)
+				{
+					continue;
+				}
+
+				for (int i = 0; i < stage.outputs.size(); i++)
+				{
+					p.values.erase(stage.outputs[i]);
+					p.hashes.erase(stage.outputs[i]);
+					p.unloaded.erase(stage.outputs[i]);
+				}
+				done[s] = false;
+				num_reset++;
+				changed = true;
+			}
+		}
+
+		return num_reset;
+	}
+
+	/*Run the stages of a pipeline once their inputs are available. Stages whose checkpoints match their inputs and parameters
+	**are skipped and their outputs are only loaded if a stage that runs needs them. Stages whose inputs become available at
+	**the same time run concurrently. If a stage fails, the stages that completed keep their checkpoints so that running the
+	**pipeline again resumes from where it failed
+	**Inputs:
+	**p: pipeline &, Pipeline to run
+	**Returns:
+	**bool, True if every stage completed
+	*/
+	bool run_pipeline(pipeline &p)
+	{
+		std::vector<bool> done(p.stages.size(), false);
+		for (int num_done = 0; num_done < p.stages.size();)
+		{
+			//Stages whose inputs are all available either have a matching checkpoint or need to run
+			std::vector<int> to_run;
+			std::vector<std::string> paths(p.stages.size());
+			for (int s = 0; s < p.stages.size(); s++)
+			{
+				pipeline_stage &stage = p.stages[s];
+
+				bool ready = !done[s];
+				for (int i = 0; i < stage.inputs.size() && ready; i++)
+				{
+					ready = p.hashes.count(stage.inputs[i]) > 0;
+				}
+				if (!ready)
+				{
+					continue;
+				}
+
+				//Checkpoints are identified by the stage, its version, its parameters and the contents of its inputs
+				uint64_t key = hash_bytes(stage.name.data(), stage.name.size(), 0xCBF29CE484222325ULL);
+				key = hash_bytes(&stage.version, sizeof(stage.version), key);
+				key = hash_bytes(stage.params.data(), stage.params.size(), key);
+				for (int i = 0; i < stage.inputs.size(); i++)
+				{
+					key = hash_bytes(&p.hashes[stage.inputs[i]], sizeof(uint64_t), key);
+				}
+
+				char key_hex[17];
+				std::snprintf(key_hex, sizeof(key_hex), "%016llx", (unsigned long long)key);
+				paths[s] = p.checkpoint_prefix + stage.name + "_" + key_hex + ".bin";
+
+				if (stage.checkpoint)
+				{
+					std::ifstream in(paths[s].c_str(), std::ios::binary);
+					std::map<std::string, uint64_t> hashes;
+					std::vector<std::string> names;
+					bool complete = in && read_checkpoint_header(in, hashes, names);
+					for (int i = 0; i < stage.outputs.size() && complete; i++)
+					{
+						complete = hashes.count(stage.outputs[i]) > 0;
+					}
+
+					if (complete)
+					{
+						for (int i = 0; i < stage.outputs.size(); i++)
+						{
+							p.hashes[stage.outputs[i]] = hashes[stage.outputs[i]];
+							p.unloaded[stage.outputs[i]] = paths[s];
+							p.values.erase(stage.outputs[i]);
+						}
+
+						std::cout << "Stage " << stage.name << ": using checkpoint" << std::endl;
+						done[s] = true;
+						num_done++;
+						continue;
+					}
+				}
+
+				to_run.push_back(s);
+			}
+
+			if (to_run.empty())
+			{
+				//Checkpoints may have made more stages ready
+				bool any_ready = false;
+				for (int s = 0; s < p.stages.size() && !any_ready; s++)
+				{
+					bool ready = !done[s];
+					for (int i = 0; i < p.stages[s].inputs.size() && ready; i++)
+					{
+						ready = p.hashes.count(p.stages[s].inputs[i]) > 0;
+					}
+					any_ready = ready;
+				}
+
+				if (any_ready)
+				{
+					continue;
+				}
+				if (num_done < p.stages.size())
+				{
+					std::cerr << "Pipeline stages are waiting for values that no stage produces" << std::endl;
+					return false;
+				}
+				break;
+			}
+
+			//Gather the inputs before the stages run so that checkpoints are only loaded by one thread
+			bool all_loaded = true;
+			std::vector<stage_values> ins(to_run.size()), outs(to_run.size());
+			for (int k = 0; k < to_run.size(); k++)
+			{
+				pipeline_stage &stage = p.stages[to_run[k]];
+				for (int i = 0; i < stage.inputs.size(); i++)
+				{
+					if (!load_pipeline_value(p, stage.inputs[i]))
+					{
+						all_loaded = false;
+						continue;
+					}
+					ins[k][stage.inputs[i]] = p.values[stage.inputs[i]];
+				}
+			}
+
+			//If a checkpoint couldn't be loaded, the stage that saved it runs again before the stages that need its outputs
+			if (!all_loaded)
+			{
+				num_done -= reset_unavailable_stages(p, done);
+				continue;
+			}
+
+			//Run the stages, saving the outputs of each as soon as it completes
+			std::vector<int> failed(to_run.size(), 0);
+			std::vector<double> run_ms(to_run.size(), 0.0);
+			std::vector<std::map<std::string, uint64_t>> out_hashes(to_run.size());
+			std::mutex log_mutex;
+			parallel_for(0, (int)to_run.size(), [&](int k)
+			{
+				pipeline_stage &stage = p.stages[to_run[k]];
+				try
+				{
+					BA_TIME_STAGE(stage.name.c_str());
+					int64 start = cv::getTickCount();
+					stage.run(ins[k], outs[k]);
+					run_ms[k] = 1e3*(cv::getTickCount() - start) / cv::getTickFrequency();
+				}
+				catch (std::exception &e)
+				{
+					std::lock_guard<std::mutex> lock(log_mutex);
+					std::cerr << "Stage " << stage.name << " failed: " << e.what() << std::endl;
+					failed[k] = 1;
+					return;
+				}
+
+				for (int i = 0; i < stage.outputs.size(); i++)
+				{
+					if (!outs[k].count(stage.outputs[i]))
+					{
+						std::lock_guard<std::mutex> lock(log_mutex);
+						std::cerr << "Stage " << stage.name << " didn't produce " << stage.outputs[i] << std::endl;
+						failed[k] = 1;
+					}
+					else
+					{
+						out_hashes[k][stage.outputs[i]] = hash_value(outs[k][stage.outputs[i]]);
+					}
+				}
+
+				if (!failed[k] && stage.checkpoint)
+				{
+					save_checkpoint(paths[to_run[k]], outs[k], out_hashes[k]);
+				}
+			}, 1);
+
+			//Publish the outputs of the stages that completed
+			bool any_failed = false;
+			for (int k = 0; k < to_run.size(); k++)
+			{
+				if (failed[k])
+				{
+					any_failed = true;
+					continue;
+				}
+
+				pipeline_stage &stage = p.stages[to_run[k]];
+				for (int i = 0; i < stage.outputs.size(); i++)
+				{
+					p.values[stage.outputs[i]] = outs[k][stage.outputs[i]];
+					p.hashes[stage.outputs[i]] = out_hashes[k][stage.outputs[i]];
+					p.unloaded.erase(stage.outputs[i]);
+				}
+
+				p.stage_ms[stage.name] = run_ms[k];
+				std::cout << "Stage " << stage.name << ": completed" << std::endl;
+				done[to_run[k]] = true;
+				num_done++;
+			}
+
+			if (any_failed)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
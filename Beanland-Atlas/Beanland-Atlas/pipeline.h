@@ -0,0 +1,107 @@
+#pragma once
+
+#include <includes.h>
+
+#include <task_scheduler.h>
+
+namespace ba
+{
+	//Version of the checkpoint file format. Checkpoints written by other versions are not used
+    #define CHECKPOINT_VERSION 1
+
+	//Values passed between pipeline stages. Every value is a list of mats so that they can all be hashed and checkpointed the
+	//same way
+	typedef std::map<std::string, std::vector<cv::Mat>> stage_values;
+
+	//Custom data structure to hold a stage of a pipeline
+	struct pipeline_stage_param {
+		std::string name; //Unique name of the stage. It is part of the names of its checkpoint files
+		std::vector<std::string> inputs; //Names of the values the stage reads. It must not modify them
+		std::vector<std::string> outputs; //Names of the values the stage writes
+		std::string params; //Values of the parameters that affect the outputs, other than the inputs
+		int version; //Version of the stage's calculation. Increase it when the outputs change for the same inputs and parameters
+		bool checkpoint; //If true, outputs are saved and reused by later runs with the same inputs and parameters
+		std::function<void(stage_values &in, stage_values &out)> run; //Calculate the outputs from the inputs
+	};
+	typedef pipeline_stage_param pipeline_stage;
+
+	//Custom data structure to hold the stages of a pipeline and the values they produce
+	struct pipeline_param {
+		std::vector<pipeline_stage> stages;
+		std::string checkpoint_prefix; //Checkpoint files start with this. It can include the path of an existing directory
+		stage_values values; //Values that have been calculated or loaded from checkpoints
+		std::map<std::string, uint64_t> hashes; //Content hashes of all available values, including ones that haven't been loaded
+		std::map<std::string, std::string> unloaded; //Checkpoint files of values that haven't been loaded yet
+		std::map<std::string, double> stage_ms; //Wall time in ms of each stage that ran, rather than using its checkpoint
+	};
+	typedef pipeline_param pipeline;
+
+	/*Pack a vector of plain data into a mat so that it can be passed between pipeline stages
+	**Inputs:
+	**vals: const std::vector<T> &, Values to pack
+	**Returns:
+	**cv::Mat, 8-bit row containing the bytes of the values
+	*/
+	template<typename T> cv::Mat pack_values(const std::vector<T> &vals)
+	{
+		cv::Mat packed(1, (int)(vals.size()*sizeof(T)), CV_8UC1);
+		if (!vals.empty())
+		{
+			std::memcpy(packed.data, vals.data(), vals.size()*sizeof(T));
+		}
+		return packed;
+	}
+
+	/*Unpack a vector of plain data from a mat packed by pack_values
+	**Inputs:
+	**packed: const cv::Mat &, Packed values
+	**Returns:
+	**std::vector<T>, Unpacked values
+	*/
+	template<typename T> std::vector<T> unpack_values(const cv::Mat &packed)
+	{
+		std::vector<T> vals(packed.total()*packed.elemSize() / sizeof(T));
+		if (!vals.empty())
+		{
+			std::memcpy(vals.data(), packed.data, vals.size()*sizeof(T));
+		}
+		return vals;
+	}
+
+	/*Hash the contents of a value so that stages can tell if their inputs have changed
+	**Inputs:
+	**value: std::vector<cv::Mat> &, Value to hash
+	**Returns:
+	**uint64_t, Hash of the sizes, types and elements of the mats
+	*/
+	uint64_t hash_value(std::vector<cv::Mat> &value);
+
+	/*Add a value that isn't produced by a stage e.g. the input data
+	**Inputs:
+	**p: pipeline &, Pipeline to add the value to
+	**name: const std::string &, Name of the value
+	**value: std::vector<cv::Mat> &, Value
+	*/
+	void set_pipeline_value(pipeline &p, const std::string &name, std::vector<cv::Mat> &value);
+
+	/*Get a value, loading it from its checkpoint if it hasn't been loaded yet. If the checkpoint can't be loaded, the pipeline
+	**is run again to recalculate it
+	**Inputs:
+	**p: pipeline &, Pipeline containing the value
+	**name: const std::string &, Name of the value
+	**Returns:
+	**std::vector<cv::Mat> &, Value. It is empty if the value isn't available
+	*/
+	std::vector<cv::Mat> &get_pipeline_value(pipeline &p, const std::string &name);
+
+	/*Run the stages of a pipeline once their inputs are available. Stages whose checkpoints match their inputs and parameters
+	**are skipped and their outputs are only loaded if a stage that runs needs them. Stages whose inputs become available at
+	**the same time run concurrently. If a stage fails, the stages that completed keep their checkpoints so that running the
+	**pipeline again resumes from where it failed
+	**Inputs:
+	**p: pipeline &, Pipeline to run
+	**Returns:
+	**bool, True if every stage completed
+	*/
+	bool run_pipeline(pipeline &p);
+}
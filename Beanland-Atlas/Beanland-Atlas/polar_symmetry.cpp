@@ -0,0 +1,315 @@
+#include <polar_symmetry.h>
+
+namespace ba
+{
+	/*Create a plan to resample images onto polar grids and correlate them along the angular direction
+	**Inputs:
+	**num_theta: const int, Number of angles to sample the polar grid at
+	**Returns:
+	**polar_plan, Plan that can be shared between threads. Its transforms are owned by the FFT plan cache
+	*/
+	polar_plan create_polar_plan(const int num_theta)
+	{
+		polar_plan plan;
+		plan.num_theta = num_theta;
+
+		//Tabulate the angles of the polar grid
+		plan.cos_theta.resize(num_theta);
+		plan.sin_theta.resize(num_theta);
+		for (int k = 0; k < num_theta; k++)
+		{
+			plan.cos_theta[k] = std::cos(2*PI*k/num_theta);
+			plan.sin_theta[k] = std::sin(2*PI*k/num_theta);
+		}
+
+		//Transforms are executed on aligned buffers from the pool, which is thread-safe
+		plan.r2c = get_fft_plan(FFT_R2C, 1, num_theta);
+		plan.c2r = get_fft_plan(FFT_C2R, 1, num_theta);
+
+		return plan;
+	}
+
+	/*Resample an image onto a polar grid around an origin using bilinear interpolation. The grid extends to the image corner
+	**furthest from the origin, with 1 px radial spacing
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to resample
+	**origin: cv::Point2f, Position of the origin in the image
+	**plan: polar_plan &, Plan containing the angles to sample at
+	**Returns:
+	**polar_img, Image resampled onto the polar grid
+	*/
+	polar_img polar_resample(cv::Mat &img, cv::Point2f origin, polar_plan &plan)
+	{
+		polar_img polar;
+		polar.origin = origin;
+
+		//Extend the grid to the furthest corner of the image
+		float dx = std::max(origin.x, img.cols-1-origin.x);
+		float dy = std::max(origin.y, img.rows-1-origin.y);
+		int num_radii = std::max(1, (int)std::ceil(std::sqrt(dx*dx + dy*dy)));
+
+		//Positions of the polar grid points in the image
+		cv::Mat map_x = cv::Mat(num_radii, plan.num_theta, CV_32FC1);
+		cv::Mat map_y = cv::Mat(num_radii, plan.num_theta, CV_32FC1);
+		polar.mask = cv::Mat(num_radii, plan.num_theta, CV_32FC1);
+		for (int i = 0; i < num_radii; i++)
+		{
+			float *p = map_x.ptr<float>(i);
+			float *q = map_y.ptr<float>(i);
+			float *m = polar.mask.ptr<float>(i);
+			float rad = (float)(i+1);
+			for (int k = 0; k < plan.num_theta; k++)
+			{
+				p[k] = origin.x + rad*plan.cos_theta[k];
+				q[k] = origin.y + rad*plan.sin_theta[k];
+				m[k] = p[k] >= 0.0f && p[k] <= img.cols-1 && q[k] >= 0.0f && q[k] <= img.rows-1 ? 1.0f : 0.0f;
+			}
+		}
+
+		cv::remap(img, polar.vals, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0.0));
+
+		return polar;
+	}
+
+	/*Inverse transform an accumulated spectrum into the circular correlations it represents
+	**Inputs:
+	**plan: polar_plan &, Plan containing the inverse transform
+	**spectrum: std::vector<std::complex<double>> &, Accumulated spectrum
+	**buf: fftw_complex *, Aligned buffer the size of the spectrum that the transform can overwrite
+	**corr: double *, Aligned output correlations
+	*/
+	static void inverse_ring(polar_plan &plan, std::vector<std::complex<double>> &spectrum, fftw_complex *buf, double *corr)
+	{
+		std::memcpy(buf, spectrum.data(), spectrum.size()*sizeof(fftw_complex));
+		fftw_execute_dft_c2r(plan.c2r, buf, corr);
+
+		double inv_num_theta = 1.0 / plan.num_theta;
+		for (int k = 0; k < plan.num_theta; k++)
+		{
+			corr[k] *= inv_num_theta;
+		}
+	}
+
+	/*Calculate Pearson's product moment correlation coefficients between a polar resampled image and its reflections and
+	**rotations about its origin. The correlations for all angles are circular correlations along each ring of the polar grid,
+	**which are calculated in the Fourier domain. Rings are weighted by their radii so that image pixels contribute equally
+	**Inputs:
+	**polar: polar_img &, Polar resampled image
+	**plan: polar_plan &, Plan the image was resampled with
+	**mirror: const bool, If true, calculate the coefficients for mirror lines
+	**rotation: const bool, If true, calculate the coefficients for rotations
+	**Returns:
+	**polar_corr, Pearson product moment correlation coefficients for the requested symmetries
+	*/
+	polar_corr polar_sym_corr(polar_img &polar, polar_plan &plan, const bool mirror, const bool rotation)
+	{
+		const int N = plan.num_theta;
+		const int num_freq = N/2+1;
+
+		//Aligned buffers for the transforms
+		const size_t real_bytes = N*sizeof(double);
+		const size_t spectrum_bytes = num_freq*sizeof(fftw_complex);
+		double *ring = (double*)fft_buffer_acquire(real_bytes);
+		fftw_complex *W = (fftw_complex*)fft_buffer_acquire(spectrum_bytes);
+		fftw_complex *G = (fftw_complex*)fft_buffer_acquire(spectrum_bytes);
+		fftw_complex *Q = (fftw_complex*)fft_buffer_acquire(spectrum_bytes);
+		std::complex<double> *w_f = reinterpret_cast<std::complex<double>*>(W);
+		std::complex<double> *g_f = reinterpret_cast<std::complex<double>*>(G);
+		std::complex<double> *q_f = reinterpret_cast<std::complex<double>*>(Q);
+
+		//Spectra of the pixel counts, sums, sums of products and sums of squares for every angle. The transforms are linear
+		//so each ring's contribution is accumulated in the Fourier domain and only inverted once
+		std::vector<std::complex<double>> mir_n(num_freq), mir_x(num_freq), mir_xy(num_freq), mir_x2(num_freq);
+		std::vector<std::complex<double>> rot_n(num_freq), rot_x(num_freq), rot_xy(num_freq), rot_x2(num_freq);
+
+		for (int i = 0; i < polar.vals.rows; i++)
+		{
+			float *v = polar.vals.ptr<float>(i);
+			float *m = polar.mask.ptr<float>(i);
+			double weight = i+1;
+
+			//Transform the mask, the masked values and their squares
+			for (int k = 0; k < N; k++)
+			{
+				ring[k] = m[k];
+			}
+			fftw_execute_dft_r2c(plan.r2c, ring, W);
+
+			for (int k = 0; k < N; k++)
+			{
+				ring[k] = m[k]*v[k];
+			}
+			fftw_execute_dft_r2c(plan.r2c, ring, G);
+
+			for (int k = 0; k < N; k++)
+			{
+				ring[k] *= ring[k];
+			}
+			fftw_execute_dft_r2c(plan.r2c, ring, Q);
+
+			//Reflection maps angle k to j-k, so mirror lines are circular convolutions
+			if (mirror)
+			{
+				for (int k = 0; k < num_freq; k++)
+				{
+					mir_n[k] += weight * w_f[k]*w_f[k];
+					mir_x[k] += weight * g_f[k]*w_f[k];
+					mir_xy[k] += weight * g_f[k]*g_f[k];
+					mir_x2[k] += weight * q_f[k]*w_f[k];
+				}
+			}
+
+			//Rotation maps angle k to k+j, so rotations are circular correlations
+			if (rotation)
+			{
+				for (int k = 0; k < num_freq; k++)
+				{
+					rot_n[k] += weight * std::norm(w_f[k]);
+					rot_x[k] += weight * std::conj(g_f[k])*w_f[k];
+					rot_xy[k] += weight * std::norm(g_f[k]);
+					rot_x2[k] += weight * std::conj(q_f[k])*w_f[k];
+				}
+			}
+		}
+
+		//Aligned outputs of the inverse transforms
+		double *n = (double*)fft_buffer_acquire(real_bytes);
+		double *sx = (double*)fft_buffer_acquire(real_bytes);
+		double *sxy = (double*)fft_buffer_acquire(real_bytes);
+		double *sx2 = (double*)fft_buffer_acquire(real_bytes);
+
+		polar_corr corr;
+		if (mirror)
+		{
+			inverse_ring(plan, mir_n, W, n);
+			inverse_ring(plan, mir_x, W, sx);
+			inverse_ring(plan, mir_xy, W, sxy);
+			inverse_ring(plan, mir_x2, W, sx2);
+
+			//Both sides of a mirror line contribute to the pairs, so the sums for the reflected values are the same
+			corr.mirror.resize(N);
+			for (int j = 0; j < N; j++)
+			{
+				double var = n[j]*sx2[j] - sx[j]*sx[j];
+				corr.mirror[j] = n[j] > 0.5 && var > 0.0 ? (float)((n[j]*sxy[j] - sx[j]*sx[j]) / var) : 0.0f;
+			}
+		}
+
+		if (rotation)
+		{
+			inverse_ring(plan, rot_n, W, n);
+			inverse_ring(plan, rot_x, W, sx);
+			inverse_ring(plan, rot_xy, W, sxy);
+			inverse_ring(plan, rot_x2, W, sx2);
+
+			//The sums for the rotated values are the sums for the opposite rotation
+			corr.rotation.resize(N);
+			for (int j = 0; j < N; j++)
+			{
+				int l = j ? N-j : 0;
+				double var_x = n[j]*sx2[j] - sx[j]*sx[j];
+				double var_y = n[j]*sx2[l] - sx[l]*sx[l];
+				corr.rotation[j] = n[j] > 0.5 && var_x > 0.0 && var_y > 0.0 ?
+					(float)((n[j]*sxy[j] - sx[j]*sx[l]) / std::sqrt(var_x*var_y)) : 0.0f;
+			}
+		}
+
+		//Return buffers to the pool
+		fft_buffer_release(ring, real_bytes);
+		fft_buffer_release(W, spectrum_bytes);
+		fft_buffer_release(G, spectrum_bytes);
+		fft_buffer_release(Q, spectrum_bytes);
+		fft_buffer_release(n, real_bytes);
+		fft_buffer_release(sx, real_bytes);
+		fft_buffer_release(sxy, real_bytes);
+		fft_buffer_release(sx2, real_bytes);
+
+		return corr;
+	}
+
+	/*Get the highest Pearson product moment correlation coefficient for mirror lines through an origin in a range of angles
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to calculate the coefficients for
+	**origin: cv::Point2f, Point the mirror lines pass through
+	**j_lo: const int, Index of the smallest angle in the range. Angles are pi*j/num_theta
+	**j_hi: const int, Index of the largest angle in the range
+	**plan: polar_plan &, Plan to resample the image with
+	**angle: float &, Output angle of the mirror line with the highest coefficient
+	**Returns:
+	**float, Highest Pearson product moment correlation coefficient in the range
+	*/
+	static float mirror_window_max(cv::Mat &img, cv::Point2f origin, const int j_lo, const int j_hi, polar_plan &plan,
+		float &angle)
+	{
+		polar_img polar = polar_resample(img, origin, plan);
+		polar_corr corr = polar_sym_corr(polar, plan, true, false);
+
+		//Mirror lines repeat every pi so wrap the indices
+		float max_corr = -FLT_MAX;
+		for (int j = j_lo; j <= j_hi; j++)
+		{
+			float c = corr.mirror[((j % plan.num_theta) + plan.num_theta) % plan.num_theta];
+			if (c > max_corr)
+			{
+				max_corr = c;
+				angle = (float)(PI*j/plan.num_theta);
+			}
+		}
+
+		return max_corr;
+	}
+
+	/*Refine the position and angle of a mirror line. Candidate origins are searched coarse-to-fine: the origin moves to the
+	**best of its neighbours at the current spacing until it is the best, then the spacing is halved
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to refine the mirror line on
+	**origin: cv::Point2f, Initial estimate of a point on the mirror line
+	**min_angle: const float, Smallest angle of the mirror line to the horizontal to consider, in rad
+	**max_angle: const float, Largest angle of the mirror line to the horizontal to consider, in rad
+	**init_step: const float, Initial spacing of the candidate origins
+	**plan: polar_plan &, Plan to resample the image with. Its number of angles sets the angular resolution
+	**Returns:
+	**cv::Vec3f, Refined origin position across and down the image and angle of the mirror line
+	*/
+	cv::Vec3f refine_polar_mirror(cv::Mat &img, cv::Point2f origin, const float min_angle, const float max_angle,
+		const float init_step, polar_plan &plan)
+	{
+		//Indices of the angles in the range
+		int j_lo = (int)std::ceil(min_angle*plan.num_theta/PI);
+		int j_hi = std::max(j_lo, (int)std::floor(max_angle*plan.num_theta/PI));
+
+		cv::Point2f centre = origin;
+		float best_angle;
+		float best = mirror_window_max(img, centre, j_lo, j_hi, plan, best_angle);
+
+		for (float step = std::max(init_step, POLAR_MIN_ORIGIN_STEP); step >= POLAR_MIN_ORIGIN_STEP; step *= 0.5f)
+		{
+			//Move to the best neighbour until the centre is the best, as a safeguard against divergence the number of moves is limited
+			for (int num_moves = 0; num_moves < MAX_EXPL; num_moves++)
+			{
+				std::vector<float> coefficients(8), angles(8);
+
+				parallel_for(0, 8, [&](int k)
+				{
+					//Skip the centre of the 3x3 neighbourhood
+					int l = k < 4 ? k : k+1;
+					cv::Point2f candidate = centre + step*cv::Point2f((float)(l%3-1), (float)(l/3-1));
+					coefficients[k] = mirror_window_max(img, candidate, j_lo, j_hi, plan, angles[k]);
+				});
+
+				int max_idx = std::distance(coefficients.begin(), std::max_element(coefficients.begin(), coefficients.end()));
+				if (coefficients[max_idx] <= best)
+				{
+					break;
+				}
+
+				int l = max_idx < 4 ? max_idx : max_idx+1;
+				centre += step*cv::Point2f((float)(l%3-1), (float)(l/3-1));
+				best = coefficients[max_idx];
+				best_angle = angles[max_idx];
+			}
+		}
+
+		return cv::Vec3f(centre.x, centre.y, best_angle);
+	}
+}
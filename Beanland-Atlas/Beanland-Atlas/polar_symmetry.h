@@ -0,0 +1,86 @@
+#pragma once
+
+#include <includes.h>
+
+#include <fft_service.h>
+#include <task_scheduler.h>
+
+namespace ba
+{
+	//Smallest spacing of the candidate origins to evaluate when refining the position of a mirror line
+    #define POLAR_MIN_ORIGIN_STEP 0.25f
+
+	//Custom data structure to hold the quantities needed to resample images onto polar grids with a particular number of
+	//angles and correlate them along the angular direction
+	struct polar_plan_param {
+		int num_theta; //Number of angles the polar grid is sampled at, evenly spaced over 2pi
+		std::vector<float> cos_theta; //Cosines of the polar grid's angles
+		std::vector<float> sin_theta; //Sines of the polar grid's angles
+		fftw_plan r2c; //Cached real to complex discrete Fourier transform of a ring of the polar grid
+		fftw_plan c2r; //Cached complex to real inverse discrete Fourier transform of a ring of the polar grid
+	};
+	typedef polar_plan_param polar_plan;
+
+	//Custom data structure to hold an image resampled onto a polar grid around an origin
+	struct polar_img_param {
+		cv::Mat vals; //32-bit values of the image. Rows are radii, starting at 1 px, and columns are angles
+		cv::Mat mask; //32-bit mask that is 1.0 where the polar grid is inside the image and 0.0 where it is not
+		cv::Point2f origin; //Position of the origin in the image
+	};
+	typedef polar_img_param polar_img;
+
+	//Custom data structure to hold Pearson's product moment correlation coefficients for every mirror line and rotation about
+	//the origin of a polar grid
+	struct polar_corr_param {
+		std::vector<float> mirror; //Element j is for the mirror line at an angle of pi*j/num_theta to the horizontal
+		std::vector<float> rotation; //Element j is for an anticlockwise rotation of 2*pi*j/num_theta
+	};
+	typedef polar_corr_param polar_corr;
+
+	/*Create a plan to resample images onto polar grids and correlate them along the angular direction
+	**Inputs:
+	**num_theta: const int, Number of angles to sample the polar grid at
+	**Returns:
+	**polar_plan, Plan that can be shared between threads. Its transforms are owned by the FFT plan cache
+	*/
+	polar_plan create_polar_plan(const int num_theta);
+
+	/*Resample an image onto a polar grid around an origin using bilinear interpolation. The grid extends to the image corner
+	**furthest from the origin, with 1 px radial spacing
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to resample
+	**origin: cv::Point2f, Position of the origin in the image
+	**plan: polar_plan &, Plan containing the angles to sample at
+	**Returns:
+	**polar_img, Image resampled onto the polar grid
+	*/
+	polar_img polar_resample(cv::Mat &img, cv::Point2f origin, polar_plan &plan);
+
+	/*Calculate Pearson's product moment correlation coefficients between a polar resampled image and its reflections and
+	**rotations about its origin. The correlations for all angles are circular correlations along each ring of the polar grid,
+	**which are calculated in the Fourier domain. Rings are weighted by their radii so that image pixels contribute equally
+	**Inputs:
+	**polar: polar_img &, Polar resampled image
+	**plan: polar_plan &, Plan the image was resampled with
+	**mirror: const bool, If true, calculate the coefficients for mirror lines
+	**rotation: const bool, If true, calculate the coefficients for rotations
+	**Returns:
+	**polar_corr, Pearson product moment correlation coefficients for the requested symmetries
+	*/
+	polar_corr polar_sym_corr(polar_img &polar, polar_plan &plan, const bool mirror = true, const bool rotation = true);
+
+	/*Refine the position and angle of a mirror line. Candidate origins are searched coarse-to-fine: the origin moves to the
+	**best of its neighbours at the current spacing until it is the best, then the spacing is halved
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to refine the mirror line on
+	**origin: cv::Point2f, Initial estimate of a point on the mirror line
+	**min_angle: const float, Smallest angle of the mirror line to the horizontal to consider, in rad
+	**max_angle: const float, Largest angle of the mirror line to the horizontal to consider, in rad
+	**init_step: const float, Initial spacing of the candidate origins
+	**plan: polar_plan &, Plan to resample the image with. Its number of angles sets the angular resolution
+	**Returns:
+	**cv::Vec3f, Refined origin position across and down the image and angle of the mirror line
+	*/
+	cv::Vec3f refine_polar_mirror(cv::Mat &img, cv::Point2f origin, const float min_angle, const float max_angle,
+		const float init_step, polar_plan &plan);
+}
@@ -3,6 +3,7 @@
 #include <includes.h>
 
 #include <utility.h>
+#include <valid_region.h>
 
 namespace ba
 {
@@ -9,6 +9,8 @@ namespace ba
 	*/
 	void preprocess(std::vector<cv::Mat> &mats, int med_filt_size)
 	{
+		BA_TIME_FUNCTION();
+
 		//ArrayFire can only performs Fourier analysis on arrays that are a power of 2 in size so pad the input arrays to this size
 		int cols = ceil_power_2(mats[0].cols);
 		int rows = ceil_power_2(mats[0].rows);
@@ -0,0 +1,86 @@
+#include <radial_profile.h>
+
+namespace ba
+{
+	/*Get the radial bins of the pixels in a square window about a point. Pixels are binned by their rounded distance from the
+	**centre, so each bin holds the pixels of a 1 px thick annulus. Tables are cached, so each window is only binned once
+	**Inputs:
+	**max_radius: const int, Largest radius to bin
+	**Returns:
+	**const radial_bins &, Bins of the pixels in the window. It stays valid for the rest of the program
+	*/
+	const radial_bins &get_radial_bins(const int max_radius)
+	{
+		//Elements of maps aren't moved when others are added, so references to them stay valid
+		static std::map<int, radial_bins> tables;
+		static std::mutex tables_mutex;
+
+		std::lock_guard<std::mutex> lock(tables_mutex);
+		std::map<int, radial_bins>::iterator it = tables.find(max_radius);
+		if (it != tables.end())
+		{
+			return it->second;
+		}
+
+		radial_bins &bins = tables[max_radius];
+		bins.max_radius = max_radius;
+
+		int size = 2*max_radius+1;
+		bins.idx = std::vector<int>(size*size);
+		for (int m = 0; m < size; m++)
+		{
+			for (int n = 0; n < size; n++)
+			{
+				int dy = m-max_radius, dx = n-max_radius;
+				int r = (int)std::round(std::sqrt(dx*dx + dy*dy));
+				bins.idx[m*size+n] = r > max_radius ? -1 : r;
+			}
+		}
+
+		return bins;
+	}
+
+	/*Average the pixels of an image about a point by their radius from it in a single pass
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to average the pixels of
+	**pos: cv::Point, Point to average the pixels about
+	**bins: const radial_bins &, Bins of the pixels in the window about the point
+	**Returns:
+	**cv::Mat, (max_radius+1) x 1 32-bit mat of the mean of the pixels on the image at each radius. Radii without any pixels
+	**on the image are zero
+	*/
+	cv::Mat radial_profile(cv::Mat &img, cv::Point pos, const radial_bins &bins)
+	{
+		std::vector<double> sums(bins.max_radius+1, 0.0);
+		std::vector<int> nums(bins.max_radius+1, 0);
+
+		//Part of the window that is on the image
+		int size = 2*bins.max_radius+1;
+		int min_row = std::max(0, bins.max_radius-pos.y);
+		int max_row = std::min(size, img.rows-pos.y+bins.max_radius);
+		int min_col = std::max(0, bins.max_radius-pos.x);
+		int max_col = std::min(size, img.cols-pos.x+bins.max_radius);
+
+		for (int m = min_row; m < max_row; m++)
+		{
+			const float *p = img.ptr<float>(pos.y-bins.max_radius+m) + pos.x-bins.max_radius;
+			const int *b = &bins.idx[m*size];
+			for (int n = min_col; n < max_col; n++)
+			{
+				if (b[n] >= 0)
+				{
+					sums[b[n]] += p[n];
+					nums[b[n]]++;
+				}
+			}
+		}
+
+		cv::Mat profile = cv::Mat(bins.max_radius+1, 1, CV_32FC1);
+		for (int i = 0; i <= bins.max_radius; i++)
+		{
+			profile.at<float>(i, 0) = nums[i] ? (float)(sums[i] / nums[i]) : 0.0f;
+		}
+
+		return profile;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <includes.h>
+
+namespace ba
+{
+	//Custom data structure to hold the radial bin of each pixel in a square window about a point, so that windows of the
+	//same size are only binned once
+	struct radial_bins_param {
+		int max_radius; //Largest radius that is binned. The window is 2*max_radius+1 px square
+		std::vector<int> idx; //For each px of the window in row-major order, its radius, or -1 if it is too far out
+	};
+	typedef radial_bins_param radial_bins;
+
+	/*Get the radial bins of the pixels in a square window about a point. Pixels are binned by their rounded distance from the
+	**centre, so each bin holds the pixels of a 1 px thick annulus. Tables are cached, so each window is only binned once
+	**Inputs:
+	**max_radius: const int, Largest radius to bin
+	**Returns:
+	**const radial_bins &, Bins of the pixels in the window. It stays valid for the rest of the program
+	*/
+	const radial_bins &get_radial_bins(const int max_radius);
+
+	/*Average the pixels of an image about a point by their radius from it in a single pass
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to average the pixels of
+	**pos: cv::Point, Point to average the pixels about
+	**bins: const radial_bins &, Bins of the pixels in the window about the point
+	**Returns:
+	**cv::Mat, (max_radius+1) x 1 32-bit mat of the mean of the pixels on the image at each radius. Radii without any pixels
+	**on the image are zero
+	*/
+	cv::Mat radial_profile(cv::Mat &img, cv::Point pos, const radial_bins &bins);
+}
@@ -2,6 +2,7 @@
 
 #include <includes.h>
 
+#include <polar_symmetry.h>
 #include <utility.h>
 
 namespace ba
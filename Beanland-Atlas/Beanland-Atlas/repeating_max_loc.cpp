@@ -14,22 +14,17 @@ namespace ba
 	*/
 	std::vector<int> repeating_max_loc(std::vector<float> corr, int num_angles, std::array<int, 4> pos_mir_sym){
 
-		double *angles;
-		fftw_complex *fft_corr_result;
-		fftw_plan fft_corr;
-
-		//Allocate memory to store result
-		angles = (double*)fftw_malloc(num_angles * sizeof(double));
+		//Get aligned buffers from the pool
+		size_t angles_bytes = num_angles*sizeof(double);
+		size_t result_bytes = (num_angles/2+1)*sizeof(fftw_complex);
+		double *angles = (double*)fft_buffer_acquire(angles_bytes);
 		for (int k = 0; k < num_angles; k++) {
 			angles[k] = (double)corr[k];
 		}
-		fft_corr_result = (fftw_complex*)fftw_malloc((num_angles/2+1)*sizeof(fftw_complex));
-
-		//Create plan
-		fft_corr = fftw_plan_dft_r2c_1d(num_angles, angles, fft_corr_result, FFTW_ESTIMATE);
+		fftw_complex *fft_corr_result = (fftw_complex*)fft_buffer_acquire(result_bytes);
 
-		//Execute plan
-		fftw_execute(fft_corr);
+		//Execute cached plan
+		fft_r2c(1, num_angles, angles, fft_corr_result);
 
 		//Symmetry is given by the power spectrum component with the highest amplitude
 		double max_power = 0;
@@ -46,10 +41,9 @@ namespace ba
 			}
 		}
 
-		//Free fftw resources
-		fftw_destroy_plan(fft_corr);
-		fftw_free(angles);
-		fftw_free(fft_corr_result);
+		//Return buffers to the pool
+		fft_buffer_release(angles, angles_bytes);
+		fft_buffer_release(fft_corr_result, result_bytes);
 
 		//Cut the Pearson normalised product moment correlation coefficient spectrum into the same number of chunks as the symmetry
 		int size = num_angles/symmetry;
@@ -2,6 +2,8 @@
 
 #include <includes.h>
 
+#include <fft_service.h>
+
 namespace ba
 {
 	/**Calculates the positions of repeating maxima in noisy data. A peak if the data's Fourier power spectrum is used to 
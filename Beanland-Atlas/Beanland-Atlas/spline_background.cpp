@@ -0,0 +1,213 @@
+#include <spline_background.h>
+
+namespace ba
+{
+	/*Estimate the background at each knot of a square grid as the mean of the unmasked pixels in the knot's cell. Cells that
+	**are completely masked are grown until they contain unmasked pixels
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to estimate the background of
+	**mask: cv::Mat &, 8-bit mask that is non-zero where pixels should not contribute to the background
+	**spacing: const int, Spacing of the knots. The first knot is at the image origin and the last knots are at or beyond the
+	**image edges
+	**Returns:
+	**cv::Mat, 32-bit background estimates at the knots
+	*/
+	cv::Mat spline_knots(cv::Mat &img, cv::Mat &mask, const int spacing)
+	{
+		//Sums of the unmasked pixels and their numbers over every rectangle can be read from summed-area tables in constant time
+		cv::Mat unmasked = mask == 0;
+		cv::Mat vals = cv::Mat::zeros(img.size(), CV_32FC1);
+		img.copyTo(vals, unmasked);
+		cv::Mat sum, num;
+		cv::integral(vals, sum, CV_64F);
+		cv::integral(unmasked / 255, num, CV_32S);
+
+		int knot_rows = (img.rows + spacing - 2) / spacing + 1;
+		int knot_cols = (img.cols + spacing - 2) / spacing + 1;
+		cv::Mat knots(knot_rows, knot_cols, CV_32FC1);
+
+		parallel_for(0, knot_rows, [&](int i)
+		{
+			float *k = knots.ptr<float>(i);
+			for (int j = 0; j < knot_cols; j++)
+			{
+				k[j] = 0.0f;
+
+				//Grow the cell until it contains unmasked pixels or covers the whole image
+				for (int half = spacing / 2; half < std::max(img.rows, img.cols) + spacing; half += std::max(spacing / 2, 1))
+				{
+					int t = std::max(i*spacing - half, 0), b = std::min(i*spacing + half + 1, img.rows);
+					int l = std::max(j*spacing - half, 0), r = std::min(j*spacing + half + 1, img.cols);
+					if (t >= b || l >= r)
+					{
+						continue;
+					}
+
+					int n = num.at<int>(b, r) - num.at<int>(t, r) - num.at<int>(b, l) + num.at<int>(t, l);
+					if (n)
+					{
+						k[j] = (float)((sum.at<double>(b, r) - sum.at<double>(t, r) - sum.at<double>(b, l) + 
+							sum.at<double>(t, l)) / n);
+						break;
+					}
+				}
+			}
+		});
+
+		return knots;
+	}
+
+	/*Interpolate evenly spaced samples down every column with natural cubic splines. The tridiagonal systems for the second
+	**derivatives of all columns share the same matrix, so they are solved together with a single Thomas sweep down the rows
+	**Inputs:
+	**knots: cv::Mat &, 32-bit samples. Rows are positions of the samples, spaced by spacing, and columns are independent
+	**spacing: const int, Spacing of the samples
+	**len: const int, Number of rows to evaluate the splines at, starting at the first sample
+	**Returns:
+	**cv::Mat, 32-bit splines evaluated at every row
+	*/
+	cv::Mat spline_interp_cols(cv::Mat &knots, const int spacing, const int len)
+	{
+		const int n = knots.rows;
+		const int cols = knots.cols;
+		cv::Mat interp(len, cols, CV_32FC1);
+
+		//A single sample can only describe a constant
+		if (n == 1)
+		{
+			for (int y = 0; y < len; y++)
+			{
+				knots.row(0).copyTo(interp.row(y));
+			}
+			return interp;
+		}
+
+		//Second derivatives of the splines at the samples. They are zero at the ends of natural splines
+		cv::Mat d2 = cv::Mat::zeros(n, cols, CV_32FC1);
+		if (n > 2)
+		{
+			//Forward sweep of the Thomas algorithm. The system is M_{i-1} + 4M_i + M_{i+1} = 6(y_{i-1} - 2y_i + y_{i+1})/h^2,
+			//so the eliminated upper diagonal is the same for every column and only the right hand sides vary
+			std::vector<float> upper(n-1);
+			const float scale = 6.0f / (spacing*spacing);
+			float prev_upper = 0.0f;
+			for (int i = 1; i < n-1; i++)
+			{
+				float inv_denom = 1.0f / (4.0f - prev_upper);
+				upper[i] = inv_denom;
+				prev_upper = inv_denom;
+
+				const float *y0 = knots.ptr<float>(i-1), *y1 = knots.ptr<float>(i), *y2 = knots.ptr<float>(i+1);
+				const float *d_prev = d2.ptr<float>(i-1);
+				float *d = d2.ptr<float>(i);
+				for (int j = 0; j < cols; j++)
+				{
+					d[j] = (scale*(y0[j] - 2.0f*y1[j] + y2[j]) - d_prev[j]) * inv_denom;
+				}
+			}
+
+			//Back substitution
+			for (int i = n-3; i >= 1; i--)
+			{
+				const float *d_next = d2.ptr<float>(i+1);
+				float *d = d2.ptr<float>(i);
+				for (int j = 0; j < cols; j++)
+				{
+					d[j] -= upper[i]*d_next[j];
+				}
+			}
+		}
+
+		//Each output row is a weighted sum of the values and second derivatives at the samples either side of it, with the same
+		//weights for every column
+		const float h2_6 = spacing*spacing / 6.0f;
+		parallel_for(0, len, [&](int y)
+		{
+			int i = std::min(y / spacing, n-2);
+			float t = (float)(y - i*spacing) / spacing;
+			float w0 = 1.0f - t, w1 = t;
+			float w2 = h2_6*(w0*w0*w0 - w0), w3 = h2_6*(t*t*t - t);
+
+			const float *y0 = knots.ptr<float>(i), *y1 = knots.ptr<float>(i+1);
+			const float *m0 = d2.ptr<float>(i), *m1 = d2.ptr<float>(i+1);
+			float *p = interp.ptr<float>(y);
+			for (int j = 0; j < cols; j++)
+			{
+				p[j] = w0*y0[j] + w1*y1[j] + w2*m0[j] + w3*m1[j];
+			}
+		});
+
+		return interp;
+	}
+
+	/*Model the background of an image as a bicubic natural spline through background estimates on a grid of knots
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to model the background of
+	**mask: cv::Mat &, 8-bit mask that is non-zero where pixels should not contribute to the background e.g. at Bragg peaks
+	**background: cv::Mat &, Output 32-bit background
+	**spacing: const int, Spacing of the spline knots
+	*/
+	void spline_background(cv::Mat &img, cv::Mat &mask, cv::Mat &background, const int spacing)
+	{
+		const int h = std::max(spacing, 1);
+		cv::Mat knots = spline_knots(img, mask, h);
+
+		//Interpolate down the columns of knots, then transpose so that the rows can also be interpolated down columns, where
+		//the arithmetic is contiguous across lines
+		cv::Mat knot_cols = spline_interp_cols(knots, h, img.rows);
+		cv::Mat knot_cols_t;
+		cv::transpose(knot_cols, knot_cols_t);
+
+		cv::transpose(spline_interp_cols(knot_cols_t, h, img.cols), background);
+	}
+
+	/*Time spline background modelling against inpainting and print the results
+	**Inputs:
+	**mats: std::vector<cv::Mat> &, 32-bit images to model the backgrounds of
+	**masks: std::vector<cv::Mat> &, 8-bit masks that are non-zero where the images should be infilled
+	**radius: const int, Radius of the masked regions
+	**inpainting_method: const int, Method to inpaint the masked regions with
+	**reps: const int, Number of times to model each background with each method
+	*/
+	void bench_background_models(std::vector<cv::Mat> &mats, std::vector<cv::Mat> &masks, const int radius, 
+		const int inpainting_method, const int reps)
+	{
+		std::vector<cv::Mat> inpainted(mats.size()), splined(mats.size());
+
+		int64 start = cv::getTickCount();
+		for (int r = 0; r < reps; r++)
+		{
+			parallel_for(0, mats.size(), [&](int j)
+			{
+				cv::inpaint(mats[j], masks[j], inpainted[j], 7, inpainting_method);
+			});
+		}
+		double inpaint_time = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+		start = cv::getTickCount();
+		for (int r = 0; r < reps; r++)
+		{
+			parallel_for(0, mats.size(), [&](int j)
+			{
+				spline_background(mats[j], masks[j], splined[j], SPLINE_KNOT_SPACING*radius);
+			});
+		}
+		double spline_time = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+		//Root mean square difference between the backgrounds in the infilled regions
+		double sum_sqr = 0.0;
+		int num = 0;
+		for (int j = 0; j < mats.size(); j++)
+		{
+			cv::Mat diff = splined[j] - inpainted[j];
+			sum_sqr += cv::norm(diff, cv::NORM_L2SQR, masks[j]);
+			num += cv::countNonZero(masks[j]);
+		}
+
+		int frames = reps*mats.size();
+		std::cout << "Inpainting: " << 1e3*inpaint_time/frames << " ms per frame" << std::endl;
+		std::cout << "Spline background: " << 1e3*spline_time/frames << " ms per frame (" << inpaint_time/spline_time << 
+			"x faster)" << std::endl;
+		std::cout << "RMS difference in infilled regions: " << (num ? std::sqrt(sum_sqr/num) : 0.0) << std::endl;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <includes.h>
+
+#include <task_scheduler.h>
+
+namespace ba
+{
+	//Multiple of the radius of the masked regions to space the knots of spline backgrounds by
+    #define SPLINE_KNOT_SPACING 2
+
+	/*Estimate the background at each knot of a square grid as the mean of the unmasked pixels in the knot's cell. Cells that
+	**are completely masked are grown until they contain unmasked pixels
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to estimate the background of
+	**mask: cv::Mat &, 8-bit mask that is non-zero where pixels should not contribute to the background
+	**spacing: const int, Spacing of the knots. The first knot is at the image origin and the last knots are at or beyond the
+	**image edges
+	**Returns:
+	**cv::Mat, 32-bit background estimates at the knots
+	*/
+	cv::Mat spline_knots(cv::Mat &img, cv::Mat &mask, const int spacing);
+
+	/*Interpolate evenly spaced samples down every column with natural cubic splines. The tridiagonal systems for the second
+	**derivatives of all columns share the same matrix, so they are solved together with a single Thomas sweep down the rows
+	**Inputs:
+	**knots: cv::Mat &, 32-bit samples. Rows are positions of the samples, spaced by spacing, and columns are independent
+	**spacing: const int, Spacing of the samples
+	**len: const int, Number of rows to evaluate the splines at, starting at the first sample
+	**Returns:
+	**cv::Mat, 32-bit splines evaluated at every row
+	*/
+	cv::Mat spline_interp_cols(cv::Mat &knots, const int spacing, const int len);
+
+	/*Model the background of an image as a bicubic natural spline through background estimates on a grid of knots
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to model the background of
+	**mask: cv::Mat &, 8-bit mask that is non-zero where pixels should not contribute to the background e.g. at Bragg peaks
+	**background: cv::Mat &, Output 32-bit background
+	**spacing: const int, Spacing of the spline knots
+	*/
+	void spline_background(cv::Mat &img, cv::Mat &mask, cv::Mat &background, const int spacing);
+
+	/*Time spline background modelling against inpainting and print the results
+	**Inputs:
+	**mats: std::vector<cv::Mat> &, 32-bit images to model the backgrounds of
+	**masks: std::vector<cv::Mat> &, 8-bit masks that are non-zero where the images should be infilled
+	**radius: const int, Radius of the masked regions
+	**inpainting_method: const int, Method to inpaint the masked regions with
+	**reps: const int, Number of times to model each background with each method
+	*/
+	void bench_background_models(std::vector<cv::Mat> &mats, std::vector<cv::Mat> &masks, const int radius, 
+		const int inpainting_method = cv::INPAINT_NS, const int reps = 1);
+}
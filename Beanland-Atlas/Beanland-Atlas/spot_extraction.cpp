@@ -12,6 +12,8 @@ namespace ba
 	**mats: std::vector<cv::Mat> &, Individual images to extract spots from
 	**spot_pos: std::vector<cv::Point>, Positions of located spots in aligned diffraction pattern
 	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images
+	**index: spot_frame_index &, Frames that each spot is on
+	**acc: cv::Mat &, Average of the aligned diffraction patterns
 	**radius: const int, Radius about the spot locations to extract pixels from
 	**ns_radius: const int, Radius to Navier-Stokes infill when removing the diffuse background
 	**inpainting_method: Method to inpaint the Bragg peak regions in the diffraction pattern. Defaults to the Navier-Stokes method
@@ -19,15 +21,16 @@ namespace ba
 	**std::vector<cv::Mat>, Regions of k space surveys by the spots
 	*/
 	std::vector<cv::Mat> create_spot_maps(std::vector<cv::Mat> &mats, std::vector<cv::Point> &spot_pos, std::vector<std::vector<int>> &rel_pos,
-		cv::Mat &acc, const int radius, const int ns_radius, const int inpainting_method)
+		spot_frame_index &index, cv::Mat &acc, const int radius, const int ns_radius, const int inpainting_method)
 	{
+		BA_TIME_FUNCTION();
+
 		//Initialise vectors of OpenCV mats to hold individual paths and number of contributions to those paths
 		std::vector<cv::Mat> indv_maps(spot_pos.size());
 		std::vector<cv::Mat> indv_num_mappers(spot_pos.size());
 	
 		//Get the maximum relative rows and columns and the difference between the maximum and minimum rows and columns
 		int col_max = 0, row_max = 0, col_min = INT_MAX, row_min = INT_MAX;
-        #pragma omp parallel for reduction(max:col_max), reduction(max:row_max), reduction(min:col_min), reduction(min:row_min)
 		for (int i = 0; i < rel_pos[0].size(); i++)
 		{
 			//Minimum relitive position column
@@ -65,7 +68,7 @@ namespace ba
 
 		////Get the ellipses describing the spots
 		//std::vector<std::vector<std::vector<double>>> ellipses;
-		//get_spot_ellipses(mats, spot_pos, rel_pos, col_max, row_max, acc, ellipses, EL_LLIM_FRAC*radius, EL_ULIM_FRAC*radius);
+		//get_spot_ellipses(mats, spot_pos, index, acc, ellipses, EL_LLIM_FRAC*radius, EL_ULIM_FRAC*radius);
 
 		//Temporary loop: convert points to point2d
 		std::vector<cv::Point2d> spot_posd(spot_pos.size());
@@ -73,7 +76,7 @@ namespace ba
 		{
 			spot_posd[i] = cv::Point2d(spot_pos[i].x, spot_pos[i].y);
 		}
-		std::vector<cv::Mat> envelope = bragg_envelope(mats, spot_posd[1], rel_pos, col_max, row_max, 
+		std::vector<cv::Mat> envelope = bragg_envelope(mats, spot_posd[1], index.hits[1], rel_pos, col_max, row_max, 
 			radius);
 
 		//Get the ellipses described by each spot so that they can be homomorphically corrected
@@ -81,65 +84,49 @@ namespace ba
 		get_spot_ellipses(mats, spot_pos, acc, ellipses);*/
 
 		//Fill the path mats with zeros
-        #pragma omp parallel for
-		for (int j = 0; j < spot_pos.size(); j++) 
+		parallel_for(0, spot_pos.size(), [&](int j)
 		{
 			indv_maps[j] = cv::Mat::zeros(mats[j].size(), CV_32FC1);
 			indv_num_mappers[j] = cv::Mat::zeros(mats[j].size(), CV_16UC1);
-		}
+		});
 
 		//Perform background subtraction using Navier-Stokes infilling or otherwise
 		subtract_background(mats, spot_pos, rel_pos, inpainting_method, col_max, row_max, ns_radius);
 
+		//Runs of pixels of the disks to extract
+		const disk_spans &disk = get_disk_spans(radius+1);
+
 		//For each spot...
-        #pragma omp parallel for
-		for (int k = 0; k < spot_pos.size(); k++) 
+		parallel_for(0, spot_pos.size(), [&](int k)
 		{
 			//...get it's dark field decoupled Bragg profile in each micrograph...
 			//std::vector<cv::Mat> bragg_profiles = beanland_commensurate(mats, spot_pos[k], rel_pos, col_max, row_max, radius, ewald_rad);
 
-			//...and extract the spot from each micrograph
-			for (int j = 0; j < mats.size(); j++)
+			//...and extract the spot from each micrograph it is on
+			for (int i = 0; i < index.hits[k].size(); i++)
 			{	
-				//Check if the spot is in the image
-				if (spot_pos[k].y >= row_max-rel_pos[1][j] && spot_pos[k].y < row_max-rel_pos[1][j]+mats[j].rows &&
-					spot_pos[k].x >= col_max-rel_pos[0][j] && spot_pos[k].x < col_max-rel_pos[0][j]+mats[j].cols)
+				int j = index.hits[k][i].frame;
+
+				//Compend the disk about the spot to the map
+				for_disk_spans(disk, index.hits[k][i].origin, mats[j].size(), [&](int m, int start, int end)
 				{
-					///Mask to extract spot from micrograph
-					cv::Mat circ_mask = cv::Mat::zeros(mats[j].size(), CV_8UC1);
-		
-					//Draw circle at the position of the spot on the mask
-					cv::Point circleCenter(spot_pos[k].x-col_max+rel_pos[0][j], spot_pos[k].y-row_max+rel_pos[1][j]);
-					cv::circle(circ_mask, circleCenter, radius+1, cv::Scalar(1), -1, 8, 0);
-		
-					//Copy the part of the micrograph containing the spot
-					cv::Mat imagePart = cv::Mat::zeros(mats[j].size(), mats[j].type());
-					mats[j].copyTo(imagePart, circ_mask);
-		
-					//Compend spot to map
-					float *r, *t;
-					ushort *s;
-					byte *u;
-					for (int m = 0; m < indv_num_mappers[k].rows; m++) 
+					float *r = indv_maps[k].ptr<float>(m);
+					ushort *s = indv_num_mappers[k].ptr<ushort>(m);
+					float *t = mats[j].ptr<float>(m);
+					#pragma omp simd
+					for (int n = start; n < end; n++) 
 					{
-						r = indv_maps[k].ptr<float>(m);
-						s = indv_num_mappers[k].ptr<ushort>(m);
-						t = imagePart.ptr<float>(m);
-						u = circ_mask.ptr<byte>(m);
-						for (int n = 0; n < indv_num_mappers[k].cols; n++) 
-						{
-							//Add contributing pixels to maps
-							r[n] += t[n];
-							s[n] += u[n];
-						}
+						//Add contributing pixels to maps
+						r[n] += t[n];
+						s[n]++;
 					}
-				}
+				});
 			}
-		}
+		});
 
 		//Normalise maps using the number of mappers contributing to each pixel
-        #pragma omp parallel for
-		for (int k = 0; k < spot_pos.size(); k++) {
+		parallel_for(0, spot_pos.size(), [&](int k)
+		{
 				
 			//Divide non-zero accumulator matrix pixel values by number of overlapping contributing micrographs
 			float *r;
@@ -157,12 +144,31 @@ namespace ba
 					}
 				}
 			}
-		}
+		});
 		
 		//Crop maps so that they only contain the paths mapped out by the spots
+		std::vector<cv::Mat> surveys = crop_spot_maps(indv_maps, spot_pos, cols_diff, rows_diff, radius);
+
+		//display_CV(create_raw_atlas(surveys, spot_pos, radius, cols_diff, rows_diff), 1e-3);
+		
+		return surveys;
+	}
+
+	/*Crop the maps of the k space mapped out by each spot so that they only contain the paths mapped out by the spots
+	**Inputs:
+	**indv_maps: std::vector<cv::Mat> &, Maps of the k space mapped out by each spot, the same size as the micrographs
+	**spot_pos: std::vector<cv::Point> &, Positions of located spots in aligned diffraction pattern
+	**cols_diff: const int, Difference between the maximum and minimum relative positions of the images' columns
+	**rows_diff: const int, Difference between the maximum and minimum relative positions of the images' rows
+	**radius: const int, Radius about the spot locations that pixels were extracted from
+	**Returns:
+	**std::vector<cv::Mat>, Regions of k space surveyed by the spots
+	*/
+	std::vector<cv::Mat> crop_spot_maps(std::vector<cv::Mat> &indv_maps, std::vector<cv::Point> &spot_pos, const int cols_diff,
+		const int rows_diff, const int radius)
+	{
 		std::vector<cv::Mat> surveys(spot_pos.size());
-        #pragma omp parallel for
-		for (int k = 0; k < spot_pos.size(); k++) 
+		parallel_for(0, spot_pos.size(), [&](int k)
 		{		
 			//Minimum row
 			int x;
@@ -194,24 +200,24 @@ namespace ba
 				
 			//Maximum row
 			int x_2;
-			if (spot_pos[k].x + radius <= mats[0].rows)
+			if (spot_pos[k].x + radius <= indv_maps[k].rows)
 			{
 				x_2 = spot_pos[k].x + radius;
 			}
 			else
 			{
-				x_2 = mats[0].rows;
+				x_2 = indv_maps[k].rows;
 			}
 		
 			//Maximum column
 			int y_2;
-			if (spot_pos[k].y + radius <= mats[0].cols) 
+			if (spot_pos[k].y + radius <= indv_maps[k].cols) 
 			{
 				y_2 = spot_pos[k].y + radius;
 			}
 			else
 			{
-				y_2 = mats[0].cols;
+				y_2 = indv_maps[k].cols;
 			}
 		
 			//Establish roi in map and cast
@@ -221,10 +227,8 @@ namespace ba
 			//Cropped map
 			surveys[k] = cv::Mat(cols_diff+2*radius, rows_diff+2*radius, CV_32FC1, cv::Scalar(0.0));
 			indv_maps[k](roi_map).copyTo(surveys[k](roi_crop));
-		}
+		});
 
-		//display_CV(create_raw_atlas(surveys, spot_pos, radius, cols_diff, rows_diff), 1e-3);
-		
 		return surveys;
 	}
 
@@ -234,7 +238,8 @@ namespace ba
 	**mats: std::vector<cv::Mat> &, Individual floating point images to extract spots from
 	**spot_pos: std::vector<cv::Point>, Positions of located spots in aligned diffraction pattern
 	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images
-	**inpainting_method: Method to inpaint the Bragg peak regions in the diffraction pattern
+	**inpainting_method: Method to inpaint the Bragg peak regions in the diffraction pattern. BACKGROUND_SPLINE to fit a spline
+	**background through the rest of the pattern instead, or -1 to leave the background
 	**col_max: int, Maximum column difference between spot positions
 	**row_max: int, Maximum row difference between spot positions
 	**ns_radius: const int, Radius to Navier-Stokes infill when removing the diffuse background
@@ -242,32 +247,31 @@ namespace ba
 	void subtract_background(std::vector<cv::Mat> &mats, std::vector<cv::Point> &spot_pos, std::vector<std::vector<int>> &rel_pos, 
 		int inpainting_method, int col_max, int row_max, int ns_radius)
 	{
+		BA_TIME_FUNCTION();
+
 		//If the user wants to use inpainting to remove the diffuse background
 		if(inpainting_method != -1)
 		{
-			//Find position of spots in each micrograph;
-			#pragma omp parallel for
-			for (int j = 0; j < mats.size(); j++) 
+			//Spots only translate between micrographs, so the regions to infill are worked out once for the aligned pattern
+			bg_inpaint_plan plan = create_bg_inpaint_plan(spot_pos, ns_radius, 
+				inpainting_method == BACKGROUND_SPLINE ? cv::INPAINT_NS : inpainting_method);
+
+			parallel_for(0, mats.size(), [&](int j)
 			{
-				///Mask to mark the positions of all the spots to be Navier-Stokes infilled on the micrograph
-				cv::Mat ns_mask = cv::Mat::zeros(mats[j].size(), CV_8UC1);
+				//Position of the micrograph in the aligned pattern
+				cv::Point origin(col_max-rel_pos[0][j], row_max-rel_pos[1][j]);
 
-				//Use Navier-Stokes infilling to remove the diffuse background from the micrographs
-				//Start by creating a mask that marks out the regions to infill
-				for (int k = 0; k < spot_pos.size(); k++) 
+				//Create Navier-Stokes inpainted diffraction pattern or model the background with a spline
+				cv::Mat inpainted;
+				if (inpainting_method == BACKGROUND_SPLINE)
 				{
-					if (spot_pos[k].y >= row_max-rel_pos[1][j] && spot_pos[k].y < row_max-rel_pos[1][j]+mats[j].rows &&
-						spot_pos[k].x >= col_max-rel_pos[0][j] && spot_pos[k].x < col_max-rel_pos[0][j]+mats[j].cols) 
-					{
-						//Draw circle at the position of the spot on the mask
-						cv::Point circleCenter(spot_pos[k].x-col_max+rel_pos[0][j], spot_pos[k].y-row_max+rel_pos[1][j]);
-						cv::circle(ns_mask, circleCenter, ns_radius, cv::Scalar(1), -1, 8, 0);
-					}
+					cv::Mat ns_mask = bg_inpaint_mask(plan, mats[j].size(), origin);
+					spline_background(mats[j], ns_mask, inpainted, SPLINE_KNOT_SPACING*ns_radius);
+				}
+				else
+				{
+					inpaint_background(mats[j], origin, plan, inpainted);
 				}
-
-				//Create Navier-Stokes inpainted diffraction pattern
-				cv::Mat inpainted = cv::Mat::zeros(mats[j].size(), CV_32FC1);
-				cv::inpaint(mats[j], ns_mask, inpainted, 7, inpainting_method);
 
 				//Subtract the background from the image
 				float *r, *s;
@@ -280,7 +284,7 @@ namespace ba
 						r[n] = r[n] > s[n] ? r[n] - s[n] : 0;
 					}
 				}
-			}
+			});
 		}
 	}
 }
\ No newline at end of file
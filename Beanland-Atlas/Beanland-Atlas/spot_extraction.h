@@ -1,7 +1,12 @@
 #pragma once
 
+#include <background_inpainting.h>
 #include <commensuration_ellipses.h>
+#include <disk_spans.h>
 #include <includes.h>
+#include <spline_background.h>
+#include <spot_frame_index.h>
+#include <task_scheduler.h>
 
 namespace ba
 {
@@ -9,6 +14,9 @@ namespace ba
     #define EL_LLIM_FRAC 0.4 //Lower bound
     #define EL_ULIM_FRAC 1.3 //Upper bound
 
+	//Background removal method that models the background with a bicubic spline instead of inpainting the Bragg peak regions
+    #define BACKGROUND_SPLINE -2
+
 	/*Combine the k spaces mapped out by spots in each of the images create maps of the whole k space navigated by that spot.
 	**Individual maps are summed together. The total map is then divided by the number of spot k space maps contributing to 
 	**each px in the total map. These maps are then combined into an atlas
@@ -16,6 +24,8 @@ namespace ba
 	**mats: std::vector<cv::Mat> &, Individual images to extract spots from
 	**spot_pos: std::vector<cv::Point>, Positions of located spots in aligned diffraction pattern
 	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images
+	**index: spot_frame_index &, Frames that each spot is on
+	**acc: cv::Mat &, Average of the aligned diffraction patterns
 	**radius: const int, Radius about the spot locations to extract pixels from
 	**ns_radius: const int, Radius to Navier-Stokes infill when removing the diffuse background
 	**inpainting_method: Method to inpaint the Bragg peak regions in the diffraction pattern. Defaults to the Navier-Stokes method
@@ -23,7 +33,20 @@ namespace ba
 	**std::vector<cv::Mat>, Regions of k space surveys by the spots
 	*/
 	std::vector<cv::Mat> create_spot_maps(std::vector<cv::Mat> &mats, std::vector<cv::Point> &spot_pos, std::vector<std::vector<int>> &rel_pos,
-		cv::Mat &acc, const int radius, const int ns_radius, const int inpainting_method = cv::INPAINT_NS);
+		spot_frame_index &index, cv::Mat &acc, const int radius, const int ns_radius, const int inpainting_method = cv::INPAINT_NS);
+
+	/*Crop the maps of the k space mapped out by each spot so that they only contain the paths mapped out by the spots
+	**Inputs:
+	**indv_maps: std::vector<cv::Mat> &, Maps of the k space mapped out by each spot, the same size as the micrographs
+	**spot_pos: std::vector<cv::Point> &, Positions of located spots in aligned diffraction pattern
+	**cols_diff: const int, Difference between the maximum and minimum relative positions of the images' columns
+	**rows_diff: const int, Difference between the maximum and minimum relative positions of the images' rows
+	**radius: const int, Radius about the spot locations that pixels were extracted from
+	**Returns:
+	**std::vector<cv::Mat>, Regions of k space surveyed by the spots
+	*/
+	std::vector<cv::Mat> crop_spot_maps(std::vector<cv::Mat> &indv_maps, std::vector<cv::Point> &spot_pos, const int cols_diff,
+		const int rows_diff, const int radius);
 
 	/*Subtract the bacground from micrographs by masking the spots, infilling the masked image and then subtracting the infilled
 	**image from the original
@@ -31,7 +54,8 @@ namespace ba
 	**mats: std::vector<cv::Mat> &, Individual floating point images to extract spots from
 	**spot_pos: std::vector<cv::Point>, Positions of located spots in aligned diffraction pattern
 	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images
-	**inpainting_method: Method to inpaint the Bragg peak regions in the diffraction pattern
+	**inpainting_method: Method to inpaint the Bragg peak regions in the diffraction pattern. BACKGROUND_SPLINE to fit a spline
+	**background through the rest of the pattern instead, or -1 to leave the background
 	**col_max: int, Maximum column difference between spot positions
 	**row_max: int, Maximum row difference between spot positions
 	**ns_radius: const int, Radius to Navier-Stokes infill when removing the diffuse background
@@ -0,0 +1,138 @@
+#include <spot_frame_index.h>
+
+namespace ba
+{
+	/*Find the frames that each spot is on. The frames are binned on a grid by their positions in the aligned pattern, so only
+	**the frames in the few cells that can contain a spot are checked
+	**Inputs:
+	**spot_pos: std::vector<cv::Point> &, Positions of located spots in aligned diffraction pattern
+	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images
+	**col_max: const int, Maximum column difference between spot positions
+	**row_max: const int, Maximum row difference between spot positions
+	**frame_size: cv::Size, Size of the frames
+	**Returns:
+	**spot_frame_index, Frames that each spot is on
+	*/
+	spot_frame_index create_spot_frame_index(std::vector<cv::Point> &spot_pos, std::vector<std::vector<int>> &rel_pos,
+		const int col_max, const int row_max, cv::Size frame_size)
+	{
+		BA_TIME_FUNCTION();
+
+		spot_frame_index index;
+		index.frame_size = frame_size;
+		index.hits = std::vector<std::vector<spot_hit>>(spot_pos.size());
+
+		//Positions of the frames' top left corners in the aligned pattern
+		int num_frames = rel_pos[0].size();
+		std::vector<cv::Point> corners(num_frames);
+		cv::Point corner_min(INT_MAX, INT_MAX), corner_max(INT_MIN, INT_MIN);
+		for (int j = 0; j < num_frames; j++)
+		{
+			corners[j] = cv::Point(col_max-rel_pos[0][j], row_max-rel_pos[1][j]);
+			corner_min = cv::Point(std::min(corner_min.x, corners[j].x), std::min(corner_min.y, corners[j].y));
+			corner_max = cv::Point(std::max(corner_max.x, corners[j].x), std::max(corner_max.y, corners[j].y));
+		}
+
+		//Bin the frames on a grid with cells the size of a frame. Frames are added in order, so each cell lists them in order
+		int grid_cols = (corner_max.x-corner_min.x)/frame_size.width + 1;
+		int grid_rows = (corner_max.y-corner_min.y)/frame_size.height + 1;
+		std::vector<std::vector<int>> cells(grid_cols*grid_rows);
+		for (int j = 0; j < num_frames; j++)
+		{
+			int cell_col = (corners[j].x-corner_min.x)/frame_size.width;
+			int cell_row = (corners[j].y-corner_min.y)/frame_size.height;
+			cells[cell_row*grid_cols + cell_col].push_back(j);
+		}
+
+		cv::Rect frame_rect(cv::Point(0, 0), frame_size);
+		parallel_for(0, spot_pos.size(), [&](int k)
+		{
+			//A spot is on the frames with corners less than a frame size above and to the left of it, so they are in at most
+			//2 x 2 cells
+			int min_col = std::max(0, (spot_pos[k].x-frame_size.width+1-corner_min.x)/frame_size.width);
+			int max_col = std::min(grid_cols-1, (spot_pos[k].x-corner_min.x)/frame_size.width);
+			int min_row = std::max(0, (spot_pos[k].y-frame_size.height+1-corner_min.y)/frame_size.height);
+			int max_row = std::min(grid_rows-1, (spot_pos[k].y-corner_min.y)/frame_size.height);
+
+			std::vector<int> frames;
+			for (int m = min_row; m <= max_row; m++)
+			{
+				for (int n = min_col; n <= max_col; n++)
+				{
+					std::vector<int> &cell = cells[m*grid_cols + n];
+					for (int i = 0; i < cell.size(); i++)
+					{
+						if (frame_rect.contains(spot_pos[k] - corners[cell[i]]))
+						{
+							frames.push_back(cell[i]);
+						}
+					}
+				}
+			}
+			std::sort(frames.begin(), frames.end());
+
+			for (int i = 0; i < frames.size(); i++)
+			{
+				index.hits[k].push_back({ frames[i], spot_pos[k] - corners[frames[i]] });
+			}
+		});
+
+		return index;
+	}
+
+	/*Get the hit of a spot on each frame in the image stack
+	**Inputs:
+	**hits: std::vector<spot_hit> &, Frames that the spot is on
+	**num_frames: const int, Number of frames in the image stack
+	**Returns:
+	**std::vector<int>, Index of the hit on each frame, or -1 if the spot isn't on it
+	*/
+	std::vector<int> hits_by_frame(std::vector<spot_hit> &hits, const int num_frames)
+	{
+		std::vector<int> by_frame(num_frames, -1);
+		for (int i = 0; i < hits.size(); i++)
+		{
+			by_frame[hits[i].frame] = i;
+		}
+
+		return by_frame;
+	}
+
+	/*Pack an index so that it can be passed between pipeline stages and checkpointed with the alignment results
+	**Inputs:
+	**index: spot_frame_index &, Index to pack
+	**Returns:
+	**std::vector<cv::Mat>, Frame size, followed by the hits of each spot
+	*/
+	std::vector<cv::Mat> pack_spot_frame_index(spot_frame_index &index)
+	{
+		std::vector<int> header = { index.frame_size.width, index.frame_size.height };
+		std::vector<cv::Mat> packed(1, pack_values(header));
+		for (int k = 0; k < index.hits.size(); k++)
+		{
+			packed.push_back(pack_values(index.hits[k]));
+		}
+
+		return packed;
+	}
+
+	/*Unpack an index packed by pack_spot_frame_index
+	**Inputs:
+	**packed: std::vector<cv::Mat> &, Packed index
+	**Returns:
+	**spot_frame_index, Unpacked index
+	*/
+	spot_frame_index unpack_spot_frame_index(std::vector<cv::Mat> &packed)
+	{
+		std::vector<int> header = unpack_values<int>(packed[0]);
+
+		spot_frame_index index;
+		index.frame_size = cv::Size(header[0], header[1]);
+		for (int k = 1; k < packed.size(); k++)
+		{
+			index.hits.push_back(unpack_values<spot_hit>(packed[k]));
+		}
+
+		return index;
+	}
+}
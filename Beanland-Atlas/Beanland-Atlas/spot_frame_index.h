@@ -0,0 +1,63 @@
+#pragma once
+
+#include <includes.h>
+
+#include <pipeline.h>
+#include <task_scheduler.h>
+
+namespace ba
+{
+	//Custom data structure to describe where a spot is on a frame it is on
+	struct spot_hit_param {
+		int frame; //Index of the frame in the image stack
+		cv::Point origin; //Position of the spot in the frame
+	};
+	typedef spot_hit_param spot_hit;
+
+	//Custom data structure to index the frames each spot is on, so that stages only visit the frames that contain a spot
+	//rather than checking every frame for every spot
+	struct spot_frame_index_param {
+		cv::Size frame_size; //Size of the frames
+		std::vector<std::vector<spot_hit>> hits; //For each spot, the frames that it is on in image stack order
+	};
+	typedef spot_frame_index_param spot_frame_index;
+
+	/*Find the frames that each spot is on. The frames are binned on a grid by their positions in the aligned pattern, so only
+	**the frames in the few cells that can contain a spot are checked
+	**Inputs:
+	**spot_pos: std::vector<cv::Point> &, Positions of located spots in aligned diffraction pattern
+	**rel_pos: std::vector<std::vector<int>> &, Relative positions of images
+	**col_max: const int, Maximum column difference between spot positions
+	**row_max: const int, Maximum row difference between spot positions
+	**frame_size: cv::Size, Size of the frames
+	**Returns:
+	**spot_frame_index, Frames that each spot is on
+	*/
+	spot_frame_index create_spot_frame_index(std::vector<cv::Point> &spot_pos, std::vector<std::vector<int>> &rel_pos,
+		const int col_max, const int row_max, cv::Size frame_size);
+
+	/*Get the hit of a spot on each frame in the image stack
+	**Inputs:
+	**hits: std::vector<spot_hit> &, Frames that the spot is on
+	**num_frames: const int, Number of frames in the image stack
+	**Returns:
+	**std::vector<int>, Index of the hit on each frame, or -1 if the spot isn't on it
+	*/
+	std::vector<int> hits_by_frame(std::vector<spot_hit> &hits, const int num_frames);
+
+	/*Pack an index so that it can be passed between pipeline stages and checkpointed with the alignment results
+	**Inputs:
+	**index: spot_frame_index &, Index to pack
+	**Returns:
+	**std::vector<cv::Mat>, Frame size, followed by the hits of each spot
+	*/
+	std::vector<cv::Mat> pack_spot_frame_index(spot_frame_index &index);
+
+	/*Unpack an index packed by pack_spot_frame_index
+	**Inputs:
+	**packed: std::vector<cv::Mat> &, Packed index
+	**Returns:
+	**spot_frame_index, Unpacked index
+	*/
+	spot_frame_index unpack_spot_frame_index(std::vector<cv::Mat> &packed);
+}
@@ -0,0 +1,196 @@
+#include <sym_quantification.h>
+
+namespace ba
+{
+	/*Preprocess the surveys for symmetry quantification. Each survey is cropped to the same size, then each of its variants is 
+	**blurred and has its spectrum calculated exactly once so that they can be shared by all of the comparisons
+	**Inputs:
+	**rot_to_align: std::vector<cv::Mat> &, Surveys that have been rotated so that they are all at the same angle to a horizontal line
+	**drawn through the brightest spot
+	**valid: std::vector<cv::Rect>, Largest rectangle of valid data in each survey. If empty, they are found from the surveys
+	**Returns:
+	**std::vector<std::vector<sym_survey>>, Preprocessed variants of each survey, indexed by survey and then variant
+	*/
+	std::vector<std::vector<sym_survey>> prepare_sym_surveys(std::vector<cv::Mat> &rot_to_align, std::vector<cv::Rect> valid)
+	{
+		const int num_surveys = rot_to_align.size();
+
+		//Trim the padding from each survey, unless it has already been tracked
+		std::vector<cv::Rect> rois = valid;
+		if (rois.empty())
+		{
+			rois.resize(num_surveys);
+			parallel_for(0, num_surveys, [&](int i)
+			{
+				rois[i] = biggest_not_black(rot_to_align[i]);
+			});
+		}
+
+		//Shrink the regions of interest to the smallest rows and columns so that every pair of surveys has the same size
+		int min_rows = INT_MAX, min_cols = INT_MAX;
+		for (int i = 0; i < num_surveys; i++)
+		{
+			min_rows = std::min(min_rows, rois[i].height);
+			min_cols = std::min(min_cols, rois[i].width);
+		}
+
+		//Flip codes of the variants
+		const int flip_codes[SYM_NUM_VAR] = { 0, 0, 1, -1 };
+
+		std::vector<std::vector<sym_survey>> prepared(num_surveys, std::vector<sym_survey>(SYM_NUM_VAR));
+		parallel_for(0, num_surveys*SYM_NUM_VAR, [&](int k)
+		{
+			int i = k / SYM_NUM_VAR, v = k % SYM_NUM_VAR;
+			cv::Mat &img = rot_to_align[i];
+			sym_survey &s = prepared[i][v];
+
+			//Centre the shrunk region of interest on the original
+			cv::Rect roi = cv::Rect(rois[i].x + (rois[i].width - min_cols) / 2, rois[i].y + (rois[i].height - min_rows) / 2,
+				min_cols, min_rows);
+
+			//Flip the survey and its region of interest
+			if (v == SYM_VAR_NONE)
+			{
+				s.img = img;
+				s.roi = roi;
+			}
+			else
+			{
+				cv::flip(img, s.img, flip_codes[v]);
+				s.roi = flip_rect(roi, img.size(), flip_codes[v]);
+			}
+
+			//Gaussian blur the region of interest, dividing by the number of elements so that sum of squared differences values
+			//won't go too high
+			s.blur = blur_by_size(s.img(s.roi)) / (s.roi.width * s.roi.height);
+		});
+
+		//All of the blurred regions of interest share a size, so they share a transform size and are centred by the same amount
+		//so that their spectra can be used for sums of squared differences against each other
+		double centre = 0.0;
+		for (int i = 0; i < num_surveys; i++)
+		{
+			centre += cv::mean(prepared[i][SYM_VAR_NONE].blur).val[0];
+		}
+		centre /= num_surveys;
+
+		cv::Size size = cv::Size(min_cols, min_rows);
+		const xcorr_plan &plan = get_xcorr_plan(size, size, (int)(QUANT_SYM_USE_FRAC*min_rows), (int)(QUANT_SYM_USE_FRAC*min_cols));
+
+		parallel_for(0, num_surveys*SYM_NUM_VAR, [&](int k)
+		{
+			sym_survey &s = prepared[k / SYM_NUM_VAR][k % SYM_NUM_VAR];
+			s.tab = get_xcorr_tables(s.blur, centre, plan);
+		});
+
+		return prepared;
+	}
+
+	/*Quantify the symmetry between a preprocessed survey and a variant of another preprocessed survey or itself
+	**Inputs:
+	**prepared: std::vector<std::vector<sym_survey>> &, Preprocessed variants of each survey
+	**task: sym_task &, Comparison to make
+	**grad_sym_use_frac: const float, Threshold this portion of the gradient based symmetry values to constrain the regions of the
+	**sum of squared differences when calculating the relative shift for internal rotational symmetry
+	**Returns:
+	**std::vector<float>, Pearson normalised product moment correlation coefficient and relative row and column shift of the second 
+	**survey, in that order
+	*/
+	std::vector<float> quantify_sym_task(std::vector<std::vector<sym_survey>> &prepared, sym_task &task, 
+		const float grad_sym_use_frac)
+	{
+		sym_survey &s1 = prepared[task.i][SYM_VAR_NONE];
+		sym_survey &s2 = prepared[task.j][task.var];
+
+		//The spectra don't depend on the padding, only the shift geometry does
+		int pad_rows = (int)(task.use_frac*s1.blur.rows);
+		int pad_cols = (int)(task.use_frac*s1.blur.cols);
+		const xcorr_plan &plan = get_xcorr_plan(s1.blur.size(), s2.blur.size(), pad_rows, pad_cols);
+
+		//Calculate the sum of squared differences
+		cv::Mat sum_sqr_diff = overlap_surface(s1.tab, s2.tab, plan, XCORR_SSD);
+
+		//Estimate the symmetry to constrain internal rotations
+		cv::Mat sym_mask;
+		if (task.wisdom == REL_SHIFT_WIS_INTERNAL_ROT)
+		{
+			cv::Mat est_sym = est_global_sym(s1.blur, task.wisdom);
+			threshold_proportion(est_sym, sym_mask, grad_sym_use_frac, cv::THRESH_BINARY_INV);
+		}
+
+		//Find the minimum sum of squared differences, applying wisdom to find the correct relative shift
+		cv::Point minLoc = rel_shift_min_loc(sum_sqr_diff, task.wisdom, sym_mask);
+
+		//Get the relative positions of the centres of highest symmetry
+		std::vector<float> sym_pos(3);
+		sym_pos[1] = s2.roi.x - s1.roi.x + pad_cols - minLoc.x;
+		sym_pos[2] = s2.roi.y - s1.roi.y + pad_rows - minLoc.y;
+
+		//Calculate Pearson normalised product moment correlation coefficient at lowest sum of squared differences and around it
+		sym_pos[0] = max_pearson_near(s1.img, s2.img, (int)sym_pos[1], (int)sym_pos[2], (int)(QUANT_GAUSS_FRAC*s1.blur.cols),
+			(int)(QUANT_GAUSS_FRAC*s1.blur.rows));
+
+		return sym_pos;
+	}
+
+	/*Quantify the mirror and rotational symmetries in and between all of the surveys. The surveys are preprocessed once, then all of
+	**the comparisons are made in parallel using the shared spectra
+	**Inputs:
+	**rot_to_align: std::vector<cv::Mat> &, Surveys that have been rotated so that they are all at the same angle to a horizontal line
+	**drawn through the brightest spot
+	**valid: std::vector<cv::Rect>, Largest rectangle of valid data in each survey. If empty, they are found from the surveys
+	**grad_sym_use_frac: const float, Threshold this portion of the gradient based symmetry values to constrain the regions of the
+	**sum of squared differences when calculating the relative shift for internal rotational symmetry
+	**Returns:
+	**sym_quant, Quantified symmetries
+	*/
+	sym_quant quantify_symmetries(std::vector<cv::Mat> &rot_to_align, std::vector<cv::Rect> valid, const float grad_sym_use_frac)
+	{
+		BA_TIME_FUNCTION();
+
+		const int num_surveys = rot_to_align.size();
+		const int num_comp = num_surveys * (num_surveys-1) / 2;
+
+		sym_quant q;
+		q.mirror_between.resize(num_comp);
+		q.rot_between.resize(num_comp);
+		q.mirror_in0.resize(num_surveys);
+		q.mirror_in1.resize(num_surveys);
+		q.rot_in.resize(num_surveys);
+
+		//Preprocess each survey once
+		std::vector<std::vector<sym_survey>> prepared = prepare_sym_surveys(rot_to_align, valid);
+
+		//Comparisons between surveys
+		std::vector<sym_task> tasks;
+		for (int i = 0, k = 0; i < num_surveys; i++)
+		{
+			for (int j = i+1; j < num_surveys; j++, k++)
+			{
+				sym_task mir = { i, j, SYM_VAR_FLIP_ROWS, QUANT_SYM_USE_FRAC, REL_SHIFT_WIS_NONE, &q.mirror_between[k] };
+				sym_task rot = { i, j, SYM_VAR_NONE, QUANT_SYM_USE_FRAC, REL_SHIFT_WIS_NONE, &q.rot_between[k] };
+				tasks.push_back(mir);
+				tasks.push_back(rot);
+			}
+		}
+
+		//Comparisons of surveys with themselves
+		for (int i = 0; i < num_surveys; i++)
+		{
+			sym_task mir0 = { i, i, SYM_VAR_FLIP_ROWS, INTERAL_MIR0_SSD_FRAC, REL_SHIFT_WIS_INTERNAL_MIR0, &q.mirror_in0[i] };
+			sym_task mir1 = { i, i, SYM_VAR_FLIP_COLS, INTERAL_MIR1_SSD_FRAC, REL_SHIFT_WIS_INTERNAL_MIR1, &q.mirror_in1[i] };
+			sym_task rot = { i, i, SYM_VAR_ROT_180, INTERAL_ROT_SSD_FRAC, REL_SHIFT_WIS_INTERNAL_ROT, &q.rot_in[i] };
+			tasks.push_back(mir0);
+			tasks.push_back(mir1);
+			tasks.push_back(rot);
+		}
+
+		//The comparisons are independent, so they are all made in parallel
+		parallel_for(0, tasks.size(), [&](int k)
+		{
+			*tasks[k].out = quantify_sym_task(prepared, tasks[k], grad_sym_use_frac);
+		}, 1);
+
+		return q;
+	}
+}
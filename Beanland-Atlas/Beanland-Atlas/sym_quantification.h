@@ -0,0 +1,89 @@
+#pragma once
+
+#include <includes.h>
+
+#include <ident_sym_utility.h>
+#include <identify_symmetry.h>
+#include <task_scheduler.h>
+#include <template_matching.h>
+#include <utility.h>
+
+namespace ba
+{
+	//Variants of a survey that can be compared against the other surveys or itself
+    #define SYM_VAR_NONE 0 //Survey as it is
+    #define SYM_VAR_FLIP_ROWS 1 //Survey flipped about a horizontal line
+    #define SYM_VAR_FLIP_COLS 2 //Survey flipped about a vertical line
+    #define SYM_VAR_ROT_180 3 //Survey rotated 180 degrees
+    #define SYM_NUM_VAR 4
+
+	//Custom data structure to hold a variant of a survey that has been preprocessed for symmetry quantification
+	struct sym_survey_param {
+		cv::Mat img; //Survey variant
+		cv::Rect roi; //Region of interest of the survey variant that was blurred
+		cv::Mat blur; //Gaussian blurred region of interest, divided by its number of elements
+		xcorr_tables tab; //Spectrum and summed-area tables of the blurred region of interest
+	};
+	typedef sym_survey_param sym_survey;
+
+	//Custom data structure to hold a comparison of a survey against a variant of another survey or itself
+	struct sym_task_param {
+		int i; //Index of the survey to compare against
+		int j; //Index of the survey whose variant is compared
+		int var; //Variant of the second survey
+		float use_frac; //Fraction of the blurred region of interest to pad it by when calculating the sum of squared differences
+		int wisdom; //Information about the comparison to constrain the relative shift
+		std::vector<float> *out; //Output Pearson normalised product moment correlation coefficient and relative shift
+	};
+	typedef sym_task_param sym_task;
+
+	//Custom data structure to hold the quantified symmetries of the surveys. Each quantification is the Pearson normalised product
+	//moment correlation coefficient and relative row and column shift of the second survey, in that order
+	struct sym_quant_param {
+		std::vector<std::vector<float>> mirror_between; //Mirror symmetry between each pair of surveys, in order of increasing indices
+		std::vector<std::vector<float>> mirror_in0; //Mirror symmetry in each survey, perpendicular to the radially outwards direction
+		std::vector<std::vector<float>> mirror_in1; //Mirror symmetry in each survey, in the radially outwards direction
+		std::vector<std::vector<float>> rot_between; //Rotational symmetry between each pair of surveys, in order of increasing indices
+		std::vector<std::vector<float>> rot_in; //180 deg rotational symmetry in each survey
+	};
+	typedef sym_quant_param sym_quant;
+
+	/*Preprocess the surveys for symmetry quantification. Each survey is cropped to the same size, then each of its variants is 
+	**blurred and has its spectrum calculated exactly once so that they can be shared by all of the comparisons
+	**Inputs:
+	**rot_to_align: std::vector<cv::Mat> &, Surveys that have been rotated so that they are all at the same angle to a horizontal line
+	**drawn through the brightest spot
+	**valid: std::vector<cv::Rect>, Largest rectangle of valid data in each survey. If empty, they are found from the surveys
+	**Returns:
+	**std::vector<std::vector<sym_survey>>, Preprocessed variants of each survey, indexed by survey and then variant
+	*/
+	std::vector<std::vector<sym_survey>> prepare_sym_surveys(std::vector<cv::Mat> &rot_to_align,
+		std::vector<cv::Rect> valid = std::vector<cv::Rect>());
+
+	/*Quantify the symmetry between a preprocessed survey and a variant of another preprocessed survey or itself
+	**Inputs:
+	**prepared: std::vector<std::vector<sym_survey>> &, Preprocessed variants of each survey
+	**task: sym_task &, Comparison to make
+	**grad_sym_use_frac: const float, Threshold this portion of the gradient based symmetry values to constrain the regions of the
+	**sum of squared differences when calculating the relative shift for internal rotational symmetry
+	**Returns:
+	**std::vector<float>, Pearson normalised product moment correlation coefficient and relative row and column shift of the second 
+	**survey, in that order
+	*/
+	std::vector<float> quantify_sym_task(std::vector<std::vector<sym_survey>> &prepared, sym_task &task, 
+		const float grad_sym_use_frac = GRAD_SYM_USE);
+
+	/*Quantify the mirror and rotational symmetries in and between all of the surveys. The surveys are preprocessed once, then all of
+	**the comparisons are made in parallel using the shared spectra
+	**Inputs:
+	**rot_to_align: std::vector<cv::Mat> &, Surveys that have been rotated so that they are all at the same angle to a horizontal line
+	**drawn through the brightest spot
+	**valid: std::vector<cv::Rect>, Largest rectangle of valid data in each survey. If empty, they are found from the surveys
+	**grad_sym_use_frac: const float, Threshold this portion of the gradient based symmetry values to constrain the regions of the
+	**sum of squared differences when calculating the relative shift for internal rotational symmetry
+	**Returns:
+	**sym_quant, Quantified symmetries
+	*/
+	sym_quant quantify_symmetries(std::vector<cv::Mat> &rot_to_align, std::vector<cv::Rect> valid = std::vector<cv::Rect>(),
+		const float grad_sym_use_frac = GRAD_SYM_USE);
+}
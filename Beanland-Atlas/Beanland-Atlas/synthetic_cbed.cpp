@@ -0,0 +1,301 @@
+#include <synthetic_cbed.h>
+
+namespace ba
+{
+	/*Default parameters for a synthetic tilt series. The lattice, disks and scan scale with the frame size
+	**Inputs:
+	**rows: const int, Rows in each frame
+	**cols: const int, Columns in each frame
+	**num_tilts: const int, Beam tilts either side of the centre of each row and column of the scan
+	**num_g: const int, Number of reflections either side of the direct beam along each lattice vector
+	**Returns:
+	**synth_cbed_spec, Parameters of the tilt series
+	*/
+	synth_cbed_spec default_synth_cbed_spec(const int rows, const int cols, const int num_tilts, const int num_g)
+	{
+		synth_cbed_spec spec;
+		spec.rows = rows;
+		spec.cols = cols;
+		spec.num_tilts = num_tilts;
+		spec.num_g1 = num_g;
+		spec.num_g2 = num_g;
+
+		//Slightly rotated, oblique lattice so that the reflections along both vectors fit in the frames
+		spec.g1 = cv::Point2f(0.2f*cols, 0.03f*rows);
+		spec.g2 = cv::Point2f(-0.04f*cols, 0.21f*rows);
+
+		//Large angle disks that nearly touch, scanned over about their radius so that the Bragg conditions of the nearest
+		//reflections are crossed
+		spec.radius = 0.35f*std::min(std::sqrt(spec.g1.dot(spec.g1)), std::sqrt(spec.g2.dot(spec.g2)));
+		spec.tilt_inc = std::max(1, (int)(spec.radius/std::max(1, num_tilts)));
+
+		spec.thickness = SYNTH_THICKNESS;
+		spec.bragg_width = spec.radius;
+		spec.background = SYNTH_BACKGROUND;
+		spec.dose = SYNTH_DOSE;
+		spec.seed = 0;
+
+		return spec;
+	}
+
+	/*Get the beam tilt of a frame of a tilt series. Tilts are scanned in a boustrophedon raster, as D-LACBED acquisition does
+	**Inputs:
+	**num_tilts: const int, Beam tilts either side of the centre of each row and column of the scan
+	**frame: const int, Index of the frame in the series
+	**Returns:
+	**cv::Point, Tilt indices across and down the scan
+	*/
+	cv::Point synth_scan_tilt(const int num_tilts, const int frame)
+	{
+		int side = 2*num_tilts+1;
+
+		int y = frame/side - num_tilts;
+		int x = ((frame % side) - num_tilts)*(y % 2 ? -1 : 1); //Flip sign every row
+
+		return cv::Point(x, y);
+	}
+
+	/*Two-beam rocking curve intensity of a reflection
+	**Inputs:
+	**k: cv::Point2f, Incident beam direction relative to the zone axis, in px
+	**g: cv::Point2f, Reflection, in px
+	**g_len: const float, Length of the reflection
+	**spec: synth_cbed_spec &, Parameters of the tilt series
+	**Returns:
+	**float, Fraction of the incident intensity diffracted into the reflection
+	*/
+	static float two_beam_intensity(cv::Point2f k, cv::Point2f g, const float g_len, synth_cbed_spec &spec)
+	{
+		//Deviation from the Bragg condition, which is met when the beam is halfway to the reflection
+		float w = (k.dot(g) + 0.5f*g_len*g_len) / (g_len*spec.bragg_width);
+		float v = 1.0f + w*w;
+		float s = std::sin((float)PI*spec.thickness*std::sqrt(v));
+
+		return s*s / v;
+	}
+
+	/*Create a synthetic CBED tilt series. Each frame has a lattice of disks with two-beam rocking curve intensities, translated
+	**by the beam tilt, on a diffuse background, with Poisson noise
+	**Inputs:
+	**spec: synth_cbed_spec &, Parameters of the tilt series
+	**Returns:
+	**synth_cbed, Frames and their ground truth
+	*/
+	synth_cbed create_synth_cbed(synth_cbed_spec &spec)
+	{
+		const int num_frames = (2*spec.num_tilts+1)*(2*spec.num_tilts+1);
+		const float r2 = spec.radius*spec.radius;
+		const float sigma2 = 0.0625f*std::max(spec.rows, spec.cols)*std::max(spec.rows, spec.cols);
+
+		//Reflections, direct beam first
+		std::vector<cv::Point2f> g(1, cv::Point2f(0.0f, 0.0f));
+		for (int i = -spec.num_g1; i <= spec.num_g1; i++)
+		{
+			for (int j = -spec.num_g2; j <= spec.num_g2; j++)
+			{
+				if (i || j)
+				{
+					g.push_back((float)i*spec.g1 + (float)j*spec.g2);
+				}
+			}
+		}
+		std::vector<float> g_len(g.size());
+		for (int m = 0; m < g.size(); m++)
+		{
+			g_len[m] = std::sqrt(g[m].dot(g[m]));
+		}
+
+		synth_cbed data;
+		data.frames.resize(num_frames);
+		data.shifts.resize(num_frames);
+
+		cv::Point first_tilt = spec.tilt_inc*synth_scan_tilt(spec.num_tilts, 0);
+		cv::Point2f centre(0.5f*spec.cols, 0.5f*spec.rows);
+		for (int m = 0; m < g.size(); m++)
+		{
+			cv::Point2f c = centre + cv::Point2f(first_tilt) + g[m];
+			if (c.x >= 0.0f && c.x < spec.cols && c.y >= 0.0f && c.y < spec.rows)
+			{
+				data.spot_pos.push_back(c);
+			}
+		}
+
+		parallel_for(0, num_frames, [&](int f)
+		{
+			cv::Point tilt = spec.tilt_inc*synth_scan_tilt(spec.num_tilts, f);
+			data.shifts[f] = tilt - first_tilt;
+			cv::Point2f direct = centre + cv::Point2f(tilt);
+
+			//Diffuse background that moves with the direct beam
+			cv::Mat intensity(spec.rows, spec.cols, CV_32FC1);
+			for (int y = 0; y < spec.rows; y++)
+			{
+				float *p = intensity.ptr<float>(y);
+				for (int x = 0; x < spec.cols; x++)
+				{
+					float dx = x - direct.x, dy = y - direct.y;
+					p[x] = spec.background*std::exp(-(dx*dx + dy*dy) / (2*sigma2));
+				}
+			}
+
+			//Disks. The direct beam loses the intensity diffracted into every reflection
+			for (int m = 0; m < g.size(); m++)
+			{
+				cv::Point2f c = direct + g[m];
+				int y_min = std::max(0, (int)std::ceil(c.y - spec.radius));
+				int y_max = std::min(spec.rows-1, (int)std::floor(c.y + spec.radius));
+				int x_min = std::max(0, (int)std::ceil(c.x - spec.radius));
+				int x_max = std::min(spec.cols-1, (int)std::floor(c.x + spec.radius));
+
+				for (int y = y_min; y <= y_max; y++)
+				{
+					float *p = intensity.ptr<float>(y);
+					for (int x = x_min; x <= x_max; x++)
+					{
+						cv::Point2f d(x - c.x, y - c.y);
+						if (d.dot(d) > r2)
+						{
+							continue;
+						}
+
+						//Direction of the incident beam that is diffracted to this px
+						cv::Point2f k = d + cv::Point2f(tilt);
+						if (m)
+						{
+							p[x] += two_beam_intensity(k, g[m], g_len[m], spec);
+						}
+						else
+						{
+							float diffracted = 0.0f;
+							for (int n = 1; n < g.size(); n++)
+							{
+								diffracted += two_beam_intensity(k, g[n], g_len[n], spec);
+							}
+							p[x] += std::max(0.0f, 1.0f - diffracted);
+						}
+					}
+				}
+			}
+
+			//Poisson noise. Each frame has its own generator so that the noise doesn't depend on the number of threads
+			std::seed_seq seq = { (uint32_t)spec.seed, (uint32_t)(spec.seed >> 32), (uint32_t)f };
+			std::mt19937_64 gen(seq);
+			data.frames[f] = cv::Mat(spec.rows, spec.cols, CV_32FC1);
+			for (int y = 0; y < spec.rows; y++)
+			{
+				float *p = intensity.ptr<float>(y);
+				float *q = data.frames[f].ptr<float>(y);
+				for (int x = 0; x < spec.cols; x++)
+				{
+					double mean = spec.dose*p[x];
+					q[x] = mean > 0.0 ? (float)std::poisson_distribution<int>(mean)(gen) : 0.0f;
+				}
+			}
+		}, 1);
+
+		return data;
+	}
+
+	/*Root mean square error of relative image positions against the ground truth. The positions are compared in the convention
+	**the pipeline places frames with, where frame j's origin in the aligned pattern is (col_max-refined_pos[0][j],
+	**row_max-refined_pos[1][j]). Its disks are therefore shifted by refined_pos[0][j] across and refined_pos[1][j] down
+	**relative to those of the first frame, so swapped axes or signs are errors
+	**Inputs:
+	**data: synth_cbed &, Synthetic tilt series
+	**refined_pos: std::vector<std::vector<int>> &, Positions of the frames relative to the first, as from refine_rel_pos.
+	**Index 0 - columns, index 1 - rows
+	**Returns:
+	**float, Root mean square error in px
+	*/
+	float synth_shift_error(synth_cbed &data, std::vector<std::vector<int>> &refined_pos)
+	{
+		const int num = std::min(data.shifts.size(), refined_pos[0].size());
+
+		double sum_sqr = 0.0;
+		for (int i = 0; i < num; i++)
+		{
+			double dx = (refined_pos[0][i] - refined_pos[0][0]) - data.shifts[i].x;
+			double dy = (refined_pos[1][i] - refined_pos[1][0]) - data.shifts[i].y;
+			sum_sqr += dx*dx + dy*dy;
+		}
+
+		return num ? (float)std::sqrt(sum_sqr/num) : 0.0f;
+	}
+
+	/*Root mean square error of spot positions against the ground truth. Spot positions are relative to an unknown origin, so
+	**they are compared after the translation that matches the most spots to disks
+	**Inputs:
+	**data: synth_cbed &, Synthetic tilt series
+	**spot_pos: std::vector<cv::Point> &, Positions of the spots
+	**match_dist: const float, Spots further than this from every disk are not matched
+	**recall: float &, Output fraction of the disks in the first frame that were matched
+	**Returns:
+	**float, Root mean square distance in px of the matched spots from their disks
+	*/
+	float synth_spot_error(synth_cbed &data, std::vector<cv::Point> &spot_pos, const float match_dist, float &recall)
+	{
+		const float match_dist2 = match_dist*match_dist;
+
+		//Every pairing of a spot and a disk is a candidate translation
+		int best_matches = 0;
+		std::vector<cv::Point2f> best_residuals;
+		for (int a = 0; a < spot_pos.size(); a++)
+		{
+			for (int b = 0; b < data.spot_pos.size(); b++)
+			{
+				cv::Point2f offset = cv::Point2f(spot_pos[a]) - data.spot_pos[b];
+
+				//Match each disk to the nearest spot
+				std::vector<cv::Point2f> residuals;
+				for (int t = 0; t < data.spot_pos.size(); t++)
+				{
+					float min_dist2 = FLT_MAX;
+					cv::Point2f residual;
+					for (int s = 0; s < spot_pos.size(); s++)
+					{
+						cv::Point2f d = cv::Point2f(spot_pos[s]) - offset - data.spot_pos[t];
+						if (d.dot(d) < min_dist2)
+						{
+							min_dist2 = d.dot(d);
+							residual = d;
+						}
+					}
+
+					if (min_dist2 <= match_dist2)
+					{
+						residuals.push_back(residual);
+					}
+				}
+
+				if (residuals.size() > best_matches)
+				{
+					best_matches = residuals.size();
+					best_residuals = residuals;
+				}
+			}
+		}
+
+		recall = data.spot_pos.empty() ? 0.0f : (float)best_matches / data.spot_pos.size();
+		if (!best_matches)
+		{
+			return 0.0f;
+		}
+
+		//Remove the part of the translation that the spots agree on
+		cv::Point2f mean(0.0f, 0.0f);
+		for (int i = 0; i < best_residuals.size(); i++)
+		{
+			mean += best_residuals[i];
+		}
+		mean *= 1.0f/best_matches;
+
+		double sum_sqr = 0.0;
+		for (int i = 0; i < best_residuals.size(); i++)
+		{
+			cv::Point2f d = best_residuals[i] - mean;
+			sum_sqr += d.dot(d);
+		}
+
+		return (float)std::sqrt(sum_sqr/best_matches);
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <includes.h>
+
+#include <task_scheduler.h>
+
+namespace ba
+{
+	//Default specimen thickness of synthetic tilt series in extinction distances
+    #define SYNTH_THICKNESS 1.3f
+
+	//Default peak of the diffuse background of synthetic tilt series, relative to the incident beam intensity
+    #define SYNTH_BACKGROUND 0.05f
+
+	//Default mean counts per px for the incident beam intensity of synthetic tilt series
+    #define SYNTH_DOSE 200.0f
+
+	//Custom data structure to hold the parameters of a synthetic CBED tilt series
+	struct synth_cbed_spec_param {
+		int rows; //Rows in each frame
+		int cols; //Columns in each frame
+		int num_tilts; //Beam tilts either side of the centre of each row and column of the scan. There are (2*num_tilts+1)^2 frames
+		int tilt_inc; //Distance in px that the disks move between consecutive beam tilts
+		float radius; //Radius of the disks
+		cv::Point2f g1; //First lattice vector, across and down the frames in px
+		cv::Point2f g2; //Second lattice vector, across and down the frames in px
+		int num_g1; //Number of reflections either side of the direct beam along g1
+		int num_g2; //Number of reflections either side of the direct beam along g2
+		float thickness; //Specimen thickness in extinction distances. This sets the Pendellosung fringes in the disks
+		float bragg_width; //Deviation from the Bragg condition in px that halves the two-beam intensity envelope
+		float background; //Peak of the diffuse background, relative to the incident beam intensity
+		float dose; //Mean counts per px for the incident beam intensity. Poisson noise is added for this dose
+		uint64_t seed; //Seed of the noise. The same parameters and seed always give the same frames
+	};
+	typedef synth_cbed_spec_param synth_cbed_spec;
+
+	//Custom data structure to hold a synthetic CBED tilt series and its ground truth
+	struct synth_cbed_param {
+		std::vector<cv::Mat> frames; //32-bit frames of counts, in the order of the scan
+		std::vector<cv::Point> shifts; //Shift of the disks in each frame relative to the first frame, across and down
+		std::vector<cv::Point2f> spot_pos; //Centres of the disks in the first frame, direct beam first
+	};
+	typedef synth_cbed_param synth_cbed;
+
+	/*Default parameters for a synthetic tilt series. The lattice, disks and scan scale with the frame size
+	**Inputs:
+	**rows: const int, Rows in each frame
+	**cols: const int, Columns in each frame
+	**num_tilts: const int, Beam tilts either side of the centre of each row and column of the scan
+	**num_g: const int, Number of reflections either side of the direct beam along each lattice vector
+	**Returns:
+	**synth_cbed_spec, Parameters of the tilt series
+	*/
+	synth_cbed_spec default_synth_cbed_spec(const int rows, const int cols, const int num_tilts, const int num_g);
+
+	/*Get the beam tilt of a frame of a tilt series. Tilts are scanned in a boustrophedon raster, as D-LACBED acquisition does
+	**Inputs:
+	**num_tilts: const int, Beam tilts either side of the centre of each row and column of the scan
+	**frame: const int, Index of the frame in the series
+	**Returns:
+	**cv::Point, Tilt indices across and down the scan
+	*/
+	cv::Point synth_scan_tilt(const int num_tilts, const int frame);
+
+	/*Create a synthetic CBED tilt series. Each frame has a lattice of disks with two-beam rocking curve intensities, translated
+	**by the beam tilt, on a diffuse background, with Poisson noise
+	**Inputs:
+	**spec: synth_cbed_spec &, Parameters of the tilt series
+	**Returns:
+	**synth_cbed, Frames and their ground truth
+	*/
+	synth_cbed create_synth_cbed(synth_cbed_spec &spec);
+
+	/*Root mean square error of relative image positions against the ground truth. The positions are compared in the convention
+	**the pipeline places frames with, where frame j's origin in the aligned pattern is (col_max-refined_pos[0][j],
+	**row_max-refined_pos[1][j]). Its disks are therefore shifted by refined_pos[0][j] across and refined_pos[1][j] down
+	**relative to those of the first frame, so swapped axes or signs are errors
+	**Inputs:
+	**data: synth_cbed &, Synthetic tilt series
+	**refined_pos: std::vector<std::vector<int>> &, Positions of the frames relative to the first, as from refine_rel_pos.
+	**Index 0 - columns, index 1 - rows
+	**Returns:
+	**float, Root mean square error in px
+	*/
+	float synth_shift_error(synth_cbed &data, std::vector<std::vector<int>> &refined_pos);
+
+	/*Root mean square error of spot positions against the ground truth. Spot positions are relative to an unknown origin, so
+	**they are compared after the translation that matches the most spots to disks
+	**Inputs:
+	**data: synth_cbed &, Synthetic tilt series
+	**spot_pos: std::vector<cv::Point> &, Positions of the spots
+	**match_dist: const float, Spots further than this from every disk are not matched
+	**recall: float &, Output fraction of the disks in the first frame that were matched
+	**Returns:
+	**float, Root mean square distance in px of the matched spots from their disks
+	*/
+	float synth_spot_error(synth_cbed &data, std::vector<cv::Point> &spot_pos, const float match_dist, float &recall);
+}
@@ -0,0 +1,297 @@
+#include <task_scheduler.h>
+
+namespace ba
+{
+	//Custom data structure to hold the state shared by the tasks of a call to parallel_for
+	struct task_group_param {
+		std::atomic<int> pending; //Number of tasks that haven't finished
+		std::mutex mutex; //Serialises recording of the first exception
+		std::exception_ptr exception; //First exception thrown by a task
+	};
+	typedef task_group_param task_group;
+
+	//Custom data structure to hold a task: a range of a parallel loop
+	struct task_param {
+		int begin; //First index
+		int end; //One past the last index
+		int grain; //Ranges at most this long are not split
+		const std::function<void(int)> *fn; //Function to call for each index
+		task_group *group; //Group the task belongs to
+	};
+	typedef task_param task;
+
+	//Custom data structure to hold the tasks queued by a thread. The owner takes the most recently queued task, which is the
+	//smallest and most likely to be in its cache, while thieves take the oldest, which is the largest
+	struct task_deque_param {
+		std::mutex mutex;
+		std::deque<task> tasks;
+	};
+	typedef task_deque_param task_deque;
+
+	//Queues of the worker threads. The last queue is shared by threads that aren't workers
+	static std::vector<std::unique_ptr<task_deque>> task_deques;
+	static std::vector<std::thread> task_workers;
+
+	//Idle workers sleep until tasks are queued or the scheduler stops
+	static std::mutex task_sleep_mutex;
+	static std::condition_variable task_wake;
+	static std::atomic<int> task_queued(0);
+	static std::atomic<bool> task_stop(false);
+
+	//Index of the calling thread's queue
+	static thread_local int task_worker_idx = -1;
+
+	/*Get the queue of the calling thread
+	**Returns:
+	**task_deque &, Queue
+	*/
+	static task_deque &own_deque()
+	{
+		return *task_deques[task_worker_idx >= 0 ? task_worker_idx : task_deques.size()-1];
+	}
+
+	/*Queue a task so that it can be stolen
+	**Inputs:
+	**t: const task &, Task to queue
+	*/
+	static void push_task(const task &t)
+	{
+		task_deque &d = own_deque();
+		{
+			std::lock_guard<std::mutex> lock(d.mutex);
+			d.tasks.push_back(t);
+		}
+		task_queued++;
+
+		std::lock_guard<std::mutex> lock(task_sleep_mutex);
+		task_wake.notify_one();
+	}
+
+	/*Take a task from the calling thread's queue or steal one from another queue
+	**Inputs:
+	**t: task &, Output task
+	**Returns:
+	**bool, True if a task was taken
+	*/
+	static bool take_task(task &t)
+	{
+		if (!task_queued)
+		{
+			return false;
+		}
+
+		task_deque &own = own_deque();
+		{
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty())
+			{
+				t = own.tasks.back();
+				own.tasks.pop_back();
+				task_queued--;
+				return true;
+			}
+		}
+
+		//Start stealing from the next queue so that thieves spread out
+		const int num_deques = task_deques.size();
+		const int start = task_worker_idx >= 0 ? task_worker_idx+1 : 0;
+		for (int k = 0; k < num_deques; k++)
+		{
+			task_deque &d = *task_deques[(start + k) % num_deques];
+			std::lock_guard<std::mutex> lock(d.mutex);
+			if (!d.tasks.empty())
+			{
+				t = d.tasks.front();
+				d.tasks.pop_front();
+				task_queued--;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/*Run a task. Its range is halved until it is no longer than the grain, queueing the upper halves
+	**Inputs:
+	**t: task, Task to run
+	*/
+	static void run_task(task t)
+	{
+		while (t.end - t.begin > t.grain)
+		{
+			int mid = t.begin + (t.end - t.begin)/2;
+
+			t.group->pending++;
+			push_task({ mid, t.end, t.grain, t.fn, t.group });
+			t.end = mid;
+		}
+
+		try
+		{
+			for (int i = t.begin; i < t.end; i++)
+			{
+				(*t.fn)(i);
+			}
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(t.group->mutex);
+			if (!t.group->exception)
+			{
+				t.group->exception = std::current_exception();
+			}
+		}
+
+		t.group->pending--;
+	}
+
+	/*Run tasks until there are none, then sleep until more are queued
+	**Inputs:
+	**idx: const int, Index of the worker's queue
+	*/
+	static void worker_loop(const int idx)
+	{
+		task_worker_idx = idx;
+
+		//Tasks are already spread over every thread, so OpenMP regions inside them mustn't start more
+		omp_set_num_threads(1);
+
+		while (true)
+		{
+			task t;
+			if (take_task(t))
+			{
+				run_task(t);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(task_sleep_mutex);
+			task_wake.wait(lock, [] { return task_stop || task_queued > 0; });
+			if (task_stop)
+			{
+				return;
+			}
+		}
+	}
+
+	/*Start the threads that run tasks. All parallel loops share them, so this is the concurrency limit of the whole program.
+	**Threads that wait for tasks to finish run other tasks, so nested loops split their work rather than adding threads. 
+	**OpenMP regions inside tasks run on 1 thread for the same reason
+	**Inputs:
+	**num_threads: const int, Number of threads that run tasks, including the thread that calls parallel_for. If this is 0,
+	**the number of concurrent threads the hardware supports is used
+	*/
+	void init_task_scheduler(const int num_threads)
+	{
+		close_task_scheduler();
+
+		int n = num_threads > 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+
+		//The calling thread runs tasks while it waits, so it is one of the threads. Like the workers, its OpenMP regions
+		//mustn't start more threads on top of the busy pool
+		omp_set_num_threads(1);
+		task_stop = false;
+		task_deques.resize(n);
+		for (int i = 0; i < n; i++)
+		{
+			task_deques[i].reset(new task_deque);
+		}
+		for (int i = 0; i < n-1; i++)
+		{
+			task_workers.push_back(std::thread(worker_loop, i));
+		}
+	}
+
+	/*Stop the threads that run tasks. Parallel loops run serially until the scheduler is started again. This must not be 
+	**called while tasks are running
+	*/
+	void close_task_scheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(task_sleep_mutex);
+			task_stop = true;
+			task_wake.notify_all();
+		}
+
+		for (int i = 0; i < task_workers.size(); i++)
+		{
+			task_workers[i].join();
+		}
+		task_workers.clear();
+		task_deques.clear();
+	}
+
+	/*Get the number of threads that run tasks
+	**Returns:
+	**int, Number of threads, including the thread that calls parallel_for. This is 1 if the scheduler isn't running
+	*/
+	int task_concurrency()
+	{
+		return std::max(1, (int)task_deques.size());
+	}
+
+	/*Call a function for every index in a range in parallel. The range is split in half recursively: one half is queued for 
+	**idle threads to steal and the other is split further, until the ranges are no longer than the grain. The calling thread
+	**runs tasks until the whole range is done. If any call throws, the first exception is rethrown once the range is done
+	**Inputs:
+	**begin: const int, First index
+	**end: const int, One past the last index
+	**fn: const std::function<void(int)> &, Function to call for each index
+	**grain: const int, Ranges at most this long are not split. If this is 0, the range is split into about TASKS_PER_THREAD
+	**ranges per thread
+	*/
+	void parallel_for(const int begin, const int end, const std::function<void(int)> &fn, const int grain)
+	{
+		const int n = end - begin;
+		if (n <= 0)
+		{
+			return;
+		}
+
+		//Run serially if there is nothing to share
+		const int num_threads = task_concurrency();
+		if (num_threads == 1 || n == 1)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				fn(i);
+			}
+			return;
+		}
+
+		task_group group;
+		group.pending = 1;
+		run_task({ begin, end, grain > 0 ? grain : std::max(1, n / (TASKS_PER_THREAD*num_threads)), &fn, &group });
+
+		//Help with any tasks while this range finishes, rather than blocking a thread
+		while (group.pending > 0)
+		{
+			task t;
+			if (take_task(t))
+			{
+				run_task(t);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		if (group.exception)
+		{
+			std::rethrow_exception(group.exception);
+		}
+	}
+
+	/*Call functions in parallel
+	**Inputs:
+	**fns: const std::vector<std::function<void()>> &, Functions to call
+	*/
+	void parallel_invoke(const std::vector<std::function<void()>> &fns)
+	{
+		parallel_for(0, fns.size(), [&](int i)
+		{
+			fns[i]();
+		}, 1);
+	}
+}
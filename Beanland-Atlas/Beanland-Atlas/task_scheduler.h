@@ -0,0 +1,93 @@
+#pragma once
+
+#include <includes.h>
+
+namespace ba
+{
+	//Number of tasks per thread that loops are split into when no grain is given. More tasks balance uneven iterations
+	//better, fewer have less overhead
+    #define TASKS_PER_THREAD 8
+
+	//Number of chunks that reductions are split into when no chunk size is given. It doesn't depend on the number of threads,
+	//so the order that floating point partial results are combined in is the same for every thread count
+    #define REDUCE_NUM_CHUNKS 64
+
+	/*Start the threads that run tasks. All parallel loops share them, so this is the concurrency limit of the whole program.
+	**Threads that wait for tasks to finish run other tasks, so nested loops split their work rather than adding threads. 
+	**OpenMP regions inside tasks run on 1 thread for the same reason
+	**Inputs:
+	**num_threads: const int, Number of threads that run tasks, including the thread that calls parallel_for. If this is 0,
+	**the number of concurrent threads the hardware supports is used
+	*/
+	void init_task_scheduler(const int num_threads = 0);
+
+	/*Stop the threads that run tasks. Parallel loops run serially until the scheduler is started again. This must not be 
+	**called while tasks are running
+	*/
+	void close_task_scheduler();
+
+	/*Get the number of threads that run tasks
+	**Returns:
+	**int, Number of threads, including the thread that calls parallel_for. This is 1 if the scheduler isn't running
+	*/
+	int task_concurrency();
+
+	/*Call a function for every index in a range in parallel. The range is split in half recursively: one half is queued for 
+	**idle threads to steal and the other is split further, until the ranges are no longer than the grain. The calling thread
+	**runs tasks until the whole range is done. If any call throws, the first exception is rethrown once the range is done
+	**Inputs:
+	**begin: const int, First index
+	**end: const int, One past the last index
+	**fn: const std::function<void(int)> &, Function to call for each index
+	**grain: const int, Ranges at most this long are not split. If this is 0, the range is split into about TASKS_PER_THREAD
+	**ranges per thread
+	*/
+	void parallel_for(const int begin, const int end, const std::function<void(int)> &fn, const int grain = 0);
+
+	/*Call functions in parallel
+	**Inputs:
+	**fns: const std::vector<std::function<void()>> &, Functions to call
+	*/
+	void parallel_invoke(const std::vector<std::function<void()>> &fns);
+
+	/*Reduce a range in parallel. The range is split into contiguous chunks that are reduced separately and then combined in
+	**order. The chunks only depend on the range and the chunk size, so the result doesn't depend on the number of threads
+	**as long as the chunk size doesn't either
+	**Inputs:
+	**begin: const int, First index
+	**end: const int, One past the last index
+	**identity: const T &, Result for an empty range
+	**chunk: const std::function<T(int, int)> &, Reduce the indices from its first argument to one before its second
+	**combine: const std::function<T(const T &, const T &)> &, Combine the reductions of 2 consecutive ranges
+	**chunk_size: const int, Number of indices in each chunk. If this is 0, the range is split into REDUCE_NUM_CHUNKS chunks
+	**Returns:
+	**T, Reduction of the range
+	*/
+	template<typename T> T parallel_reduce(const int begin, const int end, const T &identity, 
+		const std::function<T(int, int)> &chunk, const std::function<T(const T &, const T &)> &combine, 
+		const int chunk_size = 0)
+	{
+		const int n = end - begin;
+		if (n <= 0)
+		{
+			return identity;
+		}
+
+		int size = chunk_size > 0 ? chunk_size : (n + REDUCE_NUM_CHUNKS - 1) / REDUCE_NUM_CHUNKS;
+		int num_chunks = (n + size - 1) / size;
+
+		std::vector<T> partial(num_chunks, identity);
+		parallel_for(0, num_chunks, [&](int t)
+		{
+			partial[t] = chunk(begin + t*size, std::min(end, begin + (t+1)*size));
+		}, 1);
+
+		T total = identity;
+		for (int t = 0; t < num_chunks; t++)
+		{
+			total = combine(total, partial[t]);
+		}
+
+		return total;
+	}
+}
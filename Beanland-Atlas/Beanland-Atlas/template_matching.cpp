@@ -2,548 +2,235 @@
 
 namespace ba
 {
-	/*Sum of squared differences between 2 images. The second images is correlated against the first in the Fourier domain
-	**src1: cv::Mat &, One of the images
-	**src2: cv::Mat &, The second image
-	**frac: float, Proportion of the first image's dimensions to pad it by
-	**Returns,
-	**cv::Mat, Sum of the squared differences
+	/*Sum of the elements of a rectangular region from a 64-bit summed-area table
+	**Inputs:
+	**integ: cv::Mat &, Summed-area table
+	**r0: const int, First row of the region
+	**r1: const int, One past the last row of the region
+	**c0: const int, First column of the region
+	**c1: const int, One past the last column of the region
+	**Returns:
+	**double, Sum of the elements in the region
 	*/
-	cv::Mat ssd(cv::Mat &src1, cv::Mat &src2, float frac)
+	static inline double rect_sum(cv::Mat &integ, const int r0, const int r1, const int c0, const int c1)
 	{
-		//Pad the first matrix to prepare it for the second matrix being correlated accross it
-		cv::Mat pad1;
-		int pad_rows = (int)(frac*src1.rows);
-		int pad_cols = (int)(frac*src1.cols);
-		cv::copyMakeBorder(src1, pad1, pad_rows, pad_rows, pad_cols, pad_cols, cv::BORDER_CONSTANT, 0.0);
-
-		//Calculate the sum of squared differences in the Fourier domain
-		cv::Mat ssd;
-		cv::matchTemplate(pad1, src2, ssd, cv::TM_SQDIFF);
-
-		//Calculate the cumulative rowwise and columnwise sums of squares. These can be used to calculate additive corrections
-		//to the calculate sum of squared differences where the templates did not overlap
-		float *r, *s;
-
-		/* Left */
-		//Iterate across mat rows...
-		cv::Mat left = cv::Mat(src2.rows, pad_cols, CV_32FC1);
-		for (int i = 0; i < left.rows; i++)
-		{
-			//Initialise pointers
-			r = left.ptr<float>(i);
-			s = src2.ptr<float>(i);
-
-			//Calculate the square of the first column element
-			r[left.cols-1] = s[0]*s[0];
+		const double *p = integ.ptr<double>(r0);
+		const double *q = integ.ptr<double>(r1);
+		return q[c1] - q[c0] - p[c1] + p[c0];
+	}
 
-			//Iterate across the remaining mat columns, accumulating the sum of squares
-			for (int j = left.cols-2, k = 1; j >= 0; j--, k++)
-			{
-				r[j] = s[k]*s[k] + r[j+1];
-			}
-		}
+	/*Get the overlapping ranges of 2 lines of pixels when the second is shifted relative to the first
+	**Inputs:
+	**len1: const int, Length of the first line
+	**len2: const int, Length of the second line
+	**shift: const int, Position of the start of the second line relative to the start of the first
+	**Returns:
+	**cv::Vec4i, First and one past the last overlapping pixels of the first line and then the second line
+	*/
+	static cv::Vec4i line_overlap(const int len1, const int len2, const int shift)
+	{
+		int lo1 = std::max(0, shift);
+		int hi1 = std::max(lo1, std::min(len1, len2 + shift));
 
-		/* Right */
-		//Iterate across mat rows...
-		cv::Mat right = cv::Mat(src2.rows, pad_cols, CV_32FC1);
-		for (int i = 0; i < right.rows; i++)
-		{
-			//Initialise pointers
-			r = right.ptr<float>(i);
-			s = src2.ptr<float>(i);
+		return cv::Vec4i(lo1, hi1, lo1 - shift, hi1 - shift);
+	}
 
-			//Calculate the square of the first column element
-			r[0] = s[src2.cols-1]*s[src2.cols-1];
+	/*Get the plan to correlate an image against another. Plans are cached so that they only have to be created once for each
+	**combination of sizes
+	**Inputs:
+	**size1: cv::Size, Size of the image being correlated against
+	**size2: cv::Size, Size of the image being correlated across the first
+	**pad_rows: const int, Number of rows the second image can extend past the top and bottom of the first
+	**pad_cols: const int, Number of columns the second image can extend past the left and right of the first
+	**Returns:
+	**const xcorr_plan &, Plan to correlate images of these sizes
+	*/
+	const xcorr_plan &get_xcorr_plan(cv::Size size1, cv::Size size2, const int pad_rows, const int pad_cols)
+	{
+		//Plans are never removed so references to them stay valid after the lock is released
+		static std::map<std::array<int, 6>, xcorr_plan> plans;
+		static std::mutex plans_mutex;
 
-			//Iterate across the remaining mat columns, accumulating the sum of squares
-			for (int j = 1, k = src2.cols-2; j < right.cols; j++, k--)
-			{
-				r[j] = s[k]*s[k] + r[j-1];
-			}
-		}
+		std::array<int, 6> key = { size1.height, size1.width, size2.height, size2.width, pad_rows, pad_cols };
 
-		/* Top */
-		//Iterate across mat cols
-		cv::Mat top = cv::Mat(pad_rows, src2.cols, CV_32FC1);
-		for (int i = 0; i < top.cols; i++)
+		std::lock_guard<std::mutex> lock(plans_mutex);
+		std::map<std::array<int, 6>, xcorr_plan>::iterator it = plans.find(key);
+		if (it != plans.end())
 		{
-
-			//Calculate the square of the first row element
-			top.at<float>(top.rows-1, i) = src2.at<float>(0, i)*src2.at<float>(0, i);
-
-			//Iterate across the remaining mat rows, accumulating the sum of squares
-			for (int j = top.rows-2, k = 1; j >= 0; j--, k++)
-			{
-				top.at<float>(j, i) = src2.at<float>(k, i)*src2.at<float>(k, i) + top.at<float>(j+1, i);
-			}
+			return it->second;
 		}
 
-		/* Bottom */
-		//Iterate across mat cols...
-		cv::Mat bot = cv::Mat(pad_rows, src2.cols, CV_32FC1);
-		for (int i = 0; i < bot.cols; i++)
-		{
-			//Calculate the square of the first row element
-			bot.at<float>(0, i) = src2.at<float>(src2.rows-1, i)*src2.at<float>(src2.rows-1, i);
+		xcorr_plan plan;
 
-			//Iterate across the remaining mat rows, accumulating the sum of squares
-			for (int j = 1, k = src2.rows-2; j < bot.rows; j++, k--)
-			{
-				bot.at<float>(j, i) = src2.at<float>(k, i)*src2.at<float>(k, i) + bot.at<float>(j-1, i);
-			}
-		}
+		//Pad the transforms so that shifts in opposite directions don't wrap onto each other
+		plan.dft_rows = cv::getOptimalDFTSize(size1.height + size2.height - 1);
+		plan.dft_cols = cv::getOptimalDFTSize(size1.width + size2.width - 1);
 
-		//Calulate the linear map needed to map the ssd values from the Fourier analysis to the correct values
-		cv::Mat offset = cv::Mat(ssd.rows, ssd.cols, CV_32FC1, cv::Scalar(0.0));
-		cv::Mat scale = cv::Mat(ssd.rows, ssd.cols, CV_32FC1);
+		//Output has the same size as it would if the second image was template matched across the padded first image
+		int out_rows = size1.height + 2*pad_rows - size2.height + 1;
+		int out_cols = size1.width + 2*pad_cols - size2.width + 1;
+		CV_Assert(out_rows > 0 && out_cols > 0);
 
-		//Accumulate the top and bot accumulator rows
-		std::vector<float> vert_acc(2*pad_rows+1, 0);
-		for (int i = 0; i < top.rows; i++)
+		plan.row_overlaps.resize(out_rows);
+		plan.row_idx.resize(out_rows);
+		for (int m = 0; m < out_rows; m++)
 		{
-			//Iterate across the accumulator columns
-			r = top.ptr<float>(i);
-			for (int j = 0; j < top.cols; j++)
-			{
-				vert_acc[i] += r[j];
-			}
+			int shift = m - pad_rows;
+			plan.row_overlaps[m] = line_overlap(size1.height, size2.height, shift);
+			plan.row_idx[m] = shift >= 0 ? shift : shift + plan.dft_rows;
 		}
-		for (int i = 0, k = top.rows+1; i < bot.rows; i++, k++)
+
+		plan.col_overlaps.resize(out_cols);
+		plan.col_idx.resize(out_cols);
+		for (int n = 0; n < out_cols; n++)
 		{
-			//Iterate across the accumulator columns
-			r = bot.ptr<float>(i);
-			for (int j = 0; j < bot.cols; j++)
-			{
-				vert_acc[k] += r[j];
-			}
+			int shift = n - pad_cols;
+			plan.col_overlaps[n] = line_overlap(size1.width, size2.width, shift);
+			plan.col_idx[n] = shift >= 0 ? shift : shift + plan.dft_cols;
 		}
 
-		//Accumulate the left accumulator columns
-		for (int i = 0; i < left.cols; i++)
-		{
-			float acc = 0.0f;
-			for (int k = src1.rows-1; k >= top.rows; k--)
-			{
-				acc += left.at<float>(k, i);
-			}
+		return plans.insert(std::make_pair(key, plan)).first->second;
+	}
 
-			for (int j = 0, k = top.rows-1; j < top.rows; j++, k--)
-			{
-				offset.at<float>(j, i) += acc + vert_acc[j];
-				acc += left.at<float>(k, i);
-			}
+	/*Calculate the quantities of an image needed to calculate overlap-normalised surfaces
+	**Inputs:
+	**src: cv::Mat &, Image to calculate the quantities of
+	**centre: const double, Value to subtract from the image before calculating the quantities. This reduces cancellation
+	**plan: const xcorr_plan &, Plan the quantities will be used with
+	**Returns:
+	**xcorr_tables, Spectrum and summed-area tables of the image
+	*/
+	xcorr_tables get_xcorr_tables(cv::Mat &src, const double centre, const xcorr_plan &plan)
+	{
+		xcorr_tables tab;
 
-			//Continue across the left rows
-			for (int j = 0, k = bot.rows, m = src1.rows-1; j < bot.rows; j++, k++, m--)
-			{
-				offset.at<float>(k, i) += acc + vert_acc[k];
-				acc -= left.at<float>(m, i);
-			}
-		}
+		//Work in double precision so that the cross term is accurate enough to be subtracted from the sums of squares
+		cv::Mat padded = cv::Mat(plan.dft_rows, plan.dft_cols, CV_64FC1, cv::Scalar(0.0));
+		cv::Mat centred = padded(cv::Rect(0, 0, src.cols, src.rows));
+		src.convertTo(centred, CV_64FC1, 1.0, -centre);
 
-		//Middle columns
-		for (int i = 0; i < top.rows + bot.rows + 1; i++)
-		{
-			offset.at<float>(i, left.cols) = vert_acc[i];
-		}
+		cv::integral(centred, tab.sum, tab.sqsum, CV_64F, CV_64F);
 
-		//Accumulate the right accumulator columns
-		for (int i = 0, l = left.cols+1; i < right.cols; i++, l++)
-		{
-			float acc = 0.0f;
-			for (int k = src1.rows-1; k >= top.rows; k--)
-			{
-				acc += right.at<float>(k, i);
-			}
+		//Only the non-redundant half of the spectrum is calculated
+		tab.spectrum = cv::Mat(plan.dft_rows, plan.dft_cols/2+1, CV_64FC2);
+		fft_r2c(plan.dft_rows, plan.dft_cols, padded.ptr<double>(), (fftw_complex*)tab.spectrum.ptr<double>());
 
-			for (int j = 0, k = top.rows-1; j < top.rows; j++, k--)
-			{
-				offset.at<float>(j, l) += acc + vert_acc[j];
-				acc += right.at<float>(k, i);
-			}
+		return tab;
+	}
 
-			//Continue across the left rows
-			for (int j = 0, k = bot.rows, m = src1.rows-1; j < bot.rows; j++, k++, m--)
-			{
-				offset.at<float>(k, l) += acc + vert_acc[k];
-				acc -= right.at<float>(m, i);
-			}
-		}
+	/*Calculate an overlap-normalised surface from the quantities of 2 images. Each shift's value only uses the pixels where
+	**the images overlap, which is calculated in constant time from the summed-area tables
+	**Inputs:
+	**tab1: xcorr_tables &, Quantities of the image being correlated against
+	**tab2: xcorr_tables &, Quantities of the image being correlated across the first
+	**plan: const xcorr_plan &, Plan used to calculate the quantities
+	**type: const int, Type of surface to calculate. XCORR_SSD or XCORR_PEARSON
+	**Returns:
+	**cv::Mat, 32-bit surface where each element is the value for a shift of the second image
+	*/
+	cv::Mat overlap_surface(xcorr_tables &tab1, xcorr_tables &tab2, const xcorr_plan &plan, const int type)
+	{
+		//Cross-correlate the images. Padding is zero so this is the sum of products over the overlapping pixels
+		cv::Mat prod;
+		cv::mulSpectrums(tab1.spectrum, tab2.spectrum, prod, 0, true);
+		cv::Mat cross = cv::Mat(plan.dft_rows, plan.dft_cols, CV_64FC1);
+		fft_c2r(plan.dft_rows, plan.dft_cols, (fftw_complex*)prod.ptr<double>(), cross.ptr<double>());
+		cross *= 1.0 / ((double)plan.dft_rows*plan.dft_cols);
+
+		int out_rows = (int)plan.row_overlaps.size();
+		int out_cols = (int)plan.col_overlaps.size();
+		cv::Mat surface = cv::Mat(out_rows, out_cols, CV_32FC1);
+
+		parallel_for(0, out_rows, [&](int m)
+		{
+			cv::Vec4i ro = plan.row_overlaps[m];
+			const double *c = cross.ptr<double>(plan.row_idx[m]);
+			float *s = surface.ptr<float>(m);
+
+			for (int n = 0; n < out_cols; n++)
+			{
+				cv::Vec4i co = plan.col_overlaps[n];
+				double num = (double)(ro[1]-ro[0]) * (co[1]-co[0]);
+
+				//Shifts without any overlap can't be compared
+				if (!num)
+				{
+					s[n] = type == XCORR_SSD ? FLT_MAX : 0.0f;
+					continue;
+				}
+
+				double s11 = rect_sum(tab1.sqsum, ro[0], ro[1], co[0], co[1]);
+				double s22 = rect_sum(tab2.sqsum, ro[2], ro[3], co[2], co[3]);
+				double s12 = c[plan.col_idx[n]];
+
+				if (type == XCORR_SSD)
+				{
+					double sum_sqr_diff = s11 + s22 - 2.0*s12;
+					s[n] = (float)((sum_sqr_diff > 0.0 ? sum_sqr_diff : 0.0) / num); //Safeguard against rounding errors
+				}
+				else
+				{
+					double s1 = rect_sum(tab1.sum, ro[0], ro[1], co[0], co[1]);
+					double s2 = rect_sum(tab2.sum, ro[2], ro[3], co[2], co[3]);
+
+					double cov = s12 - s1*s2/num;
+					double var1 = s11 - s1*s1/num;
+					double var2 = s22 - s2*s2/num;
+					s[n] = var1 > 0.0 && var2 > 0.0 ? (float)(cov / std::sqrt(var1*var2)) : 0.0f;
+				}
+			}
+		});
+
+		return surface;
+	}
 
-		//Iterate across mat rows...
-		for (int m = 0; m < scale.rows; m++) 
-		{
-			//...and iterate across mat columns
-			s = scale.ptr<float>(m);
-			for (int n = 0; n < scale.cols; n++) 
-			{
-				s[n] = (src2.rows-std::abs(m-top.rows))*(src2.cols-std::abs(n-left.cols));
-			}
-		}
+	/*Calculate an overlap-normalised surface between 2 images
+	**src1: cv::Mat &, Image to correlate the other against
+	**src2: cv::Mat &, Image to correlate across the first
+	**frac: float, Proportion of the first image's dimensions to pad it by
+	**type: const int, Type of surface to calculate. XCORR_SSD or XCORR_PEARSON
+	**Returns,
+	**cv::Mat, 32-bit surface where each element is the value for a shift of the second image
+	*/
+	static cv::Mat xcorr_surface(cv::Mat &src1, cv::Mat &src2, float frac, const int type)
+	{
+		const xcorr_plan &plan = get_xcorr_plan(src1.size(), src2.size(), (int)(frac*src1.rows), (int)(frac*src1.cols));
+
+		//The squared differences are unchanged if both images are centred by the same amount
+		double centre1 = cv::mean(src1).val[0];
+		double centre2 = type == XCORR_SSD ? centre1 : cv::mean(src2).val[0];
 
-		//Linearly map to the correct results
-		return (ssd - offset) / scale;
+		xcorr_tables tab1 = get_xcorr_tables(src1, centre1, plan);
+		xcorr_tables tab2 = get_xcorr_tables(src2, centre2, plan);
+
+		return overlap_surface(tab1, tab2, plan, type);
 	}
 
-	/*Pearson product moment correlation coefficient between 2 images. The second images is correlated against the 
-	**first in the Fourier domain
+	/*Mean squared difference between 2 images where they overlap. The second image is correlated against the first in the
+	**Fourier domain and the non-overlapping pixels are excluded using summed-area tables
+	**src1: cv::Mat &, One of the images
+	**src2: cv::Mat &, The second image
+	**frac: float, Proportion of the first image's dimensions to pad it by
+	**Returns,
+	**cv::Mat, Mean squared differences
+	*/
+	cv::Mat ssd(cv::Mat &src1, cv::Mat &src2, float frac)
+	{
+		return xcorr_surface(src1, src2, frac, XCORR_SSD);
+	}
+
+	/*Pearson product moment correlation coefficient between 2 images where they overlap. The second image is correlated
+	**against the first in the Fourier domain and the non-overlapping pixels are excluded using summed-area tables
 	**src1: cv::Mat &, One of the images
 	**src2: cv::Mat &, The second image
 	**frac: float, Proportion of the first image's dimensions to pad it by. Must be smaller than 1.0f so that there is at 
 	**least some overlap
 	**Returns,
-	**cv::Mat, Pearson normalised product moment correlation coefficients. The result is not normalised.
+	**cv::Mat, Pearson normalised product moment correlation coefficients
 	*/
 	cv::Mat fourier_pearson_corr(cv::Mat &src1, cv::Mat &src2, float frac)
 	{
-		//Pad the first matrix to prepare it for the second matrix being correlated accross it
-		cv::Mat pad1;
-		int pad_rows = (int)(frac*src1.rows);
-		int pad_cols = (int)(frac*src1.cols);
-		float src1_mean = cv::mean(src1).val[0];
-		cv::copyMakeBorder(src1, pad1, pad_rows, pad_rows, pad_cols, pad_cols, cv::BORDER_CONSTANT, cv::Scalar(src1_mean));
-
-		//Calculate the Pearson product moment correlation coefficients in the Fourier domain
-		cv::Mat pear;
-		cv::matchTemplate(pad1, src2, pear, CV_TM_CCOEFF);
-
-		//Subtract the mean of the images so that it can be subtracted from them during the correction
-		cv::Mat sub1 = src1 - src1_mean;
-		cv::Mat sub2 = src2 - cv::mean(src2).val[0];
-
-		//Calculate the cumulative rowwise and columnwise sums of squares. These can be used to calculate additive corrections
-		//to the calculate sum of squared differences where the templates did not overlap
-		float *r, *s;
-
-		/* Left of 1st image */
-		//Iterate across mat rows...
-		cv::Mat left = cv::Mat(src1.rows, pad_cols, CV_32FC1);
-		for (int i = 0; i < left.rows; i++)
-		{
-			//Initialise pointers
-			r = left.ptr<float>(i);
-			s = sub1.ptr<float>(i);
-
-			//Calculate the square of the first column element
-			r[left.cols-1] = s[0]*s[0];
-
-			//Iterate across the remaining mat columns, accumulating the sum of squares
-			for (int j = left.cols-2, k = 1; j >= 0; j--, k++)
-			{
-				r[j] = s[k]*s[k] + r[j+1];
-			}
-		}
-
-		/* Right of 1st image */
-		//Iterate across mat rows...
-		cv::Mat right = cv::Mat(src1.rows, pad_cols, CV_32FC1);
-		for (int i = 0; i < right.rows; i++)
-		{
-			//Initialise pointers
-			r = right.ptr<float>(i);
-			s = sub1.ptr<float>(i);
-
-			//Calculate the square of the first column element
-			r[0] = s[src1.cols-1]*s[src1.cols-1];
-
-			//Iterate across the remaining mat columns, accumulating the sum of squares
-			for (int j = 1, k = src2.cols-2; j < right.cols; j++, k--)
-			{
-				r[j] = s[k]*s[k] + r[j-1];
-			}
-		}
-
-		/* Top of 1st image */
-		//Iterate across mat cols
-		cv::Mat top = cv::Mat(pad_rows, src1.cols, CV_32FC1);
-		for (int i = 0; i < top.cols; i++)
-		{
-
-			//Calculate the square of the first row element
-			top.at<float>(top.rows-1, i) = sub1.at<float>(0, i)*sub1.at<float>(0, i);
-
-			//Iterate across the remaining mat rows, accumulating the sum of squares
-			for (int j = top.rows-2, k = 1; j >= 0; j--, k++)
-			{
-				top.at<float>(j, i) = sub1.at<float>(k, i)*sub1.at<float>(k, i) + top.at<float>(j+1, i);
-			}
-		}
-
-		/* Bottom of 1st image */
-		//Iterate across mat cols...
-		cv::Mat bot = cv::Mat(pad_rows, src1.cols, CV_32FC1);
-		for (int i = 0; i < bot.cols; i++)
-		{
-			//Calculate the square of the first row element
-			bot.at<float>(0, i) = sub1.at<float>(src2.rows-1, i)*sub1.at<float>(src2.rows-1, i);
-
-			//Iterate across the remaining mat rows, accumulating the sum of squares
-			for (int j = 1, k = src2.rows-2; j < bot.rows; j++, k--)
-			{
-				bot.at<float>(j, i) = sub1.at<float>(k, i)*sub1.at<float>(k, i) + bot.at<float>(j-1, i);
-			}
-		}
-
-		/* Left of 2nd image */
-		//Iterate across mat rows...
-		cv::Mat left2 = cv::Mat(src2.rows, pad_cols, CV_32FC1);
-		for (int i = 0; i < left.rows; i++)
-		{
-			//Initialise pointers
-			r = left2.ptr<float>(i);
-			s = sub2.ptr<float>(i);
-
-			//Calculate the square of the first column element
-			r[left.cols-1] = s[0]*s[0];
-
-			//Iterate across the remaining mat columns, accumulating the sum of squares
-			for (int j = left.cols-2, k = 1; j >= 0; j--, k++)
-			{
-				r[j] = s[k]*s[k] + r[j+1];
-			}
-		}
-
-		/* Right of 2nd image */
-		//Iterate across mat rows...
-		cv::Mat right2 = cv::Mat(src2.rows, pad_cols, CV_32FC1);
-		for (int i = 0; i < right.rows; i++)
-		{
-			//Initialise pointers
-			r = right2.ptr<float>(i);
-			s = sub2.ptr<float>(i);
-
-			//Calculate the square of the first column element
-			r[0] = s[src2.cols-1]*s[src2.cols-1];
-
-			//Iterate across the remaining mat columns, accumulating the sum of squares
-			for (int j = 1, k = src2.cols-2; j < right.cols; j++, k--)
-			{
-				r[j] = s[k]*s[k] + r[j-1];
-			}
-		}
-
-		/* Top of 2nd image */
-		//Iterate across mat cols
-		cv::Mat top2 = cv::Mat(pad_rows, src2.cols, CV_32FC1);
-		for (int i = 0; i < top.cols; i++)
-		{
-
-			//Calculate the square of the first row element
-			top2.at<float>(top.rows-1, i) = sub2.at<float>(0, i)*sub2.at<float>(0, i);
-
-			//Iterate across the remaining mat rows, accumulating the sum of squares
-			for (int j = top.rows-2, k = 1; j >= 0; j--, k++)
-			{
-				top2.at<float>(j, i) = sub2.at<float>(k, i)*sub2.at<float>(k, i) + top2.at<float>(j+1, i);
-			}
-		}
-
-		/* Bottom of 2nd image */
-		//Iterate across mat cols...
-		cv::Mat bot2 = cv::Mat(pad_rows, src2.cols, CV_32FC1);
-		for (int i = 0; i < bot.cols; i++)
-		{
-			//Calculate the square of the first row element
-			bot2.at<float>(0, i) = sub2.at<float>(src2.rows-1, i)*sub2.at<float>(src2.rows-1, i);
-
-			//Iterate across the remaining mat rows, accumulating the sum of squares
-			for (int j = 1, k = src2.rows-2; j < bot.rows; j++, k--)
-			{
-				bot2.at<float>(j, i) = sub2.at<float>(k, i)*sub2.at<float>(k, i) + bot2.at<float>(j-1, i);
-			}
-		}
-
-		//Calulate the linear map needed to map the correlation coefficients to their normalised values
-		cv::Mat scale = cv::Mat(pear.rows, pear.cols, CV_32FC1, cv::Scalar(0.0));
-		cv::Mat scale2 = cv::Mat(pear.rows, pear.cols, CV_32FC1, cv::Scalar(0.0));
-
-		//Accumulate the top and bot accumulator rows of the 1st source
-		std::vector<float> vert_acc(2*pad_rows+1, 0);
-		for (int i = 0; i < top.rows; i++)
-		{
-			//Iterate across the accumulator columns
-			r = top.ptr<float>(i);
-			for (int j = 0; j < top.cols; j++)
-			{
-				vert_acc[i] += r[j];
-			}
-		}
-		for (int i = 0, k = top.rows+1; i < bot.rows; i++, k++)
-		{
-			//Iterate across the accumulator columns
-			r = bot.ptr<float>(i);
-			for (int j = 0; j < bot.cols; j++)
-			{
-				vert_acc[k] += r[j];
-			}
-		}
-
-		//Accumulate the top and bot accumulator rows of the second source
-		std::vector<float> vert_acc_2(2*pad_rows+1, 0);
-		for (int i = 0; i < top2.rows; i++)
-		{
-			//Iterate across the accumulator columns
-			r = top2.ptr<float>(i);
-			for (int j = 0; j < top2.cols; j++)
-			{
-				vert_acc_2[i] += r[j];
-			}
-		}
-		for (int i = 0, k = top2.rows+1; i < bot2.rows; i++, k++)
-		{
-			//Iterate across the accumulator columns
-			r = bot2.ptr<float>(i);
-			for (int j = 0; j < bot2.cols; j++)
-			{
-				vert_acc_2[k] += r[j];
-			}
-		}
-
-		//Accumulate the left accumulator columns of the first source
-		for (int i = 0; i < left.cols; i++)
-		{
-			float acc = 0.0f;
-			for (int k = src1.rows-1; k >= top.rows; k--)
-			{
-				acc += left.at<float>(k, i);
-			}
-
-			for (int j = 0, k = top.rows-1; j < top.rows; j++, k--)
-			{
-				scale.at<float>(j, i) += acc + vert_acc[j];
-				acc += left.at<float>(k, i);
-			}
-
-			//Continue across the left rows
-			for (int j = 0, k = bot.rows, m = src1.rows-1; j < bot.rows; j++, k++, m--)
-			{
-				scale.at<float>(k, i) += acc + vert_acc[k];
-				acc -= left.at<float>(m, i);
-			}
-		}
-
-		//Middle column of the second source
-		for (int i = 0; i < top.rows + bot.rows + 1; i++)
-		{
-			scale.at<float>(i, left.cols) = vert_acc[i];
-		}
-
-		//Accumulate the right accumulator columns of the first source
-		for (int i = 0, l = left.cols+1; i < left.cols; i++, l++)
-		{
-			float acc = 0.0f;
-			for (int k = src1.rows-1; k >= top.rows; k--)
-			{
-				acc += right.at<float>(k, i);
-			}
-
-			for (int j = 0, k = top.rows-1; j < top.rows; j++, k--)
-			{
-				scale.at<float>(j, l) += acc + vert_acc[j];
-				acc += right.at<float>(k, i);
-			}
-
-			//Continue across the left rows
-			for (int j = 0, k = bot.rows, m = src1.rows-1; j < bot.rows; j++, k++, m--)
-			{
-				scale.at<float>(k, l) += acc + vert_acc[k];
-				acc -= right.at<float>(m, i);
-			}
-		}
-
-		//Accumulate the left accumulator columns of the second source
-		for (int i = 0; i < left2.cols; i++)
-		{
-			float acc2 = 0.0f;
-			for (int k = src2.rows-1; k >= top2.rows; k--)
-			{
-				acc2 += left2.at<float>(k, i);
-			}
-
-			for (int j = 0, k = top2.rows-1; j < top2.rows; j++, k--)
-			{
-				scale2.at<float>(j, i) += acc2 + vert_acc_2[j];
-				acc2 += left2.at<float>(k, i);
-			}
-
-			//Continue across the left rows
-			for (int j = 0, k = bot2.rows, m = src2.rows-1; j < bot2.rows; j++, k++, m--)
-			{
-				scale2.at<float>(k, i) += acc2 + vert_acc_2[k];
-				acc2 -= left2.at<float>(m, i);
-			}
-		}
-
-		//Middle column of the second source
-		for (int i = 0; i < top2.rows + bot2.rows + 1; i++)
-		{
-			scale2.at<float>(i, left2.cols) = vert_acc_2[i];
-		}
-
-		//Accumulate the right accumulator columns of the second source
-		for (int i = 0, l = right2.cols+1; i < right2.cols; i++, l++)
-		{
-			float acc2 = 0.0f;
-			for (int k = src2.rows-1; k >= top2.rows; k--)
-			{
-				acc2 += right2.at<float>(k, i);
-			}
-
-			for (int j = 0, k = top2.rows-1; j < top2.rows; j++, k--)
-			{
-				scale2.at<float>(j, l) += acc2 + vert_acc_2[j];
-				acc2 += right2.at<float>(k, i);
-			}
-
-			//Continue across the left rows
-			for (int j = 0, k = bot2.rows, m = src2.rows-1; j < bot2.rows; j++, k++, m--)
-			{
-				scale2.at<float>(k, l) += acc2 + vert_acc_2[k];
-				acc2 -= right2.at<float>(m, i);
-			}
-		}
-
-		//Get the sum of the squares of the elements in the first image
-		float sum_sqr = 0.0f;
-		//Sum across the first source's rows...
-		for (int i = 0; i < src1.rows; i++)
-		{
-			//...and the first source's columns
-			r = sub1.ptr<float>(i);
-			for (int j = 0; j < src1.cols; j++)
-			{
-				sum_sqr += r[j]*r[j];
-			}
-		}
-
-		//Get the sum of the squares of the elements in the second image
-		float sum_sqr_2 = 0.0f;
-		//Sum across the first source's rows...
-		for (int i = 0; i < src2.rows; i++)
-		{
-			//...and the first source's columns
-			r = sub2.ptr<float>(i);
-			for (int j = 0; j < src2.cols; j++)
-			{
-				sum_sqr_2 += r[j]*r[j];
-			}
-		}
-
-		//Calculate the elements of the linear map needed to correct the Pearson correlation values
-		for (int i = 0, k = scale.rows-1; i < scale.rows; i++, k--)
-		{
-			r = scale.ptr<float>(k);
-			s = scale2.ptr<float>(i);
-			for (int j = 0, l = scale.cols-1; j < scale.cols; j++, l--)
-			{
-				s[j] = std::sqrt(sum_sqr > r[l] ? sum_sqr - r[l] : 0) * 
-					std::sqrt(sum_sqr_2 > s[j] ? sum_sqr_2 - s[j] : 0); //Ternary operations safeguard against rounding errors
-			}
-		}
-
-		//Linearly map to the correct results
-		return pear / scale2;
+		return xcorr_surface(src1, src2, frac, XCORR_PEARSON);
 	}
 
 	/*Create phase correlation specturm between 2 same-size images
@@ -568,50 +255,47 @@ namespace ba
 		int M = cv::getOptimalDFTSize(src1.rows);
 		int N = cv::getOptimalDFTSize(src1.cols);
 
-		cv::Mat padded1, padded2, paddedWin;
-
-		if(M != src1.rows || N != src1.cols)
-		{
-			cv::copyMakeBorder(src1, padded1, 0, M - src1.rows, 0, N - src1.cols, cv::BORDER_CONSTANT, cv::Scalar::all(0));
-			cv::copyMakeBorder(src2, padded2, 0, M - src2.rows, 0, N - src2.cols, cv::BORDER_CONSTANT, cv::Scalar::all(0));
-
-			if(!window.empty())
-			{
-				cv::copyMakeBorder(window, paddedWin, 0, M - window.rows, 0, N - window.cols, cv::BORDER_CONSTANT, cv::Scalar::all(0));
-			}
-		}
-		else
-		{
-			padded1 = src1;
-			padded2 = src2;
-			paddedWin = window;
-		}
-
-		cv::Mat FFT1, FFT2, P, Pm, C;
+		//Zero-pad the images to the optimal size in double precision for the transforms
+		cv::Mat padded1 = cv::Mat(M, N, CV_64FC1, cv::Scalar::all(0));
+		cv::Mat padded2 = cv::Mat(M, N, CV_64FC1, cv::Scalar::all(0));
+		cv::Mat roi1 = padded1(cv::Rect(0, 0, src1.cols, src1.rows));
+		cv::Mat roi2 = padded2(cv::Rect(0, 0, src2.cols, src2.rows));
+		src1.convertTo(roi1, CV_64FC1);
+		src2.convertTo(roi2, CV_64FC1);
 
 		// perform window multiplication if available
-		if(!paddedWin.empty())
+		if(!window.empty())
 		{
 			// apply window to both images before proceeding...
-			cv::multiply(paddedWin, padded1, padded1);
-			cv::multiply(paddedWin, padded2, padded2);
+			cv::Mat win;
+			window.convertTo(win, CV_64FC1);
+			cv::multiply(win, roi1, roi1);
+			cv::multiply(win, roi2, roi2);
 		}
 
 		//Execute phase correlation equation
-		cv::dft(padded1, FFT1, cv::DFT_REAL_OUTPUT);
-		cv::dft(padded2, FFT2, cv::DFT_REAL_OUTPUT);
+		cv::Mat FFT1 = cv::Mat(M, N/2+1, CV_64FC2);
+		cv::Mat FFT2 = cv::Mat(M, N/2+1, CV_64FC2);
+		fft_r2c(M, N, padded1.ptr<double>(), (fftw_complex*)FFT1.ptr<double>());
+		fft_r2c(M, N, padded2.ptr<double>(), (fftw_complex*)FFT2.ptr<double>());
 
-		//Compute FF* / |FF*|
+		//Compute FF* / (|FF*|+1)
+		cv::Mat P, C;
 		cv::mulSpectrums(FFT1, FFT2, P, 0, true);
-		cv::mulSpectrums(P, 1 / (cv::abs(P)+1) , C, 0, false);
+		cv::Mat planes[2], mag;
+		cv::split(P, planes);
+		cv::magnitude(planes[0], planes[1], mag);
+		mag += 1.0;
+		cv::divide(planes[0], mag, planes[0]);
+		cv::divide(planes[1], mag, planes[1]);
+		cv::merge(planes, 2, C);
 
-		//cv::divide(P, cv::abs(P), C, 0, false); 
+		//Get the phase correlation spectrum...
+		cv::Mat spectrum = cv::Mat(M, N, CV_64FC1);
+		fft_c2r(M, N, (fftw_complex*)C.ptr<double>(), spectrum.ptr<double>());
 
 		cv::Mat D;
-		C.convertTo(D, CV_32FC1);
-
-		//Get the phase correlation spectrum...
-		cv::idft(D, D);
+		spectrum.convertTo(D, CV_32FC1);
 
 		//...and shift its energy into the center
 		fftShift(D);
@@ -2,6 +2,7 @@
 
 #include <includes.h>
 
+#include <task_scheduler.h>
 #include <utility.h>
 
 namespace ba
@@ -12,23 +13,83 @@ namespace ba
 	//Default padding to apply when calculating Pearson's normalised product moment correlation coefficient in the Fourier domain
     #define FOURIER_PEARSON_USE_FRAC 0.5
 
-	/*Sum of squared differences between 2 images. The second images is correlated against the first in the Fourier domain
+	//Types of overlap-normalised surface that can be calculated when correlating images against each other
+    #define XCORR_SSD 0 //Mean squared difference over the overlapping pixels
+    #define XCORR_PEARSON 1 //Pearson's normalised product moment correlation coefficient over the overlapping pixels
+
+	//Custom data structure to hold the discrete Fourier transform sizes and shift geometry needed to correlate images of
+	//particular sizes against each other. These only depend on the image sizes and padding so they are cached and reused
+	struct xcorr_plan_param {
+		int dft_rows; //Rows of the zero-padded discrete Fourier transforms. Large enough that the correlation doesn't wrap
+		int dft_cols; //Columns of the zero-padded discrete Fourier transforms. Large enough that the correlation doesn't wrap
+		std::vector<cv::Vec4i> row_overlaps; //First and one past the last overlapping rows of the first and then the second image for each output row
+		std::vector<cv::Vec4i> col_overlaps; //First and one past the last overlapping columns of the first and then the second image for each output column
+		std::vector<int> row_idx; //Row of the circular correlation corresponding to each output row
+		std::vector<int> col_idx; //Column of the circular correlation corresponding to each output column
+	};
+	typedef xcorr_plan_param xcorr_plan;
+
+	//Custom data structure to hold the quantities of an image that are needed to calculate overlap-normalised surfaces. These
+	//can be calculated once for an image and reused when it is correlated against many others
+	struct xcorr_tables_param {
+		cv::Mat spectrum; //Non-redundant half of the discrete Fourier transform of the zero-padded, centred image
+		cv::Mat sum; //Summed-area table of the centred image
+		cv::Mat sqsum; //Summed-area table of the squares of the centred image
+	};
+	typedef xcorr_tables_param xcorr_tables;
+
+	/*Get the plan to correlate an image against another. Plans are cached so that they only have to be created once for each
+	**combination of sizes
+	**Inputs:
+	**size1: cv::Size, Size of the image being correlated against
+	**size2: cv::Size, Size of the image being correlated across the first
+	**pad_rows: const int, Number of rows the second image can extend past the top and bottom of the first
+	**pad_cols: const int, Number of columns the second image can extend past the left and right of the first
+	**Returns:
+	**const xcorr_plan &, Plan to correlate images of these sizes
+	*/
+	const xcorr_plan &get_xcorr_plan(cv::Size size1, cv::Size size2, const int pad_rows, const int pad_cols);
+
+	/*Calculate the quantities of an image needed to calculate overlap-normalised surfaces
+	**Inputs:
+	**src: cv::Mat &, Image to calculate the quantities of
+	**centre: const double, Value to subtract from the image before calculating the quantities. This reduces cancellation
+	**plan: const xcorr_plan &, Plan the quantities will be used with
+	**Returns:
+	**xcorr_tables, Spectrum and summed-area tables of the image
+	*/
+	xcorr_tables get_xcorr_tables(cv::Mat &src, const double centre, const xcorr_plan &plan);
+
+	/*Calculate an overlap-normalised surface from the quantities of 2 images. Each shift's value only uses the pixels where
+	**the images overlap, which is calculated in constant time from the summed-area tables
+	**Inputs:
+	**tab1: xcorr_tables &, Quantities of the image being correlated against
+	**tab2: xcorr_tables &, Quantities of the image being correlated across the first
+	**plan: const xcorr_plan &, Plan used to calculate the quantities
+	**type: const int, Type of surface to calculate. XCORR_SSD or XCORR_PEARSON
+	**Returns:
+	**cv::Mat, 32-bit surface where each element is the value for a shift of the second image
+	*/
+	cv::Mat overlap_surface(xcorr_tables &tab1, xcorr_tables &tab2, const xcorr_plan &plan, const int type);
+
+	/*Mean squared difference between 2 images where they overlap. The second image is correlated against the first in the
+	**Fourier domain and the non-overlapping pixels are excluded using summed-area tables
 	**src1: cv::Mat &, One of the images
 	**src2: cv::Mat &, The second image
 	**frac: float, Proportion of the first image's dimensions to pad it by
 	**Returns,
-	**cv::Mat, Sum of the squared differences
+	**cv::Mat, Mean squared differences
 	*/
 	cv::Mat ssd(cv::Mat &src1, cv::Mat &src2, float frac = QUANT_SYM_USE_FRAC);
 
-	/*Pearson product moment correlation coefficient between 2 images. The second images is correlated against the 
-	**first in the Fourier domain
+	/*Pearson product moment correlation coefficient between 2 images where they overlap. The second image is correlated
+	**against the first in the Fourier domain and the non-overlapping pixels are excluded using summed-area tables
 	**src1: cv::Mat &, One of the images
 	**src2: cv::Mat &, The second image
 	**frac: float, Proportion of the first image's dimensions to pad it by. Must be smaller than 1.0f so that there is at 
 	**least some overlap
 	**Returns,
-	**cv::Mat, Pearson normalised product moment correlation coefficients. The result is not normalised
+	**cv::Mat, Pearson normalised product moment correlation coefficients
 	*/
 	cv::Mat fourier_pearson_corr(cv::Mat &src1, cv::Mat &src2, float frac = FOURIER_PEARSON_USE_FRAC);
 
@@ -4,104 +4,50 @@ namespace ba
 {
 	/*Calculate Pearson normalised product moment correlation coefficient between 2 vectors of floats
 	**Inputs:
-	**vect1: std::vector<float>, One of the datasets to use in the calculation
-	**vect2: std::vector<float>, The other dataset to use in the calculation
-	**NUM_THREADS: const int, The number of threads to use for OpenMP CPU acceleration
+	**vect1: const std::vector<float> &, One of the datasets to use in the calculation
+	**vect2: const std::vector<float> &, The other dataset to use in the calculation
 	**Return:
 	**float, Pearson normalised product moment correlation coefficient between the 2 datasets
 	*/
-	float pearson_corr(std::vector<float> vect1, std::vector<float> vect2, const int NUM_THREADS) {
-
-		//Sums for Pearson product moment correlation coefficient
-		float sum_xy = 0.0f;
-		float sum_x = 0.0f;
-		float sum_y = 0.0f;
-		float sum_x2 = 0.0f;
-		float sum_y2 = 0.0f;
-
-		//Reflect points across mirror line and compare them to the nearest pixel
-		#pragma omp parallel for num_threads(NUM_THREADS), reduction(sum:sum_xy), reduction(sum:sum_x), reduction(sum:sum_y), reduction(sum:sum_x2), reduction(sum:sum_y2)
-		for (int i = 0; i < vect1.size(); i++) {
-
-			//Contribute to Pearson correlation coefficient
-			sum_xy += vect1[i]*vect2[i];
-			sum_x += vect1[i];
-			sum_y += vect2[i];
-			sum_x2 += vect1[i]*vect1[i];
-			sum_y2 += vect2[i]*vect2[i];
-		}
-
-		return (vect1.size()*sum_xy - sum_x*sum_y) / (std::sqrt(vect1.size()*sum_x2 - sum_x*sum_x) * 
-			std::sqrt(vect1.size()*sum_y2 - sum_y*sum_y));
+	float pearson_corr(const std::vector<float> &vect1, const std::vector<float> &vect2) 
+	{
+		return (float)pearson_from_moments(vect_moments(vect1, vect2));
 	}
 
 	/*Calculate weighted 1st order autocorrelation using weighted Pearson normalised product moment correlation coefficient.
-	**That is, the ratio of the weighted covariance to the product of the weighted variances of the data and the lagged data
+	**That is, the ratio of the weighted covariance to the product of the weighted standard deviations of the data and the 
+	**lagged data. Each lagged pair is weighted by the reciprocal of the sum of its elements' variances
 	**Inputs:
-	**data: std::vector<float>, One of the datasets to use in the calculation
-	**Errors: std::vector<float>, Errors in dataset elements used in the calculation
+	**data: const std::vector<float> &, One of the datasets to use in the calculation
+	**Errors: const std::vector<float> &, Errors in dataset elements used in the calculation
 	**Return:
-	**float, Measure of the autocorrelation. 2-2*<return value> approximates the Durbin-Watson statistic for large datasets
+	**float, Measure of the autocorrelation. 2-2*<return value> approximates the Durbin-Watson statistic for large datasets. It
+	**is 0 if there are fewer than 2 elements, so there are no lagged pairs
 	*/
-	float weighted_pearson_autocorr(std::vector<float> data, std::vector<float> err, const int NUM_THREADS) 
+	float weighted_pearson_autocorr(const std::vector<float> &data, const std::vector<float> &err) 
 	{
-		//sums for pearson product moment correlation coefficient
-		//x - data; e - error, 1 - lagged data, 2 - forward data
-
-		//Start by calculating means using weighted sums
-		float sum_x = 0.0f;
-		float sum_x_err = 0.0f;
-
-		int size_minus1 = data.size()-1;
-		#pragma omp parallel for num_threads(NUM_THREADS)
-		for (int i = 1; i < size_minus1; i++) {
-
-			#pragma omp atomic
-			sum_x += data[i]/(err[i]*err[i]);
-			#pragma omp atomic
-			sum_x_err += 1.0f/(err[i]*err[i]);
-		}
-
-		//Calculate weighted means (Bessel correction)
-		float x1_mean = (sum_x + data[0]/(err[0]*err[0])) / (sum_x_err + 1.0f/(err[0]*err[0]));
-		float x2_mean = (sum_x + data[size_minus1]/(err[size_minus1]*err[size_minus1])) / (sum_x_err + 1.0f/(err[size_minus1]*err[size_minus1]));
-
-		//Calculate Pearson normalised product moment correlation coefficient, disregarding errors of means
-		float sum_xy = 0.0f;
-		float sum_xy_err = 0.0f;
-		float sum_x2 = 0.0f;
-		float sum_x2_err1 = 0.0f;
-		float sum_x2_err2 = 0.0f;
-
-		int i;
-		#pragma omp parallel for num_threads(NUM_THREADS)
-		for (i = 1; i < size_minus1; i++) 
+		//Without lagged pairs there is no autocorrelation. The size is unsigned, so check it before subtracting from it
+		if (data.size() < 2)
 		{
-			#pragma omp atomic
-			sum_xy += (data[i]-x2_mean)*(data[i-1]-x1_mean) / (std::abs(data[i]-x2_mean)*err[i-1] + std::abs(data[i-1]-x1_mean)*err[i]);
-			#pragma omp atomic
-			float weight = 1.0f /(std::abs(data[i]-x2_mean)*err[i-1] + std::abs(data[i-1]-x1_mean)*err[i]);
-			sum_xy_err += weight*(1-weight);
-
-			#pragma omp atomic
-			sum_x2 += 1.0f / (err[i]*err[i]);
-			#pragma omp atomic
-			sum_x2_err1 += 1.0f / (std::abs(data[i]-x1_mean)*std::abs(data[i]-x1_mean)*err[i]*err[i]);
-			#pragma omp atomic
-			sum_x2_err2 += 1.0f / (std::abs(data[i]-x2_mean)*std::abs(data[i]-x2_mean)*err[i]*err[i]);
+			return 0.0f;
 		}
+		int size_minus1 = (int)data.size()-1;
 
-		sum_xy += (data[i]-x2_mean)*(data[i-1]-x1_mean) / (std::abs(data[i]-x2_mean)*err[i-1] + std::abs(data[i-1]-x1_mean)*err[i]);
-		float weight = 1.0f /(std::abs(data[i]-x2_mean)*err[i-1] + std::abs(data[i-1]-x1_mean)*err[i]);
-		sum_xy_err += weight*(1-weight);
+		//Weights of the lagged pairs. Pairs with no error estimate are not used
+		std::vector<float> weights(size_minus1);
+		parallel_for(0, size_minus1, [&](int i)
+		{
+			float var = err[i]*err[i] + err[i+1]*err[i+1];
+			weights[i] = var > 0.0f ? 1.0f / var : 0.0f;
+		});
 
-		//Weighted sums of squares
-		float x1 = (sum_x2 + 1.0f/(err[0]*err[0])) / 
-			(sum_x2_err1 + 1.0f / (std::abs(data[0]-x1_mean)*std::abs(data[0]-x1_mean)*err[0]*err[0]));
-		float x2 = (sum_x2 + 1.0f/(err[size_minus1]*err[size_minus1])) / 
-			(sum_x2_err2 + 1.0f / (std::abs(data[size_minus1]-x2_mean)*std::abs(data[size_minus1]-x2_mean)*err[size_minus1]*err[size_minus1]));
+		//The lagged data and forward data are the same vector offset by one element
+		corr_moments m = parallel_reduce<corr_moments>(0, size_minus1, zero_moments(), [&](int start, int stop)
+		{
+			return span_moments(&data[0]+start, &data[0]+start+1, stop-start, &weights[0]+start);
+		}, merge_moments, MOMENTS_CHUNK_SIZE);
 
-		return ( sum_xy/(data.size()*sum_xy_err) ) / ( std::sqrt( x1 ) * std::sqrt( x2 ) );
+		return (float)pearson_from_moments(m);
 	}
 
 	/*Calculates the factorial of a small integer
@@ -194,19 +140,17 @@ namespace ba
 		//Get the mean px value
 		cv::Scalar mean = cv::mean(img);
 
-		float *r, *s;
 		//Iterate across mat rows...
-        #pragma omp parallel for
-		for (int m = 0; m < img.rows; m++) 
+		parallel_for(0, img.rows, [&](int m)
 		{
 			//...and iterate across mat columns
-			r = img.ptr<float>(m);
-			s = no_black.ptr<float>(m);
+			float *r = img.ptr<float>(m);
+			float *s = no_black.ptr<float>(m);
 			for (int n = 0; n < img.cols; n++) 
 			{
 				s[n] = r[n] ? r[n] : mean.val[0];
 			}
-		}
+		});
 
 		return no_black;
 	}
@@ -250,7 +194,8 @@ namespace ba
 		return autocorr;
 	}
 
-	/*Calculate Pearson's normalised product moment correlation coefficient between 2 floating point same-size OpenCV mats
+	/*Calculate Pearson's normalised product moment correlation coefficient between 2 floating point same-size OpenCV mats.
+	**Pixels that are black in either mat are not used
 	**img1: cv::Mat &, One of the mats
 	**img2: cv::Mat &, The other mat
 	**Returns,
@@ -258,37 +203,8 @@ namespace ba
 	*/
 	float pearson_corr(cv::Mat &img1, cv::Mat &img2)
 	{
-		//Sums for Pearson product moment correlation coefficient
-		float sum_xy = 0.0f;
-		float sum_x = 0.0f;
-		float sum_y = 0.0f;
-		float sum_x2 = 0.0f;
-		float sum_y2 = 0.0f;
-
-		//Reflect points across mirror line and compare them to the nearest pixel
-		float *p, *q;
-        #pragma omp parallel for reduction(sum:sum_xy), reduction(sum:sum_x), reduction(sum:sum_y), reduction(sum:sum_x2), reduction(sum:sum_y2)
-		for (int i = 0; i < img1.rows; i++)
-		{
-			p = img1.ptr<float>(i);
-			q = img2.ptr<float>(i);
-			for (int j = 0; j < img1.cols; j++)
-			{
-				//If the pixels are both not black - safegaurd against rows or columns with some black in the middle
-				if (p[j] && q[j])
-				{
-					//Contribute to Pearson correlation coefficient
-					sum_xy += p[i]*q[i];
-					sum_x += p[i];
-					sum_y += q[i];
-					sum_x2 += p[i]*p[i];
-					sum_y2 += q[i]*q[i];
-				}
-			}
-		}
-
-		return (img1.rows*img2.cols*sum_xy - sum_x*sum_y) / (std::sqrt(img1.rows*img2.cols*sum_x2 - sum_x*sum_x) * 
-			std::sqrt(img1.rows*img2.cols*sum_y2 - sum_y*sum_y));
+		cv::Mat no_mask;
+		return (float)pearson_from_moments(mat_moments(img1, img2, no_mask, true));
 	}
 
 	/*Calculate the average feature size in an image by summing the components of its 2D Fourier transform in quadrature to produce a 
@@ -301,21 +217,41 @@ namespace ba
 	float get_avg_feature_size(cv::Mat &img)
 	{
 		//Expand the input image to optimal size
-		cv::Mat padded;
 		int m = cv::getOptimalDFTSize( img.rows );
 		int n = cv::getOptimalDFTSize( img.cols );
-		cv::copyMakeBorder(img, padded, 0, m - img.rows, 0, n - img.cols, cv::BORDER_CONSTANT, cv::Scalar::all(0)); //On the border add zero values
-
-		cv::Mat planes[] = {cv::Mat_<float>(padded), cv::Mat::zeros(padded.size(), CV_32FC1)};
-		cv::Mat complexI;
-		cv::merge(planes, 2, complexI); //Add to the expanded another plane with zeros
-
-		cv::dft(complexI, complexI); //This way the result may fit in the source matrix
+		int half_n = n/2+1;
+
+		//Copy the image into an aligned buffer from the pool. On the border add zero values
+		size_t padded_bytes = (size_t)m*n*sizeof(double);
+		size_t spectrum_bytes = (size_t)m*half_n*sizeof(fftw_complex);
+		double *padded = (double*)fft_buffer_acquire(padded_bytes);
+		fftw_complex *spectrum = (fftw_complex*)fft_buffer_acquire(spectrum_bytes);
+		cv::Mat padded_mat = cv::Mat(m, n, CV_64FC1, padded);
+		padded_mat.setTo(cv::Scalar::all(0));
+		cv::Mat padded_roi = padded_mat(cv::Rect(0, 0, img.cols, img.rows));
+		img.convertTo(padded_roi, CV_64FC1);
+
+		fft_r2c(m, n, padded, spectrum);
+
+	    //Compute the FFT magnitude. The transform of real data is Hermitian, so the half that isn't calculated is mirrored
+		cv::Mat mag = cv::Mat(m, n, CV_32FC1);
+		for (int i = 0; i < m; i++)
+		{
+			float *r = mag.ptr<float>(i);
+			fftw_complex *s = spectrum + i*half_n;
+			fftw_complex *t = spectrum + ((m-i)%m)*half_n;
+			for (int j = 0; j < half_n && j < n; j++)
+			{
+				r[j] = (float)std::sqrt(s[j][0]*s[j][0] + s[j][1]*s[j][1]);
+			}
+			for (int j = half_n; j < n; j++)
+			{
+				r[j] = (float)std::sqrt(t[n-j][0]*t[n-j][0] + t[n-j][1]*t[n-j][1]);
+			}
+		}
 
-	    //Compute the FFT magnitude
-		cv::split(complexI, planes); //planes[0] = Re(DFT(I), planes[1] = Im(DFT(I))
-		cv::magnitude(planes[0], planes[1], planes[0]); //planes[0] = magnitude
-		cv::Mat mag = planes[0];
+		fft_buffer_release(padded, padded_bytes);
+		fft_buffer_release(spectrum, spectrum_bytes);
 
 		//Convert the 2D FFt magnitudes into a 1D frequency spectrum
 		cv::Mat spectrum1D = cv::Mat(1, std::max(img.rows, img.cols), CV_32FC1, cv::Scalar(0.0)); //1D spectrum
@@ -2,6 +2,9 @@
 
 #include <includes.h>
 
+#include <corr_moments.h>
+#include <fft_service.h>
+#include <task_scheduler.h>
 #include "utility.hpp"
 
 namespace ba
@@ -11,22 +14,22 @@ namespace ba
 
 	/*Calculate Pearson normalised product moment correlation coefficient between 2 vectors of floats
 	**Inputs:
-	**vect1: std::vector<float>, One of the datasets to use in the calculation
-	**vect2: std::vector<float>, The other dataset to use in the calculation
-	**NUM_THREADS: const int, The number of threads to use for OpenMP CPU acceleration
+	**vect1: const std::vector<float> &, One of the datasets to use in the calculation
+	**vect2: const std::vector<float> &, The other dataset to use in the calculation
 	**Return:
 	**float, Pearson normalised product moment correlation coefficient between the 2 datasets
 	*/
-	float pearson_corr(std::vector<float> vect1, std::vector<float> vect2, const int NUM_THREADS);
+	float pearson_corr(const std::vector<float> &vect1, const std::vector<float> &vect2);
 
 	/*Calculate weighted 1st order autocorrelation using weighted Pearson normalised product moment correlation coefficient
 	**Inputs:
-	**data: std::vector<float>, One of the datasets to use in the calculation
-	**Errors: std::vector<float>, Errors in dataset elements used in the calculation
+	**data: const std::vector<float> &, One of the datasets to use in the calculation
+	**Errors: const std::vector<float> &, Errors in dataset elements used in the calculation
 	**Return:
-	**float, Measure of the autocorrelation. 2-2*<return value> approximates the Durbin-Watson statistic for large datasets
+	**float, Measure of the autocorrelation. 2-2*<return value> approximates the Durbin-Watson statistic for large datasets. It
+	**is 0 if there are fewer than 2 elements, so there are no lagged pairs
 	*/
-	float weighted_pearson_autocorr(std::vector<float> data, std::vector<float> err, const int NUM_THREADS);
+	float weighted_pearson_autocorr(const std::vector<float> &data, const std::vector<float> &err);
 
 	/*Calculates the factorial of a small integer
 	**Input:
@@ -79,7 +82,8 @@ namespace ba
 	*/
 	cv::Mat autocorrelation(cv::Mat &img);
 
-	/*Calculate Pearson's normalised product moment correlation coefficient between 2 floating point same-size OpenCV mats
+	/*Calculate Pearson's normalised product moment correlation coefficient between 2 floating point same-size OpenCV mats.
+	**Pixels that are black in either mat are not used
 	**img1: cv::Mat &, One of the mats
 	**img2: cv::Mat &, The other mat
 	**Returns,
@@ -173,26 +173,40 @@ namespace ba
 	*/
 	template <typename T, typename S> double pearson_corr(std::vector<S> &vect1, std::vector<T> &vect2)
 	{
-		//Sums for Pearson product moment correlation coefficient
-		double sum_xy = 0.0;
-		double sum_x = 0.0;
-		double sum_y = 0.0;
-		double sum_x2 = 0.0;
-		double sum_y2 = 0.0;
-
-		//Compare the vectors index by index
-        #pragma omp parallel for reduction(sum:sum_xy), reduction(sum:sum_x), reduction(sum:sum_y), reduction(sum:sum_x2), reduction(sum:sum_y2)
-		for (int i = 0; i < vect1.size(); i++)
+		//Reduce blocks of the vectors to centred moments in double precision, then merge them. The inputs can be double, so
+		//they aren't narrowed to use the single precision moment kernels
+		corr_moments m = zero_moments();
+		double x[MOMENTS_BLOCK_SIZE], y[MOMENTS_BLOCK_SIZE];
+		int n = (int)std::min(vect1.size(), vect2.size());
+		for (int b = 0; b < n; b += MOMENTS_BLOCK_SIZE)
 		{
-			sum_xy += vect1[i]*vect2[i];
-			sum_x += vect1[i];
-			sum_y += vect2[i];
-			sum_x2 += vect1[i]*vect1[i];
-			sum_y2 += vect2[i]*vect2[i];
+			int len = std::min(MOMENTS_BLOCK_SIZE, n-b);
+			double mean_x = 0.0, mean_y = 0.0;
+			for (int j = 0; j < len; j++)
+			{
+				x[j] = (double)vect1[b+j];
+				y[j] = (double)vect2[b+j];
+				mean_x += x[j];
+				mean_y += y[j];
+			}
+			mean_x /= len;
+			mean_y /= len;
+
+			//The block is still in the cache for the centred second pass
+			double m2_x = 0.0, m2_y = 0.0, c_xy = 0.0;
+			for (int j = 0; j < len; j++)
+			{
+				double dx = x[j] - mean_x, dy = y[j] - mean_y;
+				m2_x += dx*dx;
+				m2_y += dy*dy;
+				c_xy += dx*dy;
+			}
+
+			corr_moments block = { (double)len, mean_x, mean_y, m2_x, m2_y, c_xy };
+			m = merge_moments(m, block);
 		}
 
-		return (vect1.size()*sum_xy - sum_x*sum_y) / (std::sqrt(vect1.size()*sum_x2 - sum_x*sum_x) * 
-			std::sqrt(vect1.size()*sum_y2 - sum_y*sum_y));
+		return pearson_from_moments(m);
 	}
 
 	/*Convert an OpenCV mat to a 1D vector
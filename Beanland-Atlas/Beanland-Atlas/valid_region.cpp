@@ -0,0 +1,93 @@
+#include <valid_region.h>
+
+namespace ba
+{
+	/*Find the region of an image that is not black padding. Every pixel is visited a constant number of times: the extents of the
+	**non-black pixels are found for each row and column, then the largest rectangle of non-padding pixels is found by sweeping 
+	**down the rows with the histogram stack algorithm. The result can be stored with the image so it doesn't have to be recalculated
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to find the non-padding region of
+	**Returns:
+	**valid_region, Largest rectangle of non-padding pixels and the padding mask
+	*/
+	valid_region get_valid_region(cv::Mat &img)
+	{
+		//First and last non-black pixels in each row. Rows without any are given an empty range
+		std::vector<int> row_first(img.rows), row_last(img.rows);
+		for (int i = 0; i < img.rows; i++)
+		{
+			const float *p = img.ptr<float>(i);
+
+			int j_first = 0;
+			while (j_first < img.cols && !p[j_first])
+			{
+				j_first++;
+			}
+
+			int j_last = img.cols-1;
+			while (j_last > j_first && !p[j_last])
+			{
+				j_last--;
+			}
+
+			row_first[i] = j_first;
+			row_last[i] = j_first < img.cols ? j_last : -1;
+		}
+
+		//First and last non-black pixels in each column, accumulated row by row so that the memory is read contiguously. The loop 
+		//body is branchless so that it is vectorised
+		std::vector<int> col_first(img.cols, img.rows), col_last(img.cols, -1);
+		for (int i = 0; i < img.rows; i++)
+		{
+			const float *p = img.ptr<float>(i);
+			int *first = col_first.data();
+			int *last = col_last.data();
+			for (int j = 0; j < img.cols; j++)
+			{
+				bool non_black = p[j] != 0.0f;
+				first[j] = non_black && first[j] == img.rows ? i : first[j];
+				last[j] = non_black ? i : last[j];
+			}
+		}
+
+		//Pixels are not padding if they are inside the extents of both their row and column. Heights of the columns of consecutive 
+		//non-padding pixels ending on each row are used to find the largest rectangle
+		valid_region region;
+		region.padding = cv::Mat(img.rows, img.cols, CV_8UC1);
+		std::vector<int> heights(img.cols+1, 0); //Extra zero height column flushes the stack at the end of each row
+		std::vector<int> stack;
+		stack.reserve(img.cols+1);
+		int max_area = 0;
+		for (int i = 0; i < img.rows; i++)
+		{
+			uchar *m = region.padding.ptr<uchar>(i);
+			for (int j = 0; j < img.cols; j++)
+			{
+				bool inside = j >= row_first[i] && j <= row_last[i] && i >= col_first[j] && i <= col_last[j];
+				m[j] = inside ? 0 : 1;
+				heights[j] = inside ? heights[j]+1 : 0;
+			}
+
+			//Largest rectangle under the histogram of heights. Each column is pushed and popped once
+			stack.clear();
+			for (int j = 0; j <= img.cols; j++)
+			{
+				while (!stack.empty() && heights[stack.back()] >= heights[j])
+				{
+					int h = heights[stack.back()];
+					stack.pop_back();
+					int left = stack.empty() ? 0 : stack.back()+1;
+					int area = h * (j - left);
+					if (area > max_area)
+					{
+						max_area = area;
+						region.rect = cv::Rect(left, i-h+1, j-left, h);
+					}
+				}
+				stack.push_back(j);
+			}
+		}
+
+		return region;
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <includes.h>
+
+namespace ba
+{
+	//Custom data structure to hold the region of an image that is not black padding. Padding is made up of the black pixels that 
+	//can be reached from an edge of the image along their row or column without crossing a non-black pixel
+	struct valid_region_param {
+		cv::Rect rect; //Largest axis-aligned rectangle that does not contain any padding
+		cv::Mat padding; //8-bit mask that is 1 where pixels are padding and 0 where they are not
+	};
+	typedef valid_region_param valid_region;
+
+	/*Find the region of an image that is not black padding. Every pixel is visited a constant number of times: the extents of the
+	**non-black pixels are found for each row and column, then the largest rectangle of non-padding pixels is found by sweeping 
+	**down the rows with the histogram stack algorithm. The result can be stored with the image so it doesn't have to be recalculated
+	**Inputs:
+	**img: cv::Mat &, 32-bit image to find the non-padding region of
+	**Returns:
+	**valid_region, Largest rectangle of non-padding pixels and the padding mask
+	*/
+	valid_region get_valid_region(cv::Mat &img);
+}
@@ -7,4 +7,5 @@ namespace sym
 	#define M_PI 3.141592654
 	#define R_OK 1
 	#define NUM_THREADS 4
+	#define RECT_TILE_COLS 64
 }
\ No newline at end of file
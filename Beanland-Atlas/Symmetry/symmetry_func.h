@@ -48,4 +48,18 @@ namespace sym
 	*/
 	extern std::array<int, 4> symmetry(cv::Mat img, int opt_r, cv::Mat imgmask, double opt_alpha = 0.5, bool opt_rect = true, int opt_axial = 3, int opt_only = 0,
 		char* opt_outfile = "sym_out", bool opt_log = false, bool opt_trace = false, int opt_trace_greytrans = 0);
+
+	/*
+	**Checks the tiled symmetry transform with rectangular regions against the original per-point computation on a random
+	**image that spans several tiles, including a partial tile, for all object modes and several radii
+	**Required input parameters:-
+	**at_boundary: int &, Output number of the differing points that are next to a tile boundary
+	**max_err: double &, Output largest relative difference between the symmetry scores
+	**Optional input parameters:-
+	**tol: double, Relative tolerance of the symmetry scores [1e-9]
+	**seed: int, Seed of the random image [0]
+	**Returns:
+	**int, Number of points whose scores differ, summed over the radii and object modes
+	*/
+	extern int check_symmetry_transform_rect(int &at_boundary, double &max_err, double tol = 1e-9, int seed = 0);
 }
\ No newline at end of file
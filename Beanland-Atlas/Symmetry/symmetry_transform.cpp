@@ -175,84 +175,96 @@ namespace sym
 	};
 
 	//-----------------------------------------------------------------
-	// Compute symmetry score S and radius R at point (x,y)
+	// Add the negative scalar products of the gradients at the point
+	// pairs (x+dx,y+dy) and (x-dx,y-dy) to the running symmetry of every
+	// pixel x in [lo,hi] of a row. The row pointers point to the rows
+	// y+dy and y-dy of the float gradient images, so that the inner
+	// loops are contiguous and can be vectorised by the compiler
 	// Arguments:
-	//  grad(x|y) = gradient image (input)
-	//  R         = best radius (output)
-	//  S         = score at best radius (output)
+	//  acc       = running symmetry of the row (input and output)
+	//  gx(p|m)   = x-gradient rows y+dy and y-dy (input)
+	//  gy(p|m)   = y-gradient rows y+dy and y-dy (input)
+	//  lo,hi     = range of pixels in the row (input)
+	//  dx,dy     = offset of the point pair (input)
+	//  only      = 1 = only dark object, -1 = only light objects, 0 = all objects (input)
+	//-----------------------------------------------------------------
+	static inline void add_offset(float *acc, const float *gxp, const float *gxm, const float *gyp, const float *gym,
+	  int lo, int hi, int dx, int dy, int only)
+	{
+	  int x;
+	  if (only == 0) {
+		for (x=lo; x<=hi; x++) {
+		  acc[x] -= gxp[x+dx]*gxm[x-dx] + gyp[x+dx]*gym[x-dx];
+		}
+	  }
+	  else {
+		// theta() as a select so that the loop stays branch free
+		const float fdx = (float)(only*dx), fdy = (float)(only*dy);
+		for (x=lo; x<=hi; x++) {
+		  float scalarprod = gxp[x+dx]*gxm[x-dx] + gyp[x+dx]*gym[x-dx];
+		  acc[x] -= (fdx*gxp[x+dx] + fdy*gyp[x+dx] > 0.0f) ? scalarprod : 0.0f;
+		}
+	  }
+	}
+
+	//-----------------------------------------------------------------
+	// Compute symmetry score S and radius R for all points of row y.
+	// Instead of walking the rings of every point separately, each
+	// offset (dx,dy) of a half ring is swept along the whole row, so
+	// that the ring sums of all points in the row are accumulated at
+	// once. The sums are the same as the per point ring walk, but the
+	// gradient reads are contiguous and in float.
+	// Points are only updated while the ring fits inside the image, so
+	// that the radius is limited at the image border as before.
+	// Arguments:
+	//  grad(x|y) = float gradient image (input)
+	//  R         = best radius of each point in the row (output)
+	//  S         = score at best radius of each point in the row (output)
+	//  acc       = scratch buffer with one element per column (input)
 	//  radius    = maximum radius examined (input)
 	//  norm_at_r = precalculated normalisation factors r^alpha (input)
-	//  x,y       = point position (input)
+	//  y         = row position (input)
 	//  only      = 1 = only dark object, -1 = only light objects, 0 = all objects (input)
 	//-----------------------------------------------------------------
-	void s_and_r_at_point(const cv::Mat &gradx, const cv::Mat &grady, int* R, double* S, int radius, const std::vector<double> &norm_at_r, int x, int y, int only=0)
+	static void s_and_r_at_row(const cv::Mat &gradx, const cv::Mat &grady, double* R, double* S, float* acc, int radius,
+	  const std::vector<float> &norm_at_r, int y, int only=0)
 	{
-	  int dx,dy,r,max_radius;
-	  double symmetry, scalarprod;
-	  std::vector<double> weight_at_r(radius+1);
-	  //weight_at_r[0] = 0.0; // not needed
-  
-	  // adjust radius so that it does not extend beyond the image border
-	  max_radius = radius;
-	  if (y < max_radius)
-		max_radius = y;
-	  if (y >= gradx.rows - max_radius)
-		max_radius = gradx.rows - y - 1;
-	  if (x < max_radius)
-		max_radius = x;
-	  if (x >= gradx.cols - max_radius)
-		max_radius = gradx.cols - x - 1;
+	  int x,dx,dy,r,lo,hi,max_radius;
+	  float weight;
+
+	  // points whose window does not fit inside the image get R = S = 0
+	  for (x=0; x<gradx.cols; x++) {
+		acc[x] = 0.0f;
+		R[x] = 0.0;
+		S[x] = 0.0;
+	  }
 
-	  // compute weight in window with radius max_radius
-	  if (max_radius < 1) {
-		*R = 0;
-		*S = 0.0;
-	  } else {
-		symmetry = 0.0;
-		if (only == 0) {
-		  for (r=1; r<=max_radius; r++) {
-			dy = r;
-			for (dx=-r; dx<=r; dx++) {
-			  scalarprod = gradx.at<double>(y+dy,x+dx)*gradx.at<double>(y-dy,x-dx)
-				+ grady.at<double>(y+dy,x+dx)*grady.at<double>(y-dy,x-dx);
-			  symmetry += -scalarprod;
-			}
-			dx = r;
-			for (dy=-r+1; dy<r; dy++) {
-			  scalarprod = gradx.at<double>(y+dy,x+dx)*gradx.at<double>(y-dy,x-dx)
-				+ grady.at<double>(y+dy,x+dx)*grady.at<double>(y-dy,x-dx);
-			  symmetry += -scalarprod;
-			}
-			weight_at_r[r] = symmetry/norm_at_r[r];
-		  }
+	  // adjust radius so that it does not extend beyond the top or bottom border
+	  max_radius = std::min(radius, std::min(y, gradx.rows - y - 1));
+
+	  for (r=1; r<=max_radius; r++) {
+		// only points at least r away from the left and right border
+		lo = r;
+		hi = gradx.cols - r - 1;
+		if (lo > hi) break;
+
+		dy = r;
+		for (dx=-r; dx<=r; dx++) {
+		  add_offset(acc, gradx.ptr<float>(y+dy), gradx.ptr<float>(y-dy),
+			grady.ptr<float>(y+dy), grady.ptr<float>(y-dy), lo, hi, dx, dy, only);
 		}
-		else { // only != 0
-		  for (r=1; r<=max_radius; r++) {
-			dy = r;
-			for (dx=-r; dx<=r; dx++) {
-			  scalarprod = gradx.at<double>(y+dy,x+dx)*gradx.at<double>(y-dy,x-dx)
-				+ grady.at<double>(y+dy,x+dx)*grady.at<double>(y-dy,x-dx);
-			  symmetry += - scalarprod * 
-				theta(only*(dx*gradx.at<double>(y+dy,x+dx) + dy*grady.at<double>(y+dy,x+dx)));
-			}
-			dx = r;
-			for (dy=-r+1; dy<r; dy++) {
-			  scalarprod = gradx.at<double>(y+dy,x+dx)*gradx.at<double>(y-dy,x-dx)
-				+ grady.at<double>(y+dy,x+dx)*grady.at<double>(y-dy,x-dx);
-			  symmetry += - scalarprod * 
-				theta(only*(dx*gradx.at<double>(y+dy,x+dx) + dy*grady.at<double>(y+dy,x+dx)));
-			}
-			weight_at_r[r] = symmetry/norm_at_r[r];
-		  }
+		dx = r;
+		for (dy=-r+1; dy<r; dy++) {
+		  add_offset(acc, gradx.ptr<float>(y+dy), gradx.ptr<float>(y-dy),
+			grady.ptr<float>(y+dy), grady.ptr<float>(y-dy), lo, hi, dx, dy, only);
 		}
 
 		// find radius of maximum symmetry
-		*R = 1;
-		*S = weight_at_r[1];
-		for (r=2; r<=max_radius; r++) {
-		  if (weight_at_r[r] > *S) {
-			*R = r;
-			*S = weight_at_r[r];
+		for (x=lo; x<=hi; x++) {
+		  weight = acc[x]/norm_at_r[r];
+		  if (r == 1 || weight > S[x]) {
+			R[x] = (double)r;
+			S[x] = weight;
 		  }
 		}
 	  }
@@ -297,30 +309,189 @@ namespace sym
 		}   
 	  }
 
+	  // the ring sums are accumulated in float
+	  gradx.convertTo(gradx, CV_32F);
+	  grady.convertTo(grady, CV_32F);
+
 	  // compute symmetry weight
-	  std::vector<double> norm_at_r(radius+1);
-	  norm_at_r[0] = 1.0; // not needed
-	  for (r=1; r<=radius; r++) norm_at_r[r] = pow(r,alpha);
-
-	#if (NUM_THREADS > 1)
-	  #pragma omp parallel num_threads(NUM_THREADS) shared(result, result_r)
-	  #pragma omp for schedule(dynamic)
-	#endif
-	  for (int y=0; y<grey.rows; y++) {
-		for (int x=0; x<grey.cols; x++) {
-		  int R;
-		  double S;
-		  s_and_r_at_point(gradx, grady, &R, &S, radius, norm_at_r, x, y, only);
-		  result.at<double>(y,x) = S;
-		  result_r.at<double>(y,x) = (double)R;
+	  std::vector<float> norm_at_r(radius+1);
+	  norm_at_r[0] = 1.0f; // not needed
+	  for (r=1; r<=radius; r++) norm_at_r[r] = (float)pow(r,alpha);
+
+	  // rows are independent, but rows near the top and bottom border
+	  // are cheaper, so they are handed out dynamically
+	  #pragma omp parallel shared(result, result_r)
+	  {
+		std::vector<float> acc(grey.cols);
+		#pragma omp for schedule(dynamic)
+		for (int y=0; y<grey.rows; y++) {
+		  s_and_r_at_row(gradx, grady, result_r.ptr<double>(y), result.ptr<double>(y), acc.data(), radius, norm_at_r, y, only);
 		}
 	  }
 
 	  return;
 	}
 
+	//-----------------------------------------------------------------
+	// Compute symmetry score S and radius (Rx,Ry) with rectangular regions
+	// for the points x0 <= x < x1 of row y.
+	// The score W(ry,rx) of the rectangle with radius (rx,ry) is the sum
+	// over the rectangle's point pairs, so it follows from its neighbours
+	// with the recursion
+	//   W(ry,rx) = W(ry,rx-1) + W(ry-1,rx) - W(ry-1,rx-1) + corner pairs
+	// which is an O(1) update per rectangle. Only the rows ry-1 and ry of
+	// W are needed at any time, so they are kept for all points of the
+	// tile in a rolling buffer, and each rectangle is updated for all
+	// points of the tile in one contiguous sweep.
+	// Points are only updated while the rectangle fits inside the image,
+	// so that the radius is limited at the image border as before.
+	// Arguments:
+	//  grad(x|y) = gradient image (input)
+	//  Rx        = x-component of best radius of each point in the row (output)
+	//  Ry        = y-component of best radius of each point in the row (output)
+	//  S         = score at best radius of each point in the row (output)
+	//  W         = scratch buffer with 2*(radius+1)*(x1-x0) elements (input)
+	//  radius    = maximum radius examined (input)
+	//  norm_at_r = precalculated normalisation factors r^alpha (input)
+	//  y         = row position (input)
+	//  x0,x1     = range of points in the row (input)
+	//  only      = 1 = only dark object, -1 = only light objects, 0 = all objects (input)
+	//-----------------------------------------------------------------
+	static void s_and_r_at_tile_rect(const cv::Mat &gradx, const cv::Mat &grady, double* Rx, double* Ry, double* S, double* W,
+	  int radius, const std::vector<double> &norm_at_r, int y, int x0, int x1, int only=0)
+	{
+	  int x,rx,ry,lo,hi,max_radius;
+	  const int n = x1 - x0;
+	  double weight;
+	  double *prev, *cur, *tmp;
+
+	  // points whose window does not fit inside the image get R = S = 0
+	  for (x=x0; x<x1; x++) {
+		Rx[x] = 0.0;
+		Ry[x] = 0.0;
+		S[x] = 0.0;
+	  }
+
+	  // adjust radius so that it does not extend beyond the top or bottom border
+	  max_radius = std::min(radius, std::min(y, gradx.rows - y - 1));
+	  if (max_radius < 1) return;
+
+	  // W(ry,rx) of point x is stored at W[rx*n + x-x0], with W(1,0)
+	  // holding the center pair of the first row
+	  prev = W;
+	  cur = W + (radius+1)*n;
+
+	  const double *gx0 = gradx.ptr<double>(y);
+	  const double *gy0 = grady.ptr<double>(y);
+
+	  for (ry=1; ry<=max_radius; ry++) {
+		const double *gxp = gradx.ptr<double>(y+ry);
+		const double *gxm = gradx.ptr<double>(y-ry);
+		const double *gyp = grady.ptr<double>(y+ry);
+		const double *gym = grady.ptr<double>(y-ry);
+
+		for (rx=(ry == 1 ? 0 : 1); rx<=max_radius; rx++) {
+		  // only points at least max(rx,ry) away from the left and right border
+		  lo = std::max(x0, std::max(rx, ry));
+		  hi = std::min(x1 - 1, gradx.cols - std::max(rx, ry) - 1);
+		  double *c = cur + rx*n;
+		  double *cl = rx > 0 ? cur + (rx-1)*n : NULL;
+		  const double *p = prev + rx*n;
+		  const double *pl = rx > 0 ? prev + (rx-1)*n : NULL;
+
+		  if (only == 0) {
+			if (rx == 0) { // center row with ry=1
+			  for (x=lo; x<=hi; x++) {
+				c[x-x0] = - gxp[x]*gxm[x] - gyp[x]*gym[x];
+			  }
+			}
+			else if (ry == 1) {
+			  for (x=lo; x<=hi; x++) {
+				c[x-x0] = cl[x-x0] + ( - gxp[x+rx]*gxm[x-rx] - gyp[x+rx]*gym[x-rx]
+				  - gx0[x+rx]*gx0[x-rx] - gy0[x+rx]*gy0[x-rx]
+				  - gxm[x+rx]*gxp[x-rx] - gym[x+rx]*gyp[x-rx] );
+			  }
+			}
+			// use recursion formula for rest
+			else if (rx == 1) {
+			  for (x=lo; x<=hi; x++) {
+				c[x-x0] = p[x-x0] + ( - gxp[x+rx]*gxm[x-rx] - gyp[x+rx]*gym[x-rx]
+				  - gxp[x]*gxm[x] - gyp[x]*gym[x]
+				  - gxp[x-rx]*gxm[x+rx] - gyp[x-rx]*gym[x+rx] );
+			  }
+			}
+			else {
+			  for (x=lo; x<=hi; x++) {
+				c[x-x0] = cl[x-x0] + ( p[x-x0] - pl[x-x0]
+				  - gxp[x+rx]*gxm[x-rx] - gyp[x+rx]*gym[x-rx]
+				  - gxp[x-rx]*gxm[x+rx] - gyp[x-rx]*gym[x+rx] );
+			  }
+			}
+		  }
+		  else { // only != 0
+			if (rx == 0) { // center row with ry=1
+			  for (x=lo; x<=hi; x++) {
+				c[x-x0] = - theta(only*gyp[x]) *
+				  ( gxp[x]*gxm[x] + gyp[x]*gym[x] );
+			  }
+			}
+			else if (ry == 1) {
+			  for (x=lo; x<=hi; x++) {
+				c[x-x0] = cl[x-x0] + ( - theta(only*(rx*gxp[x+rx] + ry*gyp[x+rx])) *
+				  ( gxp[x+rx]*gxm[x-rx] + gyp[x+rx]*gym[x-rx] )
+				  - theta(only*rx*gx0[x+rx]) *
+				  ( gx0[x+rx]*gx0[x-rx] + gy0[x+rx]*gy0[x-rx] )
+				  - theta(only*(rx*gxm[x+rx] - ry*gym[x+rx])) *
+				  ( gxm[x+rx]*gxp[x-rx] + gym[x+rx]*gyp[x-rx] ) );
+			  }
+			}
+			// use recursion formula for rest
+			else if (rx == 1) {
+			  for (x=lo; x<=hi; x++) {
+				c[x-x0] = p[x-x0] + ( - theta(only*(rx*gxp[x+rx] + ry*gyp[x+rx])) *
+				  ( gxp[x+rx]*gxm[x-rx] + gyp[x+rx]*gym[x-rx] )
+				  - theta(only*ry*gyp[x+rx]) *
+				  ( gxp[x]*gxm[x] + gyp[x]*gym[x] )
+				  - theta(only*(-rx*gxp[x+rx] + ry*gyp[x+rx])) *
+				  ( gxp[x-rx]*gxm[x+rx] + gyp[x-rx]*gym[x+rx] ) );
+			  }
+			}
+			else {
+			  for (x=lo; x<=hi; x++) {
+				c[x-x0] = cl[x-x0] + ( p[x-x0] - pl[x-x0]
+				  - theta(only*(rx*gxp[x+rx] + ry*gyp[x+rx])) *
+				  ( gxp[x+rx]*gxm[x-rx] + gyp[x+rx]*gym[x-rx] )
+				  - theta(only*(-rx*gxp[x+rx] + ry*gyp[x+rx])) *
+				  ( gxp[x-rx]*gxm[x+rx] + gyp[x-rx]*gym[x+rx] ) );
+			  }
+			}
+		  }
+
+		  // find radius of maximum symmetry in the same order as a
+		  // scan over the whole table, so that ties are resolved alike
+		  if (rx > 0) {
+			for (x=lo; x<=hi; x++) {
+			  weight = c[x-x0]/norm_at_r[rx+ry];
+			  if ((ry == 1 && rx == 1) || weight > S[x]) {
+				Rx[x] = (double)rx;
+				Ry[x] = (double)ry;
+				S[x] = weight;
+			  }
+			}
+		  }
+		}
+
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+	  }
+	}
+
 	//-----------------------------------------------------------------
 	// Compute symmetry score S and radius R at point (x,y) with rectangular regions.
+	// This is the original per-point computation of the whole radius table.
+	// It is only kept as the reference that check_symmetry_transform_rect
+	// compares the tiled computation against.
 	// Arguments:
 	//  grad(x|y) = gradient image (input)
 	//  Rx        = x-component of best radius (output)
@@ -331,7 +502,7 @@ namespace sym
 	//  x,y       = point position (input)
 	//  only      = 1 = only dark object, -1 = only light objects, 0 = all objects (input)
 	//-----------------------------------------------------------------
-	void s_and_r_at_point_rect(const cv::Mat &gradx, const cv::Mat &grady, int* Rx, int* Ry, double* S, int radius, const std::vector<double> &norm_at_r, int x, int y, int only=0)
+	static void s_and_r_at_point_rect(const cv::Mat &gradx, const cv::Mat &grady, int* Rx, int* Ry, double* S, int radius, const std::vector<double> &norm_at_r, int x, int y, int only=0)
 	{
 	  int rx,ry,max_radius;
 	  double symmetry;
@@ -505,24 +676,95 @@ namespace sym
 	  norm_at_r[0] = 1.0; // not needed
 	  for (r=1; r<=2*radius; r++) norm_at_r[r] = pow(r,alpha);
 
-	#if (NUM_THREADS > 1)
-	  #pragma omp parallel num_threads(NUM_THREADS) shared(result, result_rx, result_ry)
-	  #pragma omp for schedule(dynamic)
-	#endif
-	  for (int y=0; y<grey.rows; y++) {
-		for (int x=0; x<grey.cols; x++) {
-		  int Rx, Ry;
-		  double S;
-		  s_and_r_at_point_rect(gradx, grady, &Rx, &Ry, &S, radius, norm_at_r, x, y, only);
-		  result.at<double>(y,x) = S;
-		  result_rx.at<double>(y,x) = (double)Rx;
-		  result_ry.at<double>(y,x) = (double)Ry;
+	  // the image is split into tiles of one row and at most RECT_TILE_COLS
+	  // columns, so that the scratch memory per thread is bounded by
+	  // 2*(radius+1)*RECT_TILE_COLS independently of the image size
+	  const int tiles_per_row = (grey.cols + RECT_TILE_COLS - 1) / RECT_TILE_COLS;
+	  const int num_tiles = grey.rows * tiles_per_row;
+
+	  #pragma omp parallel shared(result, result_rx, result_ry)
+	  {
+		std::vector<double> W(2*(radius+1)*RECT_TILE_COLS);
+		#pragma omp for schedule(dynamic)
+		for (int t=0; t<num_tiles; t++) {
+		  int y = t / tiles_per_row;
+		  int x0 = (t % tiles_per_row) * RECT_TILE_COLS;
+		  int x1 = std::min(x0 + RECT_TILE_COLS, grey.cols);
+		  s_and_r_at_tile_rect(gradx, grady, result_rx.ptr<double>(y), result_ry.ptr<double>(y), result.ptr<double>(y),
+			W.data(), radius, norm_at_r, y, x0, x1, only);
 		}
 	  }
 
 	  return;
 	}
 
+	//-----------------------------------------------------------------
+	// Check the tiled symmetry transform with rectangular regions against
+	// the per-point reference on a random image. The image is wider than
+	// several tiles and its width is not a multiple of RECT_TILE_COLS, so
+	// that points next to the tile boundaries and in a partial tile are
+	// compared. All object modes are checked for radii up to more than
+	// half a tile. Returns the number of points whose scores differ,
+	// summed over the radii and object modes. Points whose radii differ
+	// but whose scores agree are ties, which rounding may resolve either
+	// way, so they are not counted.
+	// Arguments:
+	//  at_boundary = number of the differing points next to a tile boundary (output)
+	//  max_err     = largest relative difference of the scores (output)
+	//  tol         = relative tolerance of the scores (input)
+	//  seed        = seed of the random image (input)
+	//-----------------------------------------------------------------
+	int check_symmetry_transform_rect(int &at_boundary, double &max_err, double tol/*=1e-9*/, int seed/*=0*/)
+	{
+	  const int radii[] = {1, 4, RECT_TILE_COLS/2 + 3};
+	  const int onlys[] = {0, 1, -1};
+	  const int max_r = RECT_TILE_COLS/2 + 3;
+	  const double alpha = 0.5;
+	  int mismatches = 0;
+	  at_boundary = 0;
+	  max_err = 0.0;
+
+	  // float pixels, so that the gradients and sums are not exact integers
+	  cv::Mat grey(2*max_r + 11, 3*RECT_TILE_COLS + 17, CV_32F);
+	  cv::RNG rng(seed);
+	  rng.fill(grey, cv::RNG::UNIFORM, 0.0, 255.0);
+
+	  cv::Mat gradx, grady;
+	  cv::Sobel(grey, gradx, CV_64F, 1, 0);
+	  cv::Sobel(grey, grady, CV_64F, 0, 1);
+
+	  for (int i=0; i<3; i++) {
+		int radius = radii[i];
+		std::vector<double> norm_at_r(2*radius+1);
+		norm_at_r[0] = 1.0; // not needed
+		for (int r=1; r<=2*radius; r++) norm_at_r[r] = pow(r,alpha);
+
+		for (int j=0; j<3; j++) {
+		  int only = onlys[j];
+		  cv::Mat result, result_rx, result_ry;
+		  symmetry_transform_rect(grey, result, result_rx, result_ry, radius, alpha, only);
+
+		  for (int y=0; y<grey.rows; y++) {
+			for (int x=0; x<grey.cols; x++) {
+			  int Rx, Ry;
+			  double S;
+			  s_and_r_at_point_rect(gradx, grady, &Rx, &Ry, &S, radius, norm_at_r, x, y, only);
+
+			  double err = fabs(result.at<double>(y,x) - S) / (1.0 + fabs(S));
+			  max_err = std::max(max_err, err);
+			  if (err > tol) {
+				mismatches++;
+				if (x % RECT_TILE_COLS == 0 || x % RECT_TILE_COLS == RECT_TILE_COLS-1)
+				  at_boundary++;
+			  }
+			}
+		  }
+		}
+	  }
+
+	  return mismatches;
+	}
+
 	//-----------------------------------------------------------------
 	// Find candidate symmetry centers in symmetry image as local
 	// maxima of the symmetry score. Returns the number of points found.
@@ -77,6 +77,19 @@ namespace sym
 	//-----------------------------------------------------------------
 	void symmetry_transform_rect(const cv::Mat &grey, cv::Mat &result, cv::Mat &result_rx, cv::Mat &result_ry, int radius, double alpha=0.5, int only=0, GradientNormalization *gradnorm=NULL);
 
+	//-----------------------------------------------------------------
+	// Check the tiled symmetry transform with rectangular regions against
+	// the per-point reference on a random image that spans several tiles,
+	// including a partial tile. Returns the number of points whose scores
+	// differ, summed over several radii and all object modes.
+	// Arguments:
+	//  at_boundary = number of the differing points next to a tile boundary (output)
+	//  max_err     = largest relative difference of the scores (output)
+	//  tol         = relative tolerance of the scores (input)
+	//  seed        = seed of the random image (input)
+	//-----------------------------------------------------------------
+	int check_symmetry_transform_rect(int &at_boundary, double &max_err, double tol=1e-9, int seed=0);
+
 	//-----------------------------------------------------------------
 	// Find candidate symmetry centers in symmetry image as local
 	// maxima of the symmetry score. Returns the number of points found.
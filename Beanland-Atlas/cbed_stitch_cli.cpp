@@ -0,0 +1,313 @@
+/*
+**Command line D-LACBED stitcher for machines without DigitalMicrograph. Stitches a raw or TIFF stack of CBED patterns
+**into a multi-page stack of D-LACBED patterns with all cores, using the same core as the DigitalMicrograph plugin
+**Build with e.g.
+**g++ -O3 -march=native -fopenmp cbed_stitch_cli.cpp cbed_stitch.cpp -o cbed_stitch `pkg-config --cflags --libs opencv`
+*/
+
+#include "cbed_stitch.h"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//Stitching parameters, named as in the D-ED_Process script
+struct stitch_args
+{
+	std::string input, output;
+	long xsize = 0, ysize = 0, zsize = 0; //Dimensions of a raw input stack
+	long nG1 = 0, nG2 = 0, nTilts = -1;
+	long pX = 0, pY = 0, tInc = 0;
+	long g1X = 0, g1Y = 0, g2X = 0, g2Y = 0;
+	long Rr2 = 0, IsizX = 0, IsizY = 0;
+	int threads = 0; //Use all cores by default
+	int bench = 0; //Number of timed repetitions of the stitch
+};
+
+static void usage()
+{
+	std::cerr <<
+		"Usage: cbed_stitch [options] input output\n"
+		"  input and output are 32-bit float stacks. Files ending in .tif or .tiff are multi-page TIFFs, anything else is\n"
+		"  raw little-endian data with x varying fastest, then y, then the pattern index\n"
+		"  --size X Y Z     Dimensions of a raw input stack\n"
+		"  --nG N1 N2       Number of reflections either side of the origin along g1 and g2\n"
+		"  --nTilts N       Beam tilts either side of the centre of the raster. Default: from the stack size\n"
+		"  --p X Y          Position of the central disk at zero tilt\n"
+		"  --tInc T         Distance the disks move between consecutive beam tilts\n"
+		"  --g1 X Y         g1 in pixels\n"
+		"  --g2 X Y         g2 in pixels\n"
+		"  --Rr2 R          Radius of the disks to extract\n"
+		"  --out-size X Y   Size of the D-LACBED patterns. Default: the size of the CBED patterns\n"
+		"  --threads N      Number of threads. Default: all cores\n"
+		"  --bench N        Stitch N times and report the throughput in CBED frames/s\n";
+}
+
+/*
+**Parse the command line
+**argc: int, Number of arguments
+**argv: char **, Arguments
+**args: stitch_args &, Output parameters
+**Returns:
+**bool, True if the command line is valid
+*/
+static bool parse_args(int argc, char **argv, stitch_args &args)
+{
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string opt = argv[i];
+
+		//Number of values each option takes
+		int n = 0;
+		long *dst[3] = { NULL, NULL, NULL };
+		long threads, bench;
+		if (opt == "--size") { n = 3; dst[0] = &args.xsize; dst[1] = &args.ysize; dst[2] = &args.zsize; }
+		else if (opt == "--nG") { n = 2; dst[0] = &args.nG1; dst[1] = &args.nG2; }
+		else if (opt == "--nTilts") { n = 1; dst[0] = &args.nTilts; }
+		else if (opt == "--p") { n = 2; dst[0] = &args.pX; dst[1] = &args.pY; }
+		else if (opt == "--tInc") { n = 1; dst[0] = &args.tInc; }
+		else if (opt == "--g1") { n = 2; dst[0] = &args.g1X; dst[1] = &args.g1Y; }
+		else if (opt == "--g2") { n = 2; dst[0] = &args.g2X; dst[1] = &args.g2Y; }
+		else if (opt == "--Rr2") { n = 1; dst[0] = &args.Rr2; }
+		else if (opt == "--out-size") { n = 2; dst[0] = &args.IsizX; dst[1] = &args.IsizY; }
+		else if (opt == "--threads") { n = 1; dst[0] = &threads; }
+		else if (opt == "--bench") { n = 1; dst[0] = &bench; }
+		else if (opt.compare(0, 2, "--") == 0)
+		{
+			std::cerr << "Unknown option " << opt << std::endl;
+			return false;
+		}
+		else
+		{
+			positional.push_back(opt);
+			continue;
+		}
+
+		if (i + n >= argc)
+		{
+			std::cerr << opt << " needs " << n << " value(s)" << std::endl;
+			return false;
+		}
+		for (int k = 0; k < n; k++)
+		{
+			char *end;
+			*dst[k] = std::strtol(argv[++i], &end, 10);
+			if (*end)
+			{
+				std::cerr << "Invalid value " << argv[i] << " for " << opt << std::endl;
+				return false;
+			}
+		}
+
+		if (opt == "--threads") args.threads = (int)threads;
+		if (opt == "--bench") args.bench = (int)bench;
+	}
+
+	if (positional.size() != 2)
+	{
+		return false;
+	}
+	args.input = positional[0];
+	args.output = positional[1];
+
+	return args.Rr2 > 0;
+}
+
+/*
+**Check if a file is a TIFF from its extension
+**path: const std::string &, File path
+**Returns:
+**bool, True if the file ends in .tif or .tiff
+*/
+static bool is_tiff(const std::string &path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos)
+	{
+		return false;
+	}
+
+	std::string ext = path.substr(dot);
+	for (size_t i = 0; i < ext.size(); i++)
+	{
+		ext[i] = (char)std::tolower(ext[i]);
+	}
+	return ext == ".tif" || ext == ".tiff";
+}
+
+/*
+**Load a stack of CBED patterns into a contiguous buffer
+**args: stitch_args &, Parameters. The dimensions of TIFF stacks are filled in
+**stack: std::vector<float> &, Output stack
+**Returns:
+**bool, True if the stack was loaded
+*/
+static bool load_stack(stitch_args &args, std::vector<float> &stack)
+{
+	if (is_tiff(args.input))
+	{
+		std::vector<cv::Mat> pages;
+		if (!cv::imreadmulti(args.input, pages, cv::IMREAD_ANYDEPTH) || pages.empty())
+		{
+			std::cerr << "Failed to read " << args.input << std::endl;
+			return false;
+		}
+
+		args.xsize = pages[0].cols;
+		args.ysize = pages[0].rows;
+		args.zsize = (long)pages.size();
+		stack.resize((size_t)args.xsize*args.ysize*args.zsize);
+
+		for (long pt = 0; pt < args.zsize; pt++)
+		{
+			if (pages[pt].cols != args.xsize || pages[pt].rows != args.ysize || pages[pt].channels() != 1)
+			{
+				std::cerr << "Page " << pt << " of " << args.input << " has a different size" << std::endl;
+				return false;
+			}
+
+			//Write the page straight into the stack, converting it to 32-bit if necessary
+			cv::Mat dst(args.ysize, args.xsize, CV_32FC1, &stack[(size_t)pt*args.xsize*args.ysize]);
+			pages[pt].convertTo(dst, CV_32FC1);
+		}
+
+		return true;
+	}
+
+	if (args.xsize <= 0 || args.ysize <= 0 || args.zsize <= 0)
+	{
+		std::cerr << "Raw stacks need their --size" << std::endl;
+		return false;
+	}
+
+	stack.resize((size_t)args.xsize*args.ysize*args.zsize);
+	std::ifstream in(args.input.c_str(), std::ios::binary);
+	in.read(reinterpret_cast<char*>(stack.data()), stack.size()*sizeof(float));
+	if (!in)
+	{
+		std::cerr << "Failed to read " << stack.size()*sizeof(float) << " bytes from " << args.input << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+**Save a stack of D-LACBED patterns
+**args: const stitch_args &, Parameters
+**patterns: std::vector<float> &, Contiguous patterns
+**Returns:
+**bool, True if the stack was saved
+*/
+static bool save_stack(const stitch_args &args, std::vector<float> &patterns)
+{
+	const size_t pattern_area = (size_t)args.IsizX*args.IsizY;
+	const long montage_size = (long)(patterns.size() / pattern_area);
+
+	if (is_tiff(args.output))
+	{
+		std::vector<cv::Mat> pages(montage_size);
+		for (long g = 0; g < montage_size; g++)
+		{
+			pages[g] = cv::Mat(args.IsizY, args.IsizX, CV_32FC1, &patterns[g*pattern_area]);
+		}
+
+		if (!cv::imwrite(args.output, pages))
+		{
+			std::cerr << "Failed to write " << args.output << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	std::ofstream out(args.output.c_str(), std::ios::binary);
+	out.write(reinterpret_cast<const char*>(patterns.data()), patterns.size()*sizeof(float));
+	if (!out)
+	{
+		std::cerr << "Failed to write " << args.output << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	stitch_args args;
+	if (!parse_args(argc, argv, args))
+	{
+		usage();
+		return EXIT_FAILURE;
+	}
+
+#ifdef _OPENMP
+	if (args.threads > 0)
+	{
+		omp_set_num_threads(args.threads);
+	}
+#endif
+
+	std::vector<float> stack;
+	if (!load_stack(args, stack))
+	{
+		return EXIT_FAILURE;
+	}
+
+	//The beam tilts form a square raster, as in the D-ED_Process script
+	if (args.nTilts < 0)
+	{
+		long side = (long)std::floor(std::sqrt((double)args.zsize) + 0.5);
+		if (side*side != args.zsize || !(side % 2))
+		{
+			std::cerr << args.zsize << " patterns is not an odd square raster of beam tilts. Set --nTilts" << std::endl;
+			return EXIT_FAILURE;
+		}
+		args.nTilts = (side-1)/2;
+	}
+
+	if (!args.IsizX || !args.IsizY)
+	{
+		args.IsizX = args.xsize;
+		args.IsizY = args.ysize;
+	}
+
+	std::vector<float> patterns((size_t)(2*args.nG1+1)*(2*args.nG2+1)*args.IsizX*args.IsizY);
+
+	//Time all repetitions, including the first, which warms the caches and thread pool
+	const int reps = args.bench > 0 ? args.bench : 1;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int r = 0; r < reps; r++)
+	{
+		stitch_cbed_stack( stack.data(), args.xsize, args.ysize, args.zsize, patterns.data(), args.nG1, args.nG2,
+			args.nTilts, args.pX, args.pY, args.tInc, args.g1X, args.g1Y, args.g2X, args.g2Y, args.Rr2, args.IsizX,
+			args.IsizY );
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (args.bench > 0)
+	{
+		int threads = 1;
+#ifdef _OPENMP
+		threads = omp_get_max_threads();
+#endif
+		std::cout << reps << " x " << args.zsize << " frames of " << args.xsize << " x " << args.ysize << " into " <<
+			(2*args.nG1+1)*(2*args.nG2+1) << " patterns on " << threads << " thread(s): " << seconds/reps << " s per stack, "
+			<< reps*args.zsize/seconds << " frames/s" << std::endl;
+	}
+
+	return save_stack(args, patterns) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,155 @@
+#include "cbed_stitch.h"
+
+#include <algorithm>
+#include <vector>
+
+/*
+**Get the coordinates of the disk at the current point. The beam tilts are collected in a boustrophedon raster
+**nTilts: const long, Number of beam tilts either side of the centre of each row and column of the raster
+**pt: const long, Index of the CBED pattern in the stack
+**x: long &, Output tilt index across the raster
+**y: long &, Output tilt index down the raster
+*/
+void getCoordsFromNTilts(const long nTilts, const long pt, long &x, long &y)
+{
+	long side = 2*nTilts+1;
+
+	y = pt/side-nTilts;
+	x = ((pt % side)-nTilts)*(y % 2 ? -1 : 1); //Flip sign every row
+}
+
+/*
+**Half-widths of the rows of a disk of pixels within Rr2 of its centre, so that the disk can be traversed as one span
+**per row without testing each pixel
+**Rr2: const long, Radius of the disk
+**halfWidths: std::vector<long> &, Output half-width of each of the 2*Rr2 rows, from the top. Empty rows have -1
+*/
+static void diskHalfWidths(const long Rr2, std::vector<long> &halfWidths)
+{
+	halfWidths.resize(2*Rr2);
+
+	//Rows are symmetric about the centre, so the half-width shrinks monotonically from the middle outwards
+	long a = Rr2;
+	for (long dy = 0; dy <= Rr2; dy++)
+	{
+		while (a >= 0 && a*a + dy*dy >= Rr2*Rr2)
+		{
+			a--;
+		}
+
+		halfWidths[Rr2-dy] = a;
+		if (dy < Rr2)
+		{
+			halfWidths[Rr2+dy] = a;
+		}
+	}
+}
+
+/*
+**Extract disks from CBED patterns to create full LACBED patterns. The stack is read once: each CBED pattern in turn has
+**the disk of every reflection scattered into that reflection's pattern. Reflections are shared between threads, so each
+**output pattern is only ever written by one thread
+**stack: const float *, Contiguous CBED patterns, each xsize x ysize with x varying fastest
+**xsize: const long, Width of the CBED patterns
+**ysize: const long, Height of the CBED patterns
+**zsize: const long, Number of CBED patterns in the stack
+**patterns: float *, Output (2nG1+1)(2nG2+1) contiguous IsizX x IsizY D-LACBED patterns, ordered by g1 index then g2 index
+**nG1: const long, Number of reflections either side of the origin along g1
+**nG2: const long, Number of reflections either side of the origin along g2
+**nTilts: const long, Number of beam tilts either side of the centre of each row and column of the raster
+**pX: const long, Column of the central disk at zero tilt
+**pY: const long, Row of the central disk at zero tilt
+**tInc: const long, Distance in pixels that the disks move between consecutive beam tilts
+**g1X: const long, Column component of g1, in pixels
+**g1Y: const long, Row component of g1, in pixels
+**g2X: const long, Column component of g2, in pixels
+**g2Y: const long, Row component of g2, in pixels
+**Rr2: const long, Radius of the disks to extract
+**IsizX: const long, Width of the D-LACBED patterns
+**IsizY: const long, Height of the D-LACBED patterns
+*/
+void stitch_cbed_stack( const float *stack, const long xsize, const long ysize, const long zsize, float *patterns,
+					   const long nG1, const long nG2, const long nTilts, const long pX, const long pY, const long tInc,
+					   const long g1X, const long g1Y, const long g2X, const long g2Y, const long Rr2, const long IsizX,
+					   const long IsizY )
+{
+	const long montage_size = (2*nG1+1)*(2*nG2+1);
+	const size_t cbed_area = (size_t)xsize*ysize;
+	const size_t pattern_area = (size_t)IsizX*IsizY;
+
+	//Displacement of each reflection's disk from the central disk
+	std::vector<long> gX(montage_size), gY(montage_size);
+	for (long i = -nG1, g = 0; i <= nG1; i++)
+	{
+		for (long j = -nG2; j <= nG2; j++, g++)
+		{
+			gX[g] = i*g1X + j*g2X;
+			gY[g] = i*g1Y + j*g2Y;
+		}
+	}
+
+	//Disks are only extracted if they are fully inside both the CBED pattern and the D-LACBED pattern
+	const long limX = std::min(xsize, IsizX);
+	const long limY = std::min(ysize, IsizY);
+
+	std::vector<long> halfWidths;
+	diskHalfWidths(Rr2, halfWidths);
+
+	//Number of contributions to each pixel of each pattern
+	std::fill(patterns, patterns + montage_size*pattern_area, 0.0f);
+	std::vector<float> contributions(montage_size*pattern_area, 0.0f);
+
+	#pragma omp parallel
+	{
+		//Loop over the CBED stack once. Static scheduling gives every thread the same reflections for every pattern, so the
+		//threads don't have to wait for each other between patterns
+		for (long pt = 0; pt < zsize; pt++)
+		{
+			//Get the coordinates of the point
+			long x, y;
+			getCoordsFromNTilts(nTilts, pt, x, y);
+
+			const float *frame = stack + pt*cbed_area;
+
+			#pragma omp for schedule(static) nowait
+			for (long g = 0; g < montage_size; g++)
+			{
+				long X = pX + x*tInc + gX[g];
+				long Y = pY + y*tInc + gY[g];
+
+				//Check that the disk is fully inside the image
+				if (X-Rr2 < 0 || X+Rr2 > limX || Y-Rr2 < 0 || Y+Rr2 > limY)
+				{
+					continue;
+				}
+
+				//Add the disk to the pattern and increment the contribution counters for the pixels it contributes to
+				float *pattern = patterns + g*pattern_area;
+				float *counts = &contributions[g*pattern_area];
+				for (long dy = -Rr2; dy < Rr2; dy++)
+				{
+					const long a = halfWidths[dy+Rr2];
+					const float *src = frame + (Y+dy)*xsize + X;
+					float *dst = pattern + (Y+dy)*IsizX + X;
+					float *cnt = counts + (Y+dy)*IsizX + X;
+					for (long dx = -a; dx <= a; dx++)
+					{
+						dst[dx] += src[dx];
+						cnt[dx] += 1.0f;
+					}
+				}
+			}
+		}
+	}
+
+	//Divide D-LACBED patterns by their contributions
+	const long num_px = (long)(montage_size*pattern_area);
+	#pragma omp parallel for
+	for (long k = 0; k < num_px; k++)
+	{
+		if (contributions[k])
+		{
+			patterns[k] /= contributions[k];
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+**Stitching of D-LACBED patterns from a stack of CBED patterns, independent of DigitalMicrograph so that it can be
+**built and benchmarked anywhere
+*/
+
+/*
+**Get the coordinates of the disk at the current point. The beam tilts are collected in a boustrophedon raster
+**nTilts: const long, Number of beam tilts either side of the centre of each row and column of the raster
+**pt: const long, Index of the CBED pattern in the stack
+**x: long &, Output tilt index across the raster
+**y: long &, Output tilt index down the raster
+*/
+void getCoordsFromNTilts(const long nTilts, const long pt, long &x, long &y);
+
+/*
+**Extract disks from CBED patterns to create full LACBED patterns. The stack is read once: each CBED pattern in turn has
+**the disk of every reflection scattered into that reflection's pattern. Reflections are shared between threads, so each
+**output pattern is only ever written by one thread
+**stack: const float *, Contiguous CBED patterns, each xsize x ysize with x varying fastest
+**xsize: const long, Width of the CBED patterns
+**ysize: const long, Height of the CBED patterns
+**zsize: const long, Number of CBED patterns in the stack
+**patterns: float *, Output (2nG1+1)(2nG2+1) contiguous IsizX x IsizY D-LACBED patterns, ordered by g1 index then g2 index
+**nG1: const long, Number of reflections either side of the origin along g1
+**nG2: const long, Number of reflections either side of the origin along g2
+**nTilts: const long, Number of beam tilts either side of the centre of each row and column of the raster
+**pX: const long, Column of the central disk at zero tilt
+**pY: const long, Row of the central disk at zero tilt
+**tInc: const long, Distance in pixels that the disks move between consecutive beam tilts
+**g1X: const long, Column component of g1, in pixels
+**g1Y: const long, Row component of g1, in pixels
+**g2X: const long, Column component of g2, in pixels
+**g2Y: const long, Row component of g2, in pixels
+**Rr2: const long, Radius of the disks to extract
+**IsizX: const long, Width of the D-LACBED patterns
+**IsizY: const long, Height of the D-LACBED patterns
+*/
+void stitch_cbed_stack( const float *stack, const long xsize, const long ysize, const long zsize, float *patterns,
+					   const long nG1, const long nG2, const long nTilts, const long pX, const long pY, const long tInc,
+					   const long g1X, const long g1Y, const long g2X, const long g2Y, const long Rr2, const long IsizX,
+					   const long IsizY );
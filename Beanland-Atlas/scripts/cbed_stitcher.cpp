@@ -11,7 +11,7 @@ using namespace Gatan;
 #include <cassert>
 #include <string>
 
-void getCoordsFromNTilts(const ulong &nTilts, const ulong &pt, ulong &x, ulong &y);
+#include "cbed_stitch.h"
 
 class SampleImageProcessingPlugIn : public Gatan::PlugIn::PlugInMain
 {
@@ -21,17 +21,6 @@ class SampleImageProcessingPlugIn : public Gatan::PlugIn::PlugInMain
 	virtual void End();
 };
 
-/*
-**Get the coordinates of the disk at the current point
-*/
-void getCoordsFromNTilts(const ulong &nTilts, const ulong &pt, ulong &x, ulong &y)
-{
-	ulong side = 2*nTilts+1;
-
-	y = (ulong)std::floor((float)(pt/side))-nTilts;
-	x = ((pt % side)-nTilts)*(y % 2 ? -1 : 1); //Flip sign every row
-}
-
 /*
 **Extract disks from CBED patterns to create full LACBED patterns
 */
@@ -39,94 +28,32 @@ void cbed_stitcher( const DM::Image &stack, DM::Image &patterns_out, long &nG1,
 				   ulong &nTilts, ulong &pX, ulong &pY, ulong &tInc, ulong &g1X, ulong &g1Y, 
 				   ulong &g2X, ulong &g2Y, ulong &Rr2, ulong &IsizX, ulong &IsizY )
 {
-	//Dimensions and area of CBED images
+	//Dimensions of CBED images
 	ulong xsize = stack.GetDimensionSize( 0 );
 	ulong ysize = stack.GetDimensionSize( 1 );
 	ulong zsize = stack.GetDimensionSize( 2 );
 
-	ulong cbed_area = xsize*ysize;
-	ulong pattern_area = IsizX*IsizY;
 	ulong montage_size = (2*nG1+1)*(2*nG2+1);
 
-	DM::Image patterns = DM::RealImage( "Contributions", 4, IsizX, IsizY, montage_size ); //Count number of contributions to each pixel
-	DM::Image contributions = DM::RealImage( "D-LACBED Stack", 4, IsizX, IsizY);
+	DM::Image patterns = DM::RealImage( "D-LACBED Stack", 4, IsizX, IsizY, montage_size );
 
 	//Lock data down so that it can be accessed from C++
 	PlugIn::ImageDataLocker stack_l( stack, PlugIn::ImageDataLocker::lock_data_CONTIGUOUS );
 	PlugIn::ImageDataLocker patterns_l( patterns, PlugIn::ImageDataLocker::lock_data_CONTIGUOUS );
-	PlugIn::ImageDataLocker contributions_l( contributions, PlugIn::ImageDataLocker::lock_data_CONTIGUOUS );
 
 	//Make sure images have the expected data type
 	assert( stack_l.get_image_data().get_data_type() == REAL4_DATA );
 	assert( patterns_l.get_image_data().get_data_type() == REAL4_DATA );
-	assert( contributions_l.get_image_data().get_data_type() == REAL4_DATA );
 
 	// Get pointers to the data
-	float32 *stack_data         = reinterpret_cast<float32 *>( stack_l.get_image_data().get_data() );
-	float32 *patterns_data      = reinterpret_cast<float32 *>( patterns_l.get_image_data().get_data() );
-	float32 *contributions_data = reinterpret_cast<float32 *>( contributions_l.get_image_data().get_data() );
-
-	{
-		//Loop over the LACBED stack to build the patterns
-		float32 *cbed_rollback = &stack_data[0];
-		for(long i = -nG1; i <= nG1; i++)
-		{
-			for(long j = -nG2; j <= nG2; j++)
-			{
-				//Loop over CBED stacks
-				for(ulong pt = 0; pt < zsize; pt++)
-				{
-					//Get the coordinates of the point
-					ulong x, y;
-					getCoordsFromNTilts(nTilts, pt, x, y);
-
-					ulong X = (ulong)std::round((float)(pX+x*tInc+(i*g1X)+(j*g2X)));
-					ulong Y = (ulong)std::round((float)(pY+y*tInc+(i*g1Y)+(j*g2Y)));
-
-					//Check that the disk is fully inside the image
-					if( !((X<Rr2) && (X+Rr2>IsizX) && (Y<Rr2) && (Y+Rr2>IsizY)) )
-					{
-						//Extract and add the disk to the patterns and increment the contribution counters
-						//for pixels that it contributes to
-						for(ulong itery = 0, k = 0; itery < ysize; itery++)
-						{
-							for(ulong iterx = 0; iterx < xsize; iterx++, k++)
-							{
-								//Extract the points in the disk
-								if((ulong)std::sqrt((float)(iterx*iterx + itery*itery)) < Rr2)
-								{
-									patterns_data[k] += stack_data[k];
-									contributions_data[k]++;
-								}
-							}
-						}
-					}
-
-					stack_data += cbed_area;
-				}
-
-				//Divide D-LACBED pattern by contributions
-				for(ulong itery = 0, k = 0; itery < ysize; itery++)
-				{
-					for(ulong iterx = 0; iterx < xsize; iterx++, k++)
-					{
-						//If the pixel has been contributed to
-						if(contributions_data[k])
-						{
-							patterns_data[k] /= contributions_data[k];
-							contributions_data[k] = 0; //Reset for next iteration (trading more processing for RAM)
-						}
-					}
-				}
-
-				stack_data = cbed_rollback; //Back to start of stack
-				patterns_data += pattern_area; //Go to next D-LACBED pattern
-			}
-		}
-
-		patterns_l.MarkDataChanged();
-		contributions_l.MarkDataChanged(); //Not sure if this line is necessary to free the memory or not
-	}
+	const float32 *stack_data = reinterpret_cast<const float32 *>( stack_l.get_image_data().get_data() );
+	float32 *patterns_data    = reinterpret_cast<float32 *>( patterns_l.get_image_data().get_data() );
+
+	//Script numbers arrive unsigned, but tilt coordinates and g-vector components can be negative
+	stitch_cbed_stack( stack_data, (long)xsize, (long)ysize, (long)zsize, patterns_data, nG1, nG2, (long)nTilts,
+		(long)pX, (long)pY, (long)tInc, (long)g1X, (long)g1Y, (long)g2X, (long)g2Y, (long)Rr2, (long)IsizX, (long)IsizY );
+
+	patterns_l.MarkDataChanged();
 
 	patterns_out = patterns;
 }